@@ -23,6 +23,7 @@
  */
 
 #include "arch.h"
+#include "os_lib.h"
 #include "os_task.h"
 
 #if ((defined(__CC_ARM) && defined(__TARGET_FPU_VFP))                         \
@@ -34,6 +35,10 @@
 #define ARCH_FPU_USED   0
 #endif
 
+#if (CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY > 0xFF)
+    #error "CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY should be in NVIC priority register format"
+#endif
+
 /* Constants required to set up the initial stack. */
 #define THUMB_CODE_BIT              ( 0x01 << 24 )
 #define ARCH_XPSR_INIT              THUMB_CODE_BIT
@@ -65,6 +70,10 @@
 #define ARCH_SYSTICK_CLK_SRC        (0x01 << 2)
 #define ARCH_SYSTICK_INT            (0x01 << 1)
 #define ARCH_SYSTICK_EN             (0x01 << 0)
+#define ARCH_SYSTICK_COUNT_FLAG     (0x01UL << 16)
+
+#define ARCH_SYSTICK_MAX_RELOAD     (0x00FFFFFFUL)
+#define ARCH_SYSTICK_TICK_CYCLES    (CONFIG_SYS_CLOCK_RATE / CONFIG_SYS_TICK_RATE_HZ)
 
 #define ARCH_COPROCESSOR_ACCESS_CTL 0xE000ED88
 
@@ -72,10 +81,23 @@
 #define ARCH_FPU_ASPEN              (0x01UL << 31)
 #define ARCH_FPU_LSPEN              (0x01UL << 30)
 
+/* DWT cycle counter for the run time stats */
+#define ARCH_DEBUG_EXC_MON_CTL      0xE000EDFC
+#define ARCH_DEBUG_TRCENA           (0x01UL << 24)
+#define ARCH_DWT_CTL                0xE0001000
+#define ARCH_DWT_CYCCNTENA          (0x01UL << 0)
+#define ARCH_DWT_CYCCNT             0xE0001004
+
 #define ARCH_NVIC_INT_CTL           0xE000ED04
 #define ARCH_PENDSV_SET             (0x01UL << 28)
+#define ARCH_PENDST_SET             (0x01UL << 26)
+#define ARCH_PENDST_CLR             (0x01UL << 25)
 #define ARCH_ISR_ACTIVE_MASK        (0xFFUL)
 
+#define ARCH_VECTOR_TABLE_OFFSET    0xE000ED08
+/* Bytes kept below the stack pointer when filling the MSP stack */
+#define ARCH_ISR_STACK_FILL_GAP     64
+
 /* Note: Do not modify this struct sequence, this definiation is sort by hardware arch */
 typedef struct _TaskContext {
     OS_Uint32_t R4;
@@ -107,6 +129,14 @@ static void TaskExitErrorEntry( void )
     while(1);
 }
 
+/* The task function returned, delete the task, only back here with error */
+static void ArchTaskReturn(void)
+{
+    OS_API_TaskExit();
+
+    TaskExitErrorEntry();
+}
+
 void *ARCH_PrepareStack(void *StartOfStack, void *Param)
 {
     TaskContext *taskContext = OS_NULL;
@@ -141,7 +171,7 @@ void *ARCH_PrepareStack(void *StartOfStack, void *Param)
     taskContext->excReturn = ARCH_EXEC_RETURN;
 #endif
     taskContext->R0  = (OS_Uint32_t)TaskParam->PrivateData;
-    taskContext->LR  = (OS_Uint32_t)TaskExitErrorEntry;
+    taskContext->LR  = (OS_Uint32_t)ArchTaskReturn;
     taskContext->PC  = (OS_Uint32_t)TaskParam->TaskEntry;
     taskContext->xPSR = ARCH_XPSR_INIT;
     taskContext->R4 =  0x44444444;
@@ -149,6 +179,28 @@ void *ARCH_PrepareStack(void *StartOfStack, void *Param)
     return (void *)taskContext;
 }
 
+#if CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY
+
+static __inline void ArchSetBasePriority(OS_Uint32_t BasePriority)
+{
+    register OS_Uint32_t RegBasePriority __asm("basepri");
+    RegBasePriority = BasePriority;
+}
+
+void ARCH_InterruptDisable(void)
+{
+    ArchSetBasePriority(CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY);
+    __dsb(0);
+    __isb(0);
+}
+
+void ARCH_InterruptEnable(void)
+{
+    ArchSetBasePriority(0);
+}
+
+#else
+
 void ARCH_InterruptDisable(void)
 {
     __disable_irq();
@@ -159,6 +211,8 @@ void ARCH_InterruptEnable(void)
     __enable_irq();
 }
 
+#endif // CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY
+
 void ARCH_InterruptInit(void)
 {
     OS_REG8(ARCH_PENDSV_PRIO_REG) = ARCH_PENDSV_PRIORITY;
@@ -172,6 +226,85 @@ void ARCH_SystemTickInit(void)
     OS_REG32(ARCH_SYSTICK_CTL) |= (ARCH_SYSTICK_CLK_SRC | ARCH_SYSTICK_INT | ARCH_SYSTICK_EN);
 }
 
+/*
+ * Called with interrupt disabled, WFI still wakes up on a pending interrupt.
+ * SysTick is reloaded to expire at the end of ExpectedIdleTicks, when the
+ * wakeup comes from other interrupt the whole ticks passed are calculated
+ * from the counter and SysTick is set to finish the current tick period.
+ */
+OS_Uint32_t ARCH_TicklessIdle(OS_Uint32_t ExpectedIdleTicks)
+{
+    OS_Uint32_t MaxIdleTicks = ARCH_SYSTICK_MAX_RELOAD / ARCH_SYSTICK_TICK_CYCLES;
+    OS_Uint32_t Current = 0;
+    OS_Uint32_t Reload = 0;
+    OS_Uint32_t Ctl = 0;
+    OS_Uint32_t ElapsedCycles = 0;
+    OS_Uint32_t ElapsedTicks = 0;
+
+    if (ExpectedIdleTicks > MaxIdleTicks)
+        ExpectedIdleTicks = MaxIdleTicks;
+
+    /* Stop SysTick, the cycles left in current tick period are kept */
+    OS_REG32(ARCH_SYSTICK_CTL) &= (~ARCH_SYSTICK_EN);
+
+    /* A tick is pending already, let the tick handler take it */
+    if (OS_REG32(ARCH_NVIC_INT_CTL) & ARCH_PENDST_SET)
+    {
+        OS_REG32(ARCH_SYSTICK_CTL) |= ARCH_SYSTICK_EN;
+        return 0;
+    }
+
+    Current = OS_REG32(ARCH_SYSTICK_CURRENT);
+    Reload = Current + (ARCH_SYSTICK_TICK_CYCLES * (ExpectedIdleTicks - 1));
+
+    OS_REG32(ARCH_SYSTICK_RELOAD) = Reload;
+    OS_REG32(ARCH_SYSTICK_CURRENT) = 0;
+    OS_REG32(ARCH_SYSTICK_CTL) |= ARCH_SYSTICK_EN;
+
+#if CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY
+    /* WFI is not woken up by the interrupts masked by BASEPRI, use PRIMASK */
+    __disable_irq();
+    ArchSetBasePriority(0);
+#endif
+    __dsb(0);
+    __wfi();
+    __isb(0);
+#if CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY
+    ArchSetBasePriority(CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY);
+    __enable_irq();
+#endif
+
+    /* Reading CTL clears COUNTFLAG, read it once and keep the flag */
+    Ctl = OS_REG32(ARCH_SYSTICK_CTL);
+    OS_REG32(ARCH_SYSTICK_CTL) = Ctl & (~ARCH_SYSTICK_EN);
+
+    if (Ctl & ARCH_SYSTICK_COUNT_FLAG)
+    {
+        /* SysTick woke us up, the tick interrupt is counted by return value */
+        OS_REG32(ARCH_NVIC_INT_CTL) = ARCH_PENDST_CLR;
+        ElapsedTicks = ExpectedIdleTicks;
+        OS_REG32(ARCH_SYSTICK_RELOAD) = ARCH_SYSTICK_TICK_CYCLES - 1;
+    }
+    else
+    {
+        /*
+         * Other interrupt woke us up, the counter counts down to 0 from
+         * TICK_CYCLES - 1 in a tick period, and from Reload in the idle
+         */
+        ElapsedCycles = (ARCH_SYSTICK_TICK_CYCLES - 1 - Current) + (Reload - OS_REG32(ARCH_SYSTICK_CURRENT));
+        ElapsedTicks = ElapsedCycles / ARCH_SYSTICK_TICK_CYCLES;
+        /* Finish the current tick period first */
+        OS_REG32(ARCH_SYSTICK_RELOAD) = ARCH_SYSTICK_TICK_CYCLES - (ElapsedCycles % ARCH_SYSTICK_TICK_CYCLES) - 1;
+    }
+
+    OS_REG32(ARCH_SYSTICK_CURRENT) = 0;
+    OS_REG32(ARCH_SYSTICK_CTL) |= ARCH_SYSTICK_EN;
+    /* Takes effect from the next reload */
+    OS_REG32(ARCH_SYSTICK_RELOAD) = ARCH_SYSTICK_TICK_CYCLES - 1;
+
+    return ElapsedTicks;
+}
+
 OS_Uint8_t ARCH_IsInterruptContext(void)
 {
     return ( (OS_Uint8_t)(OS_REG32(ARCH_NVIC_INT_CTL) & ARCH_ISR_ACTIVE_MASK) );
@@ -179,12 +312,54 @@ OS_Uint8_t ARCH_IsInterruptContext(void)
 
 void ARCH_MiscInit(void)
 {
+    OS_Uint32_t StackSize = 0;
+    OS_Uint8_t *StackBase = (OS_Uint8_t *)ARCH_IsrStackRegion(&StackSize);
+    /* Still on the MSP stack here, the frames above this one are in use */
+    OS_Uint8_t *StackPointer = (OS_Uint8_t *)&StackSize;
+
 #if ARCH_FPU_USED
     /* Set CP10 and CP11 full access */
     OS_REG32(ARCH_COPROCESSOR_ACCESS_CTL) |= ((3UL << 10*2) | (3UL << 11*2));
     /* Enable the FPU lazy stacking feature to optimise the RTOS performance */
     OS_REG32(ARCH_FPU_CONTEX_CTL) |= (ARCH_FPU_ASPEN | ARCH_FPU_LSPEN);
 #endif
+
+#if CONFIG_USE_RUN_TIME_STATS || CONFIG_USE_LATENCY_STATS
+    /* Start the cycle counter for run time and latency stats */
+    OS_REG32(ARCH_DEBUG_EXC_MON_CTL) |= ARCH_DEBUG_TRCENA;
+    OS_REG32(ARCH_DWT_CYCCNT) = 0;
+    OS_REG32(ARCH_DWT_CTL) |= ARCH_DWT_CYCCNTENA;
+#endif
+
+    /* Fill the unused MSP stack for the high water scan */
+    if (StackPointer - StackBase > ARCH_ISR_STACK_FILL_GAP)
+        OS_Memset(StackBase, OS_TASK_MAGIC_NUMBER, StackPointer - StackBase - ARCH_ISR_STACK_FILL_GAP);
+}
+
+OS_Uint32_t ARCH_RunTimeCounterGet(void)
+{
+    return OS_REG32(ARCH_DWT_CYCCNT);
+}
+
+/* The context is in the stack the kernel allocated, nothing to free */
+void ARCH_ReleaseStack(void *Stack, void *StartOfStack)
+{
+}
+
+/* Tasks run on the stack the kernel allocated, StackSize is right already */
+void *ARCH_TaskStackRegion(void *Stack, void *StartOfStack, OS_Uint32_t *StackSize)
+{
+    return StartOfStack;
+}
+
+void *ARCH_IsrStackRegion(OS_Uint32_t *StackSize)
+{
+    /* The first element of the interrupt vector is the top of MSP stack */
+    OS_Uint32_t TopOfStack = OS_REG32(OS_REG32(ARCH_VECTOR_TABLE_OFFSET));
+
+    *StackSize = ARCH_ISR_STACK_SIZE;
+
+    return (void *)(TopOfStack - ARCH_ISR_STACK_SIZE);
 }
 
 void ARCH_TriggerContextSwitch(void *_CurrentTCB, void *_NextTCB)
@@ -205,7 +380,14 @@ __asm void ARCH_PendSVHandler(void)
     PRESERVE8
 
     /* Disable all interrupt to protect this function */
+#if CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY
+    MOV     R0, #CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY
+    MSR     BASEPRI, R0
+    DSB
+    ISB
+#else
     CPSID   I
+#endif
 
     MRS     R0, PSP
     ISB
@@ -248,7 +430,12 @@ __asm void ARCH_PendSVHandler(void)
     STR     R3, [R0]
 
     /* Enable all interrupt, next will jump to next task */
+#if CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY
+    MOV     R0, #0
+    MSR     BASEPRI, R0
+#else
     CPSIE   I
+#endif
 
     BX      R14
 
@@ -294,6 +481,11 @@ __asm void ARCH_StartScheduler(void *TargetTCB)
     MOV     R2, #2
     MSR     CONTROL, R2
 
+#if CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY
+    // Unmask the kernel interrupts(BASEPRI)
+    MOV     R2, #0
+    MSR     BASEPRI, R2
+#endif
     // Enable global interrupt(PRIMASK)
     CPSIE   I
     // Enable fault interrupt(FAULTMASK)
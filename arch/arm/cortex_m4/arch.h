@@ -30,6 +30,12 @@
 #define ARCH_NAME                       "Cortex-M4"
 #define ARCH_BYTE_ALIGNMENT             8
 
+/* Run time counter counts core cycles by DWT CYCCNT */
+#define ARCH_RUN_TIME_COUNTER_HZ        CONFIG_SYS_CLOCK_RATE
+
+/* Stack_Size of the startup file, the MSP stack which interrupt handlers run on */
+#define ARCH_ISR_STACK_SIZE             0x400
+
 #if ARCH_BYTE_ALIGNMENT == 32
     #define ARCH_BYTE_ALIGNMENT_MASK    ( 0x001f )
 #endif
@@ -63,6 +69,7 @@
 #endif
 
 void *ARCH_PrepareStack(void *StartOfStack, void *Param);
+void ARCH_ReleaseStack(void *Stack, void *StartOfStack);
 void ARCH_InterruptDisable(void);
 void ARCH_InterruptEnable(void);
 void ARCH_InterruptInit(void);
@@ -72,4 +79,8 @@ void ARCH_ChangeToUserMode(void);
 void ARCH_SystemTickInit(void);
 void ARCH_StartScheduler(void *TargetTCB);
 void ARCH_TriggerContextSwitch(void *_CurrentTCB, void *_NextTCB);
+OS_Uint32_t ARCH_TicklessIdle(OS_Uint32_t ExpectedIdleTicks);
+OS_Uint32_t ARCH_RunTimeCounterGet(void);
+void *ARCH_TaskStackRegion(void *Stack, void *StartOfStack, OS_Uint32_t *StackSize);
+void *ARCH_IsrStackRegion(OS_Uint32_t *StackSize);
 #endif // !__MXOS_ARCH_H__
@@ -0,0 +1,550 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <sys/time.h>
+#if (CONFIG_CPU_CORE_NUM > 1)
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+#include "arch.h"
+#include "os_task.h"
+
+/*
+ * The host port runs all of the tasks in one process:
+ * 1. every task is a ucontext with its own host stack
+ * 2. SIGALRM from an interval timer plays the SysTick interrupt
+ * 3. blocking SIGALRM plays PRIMASK(interrupt disable)
+ * 4. a pending flag plays PendSV, the switch is done once the
+ *    interrupts are enabled again or the tick handler returns
+ *
+ * With SMP every core is a host thread, any of them may take the tick.
+ * SIGUSR1 sent to the thread of a core plays the IPI. A task context may
+ * be switched out on one core and go on running on another one.
+ */
+#define ARCH_TICK_SIGNAL            SIGALRM
+#define ARCH_IPI_SIGNAL             SIGUSR1
+#define ARCH_TICK_PERIOD_US         (1000000 / CONFIG_SYS_TICK_RATE_HZ)
+
+typedef struct _TaskContext {
+    ucontext_t      Context;
+    void            *HostStack;
+    OS_Uint32_t     HostStackSize;
+    TaskFunction_t  TaskEntry;
+    void            *PrivateData;
+} TaskContext;
+
+extern void OS_SystemTickHander(void);
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+extern ARCH_Spinlock_t OS_KernelLock;
+extern OS_TCB_t * OS_SmpSwitchNextGet(void);
+extern void OS_SmpReScheduleHandler(void);
+
+static __thread volatile OS_Uint8_t ArchThisCore = 0;
+static pthread_t ArchCoreThread[CONFIG_CPU_CORE_NUM];
+static volatile OS_Uint8_t ArchCoreStarted[CONFIG_CPU_CORE_NUM];
+
+#define ARCH_THIS_CORE()            ARCH_CoreID()
+#else
+#define ARCH_THIS_CORE()            0
+#endif
+
+static volatile OS_Uint32_t ArchInterruptNesting[CONFIG_CPU_CORE_NUM];
+static volatile OS_Uint8_t  ArchSwitchPending[CONFIG_CPU_CORE_NUM];
+static void (*volatile ArchTickHook)(void) = OS_NULL;
+static void (*volatile ArchTicklessEnterHook)(OS_Uint32_t ExpectedIdleTicks) = OS_NULL;
+static void (*volatile ArchTicklessExitHook)(OS_Uint32_t ElapsedTicks) = OS_NULL;
+
+static void TaskExitErrorEntry( void )
+{
+    ARCH_InterruptDisable();
+    while(1);
+}
+
+/* The task function returned, delete the task, only back here with error */
+static void ArchTaskReturn(void)
+{
+    OS_API_TaskExit();
+
+    TaskExitErrorEntry();
+}
+
+static void ArchTaskEntry(void)
+{
+    /* CurrentTCB have been updated to this task before switch in */
+    TaskContext *taskContext = (TaskContext *)CurrentTCB->Stack;
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+    /* Switched in with kernel lock held and interrupt masked, see ARCH_PendSVHandler */
+    ARCH_SpinUnlock(&OS_KernelLock);
+    ARCH_InterruptEnable();
+#endif
+
+    taskContext->TaskEntry(taskContext->PrivateData);
+
+    ArchTaskReturn();
+}
+
+static void ArchTickSignalHandler(int Signal)
+{
+    ARCH_SystemTickHander();
+}
+
+static void ArchInterruptSet(sigset_t *Set)
+{
+    sigemptyset(Set);
+    sigaddset(Set, ARCH_TICK_SIGNAL);
+    sigaddset(Set, ARCH_IPI_SIGNAL);
+}
+
+static OS_Uint8_t ArchInterruptMasked(void)
+{
+    sigset_t Current;
+
+    pthread_sigmask(SIG_BLOCK, OS_NULL, &Current);
+
+    return (OS_Uint8_t)sigismember(&Current, ARCH_TICK_SIGNAL);
+}
+
+void *ARCH_PrepareStack(void *StartOfStack, void *Param)
+{
+    TaskContext *taskContext = OS_NULL;
+    TaskInitParameter *TaskParam = (TaskInitParameter *)Param;
+    OS_Uint32_t HostStackSize = TaskParam->StackSize;
+
+    if (HostStackSize < ARCH_POSIX_MIN_STACK_SIZE)
+        HostStackSize = ARCH_POSIX_MIN_STACK_SIZE;
+
+    taskContext = (TaskContext *)malloc(sizeof(TaskContext));
+    OS_ASSERT(taskContext != OS_NULL);
+
+    taskContext->HostStack = malloc(HostStackSize);
+    OS_ASSERT(taskContext->HostStack != OS_NULL);
+    taskContext->HostStackSize = HostStackSize;
+
+    /* Fill the host stack as the kernel does, for the high water scan */
+    memset(taskContext->HostStack, OS_TASK_MAGIC_NUMBER, HostStackSize);
+
+    taskContext->TaskEntry = TaskParam->TaskEntry;
+    taskContext->PrivateData = TaskParam->PrivateData;
+
+    getcontext(&taskContext->Context);
+    taskContext->Context.uc_stack.ss_sp = taskContext->HostStack;
+    taskContext->Context.uc_stack.ss_size = HostStackSize;
+    taskContext->Context.uc_link = OS_NULL;
+#if (CONFIG_CPU_CORE_NUM > 1)
+    /* Task starts with interrupt masked, ArchTaskEntry enables it after unlock */
+    sigaddset(&taskContext->Context.uc_sigmask, ARCH_TICK_SIGNAL);
+    sigaddset(&taskContext->Context.uc_sigmask, ARCH_IPI_SIGNAL);
+#else
+    /* Task starts with interrupt enabled, just like xPSR init on Cortex-M */
+    sigdelset(&taskContext->Context.uc_sigmask, ARCH_TICK_SIGNAL);
+    sigdelset(&taskContext->Context.uc_sigmask, ARCH_IPI_SIGNAL);
+#endif
+    makecontext(&taskContext->Context, ArchTaskEntry, 0);
+
+    return (void *)taskContext;
+}
+
+void ARCH_InterruptDisable(void)
+{
+    sigset_t Set;
+
+    ArchInterruptSet(&Set);
+    pthread_sigmask(SIG_BLOCK, &Set, OS_NULL);
+}
+
+void ARCH_InterruptEnable(void)
+{
+    sigset_t Set;
+    OS_Uint8_t Core = ARCH_THIS_CORE();
+
+    /* The handler will unmask itself when it returns */
+    if (ArchInterruptNesting[Core] != 0)
+        return;
+
+    /* Take the pending switch before unmask, just like PendSV */
+    if (ArchSwitchPending[Core])
+        ARCH_PendSVHandler();
+
+    ArchInterruptSet(&Set);
+    pthread_sigmask(SIG_UNBLOCK, &Set, OS_NULL);
+}
+
+void ARCH_InterruptInit(void)
+{
+}
+
+void ARCH_SystemTickInit(void)
+{
+    struct sigaction Action;
+    struct itimerval Timer;
+
+    /* Keep the tick off until the first task is running */
+    ARCH_InterruptDisable();
+
+    Action.sa_handler = ArchTickSignalHandler;
+    Action.sa_flags = SA_RESTART;
+    /* Handlers run with all of the interrupts masked */
+    ArchInterruptSet(&Action.sa_mask);
+    sigaction(ARCH_TICK_SIGNAL, &Action, OS_NULL);
+
+    Timer.it_interval.tv_sec = 0;
+    Timer.it_interval.tv_usec = ARCH_TICK_PERIOD_US;
+    Timer.it_value = Timer.it_interval;
+    setitimer(ITIMER_REAL, &Timer, OS_NULL);
+}
+
+/*
+ * Reference tickless implementation, called with the tick signal masked.
+ * The timer is reprogrammed to fire once after ExpectedIdleTicks and then
+ * go on with the normal period, that expiry is consumed by sigwait so the
+ * tick handler never runs for the ticks we return.
+ */
+OS_Uint32_t ARCH_TicklessIdle(OS_Uint32_t ExpectedIdleTicks)
+{
+    sigset_t Set;
+    int Signal = 0;
+    struct itimerval Timer;
+    struct timespec Start, End;
+    OS_Uint32_t ElapsedTicks = 0;
+
+    if (ExpectedIdleTicks > ARCH_POSIX_MAX_IDLE_TICKS)
+        ExpectedIdleTicks = ARCH_POSIX_MAX_IDLE_TICKS;
+
+    sigemptyset(&Set);
+    sigaddset(&Set, ARCH_TICK_SIGNAL);
+
+    /* A tick is pending already, let the tick handler take it */
+    sigpending(&Set);
+    if (sigismember(&Set, ARCH_TICK_SIGNAL))
+        return 0;
+
+    sigemptyset(&Set);
+    sigaddset(&Set, ARCH_TICK_SIGNAL);
+
+    Timer.it_interval.tv_sec = 0;
+    Timer.it_interval.tv_usec = ARCH_TICK_PERIOD_US;
+    Timer.it_value.tv_sec = ((OS_Uintptr_t)ExpectedIdleTicks * ARCH_TICK_PERIOD_US) / 1000000;
+    Timer.it_value.tv_usec = ((OS_Uintptr_t)ExpectedIdleTicks * ARCH_TICK_PERIOD_US) % 1000000;
+
+    clock_gettime(CLOCK_MONOTONIC, &Start);
+    setitimer(ITIMER_REAL, &Timer, OS_NULL);
+
+    sigwait(&Set, &Signal);
+
+    clock_gettime(CLOCK_MONOTONIC, &End);
+
+    ElapsedTicks = (OS_Uint32_t)((((OS_Uintptr_t)(End.tv_sec - Start.tv_sec) * 1000000) +
+                                  ((End.tv_nsec - Start.tv_nsec) / 1000)) / ARCH_TICK_PERIOD_US);
+
+    /* The reprogrammed expiry woke us up */
+    if (ElapsedTicks + 1 >= ExpectedIdleTicks)
+        return ExpectedIdleTicks;
+
+    /*
+     * A tick raised just before the timer was reprogrammed woke us up,
+     * count it and go back to the normal period
+     */
+    Timer.it_value = Timer.it_interval;
+    setitimer(ITIMER_REAL, &Timer, OS_NULL);
+
+    return ElapsedTicks + 1;
+}
+
+OS_Uint8_t ARCH_IsInterruptContext(void)
+{
+    return (ArchInterruptNesting[ARCH_THIS_CORE()] != 0);
+}
+
+void ARCH_MiscInit(void)
+{
+}
+
+OS_Uint32_t ARCH_RunTimeCounterGet(void)
+{
+    struct timespec Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    return (OS_Uint32_t)((OS_Uint64_t)Now.tv_sec * 1000000 + Now.tv_nsec / 1000);
+}
+
+/*
+ * Free the context and host stack of a deleted task, the task should never
+ * run again, so it is not called on the host stack being freed
+ */
+void ARCH_ReleaseStack(void *Stack, void *StartOfStack)
+{
+    TaskContext *taskContext = (TaskContext *)Stack;
+
+    free(taskContext->HostStack);
+    free(taskContext);
+}
+
+/* Tasks run on their host stacks, not on the stack the kernel allocated */
+void *ARCH_TaskStackRegion(void *Stack, void *StartOfStack, OS_Uint32_t *StackSize)
+{
+    TaskContext *taskContext = (TaskContext *)Stack;
+
+    *StackSize = taskContext->HostStackSize;
+
+    return taskContext->HostStack;
+}
+
+/* The signal handlers run on the stack of the interrupted task */
+void *ARCH_IsrStackRegion(OS_Uint32_t *StackSize)
+{
+    *StackSize = 0;
+
+    return OS_NULL;
+}
+
+void ARCH_TriggerContextSwitch(void *_CurrentTCB, void *_NextTCB)
+{
+    ArchSwitchPending[ARCH_THIS_CORE()] = 1;
+
+    /* Called with interrupt enabled in thread, switch right now */
+    if (ArchInterruptNesting[ARCH_THIS_CORE()] == 0 && !ArchInterruptMasked())
+    {
+        ARCH_InterruptDisable();
+        ARCH_InterruptEnable();
+    }
+}
+
+/*
+ * Hook runs at the end of every tick interrupt, after the kernel tick, it
+ * plays the handler of another interrupt for the host tests
+ */
+void ARCH_TickHookSet(void (*Hook)(void))
+{
+    ArchTickHook = Hook;
+}
+
+/*
+ * Hooks of the tickless trace points, the host build routes them here, see
+ * os_configs.h, so the tests can watch the ticks slept through
+ */
+void ARCH_TicklessHookSet(void (*Enter)(OS_Uint32_t ExpectedIdleTicks),
+                          void (*Exit)(OS_Uint32_t ElapsedTicks))
+{
+    ArchTicklessEnterHook = Enter;
+    ArchTicklessExitHook = Exit;
+}
+
+void ARCH_TicklessTraceEnter(OS_Uint32_t ExpectedIdleTicks)
+{
+    if (ArchTicklessEnterHook != OS_NULL)
+        ArchTicklessEnterHook(ExpectedIdleTicks);
+}
+
+void ARCH_TicklessTraceExit(OS_Uint32_t ElapsedTicks)
+{
+    if (ArchTicklessExitHook != OS_NULL)
+        ArchTicklessExitHook(ElapsedTicks);
+}
+
+void ARCH_SystemTickHander(void)
+{
+    OS_Uint8_t Core = ARCH_THIS_CORE();
+
+    ArchInterruptNesting[Core]++;
+    OS_SystemTickHander();
+    if (ArchTickHook != OS_NULL)
+        ArchTickHook();
+    ArchInterruptNesting[Core]--;
+
+    /* Return from the tick "exception" with a pending switch */
+    if (ArchSwitchPending[Core])
+        ARCH_PendSVHandler();
+}
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+
+/*
+ * Always called with the interrupt masked. The kernel lock is taken here
+ * and held across swapcontext, it is released by the task switched in,
+ * so no other core can switch to the previous task before its context is
+ * completely saved.
+ */
+void ARCH_PendSVHandler(void)
+{
+    OS_Uint8_t Core = ARCH_THIS_CORE();
+    OS_TCB_t *PrevTCB = OS_NULL;
+    OS_TCB_t *NextTCB = OS_NULL;
+
+    ARCH_SpinLock(&OS_KernelLock);
+
+    ArchSwitchPending[Core] = 0;
+
+    PrevTCB = CoreCurrentTCB[Core];
+    NextTCB = OS_SmpSwitchNextGet();
+
+    if (PrevTCB == NextTCB)
+    {
+        ARCH_SpinUnlock(&OS_KernelLock);
+        return;
+    }
+
+    CoreCurrentTCB[Core] = NextTCB;
+
+    swapcontext(&((TaskContext *)PrevTCB->Stack)->Context,
+                &((TaskContext *)NextTCB->Stack)->Context);
+
+    /* Switched in again, maybe on other core, release the lock of that switch */
+    ARCH_SpinUnlock(&OS_KernelLock);
+}
+
+static void ArchIpiSignalHandler(int Signal)
+{
+    OS_Uint8_t Core = ARCH_THIS_CORE();
+
+    ArchInterruptNesting[Core]++;
+    OS_SmpReScheduleHandler();
+    ArchInterruptNesting[Core]--;
+
+    if (ArchSwitchPending[Core])
+        ARCH_PendSVHandler();
+}
+
+static void ArchCoreSwitchInFirst(OS_Uint8_t Core)
+{
+    TaskContext *taskContext = (TaskContext *)CoreCurrentTCB[Core]->Stack;
+
+    /* Same as ARCH_PendSVHandler, the task entry releases the lock */
+    ARCH_SpinLock(&OS_KernelLock);
+
+    setcontext(&taskContext->Context);
+}
+
+static void *ArchCoreThreadEntry(void *Param)
+{
+    ArchThisCore = (OS_Uint8_t)(OS_Uintptr_t)Param;
+
+    ArchCoreSwitchInFirst(ArchThisCore);
+
+    return OS_NULL;
+}
+
+/* Not inline, the task calling it may go on running on other thread */
+__attribute__((noinline)) OS_Uint8_t ARCH_CoreID(void)
+{
+    return ArchThisCore;
+}
+
+void ARCH_SpinLock(ARCH_Spinlock_t *Lock)
+{
+    while (__atomic_exchange_n(Lock, 1, __ATOMIC_ACQUIRE))
+    {
+        /* The holder may be a host thread which is not running now */
+        while (__atomic_load_n(Lock, __ATOMIC_RELAXED))
+            sched_yield();
+    }
+}
+
+void ARCH_SpinUnlock(ARCH_Spinlock_t *Lock)
+{
+    __atomic_store_n(Lock, 0, __ATOMIC_RELEASE);
+}
+
+void ARCH_SendIPI(OS_Uint8_t Core)
+{
+    if (ArchCoreStarted[Core])
+        pthread_kill(ArchCoreThread[Core], ARCH_IPI_SIGNAL);
+}
+
+/* Called by idle task with interrupt enabled, sleep until any signal comes */
+void ARCH_WaitForInterrupt(void)
+{
+    sigset_t Set;
+
+    sigemptyset(&Set);
+    sigsuspend(&Set);
+}
+
+void ARCH_StartScheduler(void *TargetTCB)
+{
+    struct sigaction Action;
+    OS_Uintptr_t Core = 0;
+
+    Action.sa_handler = ArchIpiSignalHandler;
+    Action.sa_flags = SA_RESTART;
+    ArchInterruptSet(&Action.sa_mask);
+    sigaction(ARCH_IPI_SIGNAL, &Action, OS_NULL);
+
+    ArchThisCore = 0;
+    ArchCoreThread[0] = pthread_self();
+    ArchCoreStarted[0] = 1;
+
+    /* Threads inherit the interrupt mask, they are masked until switch in */
+    for (Core = 1; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        if (pthread_create(&ArchCoreThread[Core], OS_NULL, ArchCoreThreadEntry, (void *)Core) != 0)
+        {
+            TaskExitErrorEntry();
+        }
+        ArchCoreStarted[Core] = 1;
+    }
+
+    /* We will never go back ^_^ */
+    ArchCoreSwitchInFirst(0);
+}
+
+#else
+
+/*
+ * Always called with the tick signal masked, the mask is part of the
+ * context, so a task switched out here comes back still masked.
+ */
+void ARCH_PendSVHandler(void)
+{
+    OS_TCB_t *PrevTCB = CurrentTCB;
+
+    ArchSwitchPending[0] = 0;
+
+    if (PrevTCB == SwitchNextTCB)
+        return;
+
+    /* Update CurrentTCB to SwitchNextTCB */
+    CurrentTCB = SwitchNextTCB;
+
+    swapcontext(&((TaskContext *)PrevTCB->Stack)->Context,
+                &((TaskContext *)SwitchNextTCB->Stack)->Context);
+}
+
+void ARCH_StartScheduler(void *TargetTCB)
+{
+    TaskContext *taskContext = (TaskContext *)((OS_TCB_t *)TargetTCB)->Stack;
+
+    /* We will never go back ^_^ */
+    setcontext(&taskContext->Context);
+}
+
+#endif // CONFIG_CPU_CORE_NUM > 1
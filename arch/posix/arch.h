@@ -0,0 +1,97 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef __MXOS_ARCH_H__
+#define __MXOS_ARCH_H__
+
+#include "os_types.h"
+#include "os_configs.h"
+
+#define ARCH_NAME                       "POSIX"
+#define ARCH_BYTE_ALIGNMENT             16
+
+/* Run time counter counts microseconds of the monotonic clock */
+#define ARCH_RUN_TIME_COUNTER_HZ        1000000
+
+#if ARCH_BYTE_ALIGNMENT == 32
+    #define ARCH_BYTE_ALIGNMENT_MASK    ( 0x001f )
+#endif
+
+#if ARCH_BYTE_ALIGNMENT == 16
+    #define ARCH_BYTE_ALIGNMENT_MASK    ( 0x000f )
+#endif
+
+#if ARCH_BYTE_ALIGNMENT == 8
+    #define ARCH_BYTE_ALIGNMENT_MASK    ( 0x0007 )
+#endif
+
+#ifndef ARCH_BYTE_ALIGNMENT_MASK
+    #error "Invalid ARCH_BYTE_ALIGNMENT definition"
+#endif
+
+/*
+ * Every task runs on a host stack of at least this size, the stack which
+ * the kernel allocated for the task only keeps the boundary magic number,
+ * libc (printf) needs much more stack than a MCU task is given.
+ */
+#define ARCH_POSIX_MIN_STACK_SIZE       (64 * OS_SIZE_KB)
+
+/* The longest sleep of tickless idle in ticks */
+#define ARCH_POSIX_MAX_IDLE_TICKS       (60 * 1000)
+
+void *ARCH_PrepareStack(void *StartOfStack, void *Param);
+void ARCH_ReleaseStack(void *Stack, void *StartOfStack);
+void ARCH_InterruptDisable(void);
+void ARCH_InterruptEnable(void);
+void ARCH_InterruptInit(void);
+OS_Uint8_t ARCH_IsInterruptContext(void);
+void ARCH_MiscInit(void);
+void ARCH_SystemTickInit(void);
+void ARCH_StartScheduler(void *TargetTCB);
+void ARCH_TriggerContextSwitch(void *_CurrentTCB, void *_NextTCB);
+OS_Uint32_t ARCH_TicklessIdle(OS_Uint32_t ExpectedIdleTicks);
+void ARCH_SystemTickHander(void);
+void ARCH_PendSVHandler(void);
+OS_Uint32_t ARCH_RunTimeCounterGet(void);
+void *ARCH_TaskStackRegion(void *Stack, void *StartOfStack, OS_Uint32_t *StackSize);
+void *ARCH_IsrStackRegion(OS_Uint32_t *StackSize);
+void ARCH_TickHookSet(void (*Hook)(void));
+void ARCH_TicklessHookSet(void (*Enter)(OS_Uint32_t ExpectedIdleTicks), void (*Exit)(OS_Uint32_t ElapsedTicks));
+void ARCH_TicklessTraceEnter(OS_Uint32_t ExpectedIdleTicks);
+void ARCH_TicklessTraceExit(OS_Uint32_t ElapsedTicks);
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+/*
+ * SMP, every core is a host thread, the other cores are brought up by
+ * ARCH_StartScheduler, IPI is a signal sent to the thread of that core
+ */
+typedef volatile OS_Uint32_t ARCH_Spinlock_t;
+
+OS_Uint8_t ARCH_CoreID(void);
+void ARCH_SpinLock(ARCH_Spinlock_t *Lock);
+void ARCH_SpinUnlock(ARCH_Spinlock_t *Lock);
+void ARCH_SendIPI(OS_Uint8_t Core);
+void ARCH_WaitForInterrupt(void);
+#endif
+#endif // !__MXOS_ARCH_H__
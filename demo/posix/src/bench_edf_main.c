@@ -0,0 +1,232 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Schedulability of synthetic periodic task sets, EDF against the fixed
+ * priority policy (rate monotonic, shorter period gets higher priority).
+ * Every task set is generated by UUniFast for a target utilization, and
+ * every run is a child process with its own kernel. A job burns its WCET
+ * with a busy loop calibrated before the kernel starts.
+ */
+#define BENCH_TASK_NUM              4
+#define BENCH_SETS_PER_UTIL         3
+#define BENCH_RUN_TICKS             1000
+#define BENCH_MIN_PERIOD            20
+#define BENCH_MAX_PERIOD            200
+#define BENCH_RM_BASE_PRIORITY      2
+#define BENCH_MONITOR_PRIORITY      (OS_MAX_TASK_PRIORITY - 2)
+
+typedef struct _BenchTask {
+    OS_Uint32_t     Period;
+    OS_Uint32_t     Wcet;
+    OS_Uint8_t      Priority;
+    OS_Uintptr_t    Handle;
+    OS_Uint32_t     Jobs;
+    OS_Uint32_t     Missed;
+} BenchTask;
+
+static BenchTask BenchTasks[BENCH_TASK_NUM];
+static double BenchLoopsPerTick = 0;
+static OS_Uint32_t BenchSeed = 1;
+static volatile OS_Uint32_t BenchSink = 0;
+
+static double BenchRandom(void)
+{
+    BenchSeed = BenchSeed * 1103515245 + 12345;
+
+    return (double)((BenchSeed >> 8) & 0xFFFF) / 65536.0;
+}
+
+static double BenchNowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void BenchCalibrate(void)
+{
+    OS_Uint32_t i = 0;
+    double Start = BenchNowNs();
+
+    for (i = 0; i < 50000000; i++)
+        BenchSink++;
+
+    BenchLoopsPerTick = 50000000 / ((BenchNowNs() - Start) / (1e9 / CONFIG_SYS_TICK_RATE_HZ));
+}
+
+/*
+ * Split Util into BENCH_TASK_NUM utilizations uniformly (the same
+ * distribution as UUniFast), by the gaps between sorted random cuts
+ */
+static double BenchGenerate(double Util)
+{
+    OS_Uint32_t i = 0, j = 0;
+    double Cut[BENCH_TASK_NUM + 1];
+    double Tmp = 0, Real = 0;
+
+    Cut[0] = 0;
+    Cut[BENCH_TASK_NUM] = 1;
+    for (i = 1; i < BENCH_TASK_NUM; i++)
+        Cut[i] = BenchRandom();
+
+    for (i = 1; i < BENCH_TASK_NUM; i++)
+    {
+        for (j = i + 1; j < BENCH_TASK_NUM; j++)
+        {
+            if (Cut[j] < Cut[i])
+            {
+                Tmp = Cut[i];
+                Cut[i] = Cut[j];
+                Cut[j] = Tmp;
+            }
+        }
+    }
+
+    for (i = 0; i < BENCH_TASK_NUM; i++)
+    {
+        BenchTasks[i].Period = BENCH_MIN_PERIOD + (OS_Uint32_t)(BenchRandom() * (BENCH_MAX_PERIOD - BENCH_MIN_PERIOD));
+        BenchTasks[i].Wcet = (OS_Uint32_t)(Util * (Cut[i + 1] - Cut[i]) * BenchTasks[i].Period + 0.5);
+        if (BenchTasks[i].Wcet == 0)
+            BenchTasks[i].Wcet = 1;
+
+        Real += (double)BenchTasks[i].Wcet / BenchTasks[i].Period;
+    }
+
+    /* Rate monotonic priorities */
+    for (i = 0; i < BENCH_TASK_NUM; i++)
+    {
+        OS_Uint32_t j = 0, Rank = 0;
+        for (j = 0; j < BENCH_TASK_NUM; j++)
+        {
+            if ( (BenchTasks[j].Period > BenchTasks[i].Period) ||
+                 ((BenchTasks[j].Period == BenchTasks[i].Period) && (j > i)) )
+                Rank++;
+        }
+        BenchTasks[i].Priority = BENCH_RM_BASE_PRIORITY + Rank;
+    }
+
+    return Real;
+}
+
+void JOB_FUNC(void *param)
+{
+    BenchTask *Task = (BenchTask *)param;
+    OS_Uint32_t i = 0;
+    OS_Uint32_t Loops = (OS_Uint32_t)(Task->Wcet * BenchLoopsPerTick);
+
+    while(1)
+    {
+        for (i = 0; i < Loops; i++)
+            BenchSink++;
+
+        Task->Jobs++;
+
+        if (OS_API_TaskWaitNextPeriod() == OS_TSK_EDF_DEADLINE_MISSED)
+            Task->Missed++;
+    }
+}
+
+void MONITOR_FUNC(void *param)
+{
+    OS_Uint32_t i = 0;
+    OS_Uint32_t Missed = 0;
+
+    OS_API_TaskDelay(BENCH_RUN_TICKS);
+
+    for (i = 0; i < BENCH_TASK_NUM; i++)
+    {
+        Missed += BenchTasks[i].Missed;
+    }
+
+    /* Report to the parent by exit code, 0 means schedulable */
+    exit(Missed ? 1 : 0);
+}
+
+/* Run the task set in a child process, return 1 if no deadline missed */
+static OS_Uint32_t BenchRun(OS_Uint8_t UseEdf)
+{
+    OS_Uint32_t i = 0;
+    TaskInitParameter Param;
+    OS_Uintptr_t Handle = 0;
+    int Status = 0;
+    pid_t Pid = fork();
+
+    if (Pid != 0)
+    {
+        waitpid(Pid, &Status, 0);
+        return (WIFEXITED(Status) && (WEXITSTATUS(Status) == 0));
+    }
+
+    OS_API_KernelInit();
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.Name[0] = 'J';
+    Param.TaskEntry = JOB_FUNC;
+    for (i = 0; i < BENCH_TASK_NUM; i++)
+    {
+        Param.Name[1] = '0' + (OS_Uint8_t)i;
+        Param.Priority = UseEdf ? OS_EDF_TASK_PRIORITY : BenchTasks[i].Priority;
+        Param.PrivateData = &BenchTasks[i];
+        OS_API_TaskCreate(Param, &BenchTasks[i].Handle);
+        OS_API_TaskEdfSet(BenchTasks[i].Handle, BenchTasks[i].Period, 0);
+    }
+
+    Param.Name[0] = 'M';
+    Param.Name[1] = 'O';
+    Param.Priority = BENCH_MONITOR_PRIORITY;
+    Param.PrivateData = OS_NULL;
+    Param.TaskEntry = MONITOR_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    OS_API_KernelStart();
+
+    exit(2);
+}
+
+int main(void)
+{
+    static const double Utils[] = { 0.60, 0.70, 0.80, 0.90, 0.95 };
+    OS_Uint32_t u = 0, Set = 0;
+    OS_Uint32_t RmPass = 0, EdfPass = 0;
+    double Real = 0;
+
+    BenchCalibrate();
+
+    printf("%d tasks per set, %d sets per utilization, %d ticks per run\r\n",
+           BENCH_TASK_NUM, BENCH_SETS_PER_UTIL, BENCH_RUN_TICKS);
+    /* Never leave buffered output to the children */
+    fflush(stdout);
+
+    for (u = 0; u < sizeof(Utils) / sizeof(Utils[0]); u++)
+    {
+        RmPass = 0;
+        EdfPass = 0;
+
+        for (Set = 0; Set < BENCH_SETS_PER_UTIL; Set++)
+        {
+            Real = BenchGenerate(Utils[u]);
+            RmPass += BenchRun(0);
+            EdfPass += BenchRun(1);
+        }
+
+        printf("utilization %.2f (last set %.2f): fixed priority %u/%u, EDF %u/%u schedulable\r\n",
+               Utils[u], Real, RmPass, BENCH_SETS_PER_UTIL, EdfPass, BENCH_SETS_PER_UTIL);
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_notify.h"
+#include "os_kernel.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Semaphore ping-pong between two tasks, every round trip costs two
+ * post/wait pairs and two context switches. Then the same with task
+ * notifications, which need no kernel object.
+ */
+#define BENCH_ROUND_TRIPS           200000
+
+OS_Uintptr_t ping_handle = 0;
+OS_Uintptr_t pong_handle = 0;
+OS_Uintptr_t notify_pong_handle = 0;
+
+OS_Uint32_t PingSem = 0;
+OS_Uint32_t PongSem = 0;
+
+static double BenchNowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+void PING_FUNC(void *param)
+{
+    OS_Uint32_t i = 0;
+    double Start = 0, End = 0;
+
+    Start = BenchNowNs();
+
+    for (i = 0; i < BENCH_ROUND_TRIPS; i++)
+    {
+        OS_API_SemPost(PongSem);
+        OS_API_SemWait(PingSem);
+    }
+
+    End = BenchNowNs();
+
+    printf("sem ping-pong: %d round trips, %.1f ns per round trip, %d ticks\r\n",
+           BENCH_ROUND_TRIPS, (End - Start) / BENCH_ROUND_TRIPS, OS_GetCurrentTime());
+
+    Start = BenchNowNs();
+
+    for (i = 0; i < BENCH_ROUND_TRIPS; i++)
+    {
+        OS_API_TaskNotify(notify_pong_handle, 0, OS_NOTIFY_INCREMENT);
+        OS_API_TaskNotifyWait(OS_NOTIFY_CLEAR_ALL, OS_NULL, OS_NOTIFY_WAIT_FOREVER);
+    }
+
+    End = BenchNowNs();
+
+    printf("notify ping-pong: %d round trips, %.1f ns per round trip, %d ticks\r\n",
+           BENCH_ROUND_TRIPS, (End - Start) / BENCH_ROUND_TRIPS, OS_GetCurrentTime());
+
+    exit(0);
+}
+
+void PONG_FUNC(void *param)
+{
+    while(1)
+    {
+        OS_API_SemWait(PongSem);
+        OS_API_SemPost(PingSem);
+    }
+}
+
+void NOTIFY_PONG_FUNC(void *param)
+{
+    while(1)
+    {
+        OS_API_TaskNotifyWait(OS_NOTIFY_CLEAR_ALL, OS_NULL, OS_NOTIFY_WAIT_FOREVER);
+        OS_API_TaskNotify(ping_handle, 0, OS_NOTIFY_INCREMENT);
+    }
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='P';
+    Param.Name[1] ='I';
+    Param.Priority = 2;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = PING_FUNC;
+    OS_API_TaskCreate(Param, &ping_handle);
+
+    Param.Name[1] ='O';
+    Param.Priority = 3;
+    Param.TaskEntry = PONG_FUNC;
+    OS_API_TaskCreate(Param, &pong_handle);
+
+    Param.Name[1] ='N';
+    Param.TaskEntry = NOTIFY_PONG_FUNC;
+    OS_API_TaskCreate(Param, &notify_pong_handle);
+
+    OS_API_SemCreate(&PingSem, 0);
+    OS_API_SemCreate(&PongSem, 0);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
@@ -0,0 +1,262 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_mem.h"
+#include "os_kernel.h"
+#include "os_critical.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Cost of OS_API_Malloc/OS_API_Free replaying allocation traces, the
+ * kernel is not started. Every call is timed alone, the worst one is what
+ * an interrupt may wait for, since the heap is locked by disabling them.
+ * 1. random, sizes of 8 ~ 2048 bytes alloc and free in random order
+ * 2. fragment, the heap is cut into small blocks, every other one is
+ *    freed, then the bigger ones alloc and free among the holes
+ * The trace is made up before the replay with a fixed seed, and the heap
+ * is all freed after it, so every round replays the same ops on the same
+ * heap. The cost of an op is the least of all the rounds, which leaves out
+ * the host interrupts. Failed mallocs print a warning, they are counted
+ * only.
+ */
+#define BENCH_SLOTS                 256
+#define BENCH_OPS                   200000
+#define BENCH_ROUNDS                5
+#define BENCH_FRAGMENT_SIZE         24
+
+typedef struct _BenchOp {
+    OS_Uint16_t Slot;
+    /* 0 means free the slot */
+    OS_Uint16_t Size;
+} BenchOp_t;
+
+static BenchOp_t BenchTrace[BENCH_OPS];
+static OS_Uint32_t BenchCost[BENCH_OPS];
+static OS_Uint8_t BenchFailed[BENCH_OPS];
+static OS_Uint32_t BenchMallocCost[BENCH_OPS];
+static OS_Uint32_t BenchFreeCost[BENCH_OPS];
+static void *BenchPtr[BENCH_SLOTS];
+static OS_Uint32_t BenchSeed = 1;
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_UNIT                  "cycles"
+static inline OS_Uint64_t BenchNow(void)
+{
+    return __rdtsc();
+}
+#else
+#define BENCH_UNIT                  "ns"
+static inline OS_Uint64_t BenchNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (OS_Uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+static OS_Uint32_t BenchRandom(void)
+{
+    BenchSeed = BenchSeed * 1103515245 + 12345;
+
+    return BenchSeed >> 8;
+}
+
+/* Mostly small objects, some frames and a few big buffers */
+static OS_Uint16_t BenchRandomSize(void)
+{
+    OS_Uint32_t Kind = BenchRandom() % 100;
+
+    if (Kind < 70)
+        return 8 + BenchRandom() % 57;
+    if (Kind < 95)
+        return 65 + BenchRandom() % 448;
+
+    return 513 + BenchRandom() % 1536;
+}
+
+/* Every op frees a used slot or fills an empty one, the live set stays about half */
+static void BenchMakeRandomTrace(void)
+{
+    OS_Uint32_t i = 0;
+    OS_Uint8_t Live[BENCH_SLOTS] = {0};
+
+    for (i = 0; i < BENCH_OPS; i++)
+    {
+        BenchTrace[i].Slot = BenchRandom() % BENCH_SLOTS;
+        BenchTrace[i].Size = Live[BenchTrace[i].Slot] ? 0 : BenchRandomSize();
+        Live[BenchTrace[i].Slot] = !Live[BenchTrace[i].Slot];
+    }
+}
+
+/* Replay trace in the slots from First on, the slots before keep the holes */
+static void BenchMakeFragmentTrace(OS_Uint32_t First)
+{
+    OS_Uint32_t i = 0;
+    OS_Uint8_t Live[BENCH_SLOTS] = {0};
+
+    for (i = 0; i < BENCH_OPS; i++)
+    {
+        BenchTrace[i].Slot = First + BenchRandom() % (BENCH_SLOTS - First);
+        BenchTrace[i].Size = Live[BenchTrace[i].Slot] ? 0 : 64 + BenchRandom() % 448;
+        Live[BenchTrace[i].Slot] = !Live[BenchTrace[i].Slot];
+    }
+}
+
+static int BenchCompare(const void *a, const void *b)
+{
+    OS_Uint32_t x = *(const OS_Uint32_t *)a;
+    OS_Uint32_t y = *(const OS_Uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void BenchReport(const char *Name, const char *Op, OS_Uint32_t *Cost, OS_Uint32_t Count)
+{
+    OS_Uint32_t i = 0;
+    OS_Uint64_t Total = 0;
+
+    if (Count == 0)
+        return;
+
+    for (i = 0; i < Count; i++)
+        Total += Cost[i];
+
+    qsort(Cost, Count, sizeof(OS_Uint32_t), BenchCompare);
+
+    printf("%-9s %-6s %7u calls: avg %6.1f, p99.9 %6u, worst %8u %s\r\n",
+           Name, Op, Count, (double)Total / Count, Cost[Count - Count / 1000 - 1],
+           Cost[Count - 1], BENCH_UNIT);
+}
+
+static void BenchFreeAll(void)
+{
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < BENCH_SLOTS; i++)
+    {
+        OS_API_Free(BenchPtr[i]);
+        BenchPtr[i] = OS_NULL;
+    }
+}
+
+static void BenchReplayRound(OS_Uint32_t Round)
+{
+    OS_Uint32_t i = 0;
+    OS_Uint32_t Cost = 0;
+    OS_Uint64_t Start = 0;
+    BenchOp_t *Op = OS_NULL;
+
+    for (i = 0; i < BENCH_OPS; i++)
+    {
+        Op = &BenchTrace[i];
+
+        /* Inside a critical zone the tick never comes into the measurement */
+        OS_API_EnterCritical();
+        Start = BenchNow();
+        if (Op->Size == 0)
+        {
+            OS_API_Free(BenchPtr[Op->Slot]);
+            Cost = (OS_Uint32_t)(BenchNow() - Start);
+            BenchPtr[Op->Slot] = OS_NULL;
+        }
+        else
+        {
+            BenchPtr[Op->Slot] = OS_API_Malloc(Op->Size);
+            Cost = (OS_Uint32_t)(BenchNow() - Start);
+            BenchFailed[i] = (BenchPtr[Op->Slot] == OS_NULL);
+        }
+        OS_API_ExitCritical();
+
+        if (Round == 0 || Cost < BenchCost[i])
+            BenchCost[i] = Cost;
+    }
+}
+
+/* Cut the heap into small blocks in the first half of the slots, free every other one */
+static void BenchCutHeap(void)
+{
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < BENCH_SLOTS / 2; i++)
+        BenchPtr[i] = OS_API_Malloc(BENCH_FRAGMENT_SIZE);
+    for (i = 0; i < BENCH_SLOTS / 2; i += 2)
+    {
+        OS_API_Free(BenchPtr[i]);
+        BenchPtr[i] = OS_NULL;
+    }
+}
+
+static void BenchReplay(const char *Name, void (*Prepare)(void))
+{
+    OS_Uint32_t i = 0;
+    OS_Uint32_t Round = 0;
+    OS_Uint32_t Mallocs = 0, Frees = 0, Failed = 0;
+
+    for (Round = 0; Round < BENCH_ROUNDS; Round++)
+    {
+        if (Prepare != OS_NULL)
+            Prepare();
+        BenchReplayRound(Round);
+        BenchFreeAll();
+    }
+
+    for (i = 0; i < BENCH_OPS; i++)
+    {
+        if (BenchTrace[i].Size == 0)
+            BenchFreeCost[Frees++] = BenchCost[i];
+        else if (BenchFailed[i])
+            Failed++;
+        else
+            BenchMallocCost[Mallocs++] = BenchCost[i];
+    }
+
+    BenchReport(Name, "malloc", BenchMallocCost, Mallocs);
+    BenchReport(Name, "free", BenchFreeCost, Frees);
+    if (Failed != 0)
+        printf("%-9s %u mallocs failed\r\n", Name, Failed);
+}
+
+/* The least cost of the lock the heap takes in every call, on host it is a syscall pair */
+static void BenchLockReport(void)
+{
+    OS_Uint32_t i = 0;
+    OS_Uint32_t Cost = 0, Least = 0;
+    OS_Uint64_t Start = 0;
+
+    for (i = 0; i < BENCH_OPS / 100; i++)
+    {
+        OS_API_EnterCritical();
+        Start = BenchNow();
+        OS_API_EnterCritical();
+        OS_API_ExitCritical();
+        Cost = (OS_Uint32_t)(BenchNow() - Start);
+        OS_API_ExitCritical();
+
+        if (i == 0 || Cost < Least)
+            Least = Cost;
+    }
+
+    printf("%-9s %u %s in every call\r\n", "lock", Least, BENCH_UNIT);
+}
+
+int main(void)
+{
+    OS_API_KernelInit();
+
+    BenchLockReport();
+
+    BenchMakeRandomTrace();
+    BenchReplay("random", OS_NULL);
+
+    BenchMakeFragmentTrace(BENCH_SLOTS / 2);
+    BenchReplay("fragment", BenchCutHeap);
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_timer_wheel.h"
+
+/*
+ * Cost of the timing wheel with 10 ~ 1000 sleeping tasks, the kernel is
+ * not started, a private wheel and dummy TCBs are used:
+ * 1. insert, every task sleeps 1 ~ BENCH_MAX_SLEEP ticks
+ * 2. cancel, every task is removed before timeout
+ * 3. tick, BENCH_TICKS ticks are advanced, every expired task goes to
+ *    sleep again at once, so the number of sleeping tasks keeps the same
+ */
+#define BENCH_MAX_TASKS             1000
+#define BENCH_MAX_SLEEP             5000
+#define BENCH_OPS                   1000000
+#define BENCH_TICKS                 200000
+
+static OS_TCB_t BenchTCB[BENCH_MAX_TASKS];
+static OS_TimerWheel_t BenchWheel;
+static OS_Uint32_t BenchSeed = 1;
+static OS_Uint32_t BenchExpired = 0;
+static OS_Uint32_t BenchMissed = 0;
+
+static double BenchNowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static OS_Uint32_t BenchSleepTicks(void)
+{
+    BenchSeed = BenchSeed * 1103515245 + 12345;
+
+    return 1 + (BenchSeed >> 8) % BENCH_MAX_SLEEP;
+}
+
+static void BenchExpire(OS_TCB_t *TaskCB)
+{
+    BenchExpired++;
+
+    /* Every task should expire right at its wakeup time */
+    if (TaskCB->WakeUpTime != BenchWheel.Time)
+        BenchMissed++;
+
+    OS_TimerWheelDel(&BenchWheel, TaskCB);
+
+    TaskCB->WakeUpTime = BenchWheel.Time + BenchSleepTicks();
+    OS_TimerWheelAdd(&BenchWheel, TaskCB);
+}
+
+static void BenchRun(OS_Uint32_t TaskNum)
+{
+    OS_Uint32_t i = 0, Round = 0;
+    OS_Uint32_t Rounds = BENCH_OPS / TaskNum;
+    double InsertNs = 0, CancelNs = 0, TickNs = 0, Start = 0;
+
+    /* Start near the wrap of 32 bits time */
+    OS_TimerWheelInit(&BenchWheel, 0xFFFFFFFF - BENCH_TICKS / 2);
+
+    for (Round = 0; Round < Rounds; Round++)
+    {
+        for (i = 0; i < TaskNum; i++)
+            BenchTCB[i].WakeUpTime = BenchWheel.Time + BenchSleepTicks();
+
+        Start = BenchNowNs();
+        for (i = 0; i < TaskNum; i++)
+            OS_TimerWheelAdd(&BenchWheel, &BenchTCB[i]);
+        InsertNs += BenchNowNs() - Start;
+
+        Start = BenchNowNs();
+        for (i = 0; i < TaskNum; i++)
+            OS_TimerWheelDel(&BenchWheel, &BenchTCB[i]);
+        CancelNs += BenchNowNs() - Start;
+    }
+
+    for (i = 0; i < TaskNum; i++)
+    {
+        BenchTCB[i].WakeUpTime = BenchWheel.Time + BenchSleepTicks();
+        OS_TimerWheelAdd(&BenchWheel, &BenchTCB[i]);
+    }
+
+    BenchExpired = 0;
+    Start = BenchNowNs();
+    for (i = 0; i < BENCH_TICKS; i++)
+        OS_TimerWheelAdvance(&BenchWheel, BenchWheel.Time + 1, BenchExpire);
+    TickNs = BenchNowNs() - Start;
+
+    printf("%5u tasks: insert %6.1f ns, cancel %6.1f ns, tick %7.1f ns, %8.1f ns per expiry (%u expired)\r\n",
+           TaskNum, InsertNs / (Rounds * TaskNum), CancelNs / (Rounds * TaskNum),
+           TickNs / BENCH_TICKS, BenchExpired ? TickNs / BenchExpired : 0.0, BenchExpired);
+
+    if (BenchMissed != 0)
+    {
+        printf("%u tasks expired at wrong time\r\n", BenchMissed);
+        exit(1);
+    }
+}
+
+int main(void)
+{
+    OS_API_KernelInit();
+
+    BenchRun(10);
+    BenchRun(100);
+    BenchRun(1000);
+
+    return 0;
+}
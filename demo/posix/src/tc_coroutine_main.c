@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_queue.h"
+#include "os_kernel.h"
+#include "os_time.h"
+#include "os_coroutine.h"
+#include "os_error_code.h"
+
+/*
+ * Coroutine test, all of the coroutines run in one host task:
+ * 1. BLINKERS coroutines delay a few ticks again and again
+ * 2. READERS coroutines read the queue PRODUCER task writes
+ * 3. SEM coroutine times out on a semaphore, then waits for CHECK to post it
+ * CHECK task checks the counts after all of them are done. Nobody kicks the
+ * host task, the posts and writes do.
+ * 4. EVENT coroutine waits on a semaphore and POLL coroutine on a condition
+ *    of its own, which counts the passes of the host. In IDLE_TICKS the host
+ *    only runs for the polls, then the post of CHECK runs EVENT at once.
+ */
+#define BLINKERS                    300
+#define BLINK_ROUNDS                10
+#define READERS                     4
+#define MESSAGES                    200
+#define SEM_TIMEOUT                 5
+#define IDLE_TICKS                  500
+
+typedef struct _Blinker {
+    OS_Uint32_t Round;
+    OS_Uint32_t Period;
+} Blinker_t;
+
+typedef struct _Reader {
+    OS_Uint32_t Msg;
+    OS_Uint32_t Count;
+} Reader_t;
+
+OS_Coroutine_t BlinkerCo[BLINKERS];
+Blinker_t      Blinker[BLINKERS];
+OS_Coroutine_t ReaderCo[READERS];
+Reader_t       Reader[READERS];
+OS_Coroutine_t SemCo;
+OS_Coroutine_t EventCo;
+OS_Coroutine_t PollCo;
+
+OS_Uint32_t MsgQueue = 0;
+OS_Uint32_t Sem = 0;
+OS_Uint32_t EventSem = 0;
+
+volatile OS_Uint32_t Blinks = 0;
+volatile OS_Uint32_t MsgSum = 0;
+volatile OS_Uint32_t Timeouts = 0;
+volatile OS_Uint32_t Done = 0;
+volatile OS_Uint32_t Passes = 0;
+volatile OS_Uint32_t PollStop = 0;
+volatile OS_Uint32_t EventTick = 0;
+
+static void TestFail(const char *What)
+{
+    printf("Coroutine test FAILED, %s\r\n", What);
+    exit(1);
+}
+
+void BLINK_CO(OS_Coroutine_t *Co)
+{
+    Blinker_t *Data = (Blinker_t *)Co->PrivateData;
+
+    OS_CO_BEGIN(Co);
+
+    for (Data->Round = 0; Data->Round < BLINK_ROUNDS; Data->Round++)
+    {
+        OS_CO_DELAY(Co, Data->Period);
+        Blinks++;
+    }
+
+    Done++;
+
+    OS_CO_END(Co);
+}
+
+void READ_CO(OS_Coroutine_t *Co)
+{
+    Reader_t *Data = (Reader_t *)Co->PrivateData;
+
+    OS_CO_BEGIN(Co);
+
+    while (1)
+    {
+        OS_CO_QUEUE_READ(Co, MsgQueue, &Data->Msg, sizeof(Data->Msg), 50);
+        if (Co->Ret != OS_SUCCESS)
+            break;
+
+        MsgSum += Data->Msg;
+        Data->Count++;
+    }
+
+    Done++;
+
+    OS_CO_END(Co);
+}
+
+void SEM_CO(OS_Coroutine_t *Co)
+{
+    OS_CO_BEGIN(Co);
+
+    OS_CO_SEM_WAIT(Co, Sem, SEM_TIMEOUT);
+    if (Co->Ret != OS_COROUTINE_WAIT_TIMEOUT)
+        TestFail("semaphore wait does not time out");
+    Timeouts++;
+
+    OS_CO_SEM_WAIT(Co, Sem, OS_CO_WAIT_FOREVER);
+    if (Co->Ret != OS_SUCCESS)
+        TestFail("semaphore wait fails");
+
+    Done++;
+
+    OS_CO_END(Co);
+}
+
+void EVENT_CO(OS_Coroutine_t *Co)
+{
+    OS_CO_BEGIN(Co);
+
+    OS_CO_SEM_WAIT(Co, EventSem, OS_CO_WAIT_FOREVER);
+    EventTick = OS_GetCurrentTime();
+
+    OS_CO_END(Co);
+}
+
+void POLL_CO(OS_Coroutine_t *Co)
+{
+    OS_CO_BEGIN(Co);
+
+    OS_CO_WAIT_UNTIL(Co, (Passes++, PollStop), OS_CO_WAIT_FOREVER);
+
+    OS_CO_END(Co);
+}
+
+void PRODUCER_FUNC(void *param)
+{
+    OS_Uint32_t Msg = 0;
+
+    for (Msg = 1; Msg <= MESSAGES; Msg++)
+    {
+        while (OS_API_QueueTryWrite(MsgQueue, &Msg, sizeof(Msg)) != OS_SUCCESS)
+        {
+            OS_API_TaskDelay(1);
+        }
+    }
+}
+
+void CHECK_FUNC(void *param)
+{
+    OS_Uint32_t i = 0;
+    OS_Uint32_t Count = 0;
+    OS_Uint32_t PostTick = 0;
+
+    OS_API_TaskDelay(SEM_TIMEOUT * 4);
+    if (Timeouts != 1)
+        TestFail("semaphore timeout not seen");
+
+    OS_API_SemPost(Sem);
+
+    OS_API_TaskDelay(200);
+
+    if (Done != BLINKERS + READERS + 1)
+        TestFail("not all coroutines done");
+
+    if (Blinks != BLINKERS * BLINK_ROUNDS)
+        TestFail("blinks lost");
+
+    for (i = 0; i < READERS; i++)
+        Count += Reader[i].Count;
+
+    if (Count != MESSAGES || MsgSum != MESSAGES * (MESSAGES + 1) / 2)
+        TestFail("messages lost");
+
+    /* Step 4 */
+    OS_API_CoroutineCreate(&EventCo, EVENT_CO, OS_NULL);
+    OS_API_CoroutineCreate(&PollCo, POLL_CO, OS_NULL);
+    OS_API_TaskDelay(1);
+    Passes = 0;
+    OS_API_TaskDelay(IDLE_TICKS);
+    if (Passes > IDLE_TICKS / CONFIG_COROUTINE_POLL_TICKS + 1)
+        TestFail("host runs for the semaphore wait");
+
+    PostTick = OS_GetCurrentTime();
+    OS_API_SemPost(EventSem);
+    OS_API_TaskDelay(2);
+    if (EventTick != PostTick)
+        TestFail("semaphore post does not kick the host");
+
+    PollStop = 1;
+    OS_API_CoroutineKick();
+
+    printf("Coroutine test PASSED, %u coroutines of %u bytes in one task\r\n",
+           BLINKERS + READERS + 1, (OS_Uint32_t)sizeof(OS_Coroutine_t));
+    exit(0);
+}
+
+int main(void)
+{
+    OS_Uintptr_t Handle = 0;
+    OS_Uint32_t i = 0;
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_API_QueueCreate(&MsgQueue, sizeof(OS_Uint32_t), 8);
+    OS_API_SemCreate(&Sem, 0);
+    OS_API_SemCreate(&EventSem, 0);
+
+    for (i = 0; i < BLINKERS; i++)
+    {
+        Blinker[i].Period = i % 7 + 1;
+        OS_API_CoroutineCreate(&BlinkerCo[i], BLINK_CO, &Blinker[i]);
+    }
+
+    for (i = 0; i < READERS; i++)
+    {
+        OS_API_CoroutineCreate(&ReaderCo[i], READ_CO, &Reader[i]);
+    }
+
+    OS_API_CoroutineCreate(&SemCo, SEM_CO, OS_NULL);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='H';
+    Param.Priority = 2;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = OS_API_CoroutineHostTask;
+    OS_API_TaskCreate(Param, &Handle);
+
+    Param.Name[0] ='P';
+    Param.TaskEntry = PRODUCER_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    Param.Name[0] ='C';
+    Param.Priority = 3;
+    Param.TaskEntry = CHECK_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_event.h"
+#include "os_kernel.h"
+#include "os_scheduler.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Event group test, three waiters with higher priority than SETTER:
+ * ANY waits for bit0 or bit1, ALL waits for bit1 and bit2 and clears them,
+ * ONE waits for bit2 and clears it, then waits for bit2 again. One set of
+ * bit1|bit2 wakes all of them in one pass, and every waiter sees the flags
+ * before the clear.
+ */
+#define BIT0                        0x01
+#define BIT1                        0x02
+#define BIT2                        0x04
+#define WAIT_TIMEOUT                10
+
+OS_Uint32_t Event = 0;
+volatile OS_Uint32_t Woken = 0;
+
+static void TestCheck(const char *Who, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Event test FAILED in %s\r\n", Who);
+        exit(1);
+    }
+}
+
+void ANY_FUNC(void *param)
+{
+    OS_Uint32_t Flags = 0;
+    OS_Uint32_t Ret = OS_SUCCESS;
+
+    Ret = OS_API_EventWait(Event, BIT0 | BIT1, OS_EVENT_WAIT_ANY, OS_EVENT_KEEP_ON_EXIT, &Flags, OS_EVENT_WAIT_FOREVER);
+    TestCheck("ANY", Ret == OS_SUCCESS && Flags == (BIT1 | BIT2));
+    Woken++;
+}
+
+void ALL_FUNC(void *param)
+{
+    OS_Uint32_t Flags = 0;
+    OS_Uint32_t Ret = OS_SUCCESS;
+
+    Ret = OS_API_EventWait(Event, BIT1 | BIT2, OS_EVENT_WAIT_ALL, OS_EVENT_CLEAR_ON_EXIT, &Flags, WAIT_TIMEOUT * 5);
+    TestCheck("ALL", Ret == OS_SUCCESS && Flags == (BIT1 | BIT2));
+    Woken++;
+}
+
+void ONE_FUNC(void *param)
+{
+    OS_Uint32_t Flags = 0;
+    OS_Uint32_t Ret = OS_SUCCESS;
+
+    Ret = OS_API_EventWait(Event, BIT2, OS_EVENT_WAIT_ALL, OS_EVENT_CLEAR_ON_EXIT, &Flags, OS_EVENT_WAIT_FOREVER);
+    TestCheck("ONE", Ret == OS_SUCCESS && Flags == BIT2);
+    Woken++;
+
+    Ret = OS_API_EventWait(Event, BIT2, OS_EVENT_WAIT_ALL, OS_EVENT_KEEP_ON_EXIT, &Flags, OS_EVENT_WAIT_FOREVER);
+    TestCheck("ONE again", Ret == OS_SUCCESS && Flags == (BIT1 | BIT2));
+    Woken++;
+}
+
+void SETTER_FUNC(void *param)
+{
+    OS_Uint32_t Flags = 0;
+    OS_Uint32_t Start = 0;
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Uint8_t HigherPriorityTaskWoken = 0;
+
+    /* The waiters are asleep now, bit2 alone satisfies ONE only */
+    OS_API_EventSet(Event, BIT2);
+    TestCheck("SETTER bit2", Woken == 1 && OS_API_EventGet(Event) == 0);
+
+    /* Cleared flags wake up nobody */
+    OS_API_EventSet(Event, BIT0 << 8);
+    OS_API_EventClear(Event, BIT0 << 8);
+    TestCheck("SETTER clear", Woken == 1 && OS_API_EventGet(Event) == 0);
+
+    /* Set like an interrupt handler, all of the waiters are woken in one pass */
+    OS_API_EventSetFromISR(Event, BIT1 | BIT2, &HigherPriorityTaskWoken);
+    TestCheck("SETTER woken flag", HigherPriorityTaskWoken == 1);
+    OS_API_YieldFromISR(HigherPriorityTaskWoken);
+    TestCheck("SETTER bit1|bit2", Woken == 4 && OS_API_EventGet(Event) == 0);
+
+    Ret = OS_API_EventWait(Event, BIT0, OS_EVENT_WAIT_ANY, OS_EVENT_KEEP_ON_EXIT, &Flags, 0);
+    TestCheck("SETTER try wait", Ret == OS_EVENT_TRY_WAIT_FAILED);
+
+    Start = OS_GetCurrentTime();
+    Ret = OS_API_EventWait(Event, BIT0, OS_EVENT_WAIT_ANY, OS_EVENT_KEEP_ON_EXIT, &Flags, WAIT_TIMEOUT);
+    TestCheck("SETTER timeout", Ret == OS_EVENT_WAIT_TIMEOUT && OS_GetCurrentTime() - Start >= WAIT_TIMEOUT);
+
+    TestCheck("SETTER mask", OS_API_EventWait(Event, 0, OS_EVENT_WAIT_ANY, OS_EVENT_KEEP_ON_EXIT, &Flags, 0) == OS_EVENT_INVALID_MASK);
+
+    printf("Event test PASSED\r\n");
+    exit(0);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+    OS_Uintptr_t Handle = 0;
+
+    OS_API_KernelInit();
+
+    OS_API_EventCreate(&Event);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+
+    Param.Name[0] ='A';
+    Param.Priority = 4;
+    Param.TaskEntry = ANY_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    Param.Name[0] ='L';
+    Param.Priority = 5;
+    Param.TaskEntry = ALL_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    Param.Name[0] ='O';
+    Param.Priority = 3;
+    Param.TaskEntry = ONE_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    Param.Name[0] ='S';
+    Param.Priority = 2;
+    Param.TaskEntry = SETTER_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
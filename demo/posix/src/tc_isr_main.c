@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arch.h"
+#include "os_lib.h"
+#include "os_sem.h"
+#include "os_queue.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_scheduler.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * FromISR test, the tick hook of the host arch plays an interrupt handler
+ * which runs while MASTER, the lowest task, spins.
+ * 1. SEM, BIN, READER and WRITER block on a semaphore, a binary semaphore,
+ *    an empty queue and a full queue. One interrupt posts both semaphores,
+ *    writes the empty queue and reads the full one. Every post reports a
+ *    higher priority task woken and none of them switches, the single
+ *    OS_API_YieldFromISR at the end switches to WRITER, the highest, in
+ *    the same tick, the others follow in priority order.
+ * 2. A post waking nobody does not report a task woken
+ * 3. EDF_WAITER blocks on a semaphore, RUNNER of the same EDF priority and
+ *    a later deadline spins. The interrupt posts the semaphore, it reports
+ *    a task woken and EDF_WAITER runs in the same tick.
+ */
+#define SEM_PRIO                    3
+#define BIN_PRIO                    4
+#define READER_PRIO                 5
+#define WRITER_PRIO                 6
+#define WOKEN_NUM                   4
+#define EDF_WAITER_PERIOD           50
+#define EDF_RUNNER_PERIOD           1000
+
+OS_Uintptr_t MasterHandle = 0;
+OS_Uint32_t  Sem = 0;
+OS_Uint32_t  BinSem = 0;
+OS_Uint32_t  ReadQueue = 0;
+OS_Uint32_t  WriteQueue = 0;
+OS_Uint32_t  EdfSem = 0;
+OS_Uintptr_t RunnerHandle = 0;
+
+volatile OS_Uint32_t IsrStep = 0;
+volatile OS_Uint32_t IsrFailed = 0;
+volatile OS_Uint32_t IsrTick = 0;
+volatile OS_Uint32_t IsrWoken = 0;
+
+volatile OS_Uint32_t RunPrio[WOKEN_NUM];
+volatile OS_Uint32_t RunTick[WOKEN_NUM];
+volatile OS_Uint32_t RunNr = 0;
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("FromISR test FAILED in step %u\r\n", Step);
+        exit(1);
+    }
+}
+
+/* Failures in the interrupt are reported by MASTER */
+static void IsrCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok && !IsrFailed)
+        IsrFailed = Step;
+}
+
+static void TestIsr(void)
+{
+    OS_Uint32_t Value = 0;
+    OS_Uint8_t Woken = 0;
+    OS_Uint8_t AllWoken = 1;
+    OS_TCB_t *Interrupted = CurrentTCB;
+
+    switch (IsrStep)
+    {
+        case 1:
+            IsrCheck(1, Interrupted == OS_TSK_HANDLE_TO_TCB(MasterHandle));
+
+            IsrCheck(1, OS_API_SemPostFromISR(Sem, &Woken) == OS_SUCCESS);
+            AllWoken &= Woken;
+            Woken = 0;
+            IsrCheck(1, OS_API_BinarySemPostFromISR(BinSem, &Woken) == OS_SUCCESS);
+            AllWoken &= Woken;
+            Woken = 0;
+            Value = WRITER_PRIO;
+            IsrCheck(1, OS_API_QueueWriteFromISR(ReadQueue, &Value, sizeof(Value), &Woken) == OS_SUCCESS);
+            AllWoken &= Woken;
+            Woken = 0;
+            IsrCheck(1, OS_API_QueueReadFromISR(WriteQueue, &Value, sizeof(Value), &Woken) == OS_SUCCESS);
+            AllWoken &= Woken;
+
+            IsrCheck(1, AllWoken == 1);
+            /* Nothing switched yet */
+            IsrCheck(1, CurrentTCB == Interrupted && RunNr == 0);
+
+            IsrTick = OS_GetCurrentTime();
+            IsrStep = 0;
+            OS_API_YieldFromISR(AllWoken);
+            break;
+        case 2:
+            IsrCheck(2, OS_API_SemPostFromISR(Sem, &Woken) == OS_SUCCESS);
+            IsrWoken = Woken;
+            IsrStep = 0;
+            OS_API_YieldFromISR(Woken);
+            break;
+        case 3:
+            IsrCheck(3, Interrupted == OS_TSK_HANDLE_TO_TCB(RunnerHandle));
+            IsrCheck(3, OS_API_SemPostFromISR(EdfSem, &Woken) == OS_SUCCESS);
+            IsrWoken = Woken;
+            IsrTick = OS_GetCurrentTime();
+            IsrStep = 0;
+            OS_API_YieldFromISR(Woken);
+            break;
+        default:
+            break;
+    }
+}
+
+static void WokenRun(OS_Uint32_t Prio)
+{
+    RunTick[RunNr] = OS_GetCurrentTime();
+    RunPrio[RunNr] = Prio;
+    RunNr++;
+}
+
+void SEM_FUNC(void *param)
+{
+    OS_API_SemWait(Sem);
+    WokenRun(SEM_PRIO);
+}
+
+void BIN_FUNC(void *param)
+{
+    OS_API_BinarySemWait(BinSem);
+    WokenRun(BIN_PRIO);
+}
+
+void READER_FUNC(void *param)
+{
+    OS_Uint32_t Value = 0;
+
+    OS_API_QueueRead(ReadQueue, &Value, sizeof(Value));
+    WokenRun(Value == WRITER_PRIO ? READER_PRIO : 0);
+}
+
+void WRITER_FUNC(void *param)
+{
+    OS_Uint32_t Value = 0;
+
+    /* The second write blocks on the full queue */
+    OS_API_QueueWrite(WriteQueue, &Value, sizeof(Value));
+    OS_API_QueueWrite(WriteQueue, &Value, sizeof(Value));
+    WokenRun(WRITER_PRIO);
+}
+
+void EDF_WAITER_FUNC(void *param)
+{
+    OS_API_SemWait(EdfSem);
+
+    TestCheck(IsrFailed, IsrFailed == 0);
+    TestCheck(3, IsrWoken == 1 && OS_GetCurrentTime() == IsrTick);
+
+    printf("FromISR test PASSED\r\n");
+    exit(0);
+}
+
+void EDF_RUNNER_FUNC(void *param)
+{
+    IsrStep = 3;
+    while (1);
+}
+
+static OS_Uintptr_t TaskStart(OS_Int8_t Name, OS_Uint8_t Priority, TaskFunction_t Entry)
+{
+    OS_Uintptr_t Handle = 0;
+    TaskInitParameter Param;
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] = Name;
+    Param.Priority = Priority;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = Entry;
+    TestCheck(0, OS_API_TaskCreate(Param, &Handle) == OS_SUCCESS);
+
+    return Handle;
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_Uint32_t i = 0;
+
+    TestCheck(0, OS_API_SemCreate(&Sem, 0) == OS_SUCCESS);
+    TestCheck(0, OS_API_BinarySemCreate(&BinSem, 0) == OS_SUCCESS);
+    TestCheck(0, OS_API_QueueCreate(&ReadQueue, sizeof(OS_Uint32_t), 1) == OS_SUCCESS);
+    TestCheck(0, OS_API_QueueCreate(&WriteQueue, sizeof(OS_Uint32_t), 1) == OS_SUCCESS);
+    TestCheck(0, OS_API_SemCreate(&EdfSem, 0) == OS_SUCCESS);
+
+    TaskStart('S', SEM_PRIO, SEM_FUNC);
+    TaskStart('B', BIN_PRIO, BIN_FUNC);
+    TaskStart('R', READER_PRIO, READER_FUNC);
+    TaskStart('W', WRITER_PRIO, WRITER_FUNC);
+
+    ARCH_TickHookSet(TestIsr);
+
+    /* Step 1, all of them block, MASTER spins for the interrupt */
+    OS_API_TaskDelay(2);
+    IsrStep = 1;
+    while (RunNr != WOKEN_NUM && !IsrFailed);
+
+    TestCheck(IsrFailed, IsrFailed == 0);
+    TestCheck(1, RunTick[0] == IsrTick);
+    for (i = 0; i < WOKEN_NUM; i++)
+    {
+        TestCheck(1, RunPrio[i] == WRITER_PRIO - i);
+    }
+
+    /* Step 2 */
+    IsrWoken = 1;
+    IsrStep = 2;
+    while (IsrStep != 0);
+    TestCheck(IsrFailed, IsrFailed == 0);
+    TestCheck(2, IsrWoken == 0);
+
+    /* Step 3, both above MASTER, so their periods are set before they run */
+    IsrWoken = 0;
+    OS_API_SchedulerSuspend();
+    TestCheck(3, OS_API_TaskEdfSet(TaskStart('E', OS_EDF_TASK_PRIORITY, EDF_WAITER_FUNC),
+                                   EDF_WAITER_PERIOD, 0) == OS_SUCCESS);
+    RunnerHandle = TaskStart('X', OS_EDF_TASK_PRIORITY, EDF_RUNNER_FUNC);
+    TestCheck(3, OS_API_TaskEdfSet(RunnerHandle, EDF_RUNNER_PERIOD, 0) == OS_SUCCESS);
+    OS_API_SchedulerResume();
+
+    /* EDF_WAITER ends the test */
+    while (1);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='M';
+    Param.Priority = 2;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreate(Param, &MasterHandle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arch.h"
+#include "os_lib.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_scheduler.h"
+#include "os_critical.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Latency statistics test, WAITER(3) blocks on a semaphore MASTER(2) posts.
+ * 1. The post switches to WAITER at once, one wakeup and one switch are
+ *    recorded and the wakeup is not pending any more
+ * 2. MASTER posts with the scheduler suspended and spins SPIN_CYCLES run
+ *    time counter cycles before it resumes, the wakeup and the switch
+ *    recorded are at least that long, in the bucket of that length
+ */
+#define WAITER_PRIO                 3
+#define SPIN_CYCLES                 2000
+/* Far above a wakeup on an idle host */
+#define WAKEUP_MAX_CYCLES           100000
+
+OS_Uint32_t  Sem = 0;
+OS_Uintptr_t WaiterHandle = 0;
+
+volatile OS_Uint32_t WakeNr = 0;
+OS_TaskLatency_t WokenLatency;
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Latency test FAILED in step %u\r\n", Step);
+        exit(1);
+    }
+}
+
+static OS_Uint32_t BucketOf(OS_Uint32_t Cycles)
+{
+    OS_Uint32_t Bucket = 0;
+
+    while ( (Cycles >>= 1) && (Bucket < OS_LATENCY_HIST_BUCKETS - 1) )
+        Bucket++;
+
+    return Bucket;
+}
+
+void WAITER_FUNC(void *param)
+{
+    while (1)
+    {
+        OS_API_SemWait(Sem);
+
+        /* Recorded by the switch to here */
+        OS_API_EnterCritical();
+        OS_Memcpy((void *)&WokenLatency, (void *)&CurrentTCB->Latency, sizeof(OS_TaskLatency_t));
+        OS_API_ExitCritical();
+
+        WakeNr++;
+    }
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_TCB_t *WaiterTCB = OS_TSK_HANDLE_TO_TCB(WaiterHandle);
+    OS_TaskLatency_t Before;
+    OS_Uint32_t Start = 0;
+    OS_Uint32_t Bucket = BucketOf(SPIN_CYCLES);
+
+    /* Step 1 */
+    OS_Memcpy((void *)&Before, (void *)&WaiterTCB->Latency, sizeof(OS_TaskLatency_t));
+    OS_API_SemPost(Sem);
+    TestCheck(1, WakeNr == 1);
+    TestCheck(1, WokenLatency.Wakeup.Count == Before.Wakeup.Count + 1);
+    TestCheck(1, WokenLatency.Switch.Count == Before.Switch.Count + 1);
+    TestCheck(1, WokenLatency.WakeupPending == 0);
+    TestCheck(1, WokenLatency.Wakeup.Max < WAKEUP_MAX_CYCLES);
+
+    /* Step 2 */
+    OS_Memcpy((void *)&Before, (void *)&WaiterTCB->Latency, sizeof(OS_TaskLatency_t));
+    OS_API_SchedulerSuspend();
+    OS_API_SemPost(Sem);
+    Start = ARCH_RunTimeCounterGet();
+    while (ARCH_RunTimeCounterGet() - Start < SPIN_CYCLES);
+    TestCheck(2, WakeNr == 1);
+    OS_API_SchedulerResume();
+
+    TestCheck(2, WakeNr == 2);
+    TestCheck(2, WokenLatency.Wakeup.Count == Before.Wakeup.Count + 1);
+    TestCheck(2, WokenLatency.Wakeup.Max >= SPIN_CYCLES);
+    TestCheck(2, WokenLatency.Switch.Max >= SPIN_CYCLES);
+    /* The long one lands in the bucket of SPIN_CYCLES or a later one */
+    for (; Bucket < OS_LATENCY_HIST_BUCKETS; Bucket++)
+    {
+        if (WokenLatency.Wakeup.Bucket[Bucket] != Before.Wakeup.Bucket[Bucket])
+            break;
+    }
+    TestCheck(2, Bucket < OS_LATENCY_HIST_BUCKETS &&
+                 WokenLatency.Wakeup.Bucket[Bucket] == Before.Wakeup.Bucket[Bucket] + 1);
+
+    printf("Latency test PASSED\r\n");
+    exit(0);
+}
+
+int main(void)
+{
+    OS_Uintptr_t Handle = 0;
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_API_SemCreate(&Sem, 0);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='W';
+    Param.Priority = WAITER_PRIO;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = WAITER_FUNC;
+    OS_API_TaskCreate(Param, &WaiterHandle);
+
+    Param.Name[0] ='M';
+    Param.Priority = 2;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arch.h"
+#include "os_lib.h"
+#include "os_mem.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Heap accounting test, MASTER creates LEAKER above it.
+ * 1. A block allocated before the kernel starts has no owner
+ * 2. The TCB and stack of LEAKER are charged to LEAKER, not to MASTER
+ * 3. Malloc and free of MASTER go up and down its bytes, the peak stays
+ * 4. LEAKER exits with a block not freed, the block is left with no owner
+ *    when LEAKER is freed, and the free of it charges nobody
+ */
+#define WANT_SIZE                   100
+#define LEAKER_STACK_SIZE           1024
+
+OS_Uintptr_t MasterHandle = 0;
+OS_Uintptr_t LeakerHandle = 0;
+
+void *BootBlock = OS_NULL;
+void *LeakBlock = OS_NULL;
+OS_Uint32_t LeakTime = 0;
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Heap accounting test FAILED in step %u\r\n", Step);
+        exit(1);
+    }
+}
+
+static MemBlockDesc_t *TestBlockDesc(void *Block)
+{
+    OS_Uint32_t DescSize = (sizeof(MemBlockDesc_t) + ARCH_BYTE_ALIGNMENT - 1) & ~(OS_Uint32_t)ARCH_BYTE_ALIGNMENT_MASK;
+
+    return (MemBlockDesc_t *)((OS_Uint8_t *)Block - DescSize);
+}
+
+void LEAKER_FUNC(void *param)
+{
+    OS_Uint32_t Bytes = 0;
+    OS_Uint32_t Peak = 0;
+
+    LeakBlock = OS_API_Malloc(WANT_SIZE);
+    LeakTime = OS_GetCurrentTime();
+    TestCheck(4, TestBlockDesc(LeakBlock)->Owner == OS_TSK_HANDLE_TO_TCB(LeakerHandle));
+
+    OS_API_TaskHeapUsageGet(LeakerHandle, &Bytes, &Peak);
+    TestCheck(4, Bytes == Peak && Bytes >= sizeof(OS_TCB_t) + LEAKER_STACK_SIZE + WANT_SIZE);
+}
+
+void MASTER_FUNC(void *param)
+{
+    TaskInitParameter Param;
+    OS_Uint32_t Bytes = 0, Peak = 0;
+    OS_Uint32_t LeakerBytes = 0, LeakerPeak = 0;
+    void *Block = OS_NULL;
+
+    /* Step 1 */
+    TestCheck(1, TestBlockDesc(BootBlock)->Owner == OS_NULL);
+
+    /* Step 2 */
+    OS_API_TaskHeapUsageGet(MasterHandle, &Bytes, &Peak);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='L';
+    Param.Priority = 2;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = LEAKER_STACK_SIZE;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = LEAKER_FUNC;
+    TestCheck(2, OS_API_TaskCreate(Param, &LeakerHandle) == OS_SUCCESS);
+
+    TestCheck(2, TestBlockDesc((void *)LeakerHandle)->Owner == OS_TSK_HANDLE_TO_TCB(LeakerHandle));
+    OS_API_TaskHeapUsageGet(LeakerHandle, &LeakerBytes, &LeakerPeak);
+    TestCheck(2, LeakerBytes >= sizeof(OS_TCB_t) + LEAKER_STACK_SIZE && LeakerBytes == LeakerPeak);
+    OS_API_TaskHeapUsageGet(MasterHandle, &LeakerBytes, &LeakerPeak);
+    TestCheck(2, LeakerBytes == Bytes && LeakerPeak == Peak);
+
+    /* Step 3 */
+    Block = OS_API_Malloc(WANT_SIZE);
+    OS_API_TaskHeapUsageGet(MasterHandle, &LeakerBytes, &LeakerPeak);
+    TestCheck(3, LeakerBytes >= Bytes + WANT_SIZE && LeakerPeak == LeakerBytes);
+    OS_API_Free(Block);
+    OS_API_TaskHeapUsageGet(MasterHandle, &Bytes, &Peak);
+    TestCheck(3, Bytes + WANT_SIZE <= LeakerBytes && Peak == LeakerPeak);
+
+    /* Step 4, LEAKER runs and exits, the idle task frees it */
+    OS_API_TaskDelay(2);
+    TestCheck(4, LeakBlock != OS_NULL);
+    TestCheck(4, TestBlockDesc(LeakBlock)->Owner == OS_NULL && TestBlockDesc(LeakBlock)->AllocTime == LeakTime);
+    OS_API_Free(LeakBlock);
+    OS_API_TaskHeapUsageGet(MasterHandle, &LeakerBytes, OS_NULL);
+    TestCheck(4, LeakerBytes == Bytes);
+
+    TestCheck(5, OS_API_TaskHeapUsageGet(0, &Bytes, &Peak) == OS_NULL_POINTER);
+
+    printf("Heap accounting test PASSED\r\n");
+    exit(0);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    BootBlock = OS_API_Malloc(WANT_SIZE);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='M';
+    Param.Priority = 3;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreate(Param, &MasterHandle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
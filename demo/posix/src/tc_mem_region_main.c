@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_mem.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_error_code.h"
+
+/*
+ * Memory region test, FastRam plays the CCM of the STM32F4, the kernel is
+ * not started.
+ * 1. Add FastRam as a fast region, an overlapped or one more region is refused
+ * 2. Malloc from the fast region, OS_API_Malloc stays in the heap, and the
+ *    free goes back to the region the block is in
+ * 3. The TCB and stack of a task come from the fast region
+ * 4. The fast region is full, the task falls back to the heap
+ */
+#define FAST_RAM_SIZE               (8 * 1024)
+#define STACK_SIZE                  1024
+#define FILLER_SIZE                 64
+
+extern MemZone_t MemRegion[CONFIG_MEM_MAX_REGIONS];
+
+OS_Uint64_t FastRam[FAST_RAM_SIZE / sizeof(OS_Uint64_t)];
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Memory region test FAILED in step %u\r\n", Step);
+        exit(1);
+    }
+}
+
+static OS_Uint32_t InFastRam(void *Addr)
+{
+    return ((OS_Uint8_t *)Addr >= (OS_Uint8_t *)FastRam &&
+            (OS_Uint8_t *)Addr < (OS_Uint8_t *)FastRam + FAST_RAM_SIZE);
+}
+
+void TASK_FUNC(void *param)
+{
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+    OS_Uintptr_t Handle = 0;
+    OS_Uint32_t Region = 0;
+    OS_Uint32_t Other = 0;
+    OS_Uint32_t Remaining = 0;
+    OS_TCB_t *TaskCB = OS_NULL;
+    void *Block = OS_NULL;
+    void *Filler = OS_NULL;
+
+    OS_API_KernelInit();
+
+    /* Step 1 */
+    TestCheck(1, OS_API_MemAddRegion(&Region, FastRam, 8, OS_MEM_ATTR_FAST) == OS_MEM_REGION_INVALID_PARAM);
+    TestCheck(1, OS_API_MemAddRegion(&Region, FastRam, FAST_RAM_SIZE, OS_MEM_ATTR_FAST) == OS_SUCCESS);
+    TestCheck(1, Region != OS_MEM_DEFAULT_REGION);
+    TestCheck(1, OS_API_MemAddRegion(&Other, (OS_Uint8_t *)FastRam + 64, 1024, 0) == OS_MEM_REGION_OVERLAP);
+    TestCheck(1, OS_API_MemAddRegion(&Other, malloc(1024), 1024, 0) == OS_NOT_ENOUGH_MEM_REGION_RESOURCE);
+    Remaining = MemRegion[Region].RemainingSize;
+
+    /* Step 2 */
+    Block = OS_API_MallocFrom(Region, 100);
+    TestCheck(2, Block != OS_NULL && InFastRam(Block));
+    TestCheck(2, MemRegion[Region].RemainingSize < Remaining);
+    TestCheck(2, OS_API_MallocFrom(CONFIG_MEM_MAX_REGIONS, 100) == OS_NULL);
+    Filler = OS_API_Malloc(100);
+    TestCheck(2, Filler != OS_NULL && !InFastRam(Filler));
+    OS_API_Free(Block);
+    OS_API_Free(Filler);
+    TestCheck(2, MemRegion[Region].RemainingSize == Remaining);
+
+    /* Step 3 */
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='T';
+    Param.Priority = 3;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = STACK_SIZE;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = TASK_FUNC;
+    TestCheck(3, OS_API_TaskCreate(Param, &Handle) == OS_SUCCESS);
+    TaskCB = OS_TSK_HANDLE_TO_TCB(Handle);
+    TestCheck(3, InFastRam(TaskCB) && InFastRam(TaskCB->StartOfStack));
+
+    /* Step 4 */
+    /* Small blocks, a big one may round up to a class above the free block */
+    while (MemRegion[Region].RemainingSize > STACK_SIZE / 2)
+    {
+        Filler = OS_API_MallocFrom(Region, FILLER_SIZE);
+        TestCheck(4, Filler != OS_NULL);
+    }
+    TestCheck(4, OS_API_TaskCreate(Param, &Handle) == OS_SUCCESS);
+    TaskCB = OS_TSK_HANDLE_TO_TCB(Handle);
+    TestCheck(4, !InFastRam(TaskCB->StartOfStack));
+
+    printf("Memory region test PASSED\r\n");
+
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "os_lib.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_mutex.h"
+#include "os_kernel.h"
+#include "os_scheduler.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Mutex priority test, LOW(2), MID(4) and TOP(6) share a ceiling mutex of
+ * ceiling 5 and the inheritance mutexes M1 and M2.
+ * 1. LOW runs at the ceiling while it holds the mutex, MID made ready then
+ *    does not preempt it until the unlock
+ * 2. LOW delays with the mutex held, MID blocks on it, LOW hands the mutex
+ *    over at unlock and MID runs at the ceiling too
+ * 3. LOW holds M1, MID holds M2 and blocks on M1, TOP blocks on M2, LOW
+ *    inherits the priority of TOP through MID
+ * 4. LOW holds M1 and M2, MID and TOP block on them, LOW unlocks M2 first
+ *    and keeps the priority of MID
+ * 5. TOP gives up waiting for M1, LOW drops back, the base priority set
+ *    meanwhile takes effect
+ * 6. TOP locks the ceiling mutex above the ceiling and gets an error
+ * 7. MID holds M2 and times out waiting for M1 of LOW, TOP runs before MID
+ *    and blocks on M2, LOW drops back at the timeout and MID inherits TOP
+ */
+#define LOW_PRIO                    2
+#define MID_PRIO                    4
+#define CEILING_PRIO                5
+#define TOP_PRIO                    6
+#define HOLD_TICKS                  5
+/* Host time TOP spins in with the scheduler suspended, longer than HOLD_TICKS */
+#define SPIN_MS                     20
+
+OS_Uint32_t Mutex = 0;
+OS_Uint32_t M1 = 0;
+OS_Uint32_t M2 = 0;
+OS_Uint32_t MidSem = 0;
+OS_Uint32_t TopSem = 0;
+OS_Uintptr_t low_handle = 0;
+OS_Uintptr_t mid_handle = 0;
+OS_Uintptr_t top_handle = 0;
+
+volatile OS_Uint32_t MidStep = 0;
+volatile OS_Uint32_t TopStep = 0;
+
+static OS_Uint64_t HostMs(void)
+{
+    struct timespec Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    return (OS_Uint64_t)Now.tv_sec * 1000 + Now.tv_nsec / 1000000;
+}
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Mutex test FAILED in step %u\r\n", Step);
+        exit(1);
+    }
+}
+
+void MID_FUNC(void *param)
+{
+    /* Step 1 */
+    OS_API_SemWait(MidSem);
+    MidStep = 1;
+
+    /* Step 2, LOW holds the mutex and delays */
+    OS_API_SemWait(MidSem);
+    TestCheck(2, OS_API_MutexLock(Mutex) == OS_SUCCESS);
+    TestCheck(2, OS_API_TaskPriorityGet(mid_handle) == CEILING_PRIO);
+    MidStep = 2;
+    OS_API_MutexUnlock(Mutex);
+    TestCheck(2, OS_API_TaskPriorityGet(mid_handle) == MID_PRIO);
+
+    /* Step 3, LOW holds M1 */
+    OS_API_SemWait(MidSem);
+    OS_API_MutexLock(M2);
+    OS_API_MutexLock(M1);
+    /* TOP still waits for M2 */
+    TestCheck(3, OS_API_TaskPriorityGet(mid_handle) == TOP_PRIO);
+    OS_API_MutexUnlock(M2);
+    TestCheck(3, TopStep == 3);
+    TestCheck(3, OS_API_TaskPriorityGet(mid_handle) == MID_PRIO);
+    OS_API_MutexUnlock(M1);
+    MidStep = 3;
+
+    /* Step 4, LOW holds M1 and M2 */
+    OS_API_SemWait(MidSem);
+    OS_API_MutexLock(M1);
+    OS_API_MutexUnlock(M1);
+    MidStep = 4;
+
+    /* Step 7, LOW holds M1 */
+    OS_API_SemWait(MidSem);
+    OS_API_MutexLock(M2);
+    TestCheck(7, OS_API_MutexLockTimeout(M1, HOLD_TICKS) == OS_MUTEX_WAIT_TIMEOUT);
+    /* TOP blocks on M2 after the timeout, before MID runs again */
+    TestCheck(7, OS_API_TaskPriorityGet(mid_handle) == TOP_PRIO);
+    MidStep = 7;
+    OS_API_MutexUnlock(M2);
+
+    while(1)
+    {
+        OS_API_SemWait(MidSem);
+    }
+}
+
+void TOP_FUNC(void *param)
+{
+    OS_Uint64_t HostStart = 0;
+
+    /* Step 3 */
+    OS_API_SemWait(TopSem);
+    OS_API_MutexLock(M2);
+    TopStep = 3;
+    OS_API_MutexUnlock(M2);
+
+    /* Step 4 */
+    OS_API_SemWait(TopSem);
+    OS_API_MutexLock(M2);
+    TopStep = 4;
+    OS_API_MutexUnlock(M2);
+
+    /* Step 5 */
+    OS_API_SemWait(TopSem);
+    TestCheck(5, OS_API_MutexLockTimeout(M1, HOLD_TICKS) == OS_MUTEX_WAIT_TIMEOUT);
+    TestCheck(5, OS_API_TaskPriorityGet(low_handle) == LOW_PRIO + 1);
+    TopStep = 5;
+
+    /* Step 6 */
+    OS_API_SemWait(TopSem);
+    TestCheck(6, OS_API_MutexLock(Mutex) == OS_MUTEX_CEILING_VIOLATED);
+
+    /* Step 7, MID waits for M1 with M2 held, the timeout passes in suspending */
+    OS_API_SemWait(TopSem);
+    OS_API_SchedulerSuspend();
+    HostStart = HostMs();
+    while (HostMs() - HostStart < SPIN_MS);
+    OS_API_SchedulerResume();
+    /* MID is ready and has not run yet */
+    TestCheck(7, MidStep == 4);
+    TestCheck(7, OS_API_TaskPriorityGet(low_handle) == LOW_PRIO);
+    OS_API_MutexLock(M2);
+    TestCheck(7, MidStep == 7);
+    OS_API_MutexUnlock(M2);
+
+    printf("Mutex test PASSED\r\n");
+    exit(0);
+}
+
+void LOW_FUNC(void *param)
+{
+    TestCheck(0, OS_API_MutexCreateCeiling(&Mutex, OS_MAX_TASK_PRIORITY) == OS_MUTEX_INVALID_CEILING);
+    TestCheck(0, OS_API_MutexCreateCeiling(&Mutex, CEILING_PRIO) == OS_SUCCESS);
+    TestCheck(0, OS_API_MutexCreate(&M1) == OS_SUCCESS);
+    TestCheck(0, OS_API_MutexCreate(&M2) == OS_SUCCESS);
+
+    /* Step 1 */
+    OS_API_MutexLock(Mutex);
+    TestCheck(1, OS_API_TaskPriorityGet(low_handle) == CEILING_PRIO);
+    OS_API_SemPost(MidSem);
+    TestCheck(1, MidStep == 0);
+    OS_API_MutexUnlock(Mutex);
+    TestCheck(1, MidStep == 1);
+    TestCheck(1, OS_API_TaskPriorityGet(low_handle) == LOW_PRIO);
+
+    /* Step 2 */
+    OS_API_MutexLock(Mutex);
+    OS_API_SemPost(MidSem);
+    OS_API_TaskDelay(HOLD_TICKS);
+    TestCheck(2, MidStep == 1);
+    OS_API_MutexUnlock(Mutex);
+    TestCheck(2, MidStep == 2);
+    TestCheck(2, OS_API_TaskPriorityGet(low_handle) == LOW_PRIO);
+
+    /* Step 3 */
+    OS_API_MutexLock(M1);
+    OS_API_SemPost(MidSem);
+    TestCheck(3, OS_API_TaskPriorityGet(low_handle) == MID_PRIO);
+    OS_API_SemPost(TopSem);
+    TestCheck(3, OS_API_TaskPriorityGet(mid_handle) == TOP_PRIO);
+    TestCheck(3, OS_API_TaskPriorityGet(low_handle) == TOP_PRIO);
+    OS_API_MutexUnlock(M1);
+    TestCheck(3, MidStep == 3 && TopStep == 3);
+    TestCheck(3, OS_API_TaskPriorityGet(low_handle) == LOW_PRIO);
+
+    /* Step 4 */
+    OS_API_MutexLock(M1);
+    OS_API_MutexLock(M2);
+    OS_API_SemPost(MidSem);
+    OS_API_SemPost(TopSem);
+    TestCheck(4, OS_API_TaskPriorityGet(low_handle) == TOP_PRIO);
+    OS_API_MutexUnlock(M2);
+    TestCheck(4, TopStep == 4 && MidStep == 3);
+    TestCheck(4, OS_API_TaskPriorityGet(low_handle) == MID_PRIO);
+    OS_API_MutexUnlock(M1);
+    TestCheck(4, MidStep == 4);
+    TestCheck(4, OS_API_TaskPriorityGet(low_handle) == LOW_PRIO);
+
+    /* Step 5 */
+    OS_API_MutexLock(M1);
+    OS_API_SemPost(TopSem);
+    TestCheck(5, OS_API_TaskPriorityGet(low_handle) == TOP_PRIO);
+    OS_API_TaskPrioritySet(low_handle, LOW_PRIO + 1);
+    TestCheck(5, OS_API_TaskPriorityGet(low_handle) == TOP_PRIO);
+    OS_API_TaskDelay(HOLD_TICKS * 2);
+    TestCheck(5, TopStep == 5);
+    OS_API_MutexUnlock(M1);
+    OS_API_TaskPrioritySet(low_handle, LOW_PRIO);
+
+    /* Step 6 */
+    OS_API_SemPost(TopSem);
+
+    /* Step 7 */
+    OS_API_MutexLock(M1);
+    OS_API_SemPost(MidSem);
+    TestCheck(7, OS_API_TaskPriorityGet(low_handle) == MID_PRIO);
+    OS_API_SemPost(TopSem);
+
+    printf("Mutex test FAILED, TOP does not run\r\n");
+    exit(1);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_API_SemCreate(&MidSem, 0);
+    OS_API_SemCreate(&TopSem, 0);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='L';
+    Param.Priority = LOW_PRIO;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = LOW_FUNC;
+    OS_API_TaskCreate(Param, &low_handle);
+
+    Param.Name[0] ='M';
+    Param.Priority = MID_PRIO;
+    Param.TaskEntry = MID_FUNC;
+    OS_API_TaskCreate(Param, &mid_handle);
+
+    Param.Name[0] ='T';
+    Param.Priority = TOP_PRIO;
+    Param.TaskEntry = TOP_FUNC;
+    OS_API_TaskCreate(Param, &top_handle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_notify.h"
+#include "os_kernel.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Task notification test, SENDER notifies WAITER in every way, WAITER
+ * checks the value it gets.
+ * 1. Nothing pending, try wait fails and wait with timeout times out
+ * 2. Set bits before WAITER waits, the bits are or-ed together
+ * 3. Increment three times, WAITER takes the count and clears it
+ * 4. Overwrite twice, the last value wins
+ * 5. WAITER sleeps forever, SENDER wakes it up later
+ */
+#define WAIT_TIMEOUT                10
+
+OS_Uintptr_t sender_handle = 0;
+OS_Uintptr_t waiter_handle = 0;
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Task notify test FAILED in step %u\r\n", Step);
+        exit(1);
+    }
+}
+
+void WAITER_FUNC(void *param)
+{
+    OS_Uint32_t Value = 0;
+    OS_Uint32_t Start = 0;
+    OS_Uint32_t Ret = OS_SUCCESS;
+
+    Ret = OS_API_TaskNotifyWait(OS_NOTIFY_CLEAR_ALL, &Value, 0);
+    TestCheck(1, Ret == OS_NOTIFY_TRY_WAIT_FAILED);
+
+    Start = OS_GetCurrentTime();
+    Ret = OS_API_TaskNotifyWait(OS_NOTIFY_CLEAR_ALL, &Value, WAIT_TIMEOUT);
+    TestCheck(1, Ret == OS_NOTIFY_WAIT_TIMEOUT);
+    TestCheck(1, OS_GetCurrentTime() - Start >= WAIT_TIMEOUT);
+
+    /* Let SENDER notify before waiting */
+    OS_API_TaskDelay(WAIT_TIMEOUT);
+
+    Ret = OS_API_TaskNotifyWait(0x0F, &Value, OS_NOTIFY_WAIT_FOREVER);
+    TestCheck(2, Ret == OS_SUCCESS && Value == 0x111);
+    /* The bits out of the clear mask stay */
+    Ret = OS_API_TaskNotifyWait(OS_NOTIFY_CLEAR_ALL, &Value, 0);
+    TestCheck(2, Ret == OS_NOTIFY_TRY_WAIT_FAILED);
+
+    OS_API_TaskDelay(WAIT_TIMEOUT);
+
+    Ret = OS_API_TaskNotifyWait(OS_NOTIFY_CLEAR_ALL, &Value, WAIT_TIMEOUT);
+    TestCheck(3, Ret == OS_SUCCESS && Value == 0x110 + 3);
+
+    OS_API_TaskDelay(WAIT_TIMEOUT);
+
+    Ret = OS_API_TaskNotifyWait(OS_NOTIFY_CLEAR_ALL, &Value, WAIT_TIMEOUT);
+    TestCheck(4, Ret == OS_SUCCESS && Value == 0xBEEF);
+
+    Start = OS_GetCurrentTime();
+    Ret = OS_API_TaskNotifyWait(OS_NOTIFY_CLEAR_ALL, &Value, OS_NOTIFY_WAIT_FOREVER);
+    TestCheck(5, Ret == OS_SUCCESS && Value == 0x5A5A);
+    TestCheck(5, OS_GetCurrentTime() - Start >= WAIT_TIMEOUT);
+
+    printf("Task notify test PASSED\r\n");
+    exit(0);
+}
+
+void SENDER_FUNC(void *param)
+{
+    /* Notify in the middle of the delays of WAITER */
+    OS_API_TaskDelay(WAIT_TIMEOUT + WAIT_TIMEOUT / 2);
+
+    /* Step 2 */
+    OS_API_TaskNotify(waiter_handle, 0x001, OS_NOTIFY_SET_BITS);
+    OS_API_TaskNotify(waiter_handle, 0x110, OS_NOTIFY_SET_BITS);
+    OS_API_TaskDelay(WAIT_TIMEOUT);
+
+    /* Step 3 */
+    OS_API_TaskNotify(waiter_handle, 0, OS_NOTIFY_INCREMENT);
+    OS_API_TaskNotify(waiter_handle, 0, OS_NOTIFY_INCREMENT);
+    OS_API_TaskNotify(waiter_handle, 0, OS_NOTIFY_INCREMENT);
+    OS_API_TaskDelay(WAIT_TIMEOUT);
+
+    /* Step 4 */
+    OS_API_TaskNotify(waiter_handle, 0xDEAD, OS_NOTIFY_OVERWRITE);
+    OS_API_TaskNotify(waiter_handle, 0xBEEF, OS_NOTIFY_OVERWRITE);
+    OS_API_TaskDelay(WAIT_TIMEOUT * 2);
+
+    /* Step 5, WAITER sleeps forever since the middle of the delay above */
+    TestCheck(5, OS_API_TaskNotify(waiter_handle, 0, OS_NOTIFY_ACTION_MAX) == OS_NOTIFY_INVALID_ACTION);
+    OS_API_TaskNotify(waiter_handle, 0x5A5A, OS_NOTIFY_OVERWRITE);
+
+    while(1)
+    {
+        OS_API_TaskDelay(WAIT_TIMEOUT);
+    }
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='W';
+    Param.Priority = 3;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = WAITER_FUNC;
+    OS_API_TaskCreate(Param, &waiter_handle);
+
+    Param.Name[0] ='S';
+    Param.Priority = 2;
+    Param.TaskEntry = SENDER_FUNC;
+    OS_API_TaskCreate(Param, &sender_handle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_scheduler.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Pended tick test, BUSY suspends the scheduler and spins for SPIN_MS of
+ * host time, longer than SLEEPER delays. The time stands still meanwhile,
+ * then catches up at resume, and SLEEPER preempts BUSY at once.
+ * It repeats for TEST_ROUNDS, the kernel time should keep up with the
+ * host time.
+ */
+#define TEST_ROUNDS                 5
+#define SPIN_MS                     50
+#define SLEEP_TICKS                 10
+#define SLACK_TICKS                 5
+
+volatile OS_Uint32_t SleeperWakeups = 0;
+
+static OS_Uint64_t HostMs(void)
+{
+    struct timespec Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    return (OS_Uint64_t)Now.tv_sec * 1000 + Now.tv_nsec / 1000000;
+}
+
+static void TestCheck(const char *What, OS_Uint32_t Round, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Pended tick test FAILED, %s in round %u\r\n", What, Round);
+        exit(1);
+    }
+}
+
+void SLEEPER_FUNC(void *param)
+{
+    while (1)
+    {
+        OS_API_TaskDelay(SLEEP_TICKS);
+        SleeperWakeups++;
+    }
+}
+
+void BUSY_FUNC(void *param)
+{
+    OS_Uint32_t Round = 0;
+    OS_Uint32_t Start = 0;
+    OS_Uint32_t Wakeups = 0;
+    OS_Uint32_t TestStart = 0;
+    OS_Uint64_t HostStart = 0;
+    OS_Uint64_t HostTestStart = 0;
+    OS_Uint64_t HostElapsed = 0;
+
+    /* Let SLEEPER go to delay */
+    OS_API_TaskDelay(1);
+
+    TestStart = OS_GetCurrentTime();
+    HostTestStart = HostMs();
+
+    for (Round = 0; Round < TEST_ROUNDS; Round++)
+    {
+        Wakeups = SleeperWakeups;
+        Start = OS_GetCurrentTime();
+
+        OS_API_SchedulerSuspend();
+
+        HostStart = HostMs();
+        while (HostMs() - HostStart < SPIN_MS);
+
+        TestCheck("time goes on in suspending", Round, OS_GetCurrentTime() == Start);
+
+        OS_API_SchedulerResume();
+
+        TestCheck("ticks lost", Round, OS_GetCurrentTime() - Start + SLACK_TICKS >= SPIN_MS);
+        TestCheck("sleeper not woken", Round, SleeperWakeups == Wakeups + 1);
+    }
+
+    HostElapsed = HostMs() - HostTestStart;
+    TestCheck("time drifts", Round, OS_GetCurrentTime() - TestStart + SLACK_TICKS >= HostElapsed);
+
+    printf("Pended tick test PASSED, %u ticks in %u ms\r\n", OS_GetCurrentTime() - TestStart, (OS_Uint32_t)HostElapsed);
+    exit(0);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+    OS_Uintptr_t Handle = 0;
+
+    OS_API_KernelInit();
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='S';
+    Param.Priority = 3;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = SLEEPER_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    Param.Name[0] ='B';
+    Param.Priority = 2;
+    Param.TaskEntry = BUSY_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
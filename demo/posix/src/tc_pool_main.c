@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_mem_pool.h"
+#include "os_scheduler.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Memory pool test, MASTER(3) with the waiters MID(4) and TOP(6).
+ * 1. Take all blocks of a static pool, they are apart by the rounded
+ *    block size, then the pool is empty and the high-water stays
+ * 2. A block not of the pool is refused, so is a block freed twice
+ * 3. MID and TOP wait on the empty pool, a free like an interrupt handler
+ *    hands the block over to TOP, the next free to MID
+ * 4. Waiting on the empty pool times out
+ * 5. A pool on heap, destory refused until all blocks are freed, a pool
+ *    too large for 32 bits is refused
+ */
+#define BLOCK_SIZE                  30
+#define BLOCK_NR                    4
+#define WAIT_TICKS                  5
+
+OS_POOL_DEFINE(Msg, BLOCK_SIZE, BLOCK_NR);
+
+OS_Uint32_t Pool = 0;
+OS_Uint32_t HeapPool = 0;
+OS_Uint32_t MidSem = 0;
+OS_Uint32_t TopSem = 0;
+
+void *Blocks[BLOCK_NR];
+void *volatile MidBlock = OS_NULL;
+void *volatile TopBlock = OS_NULL;
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Pool test FAILED in step %u\r\n", Step);
+        exit(1);
+    }
+}
+
+void MID_FUNC(void *param)
+{
+    void *Block = OS_NULL;
+
+    OS_API_SemWait(MidSem);
+    TestCheck(3, OS_API_PoolAllocTimeout(Pool, &Block, OS_POOL_WAIT_FOREVER) == OS_SUCCESS);
+    MidBlock = Block;
+
+    while (1)
+    {
+        OS_API_SemWait(MidSem);
+    }
+}
+
+void TOP_FUNC(void *param)
+{
+    void *Block = OS_NULL;
+
+    OS_API_SemWait(TopSem);
+    TestCheck(3, OS_API_PoolAllocTimeout(Pool, &Block, OS_POOL_WAIT_FOREVER) == OS_SUCCESS);
+    TopBlock = Block;
+
+    while (1)
+    {
+        OS_API_SemWait(TopSem);
+    }
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_Uint32_t i = 0;
+    OS_Uint32_t Used = 0, Peak = 0;
+    OS_Uint32_t Start = 0;
+    void *Block = OS_NULL;
+    OS_Uint8_t HigherPriorityTaskWoken = 0;
+
+    TestCheck(0, OS_API_PoolCreate(&Pool, 0, BLOCK_NR, OS_POOL_STORAGE(Msg)) == OS_POOL_CREATE_INVALID_PARAM);
+    TestCheck(0, OS_API_PoolCreate(&Pool, BLOCK_SIZE, BLOCK_NR, OS_POOL_STORAGE(Msg)) == OS_SUCCESS);
+
+    /* Step 1 */
+    for (i = 0; i < BLOCK_NR; i++)
+    {
+        TestCheck(1, OS_API_PoolAlloc(Pool, &Blocks[i]) == OS_SUCCESS);
+        TestCheck(1, (OS_Uint8_t *)Blocks[i] == (OS_Uint8_t *)OS_POOL_STORAGE(Msg) + i * OS_POOL_BLOCK_SIZE(BLOCK_SIZE));
+    }
+    TestCheck(1, OS_API_PoolAlloc(Pool, &Block) == OS_POOL_TRY_ALLOC_FAILED && Block == OS_NULL);
+    TestCheck(1, OS_API_PoolAllocTimeout(Pool, &Block, 0) == OS_POOL_TRY_ALLOC_FAILED);
+    OS_API_PoolFree(Pool, Blocks[1]);
+    OS_API_PoolFree(Pool, Blocks[2]);
+    OS_API_PoolUsageGet(Pool, &Used, &Peak);
+    TestCheck(1, Used == BLOCK_NR - 2 && Peak == BLOCK_NR);
+    /* The last freed is taken first */
+    TestCheck(1, OS_API_PoolAlloc(Pool, &Block) == OS_SUCCESS && Block == Blocks[2]);
+    TestCheck(1, OS_API_PoolAlloc(Pool, &Block) == OS_SUCCESS && Block == Blocks[1]);
+
+    /* Step 2 */
+    TestCheck(2, OS_API_PoolFree(Pool, (OS_Uint8_t *)Blocks[0] + 1) == OS_POOL_INVALID_BLOCK);
+    TestCheck(2, OS_API_PoolFree(Pool, (OS_Uint8_t *)Blocks[0] - OS_POOL_BLOCK_SIZE(BLOCK_SIZE)) == OS_POOL_INVALID_BLOCK);
+    TestCheck(2, OS_API_PoolFree(Pool, (OS_Uint8_t *)Blocks[0] + BLOCK_NR * OS_POOL_BLOCK_SIZE(BLOCK_SIZE)) == OS_POOL_INVALID_BLOCK);
+    TestCheck(2, OS_API_PoolFree(Pool, Blocks[1]) == OS_SUCCESS);
+    TestCheck(2, OS_API_PoolFree(Pool, Blocks[1]) == OS_POOL_INVALID_BLOCK);
+    OS_API_PoolUsageGet(Pool, &Used, &Peak);
+    TestCheck(2, Used == BLOCK_NR - 1);
+    TestCheck(2, OS_API_PoolAlloc(Pool, &Block) == OS_SUCCESS && Block == Blocks[1]);
+    TestCheck(2, OS_API_PoolAlloc(Pool, &Block) == OS_POOL_TRY_ALLOC_FAILED);
+
+    /* Step 3 */
+    OS_API_SemPost(MidSem);
+    OS_API_SemPost(TopSem);
+    TestCheck(3, MidBlock == OS_NULL && TopBlock == OS_NULL);
+    OS_API_PoolFreeFromISR(Pool, Blocks[3], &HigherPriorityTaskWoken);
+    TestCheck(3, HigherPriorityTaskWoken == 1 && TopBlock == OS_NULL);
+    OS_API_YieldFromISR(HigherPriorityTaskWoken);
+    TestCheck(3, TopBlock == Blocks[3] && MidBlock == OS_NULL);
+    OS_API_PoolFree(Pool, Blocks[0]);
+    TestCheck(3, MidBlock == Blocks[0]);
+    OS_API_PoolUsageGet(Pool, &Used, &Peak);
+    TestCheck(3, Used == BLOCK_NR && Peak == BLOCK_NR);
+
+    /* Step 4 */
+    Start = OS_GetCurrentTime();
+    TestCheck(4, OS_API_PoolAllocTimeout(Pool, &Block, WAIT_TICKS) == OS_POOL_WAIT_TIMEOUT && Block == OS_NULL);
+    TestCheck(4, OS_GetCurrentTime() - Start >= WAIT_TICKS);
+
+    /* Step 5 */
+    TestCheck(5, OS_API_PoolCreate(&HeapPool, BLOCK_SIZE * 8, BLOCK_NR, OS_NULL) == OS_SUCCESS);
+    TestCheck(5, OS_API_PoolAlloc(HeapPool, &Block) == OS_SUCCESS);
+    TestCheck(5, OS_API_PoolDestory(HeapPool) == OS_POOL_DESTORY_BLOCK_IN_USE);
+    TestCheck(5, OS_API_PoolFree(HeapPool, Block) == OS_SUCCESS);
+    TestCheck(5, OS_API_PoolDestory(HeapPool) == OS_SUCCESS);
+    TestCheck(5, OS_API_PoolAlloc(HeapPool, &Block) == OS_POOL_NOT_BEEN_CREATED);
+    TestCheck(5, OS_API_PoolCreate(&HeapPool, 0x10000, 0x10000, OS_NULL) == OS_POOL_CREATE_INVALID_PARAM);
+    TestCheck(5, OS_API_PoolCreate(&HeapPool, 0xFFFFFFFF, 1, OS_NULL) == OS_POOL_CREATE_INVALID_PARAM);
+
+    printf("Pool test PASSED\r\n");
+    exit(0);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+    OS_Uintptr_t Handle = 0;
+
+    OS_API_KernelInit();
+
+    OS_API_SemCreate(&MidSem, 0);
+    OS_API_SemCreate(&TopSem, 0);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='M';
+    Param.Priority = 3;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    Param.Name[0] ='I';
+    Param.Priority = 4;
+    Param.TaskEntry = MID_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    Param.Name[0] ='T';
+    Param.Priority = 6;
+    Param.TaskEntry = TOP_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
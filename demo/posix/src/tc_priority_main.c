@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Priority order test, run with PRIORITIES=256 as well as the default.
+ * MASTER above every worker covers the levels 0 ~ (OS_MAX_TASK_PRIORITY - 2)
+ * in batches, a batch takes every (OS_MAX_TASK_PRIORITY / BATCH_SIZE)th
+ * level, so with more than 32 priorities it has one level in every 32 bit
+ * group. The workers of a batch are created in a scrambled order, then
+ * MASTER delays and they must run from the highest level to the lowest.
+ * The EDF level runs in deadline order and is left out.
+ */
+#define BATCH_SIZE                  8
+#define BATCH_NUM                   (OS_MAX_TASK_PRIORITY / BATCH_SIZE)
+#define WORKER_STACK_SIZE           512
+
+OS_Uintptr_t MasterHandle = 0;
+
+volatile OS_Uint32_t RunLevel[BATCH_SIZE];
+volatile OS_Uint32_t RunNr = 0;
+OS_Uint8_t LevelSeen[OS_MAX_TASK_PRIORITY];
+
+static void TestCheck(OS_Uint32_t Batch, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Priority order test FAILED in batch %u\r\n", Batch);
+        exit(1);
+    }
+}
+
+void WORKER_FUNC(void *param)
+{
+    RunLevel[RunNr++] = (OS_Uint32_t)(OS_Uintptr_t)param;
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_Uint32_t Batch = 0;
+    OS_Uint32_t Index = 0;
+    OS_Uint32_t Level = 0;
+    OS_Uint32_t Created = 0;
+    OS_Uintptr_t Worker = 0;
+    TaskInitParameter Param;
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='W';
+    Param.StackSize = WORKER_STACK_SIZE;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = WORKER_FUNC;
+
+    for (Batch = 0; Batch < BATCH_NUM; Batch++)
+    {
+        RunNr = 0;
+        Created = 0;
+
+        /* Odd slots first, then the even ones, lowest to highest in each */
+        for (Index = 0; Index < BATCH_SIZE; Index++)
+        {
+            if (Index < BATCH_SIZE / 2)
+                Level = Batch + (Index * 2 + 1) * BATCH_NUM;
+            else
+                Level = Batch + (Index - BATCH_SIZE / 2) * 2 * BATCH_NUM;
+
+            if (Level >= OS_MAX_TASK_PRIORITY - 1 || Level == OS_EDF_TASK_PRIORITY)
+                continue;
+
+            Param.Priority = Level;
+            Param.PrivateData = (void *)(OS_Uintptr_t)Level;
+            TestCheck(Batch, OS_API_TaskCreate(Param, &Worker) == OS_SUCCESS);
+            Created++;
+        }
+
+        /* The workers run and return, the idle task frees them */
+        OS_API_TaskDelay(2);
+
+        TestCheck(Batch, RunNr == Created);
+        for (Index = 0; Index < RunNr; Index++)
+        {
+            TestCheck(Batch, Index == 0 || RunLevel[Index] < RunLevel[Index - 1]);
+            LevelSeen[RunLevel[Index]] = 1;
+        }
+    }
+
+    for (Level = 0; Level < OS_MAX_TASK_PRIORITY - 1; Level++)
+    {
+        if (Level != OS_EDF_TASK_PRIORITY && !LevelSeen[Level])
+        {
+            printf("Priority order test FAILED, level %u never runs\r\n", Level);
+            exit(1);
+        }
+    }
+
+    printf("Priority order test PASSED, %u priorities\r\n", OS_MAX_TASK_PRIORITY);
+    exit(0);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='M';
+    Param.Priority = OS_MAX_TASK_PRIORITY - 1;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreate(Param, &MasterHandle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
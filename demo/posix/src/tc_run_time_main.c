@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arch.h"
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Run time test, BUSY(2) never blocks, LAZY(3) wakes up every LAZY_TICKS
+ * and blocks again at once, MASTER(4) reads them over WINDOW_TICKS.
+ * 1. BUSY takes nearly all of the window, LAZY almost nothing
+ * 2. The running task is charged up to the read, MASTER spins SPIN_CYCLES
+ *    between two reads of its own run time
+ */
+#define WINDOW_TICKS                500
+#define LAZY_TICKS                  10
+#define SPIN_CYCLES                 5000
+
+OS_Uintptr_t MasterHandle = 0;
+OS_Uintptr_t BusyHandle = 0;
+OS_Uintptr_t LazyHandle = 0;
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Run time test FAILED in step %u\r\n", Step);
+        exit(1);
+    }
+}
+
+static OS_Uint64_t RunTimeGet(OS_Uintptr_t Handle)
+{
+    OS_Uint64_t RunTime = 0;
+
+    TestCheck(0, OS_API_TaskRunTimeGet(Handle, &RunTime) == OS_SUCCESS);
+
+    return RunTime;
+}
+
+void BUSY_FUNC(void *param)
+{
+    while (1);
+}
+
+void LAZY_FUNC(void *param)
+{
+    while (1)
+    {
+        OS_API_TaskDelay(LAZY_TICKS);
+    }
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_Uint64_t Busy = 0, Lazy = 0, Master = 0;
+    OS_Uint32_t Window = 0;
+    OS_Uint32_t Start = 0;
+
+    TestCheck(0, OS_API_TaskRunTimeGet(MasterHandle, OS_NULL) == OS_NULL_POINTER);
+
+    /* Step 1 */
+    Busy = RunTimeGet(BusyHandle);
+    Lazy = RunTimeGet(LazyHandle);
+    Start = ARCH_RunTimeCounterGet();
+
+    OS_API_TaskDelay(WINDOW_TICKS);
+
+    Busy = RunTimeGet(BusyHandle) - Busy;
+    Lazy = RunTimeGet(LazyHandle) - Lazy;
+    Window = ARCH_RunTimeCounterGet() - Start;
+
+    TestCheck(1, Busy <= Window);
+    TestCheck(1, Busy >= (OS_Uint64_t)Window * 9 / 10);
+    TestCheck(1, Lazy < (OS_Uint64_t)Window / 20);
+    TestCheck(1, Lazy < Busy / 20);
+
+    /* Step 2 */
+    Master = RunTimeGet(MasterHandle);
+    Start = ARCH_RunTimeCounterGet();
+    while (ARCH_RunTimeCounterGet() - Start < SPIN_CYCLES);
+    TestCheck(2, RunTimeGet(MasterHandle) - Master >= SPIN_CYCLES);
+
+    printf("Run time test PASSED, BUSY %lu and LAZY %lu of %u cycles\r\n",
+           (unsigned long)Busy, (unsigned long)Lazy, Window);
+    exit(0);
+}
+
+static OS_Uintptr_t TaskStart(OS_Int8_t Name, OS_Uint8_t Priority, TaskFunction_t Entry)
+{
+    OS_Uintptr_t Handle = 0;
+    TaskInitParameter Param;
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] = Name;
+    Param.Priority = Priority;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = Entry;
+    OS_API_TaskCreate(Param, &Handle);
+
+    return Handle;
+}
+
+int main(void)
+{
+    OS_API_KernelInit();
+
+    BusyHandle = TaskStart('B', 2, BUSY_FUNC);
+    LazyHandle = TaskStart('L', 3, LAZY_FUNC);
+    MasterHandle = TaskStart('M', 4, MASTER_FUNC);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
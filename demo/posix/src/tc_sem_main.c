@@ -0,0 +1,101 @@
+#include "os_mem.h"
+#include "os_list.h"
+#include "os_lib.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_scheduler.h"
+#include "os_critical.h"
+#include "os_time.h"
+#include "os_printk.h"
+#include "os_error_code.h"
+
+OS_Uintptr_t task1_handle = 0;
+OS_Uintptr_t task2_handle = 0;
+OS_Uintptr_t task3_handle = 0;
+
+OS_Uint32_t t1_cnt = 0;
+OS_Uint32_t t2_cnt = 0;
+OS_Uint32_t t3_cnt = 0;
+
+OS_Uint32_t SemHandle = 0;
+
+#define TASK_1_DELAY        100
+
+void TASK1_FUNC(void *param)
+{
+    while(1)
+    {
+        t1_cnt++;
+
+        OS_API_SchedulerSuspend();
+        OS_PRINTK_DEBUG("T1[%04d] Post, CurTime = %d", t1_cnt, OS_GetCurrentTime());
+        OS_API_SchedulerResume();
+
+        OS_API_SemPost(SemHandle);
+
+        OS_API_TaskDelay(TASK_1_DELAY);
+    }
+}
+
+void TASK2_FUNC(void *param)
+{
+    while(1)
+    {
+        OS_API_SemWait(SemHandle);
+
+        t2_cnt++;
+
+        OS_API_SchedulerSuspend();
+        OS_PRINTK_DEBUG("T2[%04d] Wakeup, CurTime = %d", t2_cnt, OS_GetCurrentTime());
+        OS_API_SchedulerResume();
+    }
+}
+
+void TASK3_FUNC(void *param)
+{
+    while(1)
+    {
+        t3_cnt++;
+
+        if (OS_API_SemWaitTimeout(SemHandle, 150) == OS_SEM_WAIT_TIMEOUT)
+        {
+            OS_API_SchedulerSuspend();
+            OS_PRINTK_DEBUG("T3[%04d] Timeout, CurTime = %d", t3_cnt, OS_GetCurrentTime());
+            OS_API_SchedulerResume();
+        }
+    }
+}
+
+int main(void)
+{
+    OS_API_KernelInit();
+
+    OS_Uint32_t TaskInputParam = 1;
+    TaskInitParameter Param;
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='T';
+    Param.Name[1] ='1';
+    Param.Priority = 1;
+    Param.PrivateData = &TaskInputParam;
+    Param.StackSize = 1024;
+    Param.TimeSlice = 1;
+    Param.TaskEntry = TASK1_FUNC;
+    OS_API_TaskCreate(Param, &task1_handle);
+
+    Param.Name[1] ='2';
+    Param.Priority = 3;
+    Param.TaskEntry = TASK2_FUNC;
+    OS_API_TaskCreate(Param, &task2_handle);
+
+    Param.Name[1] ='3';
+    Param.Priority = 2;
+    Param.TaskEntry = TASK3_FUNC;
+    OS_API_TaskCreate(Param, &task3_handle);
+
+    OS_API_SemCreate(&SemHandle, 0);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_sem.h"
+#include "os_mutex.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_critical.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * SMP stress test, every core is a host thread:
+ * 1. WORKER_NUM workers of the same priority increase a counter guarded
+ *    by a mutex, the counter must match the sum of their own counters
+ * 2. PING/PONG are pinned to different cores and bounce semaphores
+ * 3. MON wakes up after TEST_TICKS, checks the invariants and exits
+ */
+#define WORKER_NUM                  (CONFIG_CPU_CORE_NUM * 2)
+#define TEST_TICKS                  3000
+
+OS_Uintptr_t worker_handle[WORKER_NUM];
+OS_Uintptr_t ping_handle = 0;
+OS_Uintptr_t pong_handle = 0;
+OS_Uintptr_t mon_handle = 0;
+
+OS_Uint32_t CounterMutex = 0;
+OS_Uint32_t PingSem = 0;
+OS_Uint32_t PongSem = 0;
+
+volatile OS_Uint32_t SharedCounter = 0;
+volatile OS_Uint32_t WorkerCounter[WORKER_NUM];
+volatile OS_Uint32_t WorkerCoreHits[WORKER_NUM][CONFIG_CPU_CORE_NUM];
+volatile OS_Uint32_t PingCount = 0;
+volatile OS_Uint32_t PongCount = 0;
+volatile OS_Uint32_t AffinityBroken = 0;
+
+void WORKER_FUNC(void *param)
+{
+    OS_Uintptr_t Id = (OS_Uintptr_t)param;
+
+    while(1)
+    {
+        OS_API_MutexLock(CounterMutex);
+        SharedCounter++;
+        WorkerCounter[Id]++;
+        OS_API_MutexUnlock(CounterMutex);
+
+        OS_API_EnterCritical();
+        WorkerCoreHits[Id][OS_CORE_ID()]++;
+        OS_API_ExitCritical();
+
+        if ((WorkerCounter[Id] & 0xFF) == 0)
+            OS_API_TaskDelay(1);
+    }
+}
+
+void PING_FUNC(void *param)
+{
+    while(1)
+    {
+        OS_API_SemPost(PongSem);
+        OS_API_SemWait(PingSem);
+
+        OS_API_EnterCritical();
+        if (OS_CORE_ID() != 0)
+            AffinityBroken++;
+        OS_API_ExitCritical();
+
+        PingCount++;
+    }
+}
+
+void PONG_FUNC(void *param)
+{
+    while(1)
+    {
+        OS_API_SemWait(PongSem);
+
+        OS_API_EnterCritical();
+        if (OS_CORE_ID() != 1)
+            AffinityBroken++;
+        OS_API_ExitCritical();
+
+        PongCount++;
+
+        OS_API_SemPost(PingSem);
+    }
+}
+
+void MON_FUNC(void *param)
+{
+    OS_Uint32_t i = 0, Core = 0;
+    OS_Uint32_t Sum = 0, Shared = 0;
+    OS_Uint32_t CoresUsed = 0;
+    OS_Uint32_t CoreHits[CONFIG_CPU_CORE_NUM] = { 0 };
+
+    OS_API_TaskDelay(TEST_TICKS);
+
+    /* Stop the world, no task of any core can run in critical zone */
+    OS_API_EnterCritical();
+
+    Shared = SharedCounter;
+    for (i = 0; i < WORKER_NUM; i++)
+    {
+        Sum += WorkerCounter[i];
+        for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+            CoreHits[Core] += WorkerCoreHits[i][Core];
+    }
+
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        if (CoreHits[Core] != 0)
+            CoresUsed++;
+    }
+
+    printf("cores %d, workers %d, counter %u, sum %u\r\n",
+           CONFIG_CPU_CORE_NUM, WORKER_NUM, Shared, Sum);
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+        printf("core %u: %u worker rounds\r\n", Core, CoreHits[Core]);
+    printf("ping %u, pong %u, affinity broken %u\r\n", PingCount, PongCount, AffinityBroken);
+
+    if (Shared != Sum || Shared == 0 || CoresUsed < 2 ||
+        PingCount == 0 || PongCount < PingCount || AffinityBroken != 0)
+    {
+        printf("SMP test FAILED\r\n");
+        exit(1);
+    }
+
+    printf("SMP test PASSED\r\n");
+    exit(0);
+}
+
+int main(void)
+{
+    OS_Uintptr_t i = 0;
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_API_MutexCreate(&CounterMutex);
+    OS_API_SemCreate(&PingSem, 0);
+    OS_API_SemCreate(&PongSem, 0);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='W';
+    Param.Priority = 2;
+    Param.StackSize = 1024;
+    Param.TimeSlice = 10;
+    Param.TaskEntry = WORKER_FUNC;
+    for (i = 0; i < WORKER_NUM; i++)
+    {
+        Param.Name[1] = '0' + (OS_Uint8_t)i;
+        Param.PrivateData = (void *)i;
+        OS_API_TaskCreate(Param, &worker_handle[i]);
+    }
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='P';
+    Param.Name[1] ='I';
+    Param.Priority = 3;
+    Param.PrivateData = OS_NULL;
+    Param.TaskEntry = PING_FUNC;
+    OS_API_TaskCreate(Param, &ping_handle);
+    OS_API_TaskAffinitySet(ping_handle, 1 << 0);
+
+    Param.Name[1] ='O';
+    Param.TaskEntry = PONG_FUNC;
+    OS_API_TaskCreate(Param, &pong_handle);
+    OS_API_TaskAffinitySet(pong_handle, 1 << 1);
+
+    Param.Name[0] ='M';
+    Param.Name[1] ='O';
+    Param.Priority = 4;
+    Param.TaskEntry = MON_FUNC;
+    OS_API_TaskCreate(Param, &mon_handle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
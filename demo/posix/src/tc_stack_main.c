@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arch.h"
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_time.h"
+#include "os_critical.h"
+#include "os_error_code.h"
+
+/*
+ * Stack high-water test, MASTER calls a function which touches a buffer of
+ * a known size on its stack, the host stack the task runs on is of
+ * ARCH_POSIX_MIN_STACK_SIZE bytes.
+ * 1. After touching DEPTH bytes the peak is at least DEPTH, and not more
+ *    than DEPTH over the peak before, with room for the call frames. The
+ *    tick is masked meanwhile, its signal frame would go below the buffer.
+ * 2. The peak stays after the function returns
+ * 3. After touching 2 * DEPTH bytes the peak is at least that and grows
+ * 4. An invalid handle reports 0
+ */
+#define DEPTH                       (8 * OS_SIZE_KB)
+/* Frames of the calls around the buffer */
+#define FRAME_SLACK                 (2 * OS_SIZE_KB)
+
+OS_Uintptr_t MasterHandle = 0;
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Stack high-water test FAILED in step %u, peak %u bytes\r\n",
+               Step, OS_API_TaskStackHighWater(MasterHandle));
+        exit(1);
+    }
+}
+
+/* Touch every byte of Depth bytes of stack below the caller */
+static __attribute__((noinline)) void StackTouch(OS_Uint32_t Depth)
+{
+    volatile OS_Uint8_t Buffer[2 * DEPTH];
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < Depth; i++)
+    {
+        Buffer[sizeof(Buffer) - 1 - i] = (OS_Uint8_t)~OS_TASK_MAGIC_NUMBER;
+    }
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_Uint32_t Before = 0;
+    OS_Uint32_t Peak = 0;
+
+    Before = OS_API_TaskStackHighWater(MasterHandle);
+    TestCheck(0, Before != 0 && Before < ARCH_POSIX_MIN_STACK_SIZE / 2);
+
+    /* Step 1 */
+    OS_API_EnterCritical();
+    StackTouch(DEPTH);
+    Peak = OS_API_TaskStackHighWater(MasterHandle);
+    OS_API_ExitCritical();
+    TestCheck(1, Peak >= DEPTH);
+    TestCheck(1, Peak <= Before + DEPTH + FRAME_SLACK);
+
+    /* Step 2 */
+    OS_API_TaskDelay(2);
+    TestCheck(2, OS_API_TaskStackHighWater(MasterHandle) >= Peak);
+
+    /* Step 3 */
+    StackTouch(2 * DEPTH);
+    TestCheck(3, OS_API_TaskStackHighWater(MasterHandle) >= 2 * DEPTH);
+    TestCheck(3, OS_API_TaskStackHighWater(MasterHandle) > Peak);
+
+    /* Step 4 */
+    TestCheck(4, OS_API_TaskStackHighWater(0) == 0);
+
+    printf("Stack high-water test PASSED, %u bytes before, %u after %u bytes touched\r\n",
+           Before, Peak, DEPTH);
+    exit(0);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='M';
+    Param.Priority = 2;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreate(Param, &MasterHandle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
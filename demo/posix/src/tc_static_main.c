@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+#include "arch.h"
+#include "os_lib.h"
+#include "os_mem.h"
+#include "os_task.h"
+#include "os_queue.h"
+#include "os_kernel.h"
+#include "os_critical.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Static creation test, MASTER takes up the whole heap at first, then
+ * creates the tasks and the queue on the storage below again and again.
+ * 0. PRODUCER writes the queue and returns, MASTER reads it out
+ * 1. CONSUMER blocks on the empty queue and MASTER deletes it
+ * The queue is destoryed at the end of every round. The host heap should
+ * not grow either, the arch allocates a context and a host stack even for
+ * a static task.
+ */
+#define TEST_ROUNDS                 1000
+#define MSG_NR                      8
+/* Rounds before the host heap is taken as the base, and how much it may grow */
+#define WARMUP_ROUNDS               4
+#define HOST_HEAP_SLACK             (4 * ARCH_POSIX_MIN_STACK_SIZE)
+
+OS_TASK_DEFINE(Master, 2048);
+OS_TASK_DEFINE(Worker, 2048);
+OS_QUEUE_DEFINE(Msg, sizeof(OS_Uint32_t), MSG_NR);
+
+OS_Uint32_t MsgQueue = 0;
+
+volatile OS_Uint32_t WorkerRuns = 0;
+
+/* Bytes the host heap holds, read with the tick masked, a switch inside malloc would deadlock */
+static OS_Uint64_t HostHeapInUse(void)
+{
+    struct mallinfo2 Info;
+
+    OS_API_EnterCritical();
+    Info = mallinfo2();
+    OS_API_ExitCritical();
+
+    return Info.uordblks + Info.hblkhd;
+}
+
+static void TestFail(const char *What, OS_Uint32_t Ret, OS_Uint32_t Round)
+{
+    printf("Static create test FAILED, %s returns %u in round %u\r\n", What, Ret, Round);
+    exit(1);
+}
+
+void PRODUCER_FUNC(void *param)
+{
+    OS_Uint32_t Msg = 0;
+
+    WorkerRuns++;
+
+    for (Msg = 0; Msg < MSG_NR; Msg++)
+    {
+        OS_API_QueueWrite(MsgQueue, &Msg, sizeof(Msg));
+    }
+}
+
+void CONSUMER_FUNC(void *param)
+{
+    OS_Uint32_t Msg = 0;
+
+    WorkerRuns++;
+
+    OS_API_QueueRead(MsgQueue, &Msg, sizeof(Msg));
+
+    printf("Static create test FAILED, consumer got a message\r\n");
+    exit(1);
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_Uint32_t Round = 0;
+    OS_Uint32_t Msg = 0;
+    OS_Uint32_t Expect = 0;
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Uintptr_t Worker = 0;
+    OS_Uint64_t HostHeap = 0;
+    TaskInitParameter Param;
+
+    /* Nothing below may come from the heap */
+    while (OS_API_Malloc(64) != OS_NULL);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='W';
+    Param.Priority = 3;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = OS_TASK_STACK_SIZE(Worker);
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+
+    if (OS_API_TaskCreate(Param, &Worker) != OS_NOT_ENOUGH_MEM_FOR_TASK_CREATE)
+    {
+        printf("Static create test FAILED, heap is not used up\r\n");
+        exit(1);
+    }
+
+    for (Round = 0; Round < TEST_ROUNDS; Round++)
+    {
+        if (Round == WARMUP_ROUNDS)
+            HostHeap = HostHeapInUse();
+
+        Ret = OS_API_QueueCreateStatic(&MsgQueue, sizeof(OS_Uint32_t), MSG_NR, OS_QUEUE_BUFFER(Msg));
+        if (Ret != OS_SUCCESS)
+            TestFail("queue create", Ret, Round);
+
+        Param.TaskEntry = (Round % 2) ? CONSUMER_FUNC : PRODUCER_FUNC;
+        Ret = OS_API_TaskCreateStatic(Param, OS_TASK_TCB(Worker), OS_TASK_STACK(Worker), &Worker);
+        if (Ret != OS_SUCCESS)
+            TestFail("task create", Ret, Round);
+
+        /* Let the worker fill the queue and return, or block on it */
+        OS_API_TaskDelay(1);
+
+        if (Round % 2)
+        {
+            Ret = OS_API_TaskDelete(Worker);
+            if (Ret != OS_SUCCESS)
+                TestFail("task delete", Ret, Round);
+        }
+        else
+        {
+            for (Expect = 0; Expect < MSG_NR; Expect++)
+            {
+                Ret = OS_API_QueueTryRead(MsgQueue, &Msg, sizeof(Msg));
+                if (Ret != OS_SUCCESS || Msg != Expect)
+                    TestFail("queue read", Ret, Round);
+            }
+        }
+
+        Ret = OS_API_QueueDestory(MsgQueue);
+        if (Ret != OS_SUCCESS)
+            TestFail("queue destory", Ret, Round);
+
+        /* Let the idle task release the worker which returned */
+        OS_API_TaskDelay(1);
+    }
+
+    if (HostHeapInUse() > HostHeap + HOST_HEAP_SLACK)
+    {
+        printf("Static create test FAILED, host heap grows from %lu to %lu bytes\r\n",
+               (unsigned long)HostHeap, (unsigned long)HostHeapInUse());
+        exit(1);
+    }
+
+    printf("Static create test PASSED, %u workers\r\n", WorkerRuns);
+    exit(0);
+}
+
+int main(void)
+{
+    OS_Uintptr_t Master = 0;
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='M';
+    Param.Priority = 2;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = OS_TASK_STACK_SIZE(Master);
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreateStatic(Param, OS_TASK_TCB(Master), OS_TASK_STACK(Master), &Master);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+#include "arch.h"
+#include "os_lib.h"
+#include "os_mem.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_mutex.h"
+#include "os_kernel.h"
+#include "os_critical.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Task delete test, MASTER spawns a transient worker every round, the
+ * worker ends in one of the ways below. The heap only holds a few workers,
+ * so a leaked TCB or stack makes the task create fail soon.
+ * 0. The worker function returns
+ * 1. The worker calls OS_API_TaskExit
+ * 2. The worker blocks on a semaphore and MASTER deletes it
+ * 3. The worker delays and MASTER deletes it
+ * 4. The worker is ready and MASTER deletes it before it runs
+ * 5. The worker blocks with HeldMutex locked and MASTER deletes it, the
+ *    mutex is released
+ * 6. The worker function returns with HeldMutex locked, the mutex goes to
+ *    MASTER waiting for it
+ * 7. The worker blocks on a semaphore and the tick interrupt deletes it,
+ *    nothing of it is freed in the interrupt, the idle task frees it
+ * The host heap should not grow either, the arch allocates a context and a
+ * host stack for every task.
+ */
+#define TEST_ROUNDS                 3000
+#define WORKER_STACK_SIZE           4096
+/* Rounds before the host heap is taken as the base, and how much it may grow */
+#define WARMUP_ROUNDS               14
+#define HOST_HEAP_SLACK             (4 * ARCH_POSIX_MIN_STACK_SIZE)
+
+OS_Uintptr_t master_handle = 0;
+OS_Uint32_t  BlockSem = 0;
+OS_Uint32_t  HeldMutex = 0;
+
+volatile OS_Uint32_t WorkerRuns = 0;
+volatile OS_Uintptr_t IsrDeleteHandle = 0;
+volatile OS_Uint32_t IsrDeleteRet = 0;
+volatile OS_Uint32_t IsrDeleteFreed = 0;
+
+/* Bytes the host heap holds, read with the tick masked, a switch inside malloc would deadlock */
+static OS_Uint64_t HostHeapInUse(void)
+{
+    struct mallinfo2 Info;
+
+    OS_API_EnterCritical();
+    Info = mallinfo2();
+    OS_API_ExitCritical();
+
+    return Info.uordblks + Info.hblkhd;
+}
+
+static MemBlockDesc_t *TestBlockDesc(void *Block)
+{
+    OS_Uint32_t DescSize = (sizeof(MemBlockDesc_t) + ARCH_BYTE_ALIGNMENT - 1) & ~(OS_Uint32_t)ARCH_BYTE_ALIGNMENT_MASK;
+
+    return (MemBlockDesc_t *)((OS_Uint8_t *)Block - DescSize);
+}
+
+/* The TCB block still has its owner until the task is freed */
+static void TestIsr(void)
+{
+    OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(IsrDeleteHandle);
+
+    if (TaskCB == OS_NULL)
+        return;
+
+    IsrDeleteRet = OS_API_TaskDelete(IsrDeleteHandle);
+    IsrDeleteFreed = (TestBlockDesc((void *)TaskCB)->Owner != TaskCB);
+    IsrDeleteHandle = 0;
+}
+
+void WORKER_FUNC(void *param)
+{
+    OS_Uintptr_t Mode = (OS_Uintptr_t)param;
+
+    WorkerRuns++;
+
+    switch (Mode)
+    {
+        case 1:
+            OS_API_TaskExit();
+            break;
+        case 2:
+        case 7:
+            OS_API_SemWait(BlockSem);
+            break;
+        case 3:
+            OS_API_TaskDelay(1000);
+            break;
+        case 5:
+            OS_API_MutexLock(HeldMutex);
+            OS_API_SemWait(BlockSem);
+            break;
+        case 6:
+            OS_API_MutexLock(HeldMutex);
+            /* Wake up after MASTER blocks on the mutex */
+            OS_API_TaskDelay(2);
+            break;
+        default:
+            break;
+    }
+}
+
+void CHECK_FUNC(void *param)
+{
+    if (OS_API_TaskDelete(master_handle) != OS_TSK_DELETE_IN_DELETING)
+    {
+        printf("Task delete test FAILED, master is not in deleting\r\n");
+        exit(1);
+    }
+
+    /* Let the idle task free MASTER */
+    OS_API_TaskDelay(1);
+
+    printf("Task delete test PASSED, %u workers\r\n", WorkerRuns);
+    exit(0);
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_Uintptr_t Round = 0;
+    OS_Uintptr_t Mode = 0;
+    OS_Uintptr_t Worker = 0;
+    OS_Uint32_t  Ret = OS_SUCCESS;
+    OS_Uint64_t  HostHeap = 0;
+    TaskInitParameter Param;
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='W';
+    Param.StackSize = WORKER_STACK_SIZE;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = WORKER_FUNC;
+
+    for (Round = 0; Round < TEST_ROUNDS; Round++)
+    {
+        if (Round == WARMUP_ROUNDS)
+            HostHeap = HostHeapInUse();
+
+        Mode = Round % 8;
+        Param.PrivateData = (void *)Mode;
+        /* The one to delete before it runs is lower than MASTER */
+        Param.Priority = (Mode == 4) ? 1 : 3;
+
+        Ret = OS_API_TaskCreate(Param, &Worker);
+        if (Ret != OS_SUCCESS)
+        {
+            printf("Task delete test FAILED, create returns %u in round %lu\r\n", Ret, (unsigned long)Round);
+            exit(1);
+        }
+
+        /* Let the worker run to its end or block, the lower one stays ready */
+        if (Mode != 4)
+        {
+            OS_API_TaskDelay(1);
+        }
+
+        /* The worker exits with the mutex held while MASTER waits for it */
+        if (Mode == 6)
+        {
+            Ret = OS_API_MutexLock(HeldMutex);
+            if (Ret != OS_SUCCESS)
+            {
+                printf("Task delete test FAILED, mutex lock returns %u in round %lu\r\n", Ret, (unsigned long)Round);
+                exit(1);
+            }
+            OS_API_MutexUnlock(HeldMutex);
+        }
+
+        if (Mode >= 2 && Mode <= 5)
+        {
+            Ret = OS_API_TaskDelete(Worker);
+            if (Ret != OS_SUCCESS)
+            {
+                printf("Task delete test FAILED, delete returns %u in round %lu\r\n", Ret, (unsigned long)Round);
+                exit(1);
+            }
+        }
+
+        if (Mode == 7)
+        {
+            IsrDeleteHandle = Worker;
+            while (IsrDeleteHandle != 0);
+            if (IsrDeleteRet != OS_SUCCESS || IsrDeleteFreed)
+            {
+                printf("Task delete test FAILED, delete in interrupt returns %u, freed %u in round %lu\r\n",
+                       IsrDeleteRet, IsrDeleteFreed, (unsigned long)Round);
+                exit(1);
+            }
+        }
+
+        /* Let the idle task free the workers which deleted themselves */
+        OS_API_TaskDelay(1);
+
+        if (Mode == 5 && OS_API_MutexTryLock(HeldMutex) != OS_SUCCESS)
+        {
+            printf("Task delete test FAILED, mutex not released in round %lu\r\n", (unsigned long)Round);
+            exit(1);
+        }
+        if (Mode == 5)
+        {
+            OS_API_MutexUnlock(HeldMutex);
+        }
+    }
+
+    if (HostHeapInUse() > HostHeap + HOST_HEAP_SLACK)
+    {
+        printf("Task delete test FAILED, host heap grows from %lu to %lu bytes\r\n",
+               (unsigned long)HostHeap, (unsigned long)HostHeapInUse());
+        exit(1);
+    }
+
+    /* At last MASTER deletes itself, CHECK goes on after it is gone */
+    Param.Name[0] ='C';
+    Param.Priority = 1;
+    Param.StackSize = 1024;
+    Param.TaskEntry = CHECK_FUNC;
+    OS_API_TaskCreate(Param, &Worker);
+
+    OS_API_TaskExit();
+
+    printf("Task delete test FAILED, master still running after exit\r\n");
+    exit(1);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_API_SemCreate(&BlockSem, 0);
+    OS_API_MutexCreate(&HeldMutex);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='M';
+    Param.Priority = 2;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreate(Param, &master_handle);
+
+    ARCH_TickHookSet(TestIsr);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "arch.h"
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Tickless idle test, MASTER is the only task of the application and it
+ * delays SLEEP_TICKS, so only the idle task is ready in between.
+ * 1. The idle task sleeps through the trace points, it slept nearly all of
+ *    the ticks, and few tick interrupts came in the meantime
+ * 2. The kernel time stepped by the sleeps goes on with the host time
+ */
+#define SLEEP_TICKS                 2000
+/* The tick interrupts at most, and the host time drift at most, in ticks */
+#define TICK_IRQ_MAX                (SLEEP_TICKS / 20)
+#define DRIFT_MAX_TICKS             20
+
+volatile OS_Uint32_t IdleEnters = 0;
+volatile OS_Uint32_t IdleExits = 0;
+volatile OS_Uint32_t SleptTicks = 0;
+volatile OS_Uint32_t TickIrqs = 0;
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Tickless test FAILED in step %u, %u sleeps of %u ticks, %u tick interrupts\r\n",
+               Step, IdleExits, SleptTicks, TickIrqs);
+        exit(1);
+    }
+}
+
+static void TestIdleEnter(OS_Uint32_t ExpectedIdleTicks)
+{
+    IdleEnters++;
+}
+
+static void TestIdleExit(OS_Uint32_t ElapsedTicks)
+{
+    IdleExits++;
+    SleptTicks += ElapsedTicks;
+}
+
+static void TestTick(void)
+{
+    TickIrqs++;
+}
+
+/* Host time in ticks */
+static OS_Uint64_t HostTicks(void)
+{
+    struct timespec Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    return ((OS_Uint64_t)Now.tv_sec * 1000000 + Now.tv_nsec / 1000) / (1000000 / CONFIG_SYS_TICK_RATE_HZ);
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_Uint32_t KernelStart = 0;
+    OS_Uint32_t KernelTicks = 0;
+    OS_Uint64_t HostStart = 0;
+    OS_Uint64_t HostElapsed = 0;
+
+    /* Let the others settle down */
+    OS_API_TaskDelay(10);
+
+    ARCH_TicklessHookSet(TestIdleEnter, TestIdleExit);
+    ARCH_TickHookSet(TestTick);
+
+    KernelStart = OS_GetCurrentTime();
+    HostStart = HostTicks();
+
+    OS_API_TaskDelay(SLEEP_TICKS);
+
+    KernelTicks = OS_GetCurrentTime() - KernelStart;
+    HostElapsed = HostTicks() - HostStart;
+
+    ARCH_TickHookSet(OS_NULL);
+    ARCH_TicklessHookSet(OS_NULL, OS_NULL);
+
+    /* Step 1 */
+    TestCheck(1, IdleEnters != 0 && IdleExits == IdleEnters);
+    TestCheck(1, SleptTicks >= SLEEP_TICKS - TICK_IRQ_MAX);
+    TestCheck(1, TickIrqs <= TICK_IRQ_MAX);
+
+    /* Step 2 */
+    TestCheck(2, KernelTicks >= SLEEP_TICKS);
+    TestCheck(2, KernelTicks <= HostElapsed + DRIFT_MAX_TICKS &&
+                 HostElapsed <= KernelTicks + DRIFT_MAX_TICKS);
+
+    printf("Tickless test PASSED, %u ticks in %u sleeps, %u tick interrupts, %u kernel ticks in %u host ticks\r\n",
+           SleptTicks, IdleExits, TickIrqs, KernelTicks, (OS_Uint32_t)HostElapsed);
+    exit(0);
+}
+
+int main(void)
+{
+    OS_Uintptr_t Handle = 0;
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='M';
+    Param.Priority = 2;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
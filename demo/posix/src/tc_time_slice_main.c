@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_critical.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Time slice test, MASTER above two equal priority SPIN tasks which never
+ * block, every SPIN logs the tick it starts running at after the other one.
+ * 1. TimeSlice of SLICE_TICKS, they take turns every SLICE_TICKS ticks
+ * 2. OS_TASK_NO_TIME_SLICE, the first one never gives way
+ * 3. TimeSlice of SLICE_TICKS, MASTER preempts them every tick, a preempted
+ *    one resumes with the rest of its slice, so the turns stay the same
+ * 4. A task of idle priority with no time slice runs, the idle task gives way
+ */
+#define SLICE_TICKS                 3
+#define RUN_TICKS                   40
+#define SPIN_PRIO                   2
+#define MAX_SWITCHES                64
+
+OS_Uintptr_t MasterHandle = 0;
+
+volatile OS_Uint32_t LastRunner = 0;
+volatile OS_Uint32_t SwitchTick[MAX_SWITCHES];
+volatile OS_Uint32_t SwitchTask[MAX_SWITCHES];
+volatile OS_Uint32_t SwitchNr = 0;
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Time slice test FAILED in step %u\r\n", Step);
+        exit(1);
+    }
+}
+
+void SPIN_FUNC(void *param)
+{
+    OS_Uint32_t Me = (OS_Uint32_t)(OS_Uintptr_t)param;
+
+    while (1)
+    {
+        /* Tick masked, so the tick logged is the one the switch happened at */
+        OS_API_EnterCritical();
+        if (LastRunner != Me)
+        {
+            if (SwitchNr < MAX_SWITCHES)
+            {
+                SwitchTick[SwitchNr] = OS_GetCurrentTime();
+                SwitchTask[SwitchNr] = Me;
+                SwitchNr++;
+            }
+            LastRunner = Me;
+        }
+        OS_API_ExitCritical();
+    }
+}
+
+static void SpinStart(OS_Uint32_t TimeSlice, OS_Uint8_t Priority, OS_Uint32_t Count, OS_Uintptr_t *Handle)
+{
+    OS_Uint32_t i = 0;
+    TaskInitParameter Param;
+
+    LastRunner = 0;
+    SwitchNr = 0;
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='S';
+    Param.Priority = Priority;
+    Param.StackSize = 1024;
+    Param.TimeSlice = TimeSlice;
+    Param.TaskEntry = SPIN_FUNC;
+
+    for (i = 0; i < Count; i++)
+    {
+        Param.Name[1] = '1' + i;
+        Param.PrivateData = (void *)(OS_Uintptr_t)(i + 1);
+        TestCheck(0, OS_API_TaskCreate(Param, &Handle[i]) == OS_SUCCESS);
+    }
+}
+
+static void SpinStop(OS_Uint32_t Count, OS_Uintptr_t *Handle)
+{
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < Count; i++)
+    {
+        TestCheck(0, OS_API_TaskDelete(Handle[i]) == OS_SUCCESS);
+    }
+}
+
+/* The SPINs take turns and every turn lasts Ticks */
+static void TurnsCheck(OS_Uint32_t Step, OS_Uint32_t Ticks)
+{
+    OS_Uint32_t i = 0;
+
+    TestCheck(Step, SwitchNr >= RUN_TICKS / Ticks - 2);
+    for (i = 1; i < SwitchNr; i++)
+    {
+        if ( (SwitchTask[i] == SwitchTask[i - 1]) ||
+             (SwitchTick[i] - SwitchTick[i - 1] != Ticks) )
+        {
+            printf("Time slice test FAILED in step %u, turn %u at tick %u after %u\r\n",
+                   Step, i, SwitchTick[i], SwitchTick[i - 1]);
+            exit(1);
+        }
+    }
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_Uint32_t i = 0;
+    OS_Uintptr_t Spin[2];
+
+    /* Step 1 */
+    SpinStart(SLICE_TICKS, SPIN_PRIO, 2, Spin);
+    OS_API_TaskDelay(RUN_TICKS);
+    SpinStop(2, Spin);
+    TurnsCheck(1, SLICE_TICKS);
+
+    /* Step 2 */
+    SpinStart(OS_TASK_NO_TIME_SLICE, SPIN_PRIO, 2, Spin);
+    OS_API_TaskDelay(RUN_TICKS);
+    SpinStop(2, Spin);
+    TestCheck(2, SwitchNr == 1 && SwitchTask[0] == 1);
+
+    /* Step 3 */
+    SpinStart(SLICE_TICKS, SPIN_PRIO, 2, Spin);
+    for (i = 0; i < RUN_TICKS; i++)
+    {
+        OS_API_TaskDelay(1);
+    }
+    SpinStop(2, Spin);
+    TurnsCheck(3, SLICE_TICKS);
+
+    /* Step 4 */
+    SpinStart(OS_TASK_NO_TIME_SLICE, 0, 1, Spin);
+    OS_API_TaskDelay(2);
+    SpinStop(1, Spin);
+    TestCheck(4, SwitchNr == 1);
+
+    printf("Time slice test PASSED\r\n");
+    exit(0);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+
+    OS_API_KernelInit();
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='M';
+    Param.Priority = 3;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreate(Param, &MasterHandle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_lib.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_kernel.h"
+#include "os_scheduler.h"
+#include "os_work_queue.h"
+#include "os_time.h"
+#include "os_error_code.h"
+
+/*
+ * Work queue test, a queue of two workers above MASTER.
+ * 1. A batch submitted in one go runs in order on one worker
+ * 2. Submit like an interrupt handler
+ * 3. Delayed works run when due, a later submit with a shorter delay first
+ * 4. Cancel a delayed work, submit a pending one again
+ * 5. A work blocks, the other worker runs the works behind it
+ * 6. A blocking work and another one are queued before any worker runs,
+ *    the other worker runs the second one while the first blocks
+ */
+#define WORKER_PRIO                 5
+#define WORKER_NR                   2
+#define BATCH_NR                    16
+#define LONG_DELAY                  20
+#define SHORT_DELAY                 5
+
+OS_Uint32_t Queue = 0;
+OS_Uint32_t BlockSem = 0;
+
+OS_Work_t Works[BATCH_NR];
+OS_Uintptr_t RunBy[BATCH_NR];
+OS_Uint32_t RunAt[BATCH_NR];
+
+volatile OS_Uint32_t RunCount = 0;
+volatile OS_Uint32_t RunOrder[BATCH_NR];
+
+static void TestCheck(OS_Uint32_t Step, OS_Uint32_t Ok)
+{
+    if (!Ok)
+    {
+        printf("Work queue test FAILED in step %u\r\n", Step);
+        exit(1);
+    }
+}
+
+void RecordWork(void *Arg)
+{
+    OS_Uintptr_t Index = (OS_Uintptr_t)Arg;
+
+    RunBy[Index] = (OS_Uintptr_t)CurrentTCB;
+    RunAt[Index] = OS_GetCurrentTime();
+    RunOrder[RunCount++] = Index;
+}
+
+void BlockWork(void *Arg)
+{
+    RecordWork(Arg);
+    OS_API_SemWait(BlockSem);
+}
+
+static void TestReset(void)
+{
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < BATCH_NR; i++)
+    {
+        OS_API_WorkInit(&Works[i]);
+        RunBy[i] = 0;
+        RunOrder[i] = 0;
+    }
+
+    RunCount = 0;
+}
+
+void MASTER_FUNC(void *param)
+{
+    OS_Uintptr_t i = 0;
+    OS_Uint32_t Start = 0;
+    OS_Uint32_t Other = 0;
+    OS_Uint8_t HigherPriorityTaskWoken = 0;
+
+    TestCheck(0, OS_API_WorkQueueCreate(&Queue, WORKER_PRIO, CONFIG_WORK_QUEUE_MAX_WORKERS + 1, 1024) == OS_WORK_QUEUE_INVALID_WORKERS);
+    TestCheck(0, OS_API_WorkQueueCreate(&Queue, WORKER_PRIO, WORKER_NR, 1024) == OS_SUCCESS);
+    /* The heap can not hold the workers, the slot is given back */
+    TestCheck(0, OS_API_WorkQueueCreate(&Other, WORKER_PRIO, WORKER_NR, CONFIG_TOTAL_HEAP_SIZE / 2) == OS_NOT_ENOUGH_MEM_FOR_TASK_CREATE);
+    TestCheck(0, OS_API_WorkQueueCreate(&Other, WORKER_PRIO, 1, 1024) == OS_SUCCESS && Other != Queue);
+    TestCheck(0, OS_API_WorkQueueCreate(&Other, WORKER_PRIO, 1, 1024) == OS_NOT_ENOUGH_WORK_QUEUE_RESOURCE);
+    /* Let the workers go to sleep */
+    OS_API_TaskDelay(1);
+
+    /* Step 1 */
+    TestReset();
+    OS_API_SchedulerSuspend();
+    for (i = 0; i < BATCH_NR; i++)
+    {
+        TestCheck(1, OS_API_WorkSubmit(Queue, &Works[i], RecordWork, (void *)i) == OS_SUCCESS);
+    }
+    OS_API_SchedulerResume();
+    TestCheck(1, RunCount == BATCH_NR);
+    for (i = 0; i < BATCH_NR; i++)
+    {
+        TestCheck(1, RunOrder[i] == i && RunBy[i] == RunBy[0]);
+    }
+
+    /* Step 2 */
+    TestReset();
+    OS_API_WorkSubmitFromISR(Queue, &Works[0], RecordWork, (void *)0, &HigherPriorityTaskWoken);
+    TestCheck(2, RunCount == 0 && HigherPriorityTaskWoken == 1);
+    OS_API_YieldFromISR(HigherPriorityTaskWoken);
+    TestCheck(2, RunCount == 1);
+
+    /* Step 3 */
+    TestReset();
+    Start = OS_GetCurrentTime();
+    OS_API_WorkSubmitDelayed(Queue, &Works[0], RecordWork, (void *)0, LONG_DELAY);
+    OS_API_WorkSubmitDelayed(Queue, &Works[1], RecordWork, (void *)1, SHORT_DELAY);
+    TestCheck(3, RunCount == 0);
+    OS_API_TaskDelay(LONG_DELAY + 1);
+    TestCheck(3, RunCount == 2 && RunOrder[0] == 1 && RunOrder[1] == 0);
+    TestCheck(3, RunAt[1] - Start >= SHORT_DELAY && RunAt[1] - Start < LONG_DELAY);
+    TestCheck(3, RunAt[0] - Start >= LONG_DELAY);
+
+    /* Step 4 */
+    TestReset();
+    OS_API_WorkSubmitDelayed(Queue, &Works[0], RecordWork, (void *)0, SHORT_DELAY);
+    TestCheck(4, OS_API_WorkSubmit(Queue, &Works[0], RecordWork, (void *)0) == OS_WORK_ALREADY_PENDING);
+    TestCheck(4, OS_API_WorkCancel(&Works[0]) == OS_SUCCESS);
+    TestCheck(4, OS_API_WorkCancel(&Works[0]) == OS_WORK_NOT_PENDING);
+    OS_API_TaskDelay(SHORT_DELAY * 2);
+    TestCheck(4, RunCount == 0);
+    TestCheck(4, OS_API_WorkSubmit(Queue, &Works[0], RecordWork, (void *)0) == OS_SUCCESS);
+    TestCheck(4, RunCount == 1);
+
+    /* Step 5 */
+    TestReset();
+    OS_API_WorkSubmit(Queue, &Works[0], BlockWork, (void *)0);
+    OS_API_WorkSubmit(Queue, &Works[1], RecordWork, (void *)1);
+    OS_API_WorkSubmit(Queue, &Works[2], RecordWork, (void *)2);
+    TestCheck(5, RunCount == 3 && RunBy[1] == RunBy[2] && RunBy[1] != RunBy[0]);
+    OS_API_SemPost(BlockSem);
+
+    /* Step 6 */
+    TestReset();
+    OS_API_SchedulerSuspend();
+    OS_API_WorkSubmit(Queue, &Works[0], BlockWork, (void *)0);
+    OS_API_WorkSubmit(Queue, &Works[1], RecordWork, (void *)1);
+    OS_API_SchedulerResume();
+    TestCheck(6, RunCount == 2 && RunBy[1] != RunBy[0]);
+    OS_API_SemPost(BlockSem);
+
+    printf("Work queue test PASSED\r\n");
+    exit(0);
+}
+
+int main(void)
+{
+    TaskInitParameter Param;
+    OS_Uintptr_t Handle = 0;
+
+    OS_API_KernelInit();
+
+    OS_API_SemCreate(&BlockSem, 0);
+
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] ='M';
+    Param.Priority = 3;
+    Param.PrivateData = OS_NULL;
+    Param.StackSize = 1024;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+    Param.TaskEntry = MASTER_FUNC;
+    OS_API_TaskCreate(Param, &Handle);
+
+    OS_API_KernelStart();
+
+    while(1);
+}
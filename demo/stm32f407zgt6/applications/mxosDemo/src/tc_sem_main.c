@@ -19,9 +19,9 @@ void _delay(uint32_t cnt)
     while(cnt-- != 0);
 }
 
-OS_Uint32_t task1_handle = 0;
-OS_Uint32_t task2_handle = 0;
-OS_Uint32_t task3_handle = 0;
+OS_Uintptr_t task1_handle = 0;
+OS_Uintptr_t task2_handle = 0;
+OS_Uintptr_t task3_handle = 0;
 
 OS_Uint32_t t1_cnt = 0;
 OS_Uint32_t t2_cnt = 0;
@@ -125,6 +125,7 @@ int main(void)
     Param.Priority = 1;
     Param.PrivateData = &TaskInputParam;
     Param.StackSize = 1024;
+    Param.TimeSlice = 1;
     Param.TaskEntry = TASK1_FUNC;
     OS_API_TaskCreate(Param, (void *)&task1_handle);
 
@@ -0,0 +1,167 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef __MXOS_COROUTINE_H__
+#define __MXOS_COROUTINE_H__
+
+#include "os_types.h"
+#include "os_list.h"
+#include "os_sem.h"
+#include "os_queue.h"
+#include "os_error_code.h"
+
+/*
+ * Stackless coroutines, all of them run one after another in the host task
+ * OS_API_CoroutineHostTask and share its stack. A coroutine is a function
+ * which returns at every wait and goes on from there when called again, the
+ * resume point is kept in its control block, so:
+ * 1. local variables do not survive a wait, keep them in PrivateData
+ * 2. the waits can only be used in the coroutine function itself, not in
+ *    the functions it calls, and not inside a switch statement
+ * Example:
+ *     void Blink(OS_Coroutine_t *Co)
+ *     {
+ *         OS_CO_BEGIN(Co);
+ *         while (1)
+ *         {
+ *             LedToggle();
+ *             OS_CO_DELAY(Co, 500);
+ *         }
+ *         OS_CO_END(Co);
+ *     }
+ */
+typedef struct _OS_Coroutine OS_Coroutine_t;
+
+typedef void (*CoroutineFunction_t)(OS_Coroutine_t *Co);
+
+struct _OS_Coroutine {
+    ListHead_t          List;
+    CoroutineFunction_t Entry;
+    void                *PrivateData;
+    /* The time to go on of a delay, or the timeout of a wait */
+    OS_Uint32_t         WakeUpTime;
+    /* The result of the last wait, OS_SUCCESS or OS_COROUTINE_WAIT_TIMEOUT */
+    OS_Uint32_t         Ret;
+    /* The semaphore or queue it waits on, its post or write kicks the host */
+    OS_Uint32_t         WaitHandle;
+    /* The resume point, the line of the last wait */
+    OS_Uint16_t         Line;
+    OS_Uint8_t          State;
+    OS_Uint8_t          WaitOn;
+};
+
+typedef enum _OS_CoroutineState {
+    /* Runs in the next pass */
+    OS_CO_READY = 0,
+    /* Sleeps until WakeUpTime */
+    OS_CO_DELAY,
+    /* Checks its condition every pass, until WakeUpTime if it has timeout */
+    OS_CO_WAIT,
+    OS_CO_WAIT_TIMEOUT,
+    /* Returned from OS_CO_END, the control block can be used again */
+    OS_CO_DONE
+} OS_CoroutineState_e;
+
+typedef enum _OS_CoroutineWaitOn {
+    /* A condition of its own, checked by polling */
+    OS_CO_ON_CONDITION = 0,
+    OS_CO_ON_SEM,
+    OS_CO_ON_QUEUE_READ,
+    OS_CO_ON_QUEUE_WRITE
+} OS_CoroutineWaitOn_e;
+
+#define OS_CO_WAIT_FOREVER                      0xFFFFFFFF
+
+#define OS_CO_BEGIN(Co)                         switch ((Co)->Line) { case 0:
+
+#define OS_CO_END(Co)                           } (Co)->State = OS_CO_DONE; (Co)->Line = 0; return
+
+/* Finish the coroutine right now */
+#define OS_CO_EXIT(Co)                          do { (Co)->State = OS_CO_DONE; (Co)->Line = 0; return; } while (0)
+
+/* Give way to the other coroutines, go on in the next pass */
+#define OS_CO_YIELD(Co)                                                         \
+    do {                                                                        \
+        (Co)->State = OS_CO_READY;                                              \
+        (Co)->Line = __LINE__; return; case __LINE__:;                          \
+    } while (0)
+
+#define OS_CO_DELAY(Co, Ticks)                                                  \
+    do {                                                                        \
+        OS_CoroutineDelay((Co), (Ticks));                                       \
+        (Co)->Line = __LINE__; return; case __LINE__:;                          \
+    } while (0)
+
+/*
+ * Wait until Condition is true or Timeout ticks passed, Co->Ret tells which.
+ * Condition should not block, it is checked in the passes of the host. On
+ * and Handle name the semaphore or queue which makes it true, its post or
+ * write kicks the host, OS_CO_ON_CONDITION is polled every
+ * CONFIG_COROUTINE_POLL_TICKS, OS_API_CoroutineKick makes it check at once.
+ */
+#define OS_CO_WAIT_ON(Co, On, Handle, Condition, Timeout)                       \
+    do {                                                                        \
+        OS_CoroutineWaitStart((Co), (Timeout), (On), (Handle));                 \
+        (Co)->Line = __LINE__;                                                  \
+        /* fallthrough */                                                       \
+        case __LINE__:                                                          \
+        if (Condition)                                                          \
+            (Co)->Ret = OS_SUCCESS;                                             \
+        else if (!OS_CoroutineWaitExpired(Co))                                  \
+            return;                                                             \
+        OS_CoroutineWaitEnd(Co);                                                \
+    } while (0)
+
+#define OS_CO_WAIT_UNTIL(Co, Condition, Timeout)                                \
+    OS_CO_WAIT_ON((Co), OS_CO_ON_CONDITION, 0, (Condition), (Timeout))
+
+#define OS_CO_SEM_WAIT(Co, SemHandle, Timeout)                                  \
+    OS_CO_WAIT_ON((Co), OS_CO_ON_SEM, (SemHandle),                              \
+                  OS_API_SemTryWait(SemHandle) == OS_SUCCESS, (Timeout))
+
+#define OS_CO_QUEUE_READ(Co, QueueHandle, Buffer, Size, Timeout)                \
+    OS_CO_WAIT_ON((Co), OS_CO_ON_QUEUE_READ, (QueueHandle),                     \
+                  OS_API_QueueTryRead((QueueHandle), (Buffer), (Size)) == OS_SUCCESS, (Timeout))
+
+#define OS_CO_QUEUE_WRITE(Co, QueueHandle, Buffer, Size, Timeout)               \
+    OS_CO_WAIT_ON((Co), OS_CO_ON_QUEUE_WRITE, (QueueHandle),                    \
+                  OS_API_QueueTryWrite((QueueHandle), (Buffer), (Size)) == OS_SUCCESS, (Timeout))
+
+OS_Uint32_t OS_API_CoroutineCreate(OS_Coroutine_t *Co, CoroutineFunction_t Entry, void *PrivateData);
+
+void OS_API_CoroutineHostTask(void *PrivateData);
+
+void OS_API_CoroutineKick(void);
+
+void OS_API_CoroutineKickFromISR(OS_Uint8_t *HigherPriorityTaskWoken);
+
+void OS_CoroutineDelay(OS_Coroutine_t *Co, OS_Uint32_t Ticks);
+
+void OS_CoroutineWaitStart(OS_Coroutine_t *Co, OS_Uint32_t Timeout, OS_Uint8_t On, OS_Uint32_t Handle);
+
+OS_Uint8_t OS_CoroutineWaitExpired(OS_Coroutine_t *Co);
+
+void OS_CoroutineWaitEnd(OS_Coroutine_t *Co);
+
+#endif // __MXOS_COROUTINE_H__
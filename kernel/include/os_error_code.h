@@ -40,6 +40,14 @@ typedef enum _OS_ErrorCode {
     OS_RESUME_CUR_TSK,
     OS_RESUME_TSK_NOT_IN_SUSPEND,
     OS_SET_SAME_PRIO,
+    OS_TSK_AFFINITY_INVALID,
+    OS_TSK_EDF_PARAM_INVALID,
+    OS_TSK_EDF_NOT_PERIODIC,
+    OS_TSK_EDF_DEADLINE_MISSED,
+    OS_DELETE_IDLE_TSK,
+    OS_TSK_DELETE_IN_DELETING,
+    OS_DELETE_CUR_TSK_IN_INTR,
+    OS_DELETE_CUR_TSK_IN_SCH_SUSPEND,
     OS_NOT_ENOUGH_SEM_RESOURCE,
     OS_SEM_WAIT_IN_INTR_CONTEXT,
     OS_SEM_WAIT_IN_SCH_SUSPEND,
@@ -87,6 +95,46 @@ typedef enum _OS_ErrorCode {
     OS_SW_TIMER_ALREADY_RUNNING,
     OS_SW_TIMER_NOT_RUNNING,
     OS_SW_TIMER_NOT_STOPPED,
+    OS_NOTIFY_INVALID_ACTION,
+    OS_NOTIFY_INVALID_TIMEOUT,
+    OS_NOTIFY_WAIT_IN_INTR_CONTEXT,
+    OS_NOTIFY_WAIT_IN_SCH_SUSPEND,
+    OS_NOTIFY_TRY_WAIT_FAILED,
+    OS_NOTIFY_WAIT_TIMEOUT,
+    OS_EVENT_HANDLE_INVALID,
+    OS_EVENT_NOT_BEEN_CREATED,
+    OS_NOT_ENOUGH_EVENT_RESOURCE,
+    OS_EVENT_INVALID_MASK,
+    OS_EVENT_INVALID_TIMEOUT,
+    OS_EVENT_WAIT_IN_INTR_CONTEXT,
+    OS_EVENT_WAIT_IN_SCH_SUSPEND,
+    OS_EVENT_TRY_WAIT_FAILED,
+    OS_EVENT_WAIT_TIMEOUT,
+    OS_COROUTINE_WAIT_TIMEOUT,
+    OS_MUTEX_INVALID_CEILING,
+    OS_MUTEX_CEILING_VIOLATED,
+    OS_WORK_QUEUE_HANDLE_INVALID,
+    OS_WORK_QUEUE_NOT_BEEN_CREATED,
+    OS_NOT_ENOUGH_WORK_QUEUE_RESOURCE,
+    OS_WORK_QUEUE_INVALID_WORKERS,
+    OS_WORK_ALREADY_PENDING,
+    OS_WORK_NOT_PENDING,
+    OS_WORK_INVALID_DELAY,
+    OS_POOL_HANDLE_INVALID,
+    OS_POOL_NOT_BEEN_CREATED,
+    OS_NOT_ENOUGH_POOL_RESOURCE,
+    OS_POOL_CREATE_INVALID_PARAM,
+    OS_NOT_ENOUGH_MEM_FOR_POOL_CREATE,
+    OS_POOL_INVALID_TIMEOUT,
+    OS_POOL_WAIT_IN_INTR_CONTEXT,
+    OS_POOL_WAIT_IN_SCH_SUSPEND,
+    OS_POOL_TRY_ALLOC_FAILED,
+    OS_POOL_WAIT_TIMEOUT,
+    OS_POOL_INVALID_BLOCK,
+    OS_POOL_DESTORY_BLOCK_IN_USE,
+    OS_MEM_REGION_INVALID_PARAM,
+    OS_MEM_REGION_OVERLAP,
+    OS_NOT_ENOUGH_MEM_REGION_RESOURCE,
 } OS_ErrorCode_e;
 
 #define OS_CHECK_RETURN(Ret)                \
@@ -0,0 +1,74 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef __MXOS_EVENT_H__
+#define __MXOS_EVENT_H__
+
+#include "os_types.h"
+#include "os_list.h"
+
+typedef struct _OS_Event {
+    /* This list pend all of the waiters, higher priority in front */
+    ListHead_t List;
+    /* This holds the 32 event flags */
+    OS_Uint32_t Flags;
+    OS_Uint8_t Used;
+} OS_Event_t;
+
+typedef enum _OS_EventUsed {
+    OS_EVENT_UNUSED = 0,
+    OS_EVENT_USED
+} OS_EventUsed_e;
+
+typedef enum _OS_EventWaitType {
+    /* Wake up when any flag of the mask is set */
+    OS_EVENT_WAIT_ANY = 0,
+    /* Wake up when all flags of the mask are set */
+    OS_EVENT_WAIT_ALL
+} OS_EventWaitType_e;
+
+typedef enum _OS_EventClearType {
+    OS_EVENT_KEEP_ON_EXIT = 0,
+    /* Clear the flags of the mask when the wait is satisfied */
+    OS_EVENT_CLEAR_ON_EXIT
+} OS_EventClearType_e;
+
+#define OS_EVENT_WAIT_FOREVER                   0xFFFFFFFF
+
+OS_Uint32_t OS_API_EventCreate(OS_Uint32_t *EventHandle);
+
+OS_Uint32_t OS_API_EventWait(OS_Uint32_t EventHandle, OS_Uint32_t Mask, OS_Uint8_t WaitType,
+                             OS_Uint8_t ClearType, OS_Uint32_t *Flags, OS_Uint32_t Timeout);
+
+OS_Uint32_t OS_API_EventSet(OS_Uint32_t EventHandle, OS_Uint32_t Flags);
+
+OS_Uint32_t OS_API_EventSetFromISR(OS_Uint32_t EventHandle, OS_Uint32_t Flags, OS_Uint8_t *HigherPriorityTaskWoken);
+
+OS_Uint32_t OS_API_EventClear(OS_Uint32_t EventHandle, OS_Uint32_t Flags);
+
+OS_Uint32_t OS_API_EventGet(OS_Uint32_t EventHandle);
+
+OS_Uint32_t OS_API_EventDestory(OS_Uint32_t EventHandle);
+
+#endif // __MXOS_EVENT_H__
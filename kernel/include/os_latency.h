@@ -0,0 +1,86 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef __MXOS_LATENCY_H__
+#define __MXOS_LATENCY_H__
+
+#include "os_types.h"
+#include "os_configs.h"
+
+/*
+ * Latency histograms of every task, fed by the trace hooks. Bucket N counts
+ * the latencies in [2^N, 2^(N+1)) run time counter cycles, the last bucket
+ * counts all of the longer ones.
+ *
+ * Wakeup: from the wakeup (delay or block timeout, IPC wakeup) to first run
+ * Switch: from ready (wakeup, resume or preempted) to switched in
+ */
+#define OS_LATENCY_HIST_BUCKETS                 CONFIG_LATENCY_HIST_BUCKETS
+
+#if (OS_LATENCY_HIST_BUCKETS < 2) || (OS_LATENCY_HIST_BUCKETS > 32)
+#error "CONFIG_LATENCY_HIST_BUCKETS should be in 2 ~ 32"
+#endif
+
+typedef struct _OS_LatencyHist {
+    OS_Uint32_t     Bucket[OS_LATENCY_HIST_BUCKETS];
+    OS_Uint32_t     Count;
+    OS_Uint32_t     Max;
+} OS_LatencyHist_t;
+
+typedef struct _OS_TaskLatency {
+    OS_Uint32_t     ReadyStamp;
+    OS_Uint32_t     WakeupStamp;
+    OS_Uint8_t      WakeupPending;
+    OS_LatencyHist_t Wakeup;
+    OS_LatencyHist_t Switch;
+} OS_TaskLatency_t;
+
+struct _OS_TaskControlBlock;
+
+void OS_LatencyTaskInit(struct _OS_TaskControlBlock *TaskCB);
+void OS_LatencyReady(struct _OS_TaskControlBlock *TaskCB);
+void OS_LatencyWakeup(struct _OS_TaskControlBlock *TaskCB);
+void OS_LatencyContextSwitch(struct _OS_TaskControlBlock *Current, struct _OS_TaskControlBlock *Next);
+
+/*
+ * The statistics own these trace points, a user hook of one of them would
+ * replace the hook below and leave the histograms wrong without a word
+ */
+#if defined(TRACE_TaskCreate) || defined(TRACE_AddToTargetList) || defined(TRACE_TaskDelayTimeout) || \
+    defined(TRACE_TaskWakeup) || defined(TRACE_ContextSwitch)
+#error "CONFIG_USE_LATENCY_STATS hooks TRACE_TaskCreate, TRACE_AddToTargetList, TRACE_TaskDelayTimeout, TRACE_TaskWakeup and TRACE_ContextSwitch, turn it off to trace them"
+#endif
+
+#define TRACE_TaskCreate(TaskCB)                            OS_LatencyTaskInit(TaskCB)
+
+#define TRACE_AddToTargetList(List, TaskCB)                 \
+    do { if ((OS_Uint32_t)(List) == TP_READY_LIST) OS_LatencyReady(TaskCB); } while (0)
+
+#define TRACE_TaskDelayTimeout(TaskCB)                      OS_LatencyWakeup(TaskCB)
+
+#define TRACE_TaskWakeup(TaskCB)                            OS_LatencyWakeup(TaskCB)
+
+#define TRACE_ContextSwitch(_Current, _Next, Timestamp)     OS_LatencyContextSwitch(_Current, _Next)
+
+#endif // __MXOS_LATENCY_H__
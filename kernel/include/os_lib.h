@@ -59,11 +59,11 @@ static inline OS_Int32_t OS_Memcmp(const void *cs, const void *ct, OS_Uint32_t c
     return res;
 }
 
-static inline OS_Int32_t OS_DataAlign(OS_Uint32_t data, OS_Uint32_t align, OS_Uint32_t align_mask)
+static inline OS_Uintptr_t OS_DataAlign(OS_Uintptr_t data, OS_Uint32_t align, OS_Uint32_t align_mask)
 {
     if (data & align_mask)
     {
-        data &= (~align_mask);
+        data &= (~(OS_Uintptr_t)align_mask);
         data += align;
     }
     return data;
@@ -33,7 +33,7 @@ typedef struct ListHead {
 
 #define LIST_INVALID_POS            0xdeadbeef
 
-#define OffsetOf(TYPE, MEMBER) ((OS_Uint32_t) &((TYPE *)0)->MEMBER)
+#define OffsetOf(TYPE, MEMBER) ((OS_Uintptr_t) &((TYPE *)0)->MEMBER)
 /**
  * ContainerOf - cast a member of a structure out to the containing structure
  * @ptr:        the pointer to the member.
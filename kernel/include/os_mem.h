@@ -25,30 +25,93 @@
 #ifndef __MXOS_MM_H__
 #define __MXOS_MM_H__
 
+#include "arch.h"
 #include "os_types.h"
 #include "os_list.h"
+#include "os_configs.h"
 /*
- * Memory Manager support multi-zone with different priority
- * In default, the lower index in zone list, the higher priority to be allocated 
+ * Two-Level Segregated Fit memory manager
+ * The first level splits the free blocks by the power of two of their size,
+ * the second level splits every power of two into OS_MEM_SL_COUNT classes.
+ * A bitmap per level finds a non-empty class with no search, and every block
+ * knows the block just below it, so malloc, free and merge are all O(1).
  */
 
-/* MemZone_t is a struct to mamnage the whole memory */
+#if (ARCH_BYTE_ALIGNMENT < 4)
+#error "Memory manager keeps the free flag in bit0 of the block size, needs 4 bytes alignment at least"
+#endif
+
+#if (CONFIG_MEM_TLSF_SL_LOG2 > 5)
+#error "CONFIG_MEM_TLSF_SL_LOG2 should be no more than 5"
+#endif
+
+#define OS_MEM_ALIGN_LOG2           ((ARCH_BYTE_ALIGNMENT >= 32) ? 5 : (ARCH_BYTE_ALIGNMENT >= 16) ? 4 : \
+                                     (ARCH_BYTE_ALIGNMENT >= 8) ? 3 : 2)
+#define OS_MEM_SL_COUNT             (1UL << CONFIG_MEM_TLSF_SL_LOG2)
+/* Blocks smaller than this are all in first level 0, one class every alignment */
+#define OS_MEM_FL_SHIFT             (CONFIG_MEM_TLSF_SL_LOG2 + OS_MEM_ALIGN_LOG2)
+#define OS_MEM_SMALL_BLOCK_SZ       (1UL << OS_MEM_FL_SHIFT)
+#define OS_MEM_FL_COUNT             (CONFIG_MEM_TLSF_FL_MAX_LOG2 - OS_MEM_FL_SHIFT + 1)
+/* The biggest block the memory manager keeps */
+#define OS_MEM_MAX_BLOCK_SZ         ((1UL << CONFIG_MEM_TLSF_FL_MAX_LOG2) - ARCH_BYTE_ALIGNMENT)
+
+#if (CONFIG_MEM_TLSF_FL_MAX_LOG2 > 31) || (OS_MEM_FL_COUNT < 2)
+#error "CONFIG_MEM_TLSF_FL_MAX_LOG2 should be in (OS_MEM_FL_SHIFT + 1) ~ 31"
+#endif
+
+/* Set in the size of a free block */
+#define OS_MEM_BLOCK_FREE           0x01
+
+/* The region of CONFIG_TOTAL_HEAP_SIZE, used by OS_API_Malloc */
+#define OS_MEM_DEFAULT_REGION       0
+
+/* Attributes of a memory region */
+#define OS_MEM_ATTR_DMA             0x01    /* Reachable by the DMA                 */
+#define OS_MEM_ATTR_FAST            0x02    /* Zero wait state, CPU only, as CCM    */
+
+/* MemZone_t is a struct to mamnage a memory region, each has its own free blocks */
 typedef struct _MemZone {
-    ListHead_t  FreeListHead;       /* The free list head of the memory         */
     ListHead_t  UsedListHead;       /* The used list head of the memory         */
-    OS_Uint32_t StartAddr;          /* The start address of the memory          */
+    OS_Uintptr_t StartAddr;         /* The start address of the memory          */
     OS_Uint32_t TotalSize;          /* The total size of the memory(aligned)    */
-    OS_Uint32_t RemainingSize;      /* The remaining size of the memory         */
+    OS_Uint32_t RemainingSize;      /* The size of all the free blocks          */
+    OS_Uint32_t MinRemainingSize;   /* The least remaining size ever            */
+    OS_Uint32_t FailedNr;           /* The times of malloc failed               */
+    OS_Uint32_t Attributes;         /* OS_MEM_ATTR_XXX of the memory            */
+    OS_Uint8_t  Used;               /* The region has been added                */
+    OS_Uint32_t FlBitmap;           /* Bit N set when any class of FL N is free */
+    OS_Uint32_t SlBitmap[OS_MEM_FL_COUNT];
+    ListHead_t  FreeListHead[OS_MEM_FL_COUNT][OS_MEM_SL_COUNT];
 } MemZone_t;
 
 /* MemBlockDesc_t is a struct to present every memory block */
 typedef struct _MemBlockDesc
 {
-    ListHead_t  List;               /* The list node in free list               */
-    OS_Uint32_t Size;               /* The memory block size                    */
+    ListHead_t  List;               /* The list node in free list or used list  */
+    struct _MemBlockDesc *PrevPhys; /* The block just below in address          */
+    OS_Uint32_t Size;               /* The memory block size, with the free flag*/
+#if CONFIG_USE_MEM_ACCOUNTING
+    struct _OS_TaskControlBlock *Owner; /* The task charged, OS_NULL for none */
+    OS_Uint32_t AllocTime;          /* The kernel time of the allocation        */
+#endif
 } MemBlockDesc_t;
 
+#define OS_MEM_BLOCK_SIZE(Desc)     ((Desc)->Size & ~(OS_Uint32_t)OS_MEM_BLOCK_FREE)
+#define OS_MEM_BLOCK_IS_FREE(Desc)  (((Desc)->Size & OS_MEM_BLOCK_FREE) != 0)
+
 void *OS_API_Malloc(OS_Uint32_t sz);
 void OS_API_Free(void *addr);
 
+OS_Uint32_t OS_API_MemAddRegion(OS_Uint32_t *RegionHandle, void *Start, OS_Uint32_t Size, OS_Uint32_t Attributes);
+void *OS_API_MallocFrom(OS_Uint32_t RegionHandle, OS_Uint32_t sz);
+
+void *OS_MemMallocPrefer(OS_Uint32_t Attributes, OS_Uint32_t sz);
+
+#if CONFIG_USE_MEM_ACCOUNTING
+OS_Uint32_t OS_API_TaskHeapUsageGet(OS_Uintptr_t TaskHandle, OS_Uint32_t *Bytes, OS_Uint32_t *PeakBytes);
+
+void OS_MemOwnerSet(void *addr, struct _OS_TaskControlBlock *Owner);
+void OS_MemOwnerRelease(struct _OS_TaskControlBlock *Owner);
+#endif
+
 #endif // !__MXOS_MM_H__
@@ -0,0 +1,103 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef __MXOS_MEM_POOL_H__
+#define __MXOS_MEM_POOL_H__
+
+#include "os_types.h"
+#include "os_list.h"
+
+/*
+ * A pool of fixed size blocks, the free blocks are linked through their
+ * first word, so alloc and free just take and put the list head.
+ */
+typedef struct _OS_Pool {
+    /* This holds the first free block, a free block holds the next one */
+    void           *FreeList;
+    /* This list pend all of the waiters when empty, higher priority in front */
+    ListHead_t      List;
+    /* This is the storage of all blocks */
+    OS_Uint8_t     *Storage;
+    /* One bit per block after the blocks in storage, set while the block is in use */
+    OS_Uint32_t    *InUseMap;
+    OS_Uint32_t     BlockSize;
+    OS_Uint32_t     BlockNr;
+    OS_Uint32_t     FreeNr;
+    /* The least free blocks ever, BlockNr - MinFreeNr is the high-water */
+    OS_Uint32_t     MinFreeNr;
+    OS_Uint8_t      Used;
+    /* This means the storage is given by the caller, not freed on destory */
+    OS_Uint8_t      StaticStorage;
+} OS_Pool_t;
+
+typedef enum _OS_PoolUsed {
+    OS_POOL_UNUSED = 0,
+    OS_POOL_USED
+} OS_PoolUsed_e;
+
+typedef enum _OS_PoolStorage {
+    OS_POOL_HEAP_STORAGE = 0,
+    OS_POOL_STATIC_STORAGE
+} OS_PoolStorage_e;
+
+#define OS_POOL_WAIT_FOREVER                    0xFFFFFFFF
+
+/* Block size in the pool, a free block should hold the pointer to the next one */
+#define OS_POOL_BLOCK_SIZE(BlockSize)                                           \
+    (((BlockSize) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+/* Bytes of the in-use map, a bit for every block */
+#define OS_POOL_MAP_SIZE(BlockNr)                                               \
+    ((((BlockNr) / 32) + (((BlockNr) % 32) != 0)) * sizeof(OS_Uint32_t))
+
+/* Bytes of the storage of a pool, the blocks followed by the in-use map */
+#define OS_POOL_STORAGE_SIZE(BlockSize, BlockNr)                                \
+    (OS_POOL_BLOCK_SIZE(BlockSize) * (BlockNr) + OS_POOL_MAP_SIZE(BlockNr))
+
+/*
+ * Define the storage of a pool at compile time, then create the pool on it
+ * without heap:
+ *     OS_POOL_DEFINE(Msg, sizeof(Msg_t), 16);
+ *     OS_API_PoolCreate(&Handle, sizeof(Msg_t), 16, OS_POOL_STORAGE(Msg));
+ */
+#define OS_POOL_DEFINE(Name, BlockSize, BlockNr)                                \
+    OS_Uint64_t Name##PoolStorage[(OS_POOL_STORAGE_SIZE(BlockSize, BlockNr) + sizeof(OS_Uint64_t) - 1) / sizeof(OS_Uint64_t)]
+
+#define OS_POOL_STORAGE(Name)                   ((void *)Name##PoolStorage)
+
+OS_Uint32_t OS_API_PoolCreate(OS_Uint32_t *PoolHandle, OS_Uint32_t BlockSize, OS_Uint32_t BlockNr, void *Storage);
+
+OS_Uint32_t OS_API_PoolAlloc(OS_Uint32_t PoolHandle, void **Block);
+
+OS_Uint32_t OS_API_PoolAllocTimeout(OS_Uint32_t PoolHandle, void **Block, OS_Uint32_t Timeout);
+
+OS_Uint32_t OS_API_PoolFree(OS_Uint32_t PoolHandle, void *Block);
+
+OS_Uint32_t OS_API_PoolFreeFromISR(OS_Uint32_t PoolHandle, void *Block, OS_Uint8_t *HigherPriorityTaskWoken);
+
+OS_Uint32_t OS_API_PoolUsageGet(OS_Uint32_t PoolHandle, OS_Uint32_t *UsedNr, OS_Uint32_t *PeakNr);
+
+OS_Uint32_t OS_API_PoolDestory(OS_Uint32_t PoolHandle);
+
+#endif // __MXOS_MEM_POOL_H__
@@ -32,8 +32,12 @@
 typedef struct _OS_Mutex {
     ListHead_t  SleepList;
     OS_TCB_t    *Owner;
+    /* Node in MutexHeldList of the owner */
+    ListHead_t  HeldList;
     OS_Uint32_t OwnerHoldCount;
-    OS_Uint8_t  OwnerPriority;
+    /* OS_MutexProtocol_e, and the priority the owner runs at with OS_MUTEX_PRIO_CEILING */
+    OS_Uint8_t  Protocol;
+    OS_Uint8_t  Ceiling;
     OS_Uint8_t  Used;
 } OS_Mutex_t;
 
@@ -42,8 +46,17 @@ typedef enum _OS_MutexUsed {
     OS_MUTEX_USED
 } OS_MutexUsed_e;
 
+typedef enum _OS_MutexProtocol {
+    /* Raise the owner to the priority of a higher task when it blocks */
+    OS_MUTEX_PRIO_INHERIT = 0,
+    /* Raise the locker to the ceiling at once, restore it at unlock */
+    OS_MUTEX_PRIO_CEILING
+} OS_MutexProtocol_e;
+
 OS_Uint32_t OS_API_MutexCreate(OS_Uint32_t *MutexHandle);
 
+OS_Uint32_t OS_API_MutexCreateCeiling(OS_Uint32_t *MutexHandle, OS_Uint32_t Ceiling);
+
 OS_Uint32_t OS_API_MutexLock(OS_Uint32_t MutexHandle);
 
 OS_Uint32_t OS_API_MutexLockTimeout(OS_Uint32_t MutexHandle, OS_Uint32_t Timeout);
@@ -0,0 +1,60 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef __MXOS_NOTIFY_H__
+#define __MXOS_NOTIFY_H__
+
+#include "os_types.h"
+
+/*
+ * Every task owns a 32 bits notification word, other tasks and interrupts
+ * update it with one of the actions below and wake the task up if it is
+ * waiting in OS_API_TaskNotifyWait. No kernel object is needed.
+ */
+typedef enum _OS_NotifyAction {
+    /* Or the value into the word, the word works as event bits */
+    OS_NOTIFY_SET_BITS = 0,
+    /* Add one to the word, the word works as a counting semaphore */
+    OS_NOTIFY_INCREMENT,
+    /* Replace the word with the value, the word works as a mailbox */
+    OS_NOTIFY_OVERWRITE,
+    OS_NOTIFY_ACTION_MAX
+} OS_NotifyAction_e;
+
+typedef enum _OS_NotifyState {
+    OS_NOTIFY_NONE = 0,
+    OS_NOTIFY_WAITING,
+    OS_NOTIFY_PENDING
+} OS_NotifyState_e;
+
+#define OS_NOTIFY_WAIT_FOREVER                  0xFFFFFFFF
+#define OS_NOTIFY_CLEAR_ALL                     0xFFFFFFFF
+
+OS_Uint32_t OS_API_TaskNotify(OS_Uintptr_t TaskHandle, OS_Uint32_t Value, OS_Uint8_t Action);
+
+OS_Uint32_t OS_API_TaskNotifyFromISR(OS_Uintptr_t TaskHandle, OS_Uint32_t Value, OS_Uint8_t Action, OS_Uint8_t *HigherPriorityTaskWoken);
+
+OS_Uint32_t OS_API_TaskNotifyWait(OS_Uint32_t ClearBitsOnExit, OS_Uint32_t *Value, OS_Uint32_t Timeout);
+
+#endif // __MXOS_NOTIFY_H__
@@ -27,6 +27,7 @@
 
 #include "os_types.h"
 #include "os_list.h"
+#include "os_configs.h"
 
 typedef struct _OS_Queue {
     /* This field hold the buffer of the queue */
@@ -43,8 +44,15 @@ typedef struct _OS_Queue {
     OS_Uint32_t     ElementSize;
     /* This means how many element will be managed in this queue */
     OS_Uint32_t     ElementNr;
+#if CONFIG_USE_COROUTINE
+    /* The coroutines waiting to read and to write, a write or read kicks their host task */
+    OS_Uint16_t     CoReaderNr;
+    OS_Uint16_t     CoWriterNr;
+#endif
     /* This stand the status of this queue */
     OS_Uint8_t      Used;
+    /* This means the buffer is given by the caller, not freed on destory */
+    OS_Uint8_t      StaticBuffer;
 } OS_Queue_t;
 
 typedef enum _OS_QueueUsed {
@@ -52,8 +60,26 @@ typedef enum _OS_QueueUsed {
     OS_QUEUE_USED
 } OS_QueueUsed_e;
 
+typedef enum _OS_QueueBuffer {
+    OS_QUEUE_HEAP_BUFFER = 0,
+    OS_QUEUE_STATIC_BUFFER
+} OS_QueueBuffer_e;
+
+/*
+ * Define the buffer of a queue at compile time, then create the queue on it
+ * without heap:
+ *     OS_QUEUE_DEFINE(Msg, sizeof(Msg_t), 8);
+ *     OS_API_QueueCreateStatic(&Handle, sizeof(Msg_t), 8, OS_QUEUE_BUFFER(Msg));
+ */
+#define OS_QUEUE_DEFINE(Name, ElementSize, ElementNr)                           \
+    OS_Uint64_t Name##QueueBuffer[((ElementSize) * (ElementNr) + sizeof(OS_Uint64_t) - 1) / sizeof(OS_Uint64_t)]
+
+#define OS_QUEUE_BUFFER(Name)                   ((void *)Name##QueueBuffer)
+
 OS_Uint32_t OS_API_QueueCreate(OS_Uint32_t *QueueHandle,OS_Uint32_t ElementSize,OS_Uint32_t ElementNr);
 
+OS_Uint32_t OS_API_QueueCreateStatic(OS_Uint32_t *QueueHandle,OS_Uint32_t ElementSize,OS_Uint32_t ElementNr,void *Buffer);
+
 OS_Uint32_t OS_API_QueueWrite(OS_Uint32_t QueueHandle, const void * buffer, OS_Uint32_t size);
 
 OS_Uint32_t OS_API_QueueTryWrite(OS_Uint32_t QueueHandle, const void * buffer, OS_Uint32_t size);
@@ -66,8 +92,16 @@ OS_Uint32_t OS_API_QueueTryRead(OS_Uint32_t QueueHandle, void * buffer, OS_Uint3
 
 OS_Uint32_t OS_API_QueueReadTimeout(OS_Uint32_t QueueHandle, void * buffer, OS_Uint32_t size, OS_Uint32_t Timeout);
 
+OS_Uint32_t OS_API_QueueWriteFromISR(OS_Uint32_t QueueHandle, const void * buffer, OS_Uint32_t size, OS_Uint8_t *HigherPriorityTaskWoken);
+
+OS_Uint32_t OS_API_QueueReadFromISR(OS_Uint32_t QueueHandle, void * buffer, OS_Uint32_t size, OS_Uint8_t *HigherPriorityTaskWoken);
+
 OS_Uint32_t OS_API_QueueDestory(OS_Uint32_t QueueHandle);
 
 OS_Uint32_t OS_API_QueueRemainingSpace(OS_Uint32_t QueueHandle);
 
+#if CONFIG_USE_COROUTINE
+void OS_QueueCoroutineWait(OS_Uint32_t QueueHandle, OS_Uint8_t Writer, OS_Uint8_t Waiting);
+#endif
+
 #endif // __MXOS_QUEUE_H__
@@ -27,18 +27,40 @@
 
 #include "os_task.h"
 #include "os_configs.h"
+#include "os_timer_wheel.h"
 
-typedef struct _OS_TaskScheduler {
+/* The per core part of scheduler, only one of it without SMP */
+typedef struct _OS_CoreRunQueue {
     ListHead_t      ReadyListHead[OS_MAX_TASK_PRIORITY];
-    ListHead_t      BlockTimeoutListHead;
+#if OS_PRIORITY_TWO_LEVEL
+    /* Bit N set means any priority in PriorityActive[N] is active */
+    OS_Uint32_t     PriorityGroup;
+    OS_Uint32_t     PriorityActive[OS_MAX_TASK_PRIORITY / 32];
+#else
+    OS_Uint32_t     PriorityActive;
+#endif
+    OS_Int16_t      SchedulerSuspendNesting;
+    /* Ticks come while the scheduler is suspended, replayed at resume */
+    OS_Uint32_t     PendedTicks;
+    OS_Uint8_t      ReSchedulePending;
+    /* The running task should give way to the equal priority ones */
+    OS_Uint8_t      RoundRobinPending;
+#if CONFIG_USE_RUN_TIME_STATS
+    /* Run time counter when the running task was charged last time */
+    OS_Uint32_t     RunTimeStamp;
+#endif
+} OS_CoreRunQueue_t;
+
+typedef struct _OS_TaskScheduler {
+    OS_CoreRunQueue_t RunQueue[CONFIG_CPU_CORE_NUM];
+    /* Holds both of the delayed tasks and the tasks blocked with timeout */
+    OS_TimerWheel_t TimerWheel;
     ListHead_t      SuspendListHead;
-    ListHead_t      DelayListHead;
+    /* Deleted tasks still in use by a core, freed by the idle task */
+    ListHead_t      TerminateListHead;
 #if CONFIG_USE_SHELL
     ListHead_t      AllTasksListHead;
 #endif
-    OS_Uint32_t     PriorityActive;
-    OS_Int16_t      SchedulerSuspendNesting;
-    OS_Uint8_t      ReSchedulePending;
 } OS_TaskScheduler_t;
 
 typedef enum _OS_SchedulerStateList {
@@ -65,6 +87,7 @@ typedef enum _OS_SchedulerReschPending {
 
 void OS_API_SchedulerSuspend(void);
 void OS_API_SchedulerResume(void);
+void OS_API_YieldFromISR(OS_Uint8_t HigherPriorityTaskWoken);
 void OS_SystemTickHander(void);
 
 #endif // __MXOS_SCHEDULER_H__
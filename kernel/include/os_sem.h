@@ -27,10 +27,15 @@
 
 #include "os_types.h"
 #include "os_list.h"
+#include "os_configs.h"
 
 typedef struct _OS_Sem {
     ListHead_t List;
     OS_Uint32_t Count;
+#if CONFIG_USE_COROUTINE
+    /* The coroutines waiting on it, a post kicks their host task */
+    OS_Uint16_t CoWaiterNr;
+#endif
     OS_Uint8_t Used;
 } OS_Sem_t;
 
@@ -54,6 +59,13 @@ OS_Uint32_t OS_API_BinarySemTryWait(OS_Uint32_t SemHandle);
 OS_Uint32_t OS_API_SemPost(OS_Uint32_t SemHandle);
 OS_Uint32_t OS_API_BinarySemPost(OS_Uint32_t SemHandle);
 
+OS_Uint32_t OS_API_SemPostFromISR(OS_Uint32_t SemHandle, OS_Uint8_t *HigherPriorityTaskWoken);
+OS_Uint32_t OS_API_BinarySemPostFromISR(OS_Uint32_t SemHandle, OS_Uint8_t *HigherPriorityTaskWoken);
+
 OS_Uint32_t OS_API_SemDestory(OS_Uint32_t SemHandle);
 
+#if CONFIG_USE_COROUTINE
+void OS_SemCoroutineWait(OS_Uint32_t SemHandle, OS_Uint8_t Waiting);
+#endif
+
 #endif // __MXOS_SEM_H__
@@ -29,7 +29,13 @@
 #include "os_configs.h"
 #include "os_list.h"
 
-#define OS_MAX_TASK_PRIORITY                    32
+#if CONFIG_USE_LATENCY_STATS
+#include "os_latency.h"
+#endif
+
+#define OS_MAX_TASK_PRIORITY                    CONFIG_MAX_TASK_PRIORITY
+/* More than 32 priorities are searched by a group word and a word per 32 priorities */
+#define OS_PRIORITY_TWO_LEVEL                   (OS_MAX_TASK_PRIORITY > 32)
 #define OS_TASK_MAGIC_NUMBER                    0xA5
 #define OS_TASK_STACK_BOUNDARY                  0xA5A5A5A5
 
@@ -37,9 +43,10 @@ typedef void (*TaskFunction_t)(void *PrivateData);
 
 typedef struct _OS_TaskControlBlock {
     void            *Stack;
-#if CONFIG_STACK_OVERFLOW_CHECK
     void            *StartOfStack;
-#endif
+    OS_Uint32_t     StackSize;
+    /* OS_TASK_STATIC_ALLOC if the TCB and stack are given by the caller */
+    OS_Uint8_t      StaticAlloc;
     OS_Uint8_t      Priority;
     ListHead_t      StateList;
     ListHead_t      IpcSleepList;
@@ -50,6 +57,57 @@ typedef struct _OS_TaskControlBlock {
     OS_Uint8_t      State;
     OS_Int8_t       TaskName[CONFIG_TASK_NAME_LEN];
     OS_Uint32_t     WakeUpTime;
+    /* Ticks to run before the equal priority tasks take turns, 0 means never */
+    OS_Uint32_t     TimeSlice;
+    OS_Uint32_t     RemainingSlice;
+#if CONFIG_USE_RUN_TIME_STATS
+    /* Run time counter cycles the task has been running */
+    OS_Uint64_t     RunTime;
+    OS_Uint64_t     RunTimeSnapshot;
+#endif
+#if CONFIG_USE_LATENCY_STATS
+    OS_TaskLatency_t Latency;
+#endif
+#if CONFIG_USE_MUTEX
+    /* Priority without inheritance or ceiling, Priority is the effective one */
+    OS_Uint8_t      BasePriority;
+    /* The mutexes held, and the one the task blocks on */
+    ListHead_t      MutexHeldList;
+    struct _OS_Mutex *MutexWait;
+#endif
+#if CONFIG_USE_EVENT
+    /* The mask waited for, then the flags which woke the task up */
+    OS_Uint32_t     EventWaitBits;
+    OS_Uint8_t      EventWaitOption;
+#endif
+#if CONFIG_USE_MEM_ACCOUNTING
+    /* Heap bytes allocated by the task and not freed yet, with block descriptors */
+    OS_Uint32_t     HeapBytes;
+    OS_Uint32_t     HeapPeakBytes;
+#endif
+#if CONFIG_USE_MEM_POOL
+    /* The block handed over by the free while waiting on an empty pool */
+    void            *PoolBlock;
+#endif
+#if CONFIG_USE_TASK_NOTIFY
+    /* Notification word and OS_NotifyState_e, see os_notify.h */
+    OS_Uint32_t     NotifyValue;
+    OS_Uint8_t      NotifyState;
+#endif
+#if CONFIG_USE_EDF
+    /* Absolute deadline, orders the tasks of OS_EDF_TASK_PRIORITY */
+    OS_Uint32_t     Deadline;
+    /* Start of the current period, 0 Period means not periodic */
+    OS_Uint32_t     Release;
+    OS_Uint32_t     Period;
+    OS_Uint32_t     RelativeDeadline;
+#endif
+#if (CONFIG_CPU_CORE_NUM > 1)
+    /* Bit N set means the task is allowed to run on core N */
+    OS_Uint32_t     Affinity;
+    /* The core whose ready list holds the task */
+    OS_Uint8_t      Core;
+#endif
 } OS_TCB_t;
 
 typedef struct _TaskInitParameter {
@@ -58,15 +116,41 @@ typedef struct _TaskInitParameter {
     OS_Int8_t       Name[CONFIG_TASK_NAME_LEN];
     OS_Uint32_t     StackSize;
     void            *PrivateData;
+    /* Round robin quantum in ticks, OS_TASK_NO_TIME_SLICE to run until block or yield */
+    OS_Uint32_t     TimeSlice;
 } TaskInitParameter;
 
+#define OS_TASK_NO_TIME_SLICE                   0
+
+typedef enum _OS_TaskAlloc {
+    OS_TASK_HEAP_ALLOC = 0,
+    OS_TASK_STATIC_ALLOC
+} OS_TaskAlloc_e;
+
+/*
+ * Define the TCB and stack storage of a task at compile time, then create
+ * the task on it without heap:
+ *     OS_TASK_DEFINE(Worker, 1024);
+ *     Param.StackSize = OS_TASK_STACK_SIZE(Worker);
+ *     OS_API_TaskCreateStatic(Param, OS_TASK_TCB(Worker), OS_TASK_STACK(Worker), &Handle);
+ * The stack is an array of 8 bytes words, which meets the stack alignment.
+ */
+#define OS_TASK_DEFINE(Name, StackSize)                                         \
+    OS_TCB_t    Name##TaskTCB;                                                  \
+    OS_Uint64_t Name##TaskStack[((StackSize) + sizeof(OS_Uint64_t) - 1) / sizeof(OS_Uint64_t)]
+
+#define OS_TASK_TCB(Name)                       (&Name##TaskTCB)
+#define OS_TASK_STACK(Name)                     ((void *)Name##TaskStack)
+#define OS_TASK_STACK_SIZE(Name)                ((OS_Uint32_t)sizeof(Name##TaskStack))
+
 typedef enum _OS_TaskState {
     OS_TASK_READY = 0,
     OS_TASK_DELAY,
     OS_TASK_SUSPEND,
     OS_TASK_ENDLESS_BLOCKED,
     OS_TASK_TIMEOUT_BLOCKED,
-    OS_TASK_UNKNOWN
+    OS_TASK_UNKNOWN,
+    OS_TASK_DELETED
 } OS_TaskState_e;
 
 typedef enum _OS_IpcTimeoutWakeup {
@@ -74,14 +158,71 @@ typedef enum _OS_IpcTimeoutWakeup {
     OS_IPC_WAIT_TIMEOUT
 } OS_IpcTimeoutWakeup_e;
 
-#define OS_TSK_HANDLE_TO_TCB(Handle)            ((OS_TCB_t *)Handle)
+#define OS_TSK_HANDLE_TO_TCB(Handle)            ((OS_TCB_t *)(Handle))
 
-OS_Uint32_t OS_API_TaskCreate(TaskInitParameter Param, OS_Uint32_t *TaskHandle);
+#if CONFIG_USE_EDF
+#define OS_EDF_TASK_PRIORITY                    CONFIG_EDF_TASK_PRIORITY
+/* Deadline a is earlier than deadline b, wraps like the kernel time */
+#define OS_EDF_DEADLINE_BEFORE(a, b)            ((OS_Int32_t)((a) - (b)) < 0)
+
+#if (OS_EDF_TASK_PRIORITY == 0) || (OS_EDF_TASK_PRIORITY >= OS_MAX_TASK_PRIORITY)
+#error "CONFIG_EDF_TASK_PRIORITY should be in 1 ~ (CONFIG_MAX_TASK_PRIORITY - 1)"
+#endif
+#endif
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+#include "arch.h"
+
+#define OS_CORE_ID()                            ARCH_CoreID()
+#define OS_CORE_NONE                            0xFF
+#define OS_CORE_MASK_ALL                        (0xFFFFFFFFUL >> (32 - CONFIG_CPU_CORE_NUM))
+#define OS_TASK_CORE(TaskCB)                    ((TaskCB)->Core)
+
+extern OS_TCB_t * volatile CoreCurrentTCB[CONFIG_CPU_CORE_NUM];
+extern OS_TCB_t * volatile CoreSwitchNextTCB[CONFIG_CPU_CORE_NUM];
+
+/*
+ * Only valid in kernel critical zone, out of it the task may be switched
+ * out and go on running on other core
+ */
+#define CurrentTCB                              CoreCurrentTCB[OS_CORE_ID()]
+#define SwitchNextTCB                           CoreSwitchNextTCB[OS_CORE_ID()]
+#else
+#define OS_CORE_ID()                            0
+#define OS_TASK_CORE(TaskCB)                    0
+
+extern OS_TCB_t * volatile CurrentTCB;
+extern OS_TCB_t * volatile SwitchNextTCB;
+#endif
+
+OS_Uint32_t OS_API_TaskCreate(TaskInitParameter Param, OS_Uintptr_t *TaskHandle);
+OS_Uint32_t OS_API_TaskCreateStatic(TaskInitParameter Param, OS_TCB_t *TaskCB, void *Stack, OS_Uintptr_t *TaskHandle);
 OS_Uint32_t OS_API_TaskDelay(OS_Uint32_t TickCnt);
-OS_Uint32_t OS_API_TaskSuspend(OS_Uint32_t TaskHandle);
-OS_Uint32_t OS_API_TaskResume(OS_Uint32_t TaskHandle);
+OS_Uint32_t OS_API_TaskYield(void);
+OS_Uint32_t OS_API_TaskSuspend(OS_Uintptr_t TaskHandle);
+OS_Uint32_t OS_API_TaskResume(OS_Uintptr_t TaskHandle);
+OS_Uint32_t OS_API_TaskDelete(OS_Uintptr_t TaskHandle);
+OS_Uint32_t OS_API_TaskExit(void);
+
+OS_Uint32_t OS_API_TaskPrioritySet(OS_Uintptr_t TaskHandle, OS_Uint8_t NewPriority);
+OS_Uint8_t OS_API_TaskPriorityGet(OS_Uintptr_t TaskHandle);
 
-OS_Uint32_t OS_API_TaskPrioritySet(OS_Uint32_t TaskHandle, OS_Uint8_t NewPriority);
-OS_Uint8_t OS_API_TaskPriorityGet(OS_Uint32_t TaskHandle);
+OS_Uint32_t OS_API_TaskStackHighWater(OS_Uintptr_t TaskHandle);
+OS_Uint32_t OS_API_IsrStackHighWater(OS_Uint32_t *StackSize);
+OS_Uint32_t OS_TaskStackUsage(OS_TCB_t *TaskCB, OS_Uint32_t *StackSize);
+
+#if CONFIG_USE_RUN_TIME_STATS
+OS_Uint32_t OS_API_TaskRunTimeGet(OS_Uintptr_t TaskHandle, OS_Uint64_t *RunTime);
+#endif
+
+#if CONFIG_USE_EDF
+OS_Uint32_t OS_API_TaskEdfSet(OS_Uintptr_t TaskHandle, OS_Uint32_t Period, OS_Uint32_t RelativeDeadline);
+OS_Uint32_t OS_API_TaskWaitNextPeriod(void);
+#endif
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+OS_Uint32_t OS_API_TaskAffinitySet(OS_Uintptr_t TaskHandle, OS_Uint32_t CoreMask);
+OS_Uint32_t OS_API_TaskAffinityGet(OS_Uintptr_t TaskHandle);
+#endif
 
 #endif // __MXOS_TASK_H__
@@ -51,6 +51,7 @@
 
 void OS_TimeInit(void);
 void OS_IncrementTime(void);
+void OS_StepTime(OS_Uint32_t Ticks);
 OS_Uint32_t OS_GetCurrentTime(void);
 
 #endif // __MXOS_TIME_H__
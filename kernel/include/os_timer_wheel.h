@@ -0,0 +1,63 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef __MXOS_TIMER_WHEEL_H__
+#define __MXOS_TIMER_WHEEL_H__
+
+#include "os_types.h"
+#include "os_list.h"
+#include "os_task.h"
+#include "os_configs.h"
+
+/*
+ * Hierarchical timing wheel, every level has OS_TIMER_WHEEL_SLOTS slots
+ * and covers OS_TIMER_WHEEL_SLOT_BITS bits of the wakeup time, all of the
+ * levels together cover the whole 32 bits timestamp.
+ */
+#define OS_TIMER_WHEEL_SLOT_BITS                CONFIG_TIMER_WHEEL_SLOT_BITS
+#define OS_TIMER_WHEEL_SLOTS                    (1 << OS_TIMER_WHEEL_SLOT_BITS)
+#define OS_TIMER_WHEEL_SLOT_MASK                (OS_TIMER_WHEEL_SLOTS - 1)
+#define OS_TIMER_WHEEL_LEVELS                   ((32 + OS_TIMER_WHEEL_SLOT_BITS - 1) / OS_TIMER_WHEEL_SLOT_BITS)
+
+#if (OS_TIMER_WHEEL_SLOT_BITS < 2) || (OS_TIMER_WHEEL_SLOT_BITS > 8)
+#error "CONFIG_TIMER_WHEEL_SLOT_BITS should be in 2 ~ 8"
+#endif
+
+/* Called for every expired task, it should remove the task from the wheel */
+typedef void (*OS_TimerWheelExpire_t)(OS_TCB_t *TaskCB);
+
+typedef struct _OS_TimerWheel {
+    ListHead_t      Slot[OS_TIMER_WHEEL_LEVELS][OS_TIMER_WHEEL_SLOTS];
+    /* The last time the wheel have been advanced to */
+    OS_Uint32_t     Time;
+    OS_Uint32_t     Count;
+} OS_TimerWheel_t;
+
+void OS_TimerWheelInit(OS_TimerWheel_t *Wheel, OS_Uint32_t Time);
+void OS_TimerWheelAdd(OS_TimerWheel_t *Wheel, OS_TCB_t *TaskCB);
+void OS_TimerWheelDel(OS_TimerWheel_t *Wheel, OS_TCB_t *TaskCB);
+void OS_TimerWheelAdvance(OS_TimerWheel_t *Wheel, OS_Uint32_t Time, OS_TimerWheelExpire_t Expire);
+OS_Uint8_t OS_TimerWheelNextExpiry(OS_TimerWheel_t *Wheel, OS_Uint32_t *Expires);
+
+#endif // __MXOS_TIMER_WHEEL_H__
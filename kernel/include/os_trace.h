@@ -25,6 +25,12 @@
 #ifndef __MXOS_TRACE_H__
 #define __MXOS_TRACE_H__
 
+#include "os_configs.h"
+
+#if CONFIG_USE_LATENCY_STATS
+#include "os_latency.h"
+#endif
+
 /************************** Trace For Memory manger **************************/
 typedef enum _OS_TracePointMem {
     TP_MALLOC_SUCCESS,
@@ -76,6 +82,10 @@ typedef enum _OS_TracePointScheduler {
     #define TRACE_TaskBlockTimeout(TaskCB)
 #endif
 
+#ifndef TRACE_TaskWakeup
+    #define TRACE_TaskWakeup(TaskCB)
+#endif
+
 #ifndef TRACE_ContextSwitch
     #define TRACE_ContextSwitch(_Current, _Next, Timestamp)
 #endif
@@ -88,6 +98,18 @@ typedef enum _OS_TracePointScheduler {
     #define TRACE_SchedulerResume(NestingCnt)
 #endif
 
+#ifndef TRACE_SchedulerPendedTicks
+    #define TRACE_SchedulerPendedTicks(Ticks)
+#endif
+
+#ifndef TRACE_TicklessIdleEnter
+    #define TRACE_TicklessIdleEnter(ExpectedIdleTicks)
+#endif
+
+#ifndef TRACE_TicklessIdleExit
+    #define TRACE_TicklessIdleExit(ElapsedTicks)
+#endif
+
 /**************************** Trace For Task ****************************/
 #ifndef TRACE_TaskCreate
     #define TRACE_TaskCreate(TaskCB)
@@ -109,6 +131,10 @@ typedef enum _OS_TracePointScheduler {
     #define TRACE_TaskYield(TaskCB)
 #endif
 
+#ifndef TRACE_TaskDelete
+    #define TRACE_TaskDelete(TaskCB, _Current)
+#endif
+
 #ifndef TARCE_TaskPrioritySet
     #define TARCE_TaskPrioritySet(TaskCB, _Current, Priority)
 #endif
@@ -192,6 +218,69 @@ typedef enum _OS_TracePointScheduler {
     #define TARCE_QueueWriteIn(TaskCB, Queue)
 #endif
 
+/**************************** Trace For Event ****************************/
+#ifndef TRACE_EventCreate
+    #define TRACE_EventCreate(EventHandle)
+#endif
+
+#ifndef TRACE_EventWaitSleep
+    #define TRACE_EventWaitSleep(TaskCB, Event, BlockType)
+#endif
+
+#ifndef TRACE_EventSet
+    #define TRACE_EventSet(Event, Flags)
+#endif
+
+#ifndef TRACE_EventWakeup
+    #define TRACE_EventWakeup(TaskCB, Event)
+#endif
+
+/**************************** Trace For Work Queue ****************************/
+#ifndef TRACE_WorkQueueCreate
+    #define TRACE_WorkQueueCreate(QueueHandle, Priority, WorkerNr)
+#endif
+
+#ifndef TRACE_WorkSubmit
+    #define TRACE_WorkSubmit(Queue, Work, Delay)
+#endif
+
+#ifndef TRACE_WorkRun
+    #define TRACE_WorkRun(Queue, Work)
+#endif
+
+#ifndef TRACE_WorkCancel
+    #define TRACE_WorkCancel(Work)
+#endif
+
+/**************************** Trace For Memory Pool ****************************/
+#ifndef TRACE_PoolCreate
+    #define TRACE_PoolCreate(PoolHandle, BlockSize, BlockNr)
+#endif
+
+#ifndef TRACE_PoolAlloc
+    #define TRACE_PoolAlloc(Pool, Block)
+#endif
+
+#ifndef TRACE_PoolAllocSleep
+    #define TRACE_PoolAllocSleep(TaskCB, Pool, BlockType)
+#endif
+
+#ifndef TRACE_PoolFree
+    #define TRACE_PoolFree(Pool, Block)
+#endif
+
+#ifndef TRACE_PoolWakeup
+    #define TRACE_PoolWakeup(TaskCB, Pool)
+#endif
+
+/**************************** Trace For Task Notify ****************************/
+#ifndef TRACE_TaskNotify
+    #define TRACE_TaskNotify(TaskCB, Value, Action)
+#endif
+
+#ifndef TRACE_TaskNotifyWaitSleep
+    #define TRACE_TaskNotifyWaitSleep(TaskCB, BlockType)
+#endif
 
 /**************************** Trace For Sw Timer ****************************/
 #ifndef TRACE_SwTimerCreate
@@ -46,6 +46,18 @@ typedef   signed           int OS_Int32_t;
 typedef unsigned          char OS_Uint8_t;
 typedef unsigned short     int OS_Uint16_t;
 typedef unsigned           int OS_Uint32_t;
+typedef unsigned     long long OS_Uint64_t;
+
+/*
+ * OS_Uintptr_t is wide enough to hold a pointer, use it when an address is
+ * stored in an integer (task handles, heap addresses), 32bit on the MCU and
+ * 64bit on a LP64 host.
+ */
+#if defined(__SIZEOF_POINTER__) && (__SIZEOF_POINTER__ == 8)
+typedef unsigned          long OS_Uintptr_t;
+#else
+typedef unsigned           int OS_Uintptr_t;
+#endif
 
 #define REG_32BIT_WR(addr, val) (* ((volatile OS_Uint32_t *)(addr)) ) = val
 #define REG_32BIT_RD(addr)      (* ((volatile OS_Uint32_t *)(addr)) )
@@ -0,0 +1,87 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef __MXOS_WORK_QUEUE_H__
+#define __MXOS_WORK_QUEUE_H__
+
+#include "os_types.h"
+#include "os_list.h"
+#include "os_configs.h"
+
+typedef void (*OS_WorkFunction_t)(void *Arg);
+
+/* A job for the work queue, given by caller and linked into the queue */
+typedef struct _OS_Work {
+    ListHead_t          List;
+    OS_WorkFunction_t   Func;
+    void                *Arg;
+    /* When a delayed work is due */
+    OS_Uint32_t         WakeUpTime;
+    OS_Uint8_t          State;
+} OS_Work_t;
+
+typedef struct _OS_WorkQueue {
+    /* The works to run, first submitted first run */
+    ListHead_t  PendingList;
+    /* The delayed works, earlier due in front */
+    ListHead_t  DelayedList;
+    /* The idle workers */
+    ListHead_t  SleepList;
+    OS_Uintptr_t Workers[CONFIG_WORK_QUEUE_MAX_WORKERS];
+    OS_Uint8_t  WorkerNr;
+    OS_Uint8_t  Used;
+} OS_WorkQueue_t;
+
+typedef enum _OS_WorkQueueUsed {
+    OS_WORK_QUEUE_UNUSED = 0,
+    OS_WORK_QUEUE_USED,
+    /* Taken by a create still making its workers */
+    OS_WORK_QUEUE_CREATING
+} OS_WorkQueueUsed_e;
+
+typedef enum _OS_WorkState {
+    /* Not in any queue, it can be submitted, also when its function runs */
+    OS_WORK_IDLE = 0,
+    OS_WORK_PENDING,
+    OS_WORK_DELAYED
+} OS_WorkState_e;
+
+OS_Uint32_t OS_API_WorkQueueCreate(OS_Uint32_t *QueueHandle, OS_Uint8_t Priority,
+                                   OS_Uint8_t WorkerNr, OS_Uint32_t StackSize);
+
+void OS_API_WorkInit(OS_Work_t *Work);
+
+OS_Uint32_t OS_API_WorkSubmit(OS_Uint32_t QueueHandle, OS_Work_t *Work,
+                              OS_WorkFunction_t Func, void *Arg);
+
+OS_Uint32_t OS_API_WorkSubmitDelayed(OS_Uint32_t QueueHandle, OS_Work_t *Work,
+                                     OS_WorkFunction_t Func, void *Arg, OS_Uint32_t Delay);
+
+OS_Uint32_t OS_API_WorkSubmitFromISR(OS_Uint32_t QueueHandle, OS_Work_t *Work,
+                                     OS_WorkFunction_t Func, void *Arg,
+                                     OS_Uint8_t *HigherPriorityTaskWoken);
+
+OS_Uint32_t OS_API_WorkCancel(OS_Work_t *Work);
+
+#endif // __MXOS_WORK_QUEUE_H__
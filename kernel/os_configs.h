@@ -8,26 +8,104 @@
 
 #define OS_ASSERT(x)                                if((x) == 0) {ARCH_InterruptDisable(); while(1);}
 
+/* Architecture */
+#ifndef CONFIG_POSIX_ARCH
+#define CONFIG_POSIX_ARCH                           0
+#endif
+
+#if CONFIG_POSIX_ARCH
+/* Host build, see arch/posix and demo/posix */
+#define CONFIG_ARM_ARCH                             0
+
+/* The host tests watch the tickless idle, see ARCH_TicklessHookSet */
+#define TRACE_TicklessIdleEnter(ExpectedIdleTicks)  ARCH_TicklessTraceEnter(ExpectedIdleTicks)
+#define TRACE_TicklessIdleExit(ElapsedTicks)        ARCH_TicklessTraceExit(ElapsedTicks)
+#else
+#define CONFIG_ARM_ARCH                             1
+
+#define ARCH_SystemTickHander                       SysTick_Handler
+#define ARCH_PendSVHandler                          PendSV_Handler
+
+/*
+ * 0 : Kernel critical zone masks all of the interrupts(PRIMASK)
+ * Others : Kernel critical zone only masks the interrupts whose priority
+ * value is greater than or equal to this(BASEPRI), the interrupts with
+ * smaller priority value are never delayed by kernel, but they must not
+ * call any kernel API. The value is in the NVIC priority register format,
+ * STM32F4 implements 4 bits, so (5 << 4) means priority 5.
+ */
+#define CONFIG_MAX_SYSCALL_INTERRUPT_PRIORITY       0
+#endif
+
+/* Number of cores run by the scheduler, more than 1 needs a SMP arch port */
+#ifndef CONFIG_CPU_CORE_NUM
+#define CONFIG_CPU_CORE_NUM                         1
+#endif
+
+#if (CONFIG_CPU_CORE_NUM > 1) && !CONFIG_POSIX_ARCH
+    #error "Only POSIX arch supports SMP now"
+#endif
+
+#if (CONFIG_CPU_CORE_NUM > 32)
+    #error "Task affinity mask supports 32 cores at most"
+#endif
+
 /* Memory Mamanger */
 #define CONFIG_TOTAL_HEAP_SIZE                      (32 * OS_SIZE_KB)
+#define CONFIG_TOTAL_HEAP_ATTR                      (OS_MEM_ATTR_DMA)
+/* Regions including the heap above, more are added by OS_API_MemAddRegion */
+#define CONFIG_MEM_MAX_REGIONS                      2
+/* Task stacks and TCBs come from a region of these attributes first, 0 for the heap only */
+#define CONFIG_TASK_MEM_ATTR                        (OS_MEM_ATTR_FAST)
+/* 2^SL_LOG2 size classes in every power of two, blocks are smaller than 2^FL_MAX_LOG2 bytes */
+#define CONFIG_MEM_TLSF_SL_LOG2                     3
+#define CONFIG_MEM_TLSF_FL_MAX_LOG2                 17
+/* Every block records its owner task and allocation time, every task its heap bytes */
+#define CONFIG_USE_MEM_ACCOUNTING                   1
 
 /* Task and Scheduler */
 #define CONFIG_TASK_NAME_LEN                        (16 * OS_SIZE_BYTE)
 #define CONFIG_IDLE_TASK_STACK_SIZE                 (512 * OS_SIZE_BYTE)
 #define CONFIG_TICK_COUNT_INIT_VALUE                (0x00000000)
 
+/* Number of task priorities, 32 or a multiple of 32 up to 256 */
+#ifndef CONFIG_MAX_TASK_PRIORITY
+#define CONFIG_MAX_TASK_PRIORITY                    32
+#endif
+
+#if (CONFIG_MAX_TASK_PRIORITY % 32) || (CONFIG_MAX_TASK_PRIORITY > 256)
+#error "CONFIG_MAX_TASK_PRIORITY should be a multiple of 32 and no more than 256"
+#endif
+
+/* Tasks of CONFIG_EDF_TASK_PRIORITY run in the order of absolute deadline */
+#define CONFIG_USE_EDF                              1
+#define CONFIG_EDF_TASK_PRIORITY                    16
+
 #define CONFIG_STACK_OVERFLOW_CHECK                 1
 
+/* Run time of every task from the arch run time counter, shown by shell top */
+#define CONFIG_USE_RUN_TIME_STATS                   1
+#define CONFIG_TOP_WINDOW_TICKS                     (1 * CONFIG_SYS_TICK_RATE_HZ)
+
+/* Wakeup and switch latency histograms of every task through the trace hooks */
+#define CONFIG_USE_LATENCY_STATS                    1
+#define CONFIG_LATENCY_HIST_BUCKETS                 24
+
+/* Bits of time every level of the timing wheel covers, costs (32 / bits) * 2^bits list heads */
+#define CONFIG_TIMER_WHEEL_SLOT_BITS                6
+
+/* Tickless idle, sleep to the next deadline when only idle task is ready */
+#if CONFIG_POSIX_ARCH && (CONFIG_CPU_CORE_NUM == 1)
+#define CONFIG_USE_TICKLESS_IDLE                    1
+#else
+#define CONFIG_USE_TICKLESS_IDLE                    0
+#endif
+#define CONFIG_TICKLESS_MIN_IDLE_TICKS              2
+
 /* Configure System Tick Rate */
 #define CONFIG_SYS_CLOCK_RATE                       (168 * OS_FREQ_MHZ)
 #define CONFIG_SYS_TICK_RATE_HZ                     (1 * OS_FREQ_KHZ)
 
-/* Architecture */
-#define CONFIG_ARM_ARCH                             1
-
-#define ARCH_SystemTickHander                       SysTick_Handler
-#define ARCH_PendSVHandler                          PendSV_Handler
-
 /* OS Debug */
 #define OS_DBG_SCHEDULER                            1
 #define OS_DBG_MEMORY                               1
@@ -53,14 +131,44 @@
 #define CONFIG_USE_QUEUE                            1
 #define CONFIG_MAX_QUEUE_DEFINE                     5
 
+/* OS Event group configures */
+#define CONFIG_USE_EVENT                            1
+#define CONFIG_MAX_EVENT_DEFINE                     5
+
+/* OS Task notification configures */
+#define CONFIG_USE_TASK_NOTIFY                      1
+
+/*
+ * OS Coroutine configures, a post or write kicks the host task of the coroutines
+ * waiting on the semaphore or queue, the ones waiting on a condition of their own
+ * are polled every this ticks
+ */
+#define CONFIG_USE_COROUTINE                        1
+#define CONFIG_COROUTINE_POLL_TICKS                 (CONFIG_SYS_TICK_RATE_HZ / 10)
+
+/* OS Work queue configures, every queue has up to CONFIG_WORK_QUEUE_MAX_WORKERS worker tasks */
+#define CONFIG_USE_WORK_QUEUE                       1
+#define CONFIG_MAX_WORK_QUEUE_DEFINE                2
+#define CONFIG_WORK_QUEUE_MAX_WORKERS               4
+
+/* OS Memory pool configures, pools of fixed size blocks */
+#define CONFIG_USE_MEM_POOL                         1
+#define CONFIG_MAX_MEM_POOL_DEFINE                  4
+
 /* OS Software timer configures */
 #define CONFIG_USE_SW_TIMER                         1
 #define CONFIG_MAX_TIMER_DEFINE                     5
 #define CONFIG_SW_TMR_TASK_STACK_SIZE               (1024 * OS_SIZE_BYTE)
 
 /* OS Shell */
+#if CONFIG_POSIX_ARCH
+/* letter shell finds its commands through linker sections, not on host */
+#define CONFIG_USE_SHELL                            0
+#else
 #define CONFIG_USE_SHELL                            1
+#endif
 #define CONFIG_SHELL_TASK_PRIO                      1
+#define CONFIG_SHELL_TASK_TIME_SLICE                1
 #define CONFIG_SHELL_TASK_STACK_SIZE                (1024 * OS_SIZE_BYTE)
 
 #endif // !__MXOS_CONFIG_H__
@@ -0,0 +1,257 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+#include "os_list.h"
+#include "os_task.h"
+#include "os_time.h"
+#include "os_notify.h"
+#include "os_critical.h"
+#include "os_configs.h"
+#include "os_coroutine.h"
+#include "os_error_code.h"
+
+#if CONFIG_USE_COROUTINE
+
+#if !CONFIG_USE_TASK_NOTIFY
+#error "CONFIG_USE_COROUTINE needs CONFIG_USE_TASK_NOTIFY to sleep the host task"
+#endif
+
+#define OS_CO_LOCK()                                OS_API_EnterCritical()
+#define OS_CO_UNLOCK()                              OS_API_ExitCritical()
+
+/* Time a is earlier than time b, wraps like the kernel time */
+#define OS_CO_TIME_BEFORE(a, b)                     ((OS_Int32_t)((a) - (b)) < 0)
+
+/* The created coroutines which the host task has not taken yet */
+static ListHead_t OS_CoPendingList;
+/* The coroutines run by the host task, only the host task touches it */
+static ListHead_t OS_CoRunList;
+static volatile OS_Uintptr_t OS_CoHostHandle = 0;
+
+void OS_CoroutineInit(void)
+{
+    ListHeadInit(&OS_CoPendingList);
+    ListHeadInit(&OS_CoRunList);
+    OS_CoHostHandle = 0;
+}
+
+/*
+ * The control block is given by caller and should live until the coroutine
+ * is done. It can be called from tasks and from coroutines.
+ */
+OS_Uint32_t OS_API_CoroutineCreate(OS_Coroutine_t *Co, CoroutineFunction_t Entry, void *PrivateData)
+{
+    OS_CHECK_NULL_POINTER(Co);
+    OS_CHECK_NULL_POINTER(Entry);
+
+    Co->Entry = Entry;
+    Co->PrivateData = PrivateData;
+    Co->WakeUpTime = 0;
+    Co->Ret = OS_SUCCESS;
+    Co->WaitHandle = 0;
+    Co->Line = 0;
+    Co->State = OS_CO_READY;
+    Co->WaitOn = OS_CO_ON_CONDITION;
+
+    OS_CO_LOCK();
+    ListAddTail(&Co->List, &OS_CoPendingList);
+    OS_CO_UNLOCK();
+
+    OS_API_CoroutineKick();
+
+    return OS_SUCCESS;
+}
+
+/*
+ * Wake the host task up to check the waiting coroutines at once, instead of
+ * at the next poll, e.g. after posting a semaphore a coroutine waits on.
+ */
+void OS_API_CoroutineKick(void)
+{
+    if (OS_CoHostHandle != 0)
+        OS_API_TaskNotify(OS_CoHostHandle, 0, OS_NOTIFY_INCREMENT);
+}
+
+void OS_API_CoroutineKickFromISR(OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    if (OS_CoHostHandle != 0)
+        OS_API_TaskNotifyFromISR(OS_CoHostHandle, 0, OS_NOTIFY_INCREMENT, HigherPriorityTaskWoken);
+}
+
+void OS_CoroutineDelay(OS_Coroutine_t *Co, OS_Uint32_t Ticks)
+{
+    Co->State = OS_CO_DELAY;
+    Co->WakeUpTime = OS_GetCurrentTime() + Ticks;
+}
+
+/* Count the coroutine in the waiters of its semaphore or queue, or out of them */
+static void OS_CoroutineWaiterSet(OS_Coroutine_t *Co, OS_Uint8_t Waiting)
+{
+    switch (Co->WaitOn)
+    {
+#if CONFIG_USE_SEM
+        case OS_CO_ON_SEM:
+            OS_SemCoroutineWait(Co->WaitHandle, Waiting);
+            break;
+#endif
+#if CONFIG_USE_QUEUE
+        case OS_CO_ON_QUEUE_READ:
+            OS_QueueCoroutineWait(Co->WaitHandle, 0, Waiting);
+            break;
+        case OS_CO_ON_QUEUE_WRITE:
+            OS_QueueCoroutineWait(Co->WaitHandle, 1, Waiting);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+/* Counted before the first check, so a post after the check kicks the host */
+void OS_CoroutineWaitStart(OS_Coroutine_t *Co, OS_Uint32_t Timeout, OS_Uint8_t On, OS_Uint32_t Handle)
+{
+    Co->WaitOn = On;
+    Co->WaitHandle = Handle;
+    OS_CoroutineWaiterSet(Co, 1);
+
+    if (Timeout == OS_CO_WAIT_FOREVER)
+    {
+        Co->State = OS_CO_WAIT;
+    }
+    else
+    {
+        Co->State = OS_CO_WAIT_TIMEOUT;
+        Co->WakeUpTime = OS_GetCurrentTime() + Timeout;
+    }
+}
+
+OS_Uint8_t OS_CoroutineWaitExpired(OS_Coroutine_t *Co)
+{
+    if (Co->State != OS_CO_WAIT_TIMEOUT)
+        return 0;
+
+    if (OS_CO_TIME_BEFORE(OS_GetCurrentTime(), Co->WakeUpTime))
+        return 0;
+
+    Co->Ret = OS_COROUTINE_WAIT_TIMEOUT;
+
+    return 1;
+}
+
+void OS_CoroutineWaitEnd(OS_Coroutine_t *Co)
+{
+    OS_CoroutineWaiterSet(Co, 0);
+
+    Co->WaitOn = OS_CO_ON_CONDITION;
+    Co->State = OS_CO_READY;
+}
+
+/* Ticks the host may sleep for the coroutine, 0 means run it again at once */
+static OS_Uint32_t OS_CoroutineSleepTicks(OS_Coroutine_t *Co, OS_Uint32_t Now)
+{
+    OS_Uint32_t Ticks = OS_NOTIFY_WAIT_FOREVER;
+
+    if (Co->State == OS_CO_READY)
+        return 0;
+
+    if ( (Co->State == OS_CO_DELAY) || (Co->State == OS_CO_WAIT_TIMEOUT) )
+    {
+        if (!OS_CO_TIME_BEFORE(Now, Co->WakeUpTime))
+            return 0;
+
+        Ticks = Co->WakeUpTime - Now;
+    }
+
+    /* The ones on a semaphore or queue are kicked, the others poll their conditions */
+    if ( (Co->State != OS_CO_DELAY) && (Co->WaitOn == OS_CO_ON_CONDITION) &&
+         (Ticks > CONFIG_COROUTINE_POLL_TICKS) )
+        Ticks = CONFIG_COROUTINE_POLL_TICKS;
+
+    return Ticks;
+}
+
+/*
+ * The body of the task which runs the coroutines, create it with the stack
+ * the deepest coroutine needs. Every pass runs the coroutines not delayed,
+ * then the task sleeps on its notification until the earliest coroutine
+ * delay or timeout, the next poll of a condition, or a kick. Do not notify
+ * the host task for others.
+ */
+void OS_API_CoroutineHostTask(void *PrivateData)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    ListHead_t *ListNext = OS_NULL;
+    OS_Coroutine_t *Co = OS_NULL;
+    OS_Uint32_t SleepTicks = 0;
+    OS_Uint32_t Ticks = 0;
+
+    OS_CO_LOCK();
+    OS_CoHostHandle = (OS_Uintptr_t)CurrentTCB;
+    OS_CO_UNLOCK();
+
+    while (1)
+    {
+        OS_CO_LOCK();
+        ListSpliceTail(&OS_CoPendingList, &OS_CoRunList);
+        ListHeadInit(&OS_CoPendingList);
+        OS_CO_UNLOCK();
+
+        SleepTicks = OS_NOTIFY_WAIT_FOREVER;
+
+        for (ListIterator = OS_CoRunList.next; ListIterator != &OS_CoRunList; ListIterator = ListNext)
+        {
+            ListNext = ListIterator->next;
+            Co = ListEntry(ListIterator, OS_Coroutine_t, List);
+
+            if ( (Co->State != OS_CO_DELAY) ||
+                 !OS_CO_TIME_BEFORE(OS_GetCurrentTime(), Co->WakeUpTime) )
+            {
+                Co->Entry(Co);
+            }
+
+            if (Co->State == OS_CO_DONE)
+            {
+                ListDel(&Co->List);
+                continue;
+            }
+
+            Ticks = OS_CoroutineSleepTicks(Co, OS_GetCurrentTime());
+            if (Ticks < SleepTicks)
+                SleepTicks = Ticks;
+        }
+
+        if (SleepTicks == 0)
+        {
+            /* Some coroutines yielded, give way to the tasks of the same priority */
+            OS_API_TaskYield();
+            continue;
+        }
+
+        if ( (SleepTicks != OS_NOTIFY_WAIT_FOREVER) && (SleepTicks >= OS_TSK_DLY_MAX) )
+            SleepTicks = OS_TSK_DLY_MAX - 1;
+
+        OS_API_TaskNotifyWait(OS_NOTIFY_CLEAR_ALL, OS_NULL, SleepTicks);
+    }
+}
+
+#endif // CONFIG_USE_COROUTINE
@@ -26,6 +26,60 @@
 #include "os_types.h"
 #include "os_configs.h"
 
+#if (CONFIG_CPU_CORE_NUM > 1)
+
+/*
+ * With SMP, masking the interrupts only protects the local core, so the
+ * outermost critical zone of every core also holds the kernel spin lock.
+ * Arch takes this lock for the context switch too, see the arch port.
+ */
+ARCH_Spinlock_t OS_KernelLock = 0;
+
+static OS_Int16_t CriticalNesting[CONFIG_CPU_CORE_NUM];
+
+/* 
+ * Initial the Critical zone
+ */
+void OS_CriticalInit(void)
+{
+    OS_Uint32_t Core = 0;
+
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+        CriticalNesting[Core] = 0;
+
+    OS_KernelLock = 0;
+}
+
+/* 
+ * Enter the Critical zone
+ */
+void OS_API_EnterCritical(void)
+{
+    ARCH_InterruptDisable();
+
+    /* The core id is stable only after interrupt disabled */
+    if (CriticalNesting[ARCH_CoreID()]++ == 0)
+        ARCH_SpinLock(&OS_KernelLock);
+}
+
+/* 
+ * Exit the Critical zone
+ */
+void OS_API_ExitCritical(void)
+{
+    OS_Uint8_t Core = ARCH_CoreID();
+
+    CriticalNesting[Core]--;
+    OS_ASSERT(CriticalNesting[Core] >= 0);
+    if (CriticalNesting[Core] == 0)
+    {
+        ARCH_SpinUnlock(&OS_KernelLock);
+        ARCH_InterruptEnable();
+    }
+}
+
+#else
+
 static OS_Int16_t CriticalNesting = 0;
 
 /* 
@@ -55,3 +109,5 @@ void OS_API_ExitCritical(void)
     if (CriticalNesting == 0)
         ARCH_InterruptEnable();
 }
+
+#endif // CONFIG_CPU_CORE_NUM > 1
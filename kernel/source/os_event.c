@@ -0,0 +1,388 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+#include "arch.h"
+#include "os_task.h"
+#include "os_time.h"
+#include "os_list.h"
+#include "os_event.h"
+#include "os_trace.h"
+#include "os_critical.h"
+#include "os_configs.h"
+#include "os_scheduler.h"
+#include "os_error_code.h"
+
+#if CONFIG_USE_EVENT
+
+#define OS_EVENT_LOCK()                             OS_API_EnterCritical()
+#define OS_EVENT_UNLOCK()                           OS_API_ExitCritical()
+
+/* The wait option bits kept in TCB while the task waits */
+#define OS_EVENT_OPT_WAIT_ALL                       0x01
+#define OS_EVENT_OPT_CLEAR                          0x02
+#define OS_EVENT_OPT_SATISFIED                      0x04
+
+OS_Event_t OS_EventPool[CONFIG_MAX_EVENT_DEFINE];
+
+#define OS_EVENT_CHECK_HANDLE_VALID(HANDLE)         \
+{                                                   \
+    if (HANDLE >= CONFIG_MAX_EVENT_DEFINE)          \
+    {                                               \
+        return OS_EVENT_HANDLE_INVALID;             \
+    }                                               \
+}
+
+#define OS_EVENT_CHECK_BEEN_CREATED(HANDLE)         \
+{                                                   \
+    if (OS_EventPool[HANDLE].Used == OS_EVENT_UNUSED) \
+    {                                               \
+        return OS_EVENT_NOT_BEEN_CREATED;           \
+    }                                               \
+}
+
+#define OS_EVENT_HANDLE_TO_POINTER(HANDLE)          &OS_EventPool[HANDLE]
+
+extern void OS_TaskReadyToBlock(OS_TCB_t * TaskCB, ListHead_t *SleepHead, OS_Uint8_t BlockType, OS_Uint8_t SortType);
+extern OS_Int16_t OS_IsSchedulerSuspending(void);
+extern void OS_Schedule(void);
+extern void OS_TaskBlockToReady(OS_TCB_t * TaskCB);
+extern void OS_TaskWokenFromISR(OS_TCB_t * TaskCB, OS_Uint8_t *HigherPriorityTaskWoken);
+
+void OS_EventInit(void)
+{
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < CONFIG_MAX_EVENT_DEFINE; i++)
+    {
+        OS_EventPool[i].Flags = 0;
+        OS_EventPool[i].Used = OS_EVENT_UNUSED;
+        ListHeadInit(&OS_EventPool[i].List);
+    }
+}
+
+OS_Uint32_t OS_GetEventResource(OS_Uint32_t *EventHandle)
+{
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < CONFIG_MAX_EVENT_DEFINE; i++)
+    {
+        if (OS_EventPool[i].Used == OS_EVENT_UNUSED)
+            break;
+    }
+
+    if (i == CONFIG_MAX_EVENT_DEFINE)
+    {
+        return OS_NOT_ENOUGH_EVENT_RESOURCE;
+    }
+    else
+    {
+        *EventHandle = i;
+    }
+
+    return OS_SUCCESS;
+}
+
+OS_Uint32_t OS_API_EventCreate(OS_Uint32_t *EventHandle)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+
+    OS_CHECK_NULL_POINTER(EventHandle);
+
+    OS_EVENT_LOCK();
+
+    Ret = OS_GetEventResource(EventHandle);
+    if (Ret != OS_SUCCESS)
+        goto OS_API_EventCreate_Exit;
+
+    OS_EventPool[*EventHandle].Used = OS_EVENT_USED;
+    OS_EventPool[*EventHandle].Flags = 0;
+    ListHeadInit(&OS_EventPool[*EventHandle].List);
+
+    TRACE_EventCreate(EventHandle);
+
+OS_API_EventCreate_Exit:
+    OS_EVENT_UNLOCK();
+
+    return Ret;
+}
+
+static OS_Uint8_t OS_EventSatisfied(OS_Uint32_t Flags, OS_Uint32_t Mask, OS_Uint8_t Option)
+{
+    if (Option & OS_EVENT_OPT_WAIT_ALL)
+        return ((Flags & Mask) == Mask);
+
+    return ((Flags & Mask) != 0);
+}
+
+OS_Uint32_t OS_API_EventWait(OS_Uint32_t EventHandle, OS_Uint32_t Mask, OS_Uint8_t WaitType,
+                             OS_Uint8_t ClearType, OS_Uint32_t *Flags, OS_Uint32_t Timeout)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Event_t *Event = OS_NULL;
+    OS_TCB_t *TaskCB = OS_NULL;
+    OS_Uint32_t Result = 0;
+    OS_Uint8_t Option = 0;
+    OS_Uint8_t BlockType = OS_BLOCK_TYPE_ENDLESS;
+
+    OS_EVENT_CHECK_HANDLE_VALID(EventHandle);
+    OS_EVENT_CHECK_BEEN_CREATED(EventHandle);
+
+    if (Mask == 0)
+    {
+        return OS_EVENT_INVALID_MASK;
+    }
+
+    if ( (Timeout != OS_EVENT_WAIT_FOREVER) && (Timeout >= OS_TSK_DLY_MAX) )
+    {
+        return OS_EVENT_INVALID_TIMEOUT;
+    }
+
+    if (WaitType == OS_EVENT_WAIT_ALL)
+        Option |= OS_EVENT_OPT_WAIT_ALL;
+
+    if (ClearType == OS_EVENT_CLEAR_ON_EXIT)
+        Option |= OS_EVENT_OPT_CLEAR;
+
+    OS_EVENT_LOCK();
+
+    TaskCB = CurrentTCB;
+
+    Event = OS_EVENT_HANDLE_TO_POINTER(EventHandle);
+
+    if (ARCH_IsInterruptContext())
+    {
+        Ret = OS_EVENT_WAIT_IN_INTR_CONTEXT;
+        goto OS_API_EventWait_Exit;
+    }
+
+    if (OS_IsSchedulerSuspending())
+    {
+        Ret = OS_EVENT_WAIT_IN_SCH_SUSPEND;
+        goto OS_API_EventWait_Exit;
+    }
+
+    if (OS_EventSatisfied(Event->Flags, Mask, Option))
+    {
+        Result = Event->Flags;
+
+        if (Option & OS_EVENT_OPT_CLEAR)
+            Event->Flags &= ~Mask;
+
+        goto OS_API_EventWait_Exit;
+    }
+
+    if (Timeout == 0)
+    {
+        Ret = OS_EVENT_TRY_WAIT_FAILED;
+        goto OS_API_EventWait_Exit;
+    }
+
+    if (Timeout != OS_EVENT_WAIT_FOREVER)
+    {
+        BlockType = OS_BLOCK_TYPE_TIMEOUT;
+        TaskCB->WakeUpTime = OS_GetCurrentTime() + Timeout;
+    }
+
+    /* The setter checks the waiter with these and gives the flags back in EventWaitBits */
+    TaskCB->EventWaitBits = Mask;
+    TaskCB->EventWaitOption = Option;
+
+    /* Before sleep, clear the wake up flag */
+    TaskCB->IpcTimeoutWakeup = OS_IPC_NO_TIMEOUT;
+
+    TRACE_EventWaitSleep(TaskCB, Event, BlockType);
+
+    OS_TaskReadyToBlock(TaskCB, &Event->List, BlockType, OS_BLOCK_SORT_TASK_PRIO);
+
+    OS_Schedule();
+
+    OS_EVENT_UNLOCK();
+    OS_EVENT_LOCK();
+
+    /* Wake up here */
+    if (TaskCB->EventWaitOption & OS_EVENT_OPT_SATISFIED)
+    {
+        Result = TaskCB->EventWaitBits;
+    }
+    else if (Event->Used == OS_EVENT_UNUSED)
+    {
+        Ret = OS_EVENT_NOT_BEEN_CREATED;
+    }
+    else
+    {
+        Ret = OS_EVENT_WAIT_TIMEOUT;
+    }
+
+OS_API_EventWait_Exit:
+    OS_EVENT_UNLOCK();
+
+    if (Flags != OS_NULL)
+        *Flags = Result;
+
+    return Ret;
+}
+
+/*
+ * Set the flags and wake up all of the satisfied waiters in one pass, the
+ * flags asked to clear by them are cleared after the pass, so every waiter
+ * sees the same flags. Returns 1 if any task is woken up.
+ */
+static OS_Uint8_t OS_EventSetFlags(OS_Event_t *Event, OS_Uint32_t Flags,
+                                   OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    ListHead_t *ListNext = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+    OS_Uint32_t ClearBits = 0;
+    OS_Uint8_t Woken = 0;
+
+    Event->Flags |= Flags;
+
+    TRACE_EventSet(Event, Flags);
+
+    for (ListIterator = Event->List.next; ListIterator != &Event->List; ListIterator = ListNext)
+    {
+        ListNext = ListIterator->next;
+        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, IpcSleepList);
+
+        if (!OS_EventSatisfied(Event->Flags, TCB_Iterator->EventWaitBits, TCB_Iterator->EventWaitOption))
+            continue;
+
+        if (TCB_Iterator->EventWaitOption & OS_EVENT_OPT_CLEAR)
+            ClearBits |= TCB_Iterator->EventWaitBits;
+
+        TCB_Iterator->EventWaitBits = Event->Flags;
+        TCB_Iterator->EventWaitOption |= OS_EVENT_OPT_SATISFIED;
+
+        TRACE_EventWakeup(TCB_Iterator, Event);
+
+        OS_TaskBlockToReady(TCB_Iterator);
+
+        OS_TaskWokenFromISR(TCB_Iterator, HigherPriorityTaskWoken);
+
+        Woken = 1;
+    }
+
+    Event->Flags &= ~ClearBits;
+
+    return Woken;
+}
+
+OS_Uint32_t OS_API_EventSet(OS_Uint32_t EventHandle, OS_Uint32_t Flags)
+{
+    OS_EVENT_CHECK_HANDLE_VALID(EventHandle);
+    OS_EVENT_CHECK_BEEN_CREATED(EventHandle);
+
+    OS_EVENT_LOCK();
+
+    if (OS_EventSetFlags(OS_EVENT_HANDLE_TO_POINTER(EventHandle), Flags, OS_NULL))
+    {
+        OS_Schedule();
+    }
+
+    OS_EVENT_UNLOCK();
+
+    return OS_SUCCESS;
+}
+
+/*
+ * Set in interrupt handler, never print and never schedule, the caller
+ * should use OS_API_YieldFromISR with the woken flag before return.
+ */
+OS_Uint32_t OS_API_EventSetFromISR(OS_Uint32_t EventHandle, OS_Uint32_t Flags,
+                                   OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    OS_EVENT_CHECK_HANDLE_VALID(EventHandle);
+    OS_EVENT_CHECK_BEEN_CREATED(EventHandle);
+
+    OS_EVENT_LOCK();
+
+    OS_EventSetFlags(OS_EVENT_HANDLE_TO_POINTER(EventHandle), Flags, HigherPriorityTaskWoken);
+
+    OS_EVENT_UNLOCK();
+
+    return OS_SUCCESS;
+}
+
+OS_Uint32_t OS_API_EventClear(OS_Uint32_t EventHandle, OS_Uint32_t Flags)
+{
+    OS_EVENT_CHECK_HANDLE_VALID(EventHandle);
+    OS_EVENT_CHECK_BEEN_CREATED(EventHandle);
+
+    OS_EVENT_LOCK();
+
+    OS_EventPool[EventHandle].Flags &= ~Flags;
+
+    OS_EVENT_UNLOCK();
+
+    return OS_SUCCESS;
+}
+
+/* Returns the current flags, 0 for an invalid handle */
+OS_Uint32_t OS_API_EventGet(OS_Uint32_t EventHandle)
+{
+    OS_Uint32_t Flags = 0;
+
+    if (EventHandle >= CONFIG_MAX_EVENT_DEFINE)
+        return 0;
+
+    OS_EVENT_LOCK();
+
+    Flags = OS_EventPool[EventHandle].Flags;
+
+    OS_EVENT_UNLOCK();
+
+    return Flags;
+}
+
+OS_Uint32_t OS_API_EventDestory(OS_Uint32_t EventHandle)
+{
+    OS_Event_t  *Event = OS_NULL;
+    OS_TCB_t    *TCB_Iterator = OS_NULL;
+
+    OS_EVENT_CHECK_HANDLE_VALID(EventHandle);
+    OS_EVENT_CHECK_BEEN_CREATED(EventHandle);
+
+    OS_EVENT_LOCK();
+
+    Event = OS_EVENT_HANDLE_TO_POINTER(EventHandle);
+
+    // Wake up all of the task, they return OS_EVENT_NOT_BEEN_CREATED
+    while (!ListEmpty(&Event->List))
+    {
+        TCB_Iterator = ListFirstEntry(&Event->List, OS_TCB_t, IpcSleepList);
+
+        OS_TaskBlockToReady(TCB_Iterator);
+    }
+
+    Event->Flags = 0;
+    Event->Used = OS_EVENT_UNUSED;
+
+    OS_Schedule();
+
+    OS_EVENT_UNLOCK();
+
+    return OS_SUCCESS;
+}
+
+#endif // CONFIG_USE_EVENT
@@ -45,6 +45,26 @@ extern void OS_MutexInit(void);
 extern void OS_QueueInit(void);
 #endif
 
+#if CONFIG_USE_EVENT
+extern void OS_EventInit(void);
+#endif
+
+#if CONFIG_USE_TASK_NOTIFY
+extern void OS_TaskNotifyInit(void);
+#endif
+
+#if CONFIG_USE_COROUTINE
+extern void OS_CoroutineInit(void);
+#endif
+
+#if CONFIG_USE_WORK_QUEUE
+extern void OS_WorkQueueInit(void);
+#endif
+
+#if CONFIG_USE_MEM_POOL
+extern void OS_MemPoolInit(void);
+#endif
+
 #if CONFIG_USE_SW_TIMER
 extern void OS_SwTimerInit(void);
 extern void OS_SwTimerTaskCreate(void);
@@ -86,6 +106,31 @@ void OS_API_KernelInit(void)
     OS_QueueInit();
 #endif
 
+#if CONFIG_USE_EVENT
+    /* Initial the event group */
+    OS_EventInit();
+#endif
+
+#if CONFIG_USE_TASK_NOTIFY
+    /* Initial the task notification */
+    OS_TaskNotifyInit();
+#endif
+
+#if CONFIG_USE_COROUTINE
+    /* Initial the coroutine lists */
+    OS_CoroutineInit();
+#endif
+
+#if CONFIG_USE_WORK_QUEUE
+    /* Initial the work queue pool */
+    OS_WorkQueueInit();
+#endif
+
+#if CONFIG_USE_MEM_POOL
+    /* Initial the memory pool table */
+    OS_MemPoolInit();
+#endif
+
 #if CONFIG_USE_SW_TIMER
     OS_SwTimerInit();
 #endif
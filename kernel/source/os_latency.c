@@ -0,0 +1,175 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include "arch.h"
+#include "os_lib.h"
+#include "os_list.h"
+#include "os_task.h"
+#include "os_types.h"
+#include "os_printk.h"
+#include "os_configs.h"
+#include "os_critical.h"
+#include "os_latency.h"
+
+#if CONFIG_USE_SHELL
+#include "os_shell.h"
+#endif
+
+#if CONFIG_USE_LATENCY_STATS
+
+/*
+ * All of the hooks are called by the scheduler with lock held, the time is
+ * taken from the arch run time counter.
+ */
+#define OS_LATENCY_LOCK()                 OS_API_EnterCritical()
+#define OS_LATENCY_UNLOCK()               OS_API_ExitCritical()
+
+static void OS_LatencyRecord(OS_LatencyHist_t *Hist, OS_Uint32_t Latency)
+{
+    OS_Uint32_t Bucket = 0;
+    OS_Uint32_t Value = Latency;
+
+    while ( (Value >>= 1) && (Bucket < OS_LATENCY_HIST_BUCKETS - 1) )
+        Bucket++;
+
+    Hist->Bucket[Bucket]++;
+    Hist->Count++;
+    if (Latency > Hist->Max)
+        Hist->Max = Latency;
+}
+
+void OS_LatencyTaskInit(OS_TCB_t *TaskCB)
+{
+    OS_Memset((void *)&TaskCB->Latency, 0x00, sizeof(OS_TaskLatency_t));
+
+    /* Created in the ready list */
+    TaskCB->Latency.ReadyStamp = ARCH_RunTimeCounterGet();
+}
+
+void OS_LatencyReady(OS_TCB_t *TaskCB)
+{
+    TaskCB->Latency.ReadyStamp = ARCH_RunTimeCounterGet();
+}
+
+void OS_LatencyWakeup(OS_TCB_t *TaskCB)
+{
+    TaskCB->Latency.WakeupStamp = ARCH_RunTimeCounterGet();
+    TaskCB->Latency.WakeupPending = 1;
+}
+
+void OS_LatencyContextSwitch(OS_TCB_t *Current, OS_TCB_t *Next)
+{
+    OS_Uint32_t Now = ARCH_RunTimeCounterGet();
+
+    /* Preempted, it waits in the ready list from now on */
+    if (Current->State == OS_TASK_READY)
+        Current->Latency.ReadyStamp = Now;
+
+    OS_LatencyRecord(&Next->Latency.Switch, Now - Next->Latency.ReadyStamp);
+
+    if (Next->Latency.WakeupPending)
+    {
+        OS_LatencyRecord(&Next->Latency.Wakeup, Now - Next->Latency.WakeupStamp);
+        Next->Latency.WakeupPending = 0;
+    }
+}
+
+#if CONFIG_USE_SHELL
+extern ListHead_t * OS_SchAllTasksListGet(void);
+
+static OS_Uint32_t ShellLatencyToNs(OS_Uint64_t Cycles)
+{
+    return (OS_Uint32_t)(Cycles * 1000000000ULL / ARCH_RUN_TIME_COUNTER_HZ);
+}
+
+static void ShellLatencyHistShow(OS_Int8_t *TaskName, const char *Type, OS_LatencyHist_t *Hist)
+{
+    OS_Uint32_t Bucket = 0;
+
+    printf("|  %8s   ", TaskName);
+    printf("   %6s   ", Type);
+    printf("  %10u  ", Hist->Count);
+    printf("  %10u  |", ShellLatencyToNs(Hist->Max));
+    printf("\r\n");
+
+    for (Bucket = 0; Bucket < OS_LATENCY_HIST_BUCKETS; Bucket++)
+    {
+        if (Hist->Bucket[Bucket] == 0)
+            continue;
+
+        if (Bucket == OS_LATENCY_HIST_BUCKETS - 1)
+            printf("        >= %10u ns : %u\r\n", ShellLatencyToNs(1ULL << Bucket), Hist->Bucket[Bucket]);
+        else
+            printf("        <  %10u ns : %u\r\n", ShellLatencyToNs(2ULL << Bucket), Hist->Bucket[Bucket]);
+    }
+}
+
+void ShellLatency(void)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+    OS_Int8_t   TaskName[CONFIG_TASK_NAME_LEN];
+    OS_TaskLatency_t Latency;
+
+    printf("--------------------- Task Latency (ns) ---------------------\r\n");
+    printf("|--- Name ---|--- Type ---|--- Count ---|--- Max ---|\r\n");
+
+    ListForEach(ListIterator, OS_SchAllTasksListGet())
+    {
+        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, TasksList);
+
+        /* Take a consistent copy, the hooks keep updating it */
+        OS_LATENCY_LOCK();
+        OS_Memcpy((void *)&Latency, (void *)&TCB_Iterator->Latency, sizeof(OS_TaskLatency_t));
+        OS_Memcpy((void *)TaskName, (void *)TCB_Iterator->TaskName, CONFIG_TASK_NAME_LEN);
+        OS_LATENCY_UNLOCK();
+
+        ShellLatencyHistShow(TaskName, "Wakeup", &Latency.Wakeup);
+        ShellLatencyHistShow(TaskName, "Switch", &Latency.Switch);
+    }
+}
+
+SHELL_EXPORT_CMD(latency, ShellLatency, Show task latency histograms);
+
+void ShellLatencyReset(void)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+
+    OS_LATENCY_LOCK();
+
+    ListForEach(ListIterator, OS_SchAllTasksListGet())
+    {
+        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, TasksList);
+        OS_Memset((void *)&TCB_Iterator->Latency.Wakeup, 0x00, sizeof(OS_LatencyHist_t));
+        OS_Memset((void *)&TCB_Iterator->Latency.Switch, 0x00, sizeof(OS_LatencyHist_t));
+    }
+
+    OS_LATENCY_UNLOCK();
+}
+
+SHELL_EXPORT_CMD(latclr, ShellLatencyReset, Reset task latency histograms);
+#endif // CONFIG_USE_SHELL
+
+#endif // CONFIG_USE_LATENCY_STATS
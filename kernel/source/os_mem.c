@@ -25,10 +25,13 @@
 #include "os_lib.h"
 #include "os_mem.h"
 #include "os_list.h"
+#include "os_task.h"
+#include "os_time.h"
 #include "os_trace.h"
 #include "os_printk.h"
 #include "os_configs.h"
 #include "os_critical.h"
+#include "os_error_code.h"
 
 #if CONFIG_USE_SHELL
 #include "os_shell.h"
@@ -50,132 +53,371 @@ static const OS_Uint32_t MmBlkDescAlignSize = ( sizeof( MemBlockDesc_t ) + ( ( O
 
 #define OS_MM_MIN_BLOCK_SZ          (MmBlkDescAlignSize << 1)
 
-MEM_FUNCTION_SPACE MemZone_t MemZone;
+/* A region should hold a minimum block and the block of size 0 at the end */
+#define OS_MM_MIN_REGION_SZ         (OS_MM_MIN_BLOCK_SZ + MmBlkDescAlignSize)
+
+#define OS_MEM_CHECK_REGION_VALID(HANDLE)                               \
+{                                                                       \
+    if (HANDLE >= CONFIG_MEM_MAX_REGIONS || MemRegion[HANDLE].Used == 0) \
+    {                                                                   \
+        return OS_NULL;                                                 \
+    }                                                                   \
+}
+
+MEM_FUNCTION_SPACE MemZone_t MemRegion[CONFIG_MEM_MAX_REGIONS];
 MEM_FUNCTION_SPACE OS_Uint8_t _Heap[ CONFIG_TOTAL_HEAP_SIZE ];
 
-void OS_MemInit(void)
+/* Index of the highest bit set in Word, Word should not be 0 */
+static inline OS_Uint32_t OS_MemHighestBit(OS_Uint32_t Word)
+{
+#if CONFIG_ARM_ARCH
+    return (31 - __clz(Word));
+#elif defined(__GNUC__)
+    return (31 - __builtin_clz(Word));
+#else
+    OS_Uint32_t TargetBit = 31;
+
+    for (; TargetBit > 0; TargetBit--)
+    {
+        if (Word & (0x01UL << TargetBit))
+            break;
+    }
+
+    return TargetBit;
+#endif
+}
+
+/* Index of the lowest bit set in Word, Word should not be 0 */
+static inline OS_Uint32_t OS_MemLowestBit(OS_Uint32_t Word)
+{
+    return OS_MemHighestBit(Word & (~Word + 1));
+}
+
+static inline MemBlockDesc_t *OS_MemBlockNext(MemBlockDesc_t *MmBlkDesc)
+{
+    return (MemBlockDesc_t *)((OS_Uint8_t *)MmBlkDesc + OS_MEM_BLOCK_SIZE(MmBlkDesc));
+}
+
+/* The class a free block of Size is kept in */
+static void OS_MemMappingInsert(OS_Uint32_t Size, OS_Uint32_t *Fl, OS_Uint32_t *Sl)
+{
+    OS_Uint32_t HighestBit = 0;
+
+    if (Size < OS_MEM_SMALL_BLOCK_SZ)
+    {
+        *Fl = 0;
+        *Sl = Size >> OS_MEM_ALIGN_LOG2;
+    }
+    else
+    {
+        HighestBit = OS_MemHighestBit(Size);
+        *Fl = HighestBit - OS_MEM_FL_SHIFT + 1;
+        *Sl = (Size >> (HighestBit - CONFIG_MEM_TLSF_SL_LOG2)) ^ OS_MEM_SL_COUNT;
+    }
+}
+
+/*
+ * The first class every block of which fits Size, the size is rounded up to
+ * the next class, so any block found there is big enough with no search
+ */
+static void OS_MemMappingSearch(OS_Uint32_t Size, OS_Uint32_t *Fl, OS_Uint32_t *Sl)
 {
+    if (Size >= OS_MEM_SMALL_BLOCK_SZ)
+    {
+        Size += (1UL << (OS_MemHighestBit(Size) - CONFIG_MEM_TLSF_SL_LOG2)) - 1;
+    }
+
+    OS_MemMappingInsert(Size, Fl, Sl);
+}
+
+static void OS_MemFreeBlockInsert(MemZone_t *Zone, MemBlockDesc_t *MmBlkDesc)
+{
+    OS_Uint32_t Fl = 0, Sl = 0;
+
+    OS_MemMappingInsert(OS_MEM_BLOCK_SIZE(MmBlkDesc), &Fl, &Sl);
+
+    MmBlkDesc->Size |= OS_MEM_BLOCK_FREE;
+    ListAdd(&MmBlkDesc->List, &Zone->FreeListHead[Fl][Sl]);
+    Zone->SlBitmap[Fl] |= (0x01UL << Sl);
+    Zone->FlBitmap     |= (0x01UL << Fl);
+}
+
+static void OS_MemFreeBlockRemove(MemZone_t *Zone, MemBlockDesc_t *MmBlkDesc)
+{
+    OS_Uint32_t Fl = 0, Sl = 0;
+
+    OS_MemMappingInsert(OS_MEM_BLOCK_SIZE(MmBlkDesc), &Fl, &Sl);
+
+    MmBlkDesc->Size &= ~(OS_Uint32_t)OS_MEM_BLOCK_FREE;
+    ListDel(&MmBlkDesc->List);
+    if (ListEmpty(&Zone->FreeListHead[Fl][Sl]))
+    {
+        Zone->SlBitmap[Fl] &= ~(0x01UL << Sl);
+        if (Zone->SlBitmap[Fl] == 0)
+        {
+            Zone->FlBitmap &= ~(0x01UL << Fl);
+        }
+    }
+}
+
+/* Take a free block of RequstSize at least, OS_NULL if none */
+static MemBlockDesc_t *OS_MemFreeBlockFind(MemZone_t *Zone, OS_Uint32_t RequstSize)
+{
+    OS_Uint32_t Fl = 0, Sl = 0;
+    OS_Uint32_t Bitmap = 0;
+    MemBlockDesc_t *MmBlkDesc = OS_NULL;
+
+    OS_MemMappingSearch(RequstSize, &Fl, &Sl);
+    if (Fl >= OS_MEM_FL_COUNT)
+        return OS_NULL;
+
+    // Any class not smaller in the same first level
+    Bitmap = Zone->SlBitmap[Fl] & (~0UL << Sl);
+    if (Bitmap == 0)
+    {
+        // Or the smallest class of any bigger first level
+        Bitmap = (Fl + 1 < OS_MEM_FL_COUNT) ? (Zone->FlBitmap & (~0UL << (Fl + 1))) : 0;
+        if (Bitmap == 0)
+            return OS_NULL;
+
+        Fl = OS_MemLowestBit(Bitmap);
+        Bitmap = Zone->SlBitmap[Fl];
+    }
+    Sl = OS_MemLowestBit(Bitmap);
+
+    MmBlkDesc = (MemBlockDesc_t *)Zone->FreeListHead[Fl][Sl].next;
+    OS_MemFreeBlockRemove(Zone, MmBlkDesc);
+
+    return MmBlkDesc;
+}
+
+#if CONFIG_USE_MEM_ACCOUNTING
+/* Charge a used block to Owner, which may be OS_NULL */
+static void OS_MemOwnerCharge(MemBlockDesc_t *MmBlkDesc, OS_TCB_t *Owner)
+{
+    MmBlkDesc->Owner = Owner;
+    if (Owner == OS_NULL)
+        return;
+
+    Owner->HeapBytes += MmBlkDesc->Size;
+    if (Owner->HeapBytes > Owner->HeapPeakBytes)
+        Owner->HeapPeakBytes = Owner->HeapBytes;
+}
+
+static void OS_MemOwnerUncharge(MemBlockDesc_t *MmBlkDesc)
+{
+    if (MmBlkDesc->Owner != OS_NULL)
+        MmBlkDesc->Owner->HeapBytes -= MmBlkDesc->Size;
+
+    MmBlkDesc->Owner = OS_NULL;
+}
+#endif
+
+/* Make the memory of Size at StartAddr one free block of the zone, the address should be aligned */
+static void OS_MemZoneInit(MemZone_t *Zone, OS_Uintptr_t StartAddr, OS_Uint32_t Size, OS_Uint32_t Attributes)
+{
+    OS_Uint32_t Fl = 0, Sl = 0;
     MemBlockDesc_t *MmBlockDesc = OS_NULL;
+    MemBlockDesc_t *SentinelDesc = OS_NULL;
+
+    Zone->StartAddr = StartAddr;
+    Zone->TotalSize = Size & ~(OS_Uint32_t)ARCH_BYTE_ALIGNMENT_MASK;
+    if (Zone->TotalSize > OS_MEM_MAX_BLOCK_SZ + MmBlkDescAlignSize)
+    {
+        OS_PRINTK_WARNING("Memory above 2^CONFIG_MEM_TLSF_FL_MAX_LOG2 Bytes is not used");
+        Zone->TotalSize = OS_MEM_MAX_BLOCK_SZ + MmBlkDescAlignSize;
+    }
+    Zone->Attributes = Attributes;
+
+    ListHeadInit(&Zone->UsedListHead);
+    Zone->FlBitmap = 0;
+    for (Fl = 0; Fl < OS_MEM_FL_COUNT; Fl++)
+    {
+        Zone->SlBitmap[Fl] = 0;
+        for (Sl = 0; Sl < OS_MEM_SL_COUNT; Sl++)
+        {
+            ListHeadInit(&Zone->FreeListHead[Fl][Sl]);
+        }
+    }
 
-    /* Start Address must be aligned firstly */
-    MemZone.StartAddr = OS_DataAlign((OS_Uint32_t)_Heap, ARCH_BYTE_ALIGNMENT, ARCH_BYTE_ALIGNMENT_MASK);
     /*
-     * Calculate the total size of the memory zone.
-     * Note: the total size include the block descriptor struct : MemBlockDesc_t
+     * The whole memory is one free block, but for a used block of size 0 at
+     * the end, so the last block has a neighbour above to check like others.
+     * The remaining size includes the block descriptor of the free block.
      */
-    MemZone.TotalSize = CONFIG_TOTAL_HEAP_SIZE - (MemZone.StartAddr - (OS_Uint32_t)_Heap);
+    MmBlockDesc           = (MemBlockDesc_t *)Zone->StartAddr;
+    MmBlockDesc->PrevPhys = OS_NULL;
+    MmBlockDesc->Size     = Zone->TotalSize - MmBlkDescAlignSize;
+    Zone->RemainingSize    = MmBlockDesc->Size;
+    Zone->MinRemainingSize = MmBlockDesc->Size;
+    Zone->FailedNr         = 0;
+
+    SentinelDesc           = OS_MemBlockNext(MmBlockDesc);
+    SentinelDesc->PrevPhys = MmBlockDesc;
+    SentinelDesc->Size     = 0;
+    ListHeadInit(&SentinelDesc->List);
+
+    OS_MemFreeBlockInsert(Zone, MmBlockDesc);
 
+    Zone->Used = 1;
+
+    TRACE_MemoryInit(*Zone);
+}
+
+void OS_MemInit(void)
+{
+    OS_Uint32_t i = 0;
+    OS_Uintptr_t StartAddr = 0;
+
+    for (i = 0; i < CONFIG_MEM_MAX_REGIONS; i++)
+    {
+        MemRegion[i].Used = 0;
+    }
+
+    /* Start Address must be aligned firstly */
+    StartAddr = OS_DataAlign((OS_Uintptr_t)_Heap, ARCH_BYTE_ALIGNMENT, ARCH_BYTE_ALIGNMENT_MASK);
     /*
-     * Calculate the remaining size of the memory zone.
-     * Note: This size not include the block descriptor struct : MemBlockDesc_t
-     * So, we sub a MmBlkDescAlignSize because the first of the memory will put the MemBlockDesc_t
+     * Calculate the total size of the memory zone.
+     * Note: the total size include the block descriptor struct : MemBlockDesc_t
      */
-    MemZone.RemainingSize    = MemZone.TotalSize - MmBlkDescAlignSize;
-    /* Init the list head of the free list */
-    ListHeadInit(&MemZone.FreeListHead);
-    ListHeadInit(&MemZone.UsedListHead);
-
-    /* Add a free memory block at the begining of the aligned heap */
-    MmBlockDesc         = (MemBlockDesc_t *)MemZone.StartAddr;
-    MmBlockDesc->Size   = MemZone.TotalSize;
-    ListAdd(&MmBlockDesc->List, &MemZone.FreeListHead);
+    OS_MemZoneInit(&MemRegion[OS_MEM_DEFAULT_REGION], StartAddr,
+                   CONFIG_TOTAL_HEAP_SIZE - (StartAddr - (OS_Uintptr_t)_Heap), CONFIG_TOTAL_HEAP_ATTR);
 
-    OS_PRINTK_INFO("Total memory : 0x%08X Bytes, Address at 0x%08X", MemZone.TotalSize, MemZone.StartAddr);
+    OS_PRINTK_INFO("Total memory : 0x%08X Bytes, Address at %p", MemRegion[OS_MEM_DEFAULT_REGION].TotalSize, (void *)StartAddr);
     OS_PRINTK_INFO("Memory Mamanger Init finished...");
-
-    TRACE_MemoryInit(MemZone);
 }
 
-static void OS_InsertMemBlockDescToFreeList(ListHead_t *InsertList)
+/*
+ * Add the memory of Size at Start as a new region, such as the CCM of the
+ * STM32F4, with OS_MEM_ATTR_XXX attributes. The region handle is given back
+ * for OS_API_MallocFrom.
+ */
+OS_Uint32_t OS_API_MemAddRegion(OS_Uint32_t *RegionHandle, void *Start, OS_Uint32_t Size, OS_Uint32_t Attributes)
 {
-    ListHead_t     *ListIterator = OS_NULL;
-    MemBlockDesc_t *MmBlkDescIterator = OS_NULL;
-    MemBlockDesc_t *WaitForInsert = (MemBlockDesc_t *)InsertList;
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Uint32_t i = 0;
+    OS_Uintptr_t StartAddr = 0;
+    OS_Uintptr_t EndAddr = 0;
+
+    OS_CHECK_NULL_POINTER(RegionHandle);
+    OS_CHECK_NULL_POINTER(Start);
 
-    // Sort the memory block size from small to big
-    ListForEach(ListIterator, &MemZone.FreeListHead)
+    StartAddr = OS_DataAlign((OS_Uintptr_t)Start, ARCH_BYTE_ALIGNMENT, ARCH_BYTE_ALIGNMENT_MASK);
+    EndAddr = (OS_Uintptr_t)Start + Size;
+    if (EndAddr <= StartAddr || EndAddr - StartAddr < OS_MM_MIN_REGION_SZ)
     {
-        MmBlkDescIterator = (MemBlockDesc_t *)ListIterator;
-        if (MmBlkDescIterator->Size > WaitForInsert->Size)
-            break;
+        return OS_MEM_REGION_INVALID_PARAM;
     }
 
-    // The insert one is the biggset one
-    if (ListIterator == &MemZone.FreeListHead)
+    OS_MEM_LOCK();
+
+    for (i = 0; i < CONFIG_MEM_MAX_REGIONS; i++)
     {
-        ListAddTail(InsertList, &MemZone.FreeListHead);
+        if (MemRegion[i].Used == 0)
+            continue;
+
+        if (StartAddr < MemRegion[i].StartAddr + MemRegion[i].TotalSize &&
+            MemRegion[i].StartAddr < EndAddr)
+        {
+            Ret = OS_MEM_REGION_OVERLAP;
+            goto OS_API_MemAddRegion_Exit;
+        }
     }
-    else
+
+    for (i = 0; i < CONFIG_MEM_MAX_REGIONS; i++)
     {
-        ListAdd(InsertList, MmBlkDescIterator->List.prev);
+        if (MemRegion[i].Used == 0)
+            break;
+    }
+
+    if (i == CONFIG_MEM_MAX_REGIONS)
+    {
+        Ret = OS_NOT_ENOUGH_MEM_REGION_RESOURCE;
+        goto OS_API_MemAddRegion_Exit;
     }
+
+    OS_MemZoneInit(&MemRegion[i], StartAddr, (OS_Uint32_t)(EndAddr - StartAddr), Attributes);
+    *RegionHandle = i;
+
+    OS_PRINTK_INFO("Memory region %u : 0x%08X Bytes, Address at %p", i, MemRegion[i].TotalSize, (void *)StartAddr);
+
+OS_API_MemAddRegion_Exit:
+    OS_MEM_UNLOCK();
+
+    return Ret;
 }
 
-void *OS_API_Malloc(OS_Uint32_t WantSize)
+/* The block is charged to the caller task if Charge, else to no task */
+static void *OS_MemZoneMalloc(MemZone_t *Zone, OS_Uint32_t WantSize, OS_Uint8_t Charge)
 {
     void *pReturnAddr = OS_NULL;
 
     OS_Uint32_t OS_RequstSize = 0;
-    ListHead_t *ListPos = OS_NULL;
 
     MemBlockDesc_t *AllocteMmBlkDesc = OS_NULL;
     MemBlockDesc_t *NewMmBlkDesc     = OS_NULL;
 
-    OS_MEM_LOCK();
-
-    if (WantSize > 0)
+    if (WantSize == 0 || WantSize > OS_MEM_MAX_BLOCK_SZ)
     {
-        // Calculate real os size by adding the aligned MemBlockDesc_t
-        OS_RequstSize = WantSize + MmBlkDescAlignSize;
-        OS_RequstSize = OS_DataAlign(OS_RequstSize, ARCH_BYTE_ALIGNMENT, ARCH_BYTE_ALIGNMENT_MASK);
+        TRACE_Malloc(TP_MALLOC_FAILED_WANT_TOO_LARGE, OS_NULL, *Zone);
+        return OS_NULL;
     }
 
+    // Calculate real os size by adding the aligned MemBlockDesc_t
+    OS_RequstSize = WantSize + MmBlkDescAlignSize;
+    OS_RequstSize = OS_DataAlign(OS_RequstSize, ARCH_BYTE_ALIGNMENT, ARCH_BYTE_ALIGNMENT_MASK);
+
+    OS_MEM_LOCK();
+
     // Check if the max free block memory size is enough
-    if (OS_RequstSize <= MemZone.RemainingSize)
+    if (OS_RequstSize <= Zone->RemainingSize)
     {
-        // Iterate the memory block descriptor to find the bestfit free block
-        ListForEach(ListPos, &MemZone.FreeListHead)
+        AllocteMmBlkDesc = OS_MemFreeBlockFind(Zone, OS_RequstSize);
+        if (AllocteMmBlkDesc != OS_NULL)
         {
-            AllocteMmBlkDesc = (MemBlockDesc_t *)ListPos;
-            // Find bestfit one
-            if (AllocteMmBlkDesc->Size >= OS_RequstSize)
-            {
-                pReturnAddr = (void *)( ((OS_Uint8_t *)AllocteMmBlkDesc) + MmBlkDescAlignSize);
-                // Delete from the free list
-                ListDel(&AllocteMmBlkDesc->List);
-                // Add the allocted memory block to used list
-                ListAdd(&AllocteMmBlkDesc->List, &MemZone.UsedListHead);
+            pReturnAddr = (void *)( ((OS_Uint8_t *)AllocteMmBlkDesc) + MmBlkDescAlignSize);
+            // Add the allocted memory block to used list
+            ListAdd(&AllocteMmBlkDesc->List, &Zone->UsedListHead);
 
-                TRACE_Malloc(TP_MALLOC_SUCCESS, AllocteMmBlkDesc, MemZone);
+            TRACE_Malloc(TP_MALLOC_SUCCESS, AllocteMmBlkDesc, *Zone);
 
-                // Check if the size of this block can be split into two part
-                if ((AllocteMmBlkDesc->Size - OS_RequstSize) > OS_MM_MIN_BLOCK_SZ)
-                {
-                    NewMmBlkDesc = (MemBlockDesc_t *)( (OS_Uint8_t *)AllocteMmBlkDesc + OS_RequstSize);
-                    NewMmBlkDesc->Size   = AllocteMmBlkDesc->Size - OS_RequstSize;
+            // Check if the size of this block can be split into two part
+            if ((AllocteMmBlkDesc->Size - OS_RequstSize) >= OS_MM_MIN_BLOCK_SZ)
+            {
+                NewMmBlkDesc = (MemBlockDesc_t *)( (OS_Uint8_t *)AllocteMmBlkDesc + OS_RequstSize);
+                NewMmBlkDesc->Size     = AllocteMmBlkDesc->Size - OS_RequstSize;
+                NewMmBlkDesc->PrevPhys = AllocteMmBlkDesc;
+                OS_MemBlockNext(NewMmBlkDesc)->PrevPhys = NewMmBlkDesc;
 
-                    AllocteMmBlkDesc->Size = OS_RequstSize;
+                AllocteMmBlkDesc->Size = OS_RequstSize;
 
-                    OS_InsertMemBlockDescToFreeList(&NewMmBlkDesc->List);
+                OS_MemFreeBlockInsert(Zone, NewMmBlkDesc);
 
-                    TRACE_Malloc(TP_MALLOC_SUCCESS_SPLIT, NewMmBlkDesc, MemZone);
-                }
-                MemZone.RemainingSize -= AllocteMmBlkDesc->Size;
-                break;
+                TRACE_Malloc(TP_MALLOC_SUCCESS_SPLIT, NewMmBlkDesc, *Zone);
             }
+            Zone->RemainingSize -= AllocteMmBlkDesc->Size;
+            if (Zone->RemainingSize < Zone->MinRemainingSize)
+                Zone->MinRemainingSize = Zone->RemainingSize;
+
+#if CONFIG_USE_MEM_ACCOUNTING
+            // No owner in interrupts, nor before the first task runs
+            AllocteMmBlkDesc->AllocTime = OS_GetCurrentTime();
+            OS_MemOwnerCharge(AllocteMmBlkDesc, (Charge && !ARCH_IsInterruptContext()) ? CurrentTCB : OS_NULL);
+#endif
         }
-
-        if (ListPos == &MemZone.FreeListHead)
+        else
         {
             // can not find memory to be allocted
-            TRACE_Malloc(TP_MALLOC_FAILED_NOT_ENOUGH, OS_NULL, MemZone);
+            Zone->FailedNr++;
+            TRACE_Malloc(TP_MALLOC_FAILED_NOT_ENOUGH, OS_NULL, *Zone);
             OS_PRINTK_WARNING("Not enough memory in free list for Malloc");
         }
     }
     else
     {
         // not enough memory
-        TRACE_Malloc(TP_MALLOC_FAILED_WANT_TOO_LARGE, OS_NULL, MemZone);
+        Zone->FailedNr++;
+        TRACE_Malloc(TP_MALLOC_FAILED_WANT_TOO_LARGE, OS_NULL, *Zone);
         OS_PRINTK_WARNING("Total memory not enough for Malloc");
     }
 
@@ -184,110 +426,343 @@ void *OS_API_Malloc(OS_Uint32_t WantSize)
     return pReturnAddr;
 }
 
-static void OS_MergeMemBlock(ListHead_t *MergetList)
+void *OS_API_Malloc(OS_Uint32_t WantSize)
 {
-    ListHead_t     *ListIterator      = OS_NULL;
-    MemBlockDesc_t *MmBlkDescIterator = OS_NULL;
-    MemBlockDesc_t *MmBlkDescAddrPrev = OS_NULL;
-    MemBlockDesc_t *MmBlkDescAddrPost = OS_NULL;
-    MemBlockDesc_t *MergeMmBlkDesc    = (MemBlockDesc_t *)MergetList;
-    ListHead_t     *InsertList        = MergetList;
+    return OS_MemZoneMalloc(&MemRegion[OS_MEM_DEFAULT_REGION], WantSize, 1);
+}
+
+void *OS_API_MallocFrom(OS_Uint32_t RegionHandle, OS_Uint32_t WantSize)
+{
+    OS_MEM_CHECK_REGION_VALID(RegionHandle);
+
+    return OS_MemZoneMalloc(&MemRegion[RegionHandle], WantSize, 1);
+}
+
+/*
+ * Allocate from the first region with all of the Attributes, and from the
+ * default region if none of them can, used for the task stacks and TCBs.
+ * The block is charged to no task, the task created takes it over.
+ */
+void *OS_MemMallocPrefer(OS_Uint32_t Attributes, OS_Uint32_t WantSize)
+{
+    OS_Uint32_t i = 0;
+    void *pReturnAddr = OS_NULL;
 
-    // find the prev and post address
-    ListForEach(ListIterator, &MemZone.FreeListHead)
+    for (i = 0; i < CONFIG_MEM_MAX_REGIONS && Attributes != 0; i++)
     {
-        MmBlkDescIterator = (MemBlockDesc_t *)ListIterator;
-        if ((OS_Uint8_t *)MmBlkDescIterator + MmBlkDescIterator->Size == (OS_Uint8_t *)MergeMmBlkDesc)
-        {
-            MmBlkDescAddrPrev = MmBlkDescIterator;
-        }
-        if ((OS_Uint8_t *)MergeMmBlkDesc + MergeMmBlkDesc->Size == (OS_Uint8_t *)MmBlkDescIterator)
-        {
-            MmBlkDescAddrPost = MmBlkDescIterator;
-        }
+        if (MemRegion[i].Used == 0 || (MemRegion[i].Attributes & Attributes) != Attributes)
+            continue;
+
+        // Check the size first, a region too small for it does not warn
+        if (WantSize + MmBlkDescAlignSize > MemRegion[i].RemainingSize)
+            continue;
+
+        pReturnAddr = OS_MemZoneMalloc(&MemRegion[i], WantSize, 0);
+        if (pReturnAddr != OS_NULL)
+            return pReturnAddr;
     }
 
-    if (MmBlkDescAddrPost)
+    return OS_MemZoneMalloc(&MemRegion[OS_MEM_DEFAULT_REGION], WantSize, 0);
+}
+
+/* Merge a block given back with the free blocks just above and below it */
+static MemBlockDesc_t *OS_MergeMemBlock(MemZone_t *Zone, MemBlockDesc_t *MergeMmBlkDesc)
+{
+    MemBlockDesc_t *MmBlkDescAddrPrev = MergeMmBlkDesc->PrevPhys;
+    MemBlockDesc_t *MmBlkDescAddrPost = OS_MemBlockNext(MergeMmBlkDesc);
+
+    if (OS_MEM_BLOCK_IS_FREE(MmBlkDescAddrPost))
     {
-        TRACE_Free(TP_FREE_MERGE_POST, MergeMmBlkDesc, MmBlkDescAddrPost, MemZone);
+        TRACE_Free(TP_FREE_MERGE_POST, MergeMmBlkDesc, MmBlkDescAddrPost, *Zone);
 
-        ListDel(&MmBlkDescAddrPost->List);
-        MergeMmBlkDesc->Size   += MmBlkDescAddrPost->Size;
+        OS_MemFreeBlockRemove(Zone, MmBlkDescAddrPost);
+        MergeMmBlkDesc->Size += MmBlkDescAddrPost->Size;
     }
 
-    if (MmBlkDescAddrPrev)
+    if (MmBlkDescAddrPrev != OS_NULL && OS_MEM_BLOCK_IS_FREE(MmBlkDescAddrPrev))
     {
-        TRACE_Free(TP_FREE_MERGE_PREV, MergeMmBlkDesc, MmBlkDescAddrPost, MemZone);
+        TRACE_Free(TP_FREE_MERGE_PREV, MergeMmBlkDesc, MmBlkDescAddrPrev, *Zone);
+
+        OS_MemFreeBlockRemove(Zone, MmBlkDescAddrPrev);
+        MmBlkDescAddrPrev->Size += MergeMmBlkDesc->Size;
+        MergeMmBlkDesc = MmBlkDescAddrPrev;
+    }
+
+    OS_MemBlockNext(MergeMmBlkDesc)->PrevPhys = MergeMmBlkDesc;
+
+    return MergeMmBlkDesc;
+}
 
-        ListDel(&MmBlkDescAddrPrev->List);
-        MmBlkDescAddrPrev->Size   += MergeMmBlkDesc->Size;
-        InsertList = &MmBlkDescAddrPrev->List;
+/* The region the address is in, OS_NULL if none */
+static MemZone_t *OS_MemZoneOf(OS_Uintptr_t Addr)
+{
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < CONFIG_MEM_MAX_REGIONS; i++)
+    {
+        if (MemRegion[i].Used != 0 &&
+            Addr >= MemRegion[i].StartAddr &&
+            Addr < MemRegion[i].StartAddr + MemRegion[i].TotalSize - MmBlkDescAlignSize)
+        {
+            return &MemRegion[i];
+        }
     }
-    OS_InsertMemBlockDescToFreeList(InsertList);
+
+    return OS_NULL;
 }
 
 void OS_API_Free(void *pAddr)
 {
-    ListHead_t     *ListIterator = OS_NULL;
+    MemZone_t *Zone = OS_NULL;
     MemBlockDesc_t *UsedMmBlkDesc = OS_NULL;
-    MemBlockDesc_t *MmBlkDescIterator = OS_NULL;
+
+    if (pAddr == OS_NULL)
+        return;
+
+    // find the memory block descriptor first
+    UsedMmBlkDesc = (MemBlockDesc_t *)( (OS_Uint8_t *)pAddr - MmBlkDescAlignSize );
 
     OS_MEM_LOCK();
 
-    if (pAddr != OS_NULL)
+    // check if this is a used block of a region, the block above knows it too
+    Zone = OS_MemZoneOf((OS_Uintptr_t)UsedMmBlkDesc);
+    OS_ASSERT(Zone != OS_NULL);
+    OS_ASSERT(!OS_MEM_BLOCK_IS_FREE(UsedMmBlkDesc) && UsedMmBlkDesc->Size != 0);
+    OS_ASSERT(OS_MemBlockNext(UsedMmBlkDesc)->PrevPhys == UsedMmBlkDesc);
+
+#if CONFIG_USE_MEM_ACCOUNTING
+    OS_MemOwnerUncharge(UsedMmBlkDesc);
+#endif
+
+    // Delete from used list
+    ListDel(&UsedMmBlkDesc->List);
+    Zone->RemainingSize += UsedMmBlkDesc->Size;
+    // Check if it can be merged with other memory block
+    OS_MemFreeBlockInsert(Zone, OS_MergeMemBlock(Zone, UsedMmBlkDesc));
+
+    TRACE_Free(TP_FREE_DONE, OS_NULL, OS_NULL, *Zone);
+
+    OS_MEM_UNLOCK();
+}
+
+#if CONFIG_USE_MEM_ACCOUNTING
+/* Charge the used block at addr to Owner instead, the allocation time is kept */
+void OS_MemOwnerSet(void *pAddr, OS_TCB_t *Owner)
+{
+    MemBlockDesc_t *UsedMmBlkDesc = (MemBlockDesc_t *)( (OS_Uint8_t *)pAddr - MmBlkDescAlignSize );
+
+    OS_MEM_LOCK();
+
+    OS_ASSERT(OS_MemZoneOf((OS_Uintptr_t)UsedMmBlkDesc) != OS_NULL);
+    OS_ASSERT(!OS_MEM_BLOCK_IS_FREE(UsedMmBlkDesc) && UsedMmBlkDesc->Size != 0);
+
+    OS_MemOwnerUncharge(UsedMmBlkDesc);
+    OS_MemOwnerCharge(UsedMmBlkDesc, Owner);
+
+    OS_MEM_UNLOCK();
+}
+
+/*
+ * Called before the TCB of Owner is freed, the blocks it still holds are
+ * left with no owner, as the leaks of a deleted task. The callers hold no
+ * kernel lock, so the interrupts are disabled for one used list at a time.
+ */
+void OS_MemOwnerRelease(OS_TCB_t *Owner)
+{
+    OS_Uint32_t i = 0;
+    ListHead_t     *ListIterator = OS_NULL;
+    MemBlockDesc_t *MmBlkDescIterator = OS_NULL;
+
+    for (i = 0; i < CONFIG_MEM_MAX_REGIONS; i++)
     {
-        // find the memory block descriptor first
-        UsedMmBlkDesc = (MemBlockDesc_t *)( (OS_Uint8_t *)pAddr - MmBlkDescAlignSize );
-        // check if this is in used list
-        ListForEach(ListIterator, &MemZone.UsedListHead)
+        OS_MEM_LOCK();
+
+        if (MemRegion[i].Used != 0)
         {
-            MmBlkDescIterator = (MemBlockDesc_t *)ListIterator;
-            if (MmBlkDescIterator == UsedMmBlkDesc)
-                break;
+            ListForEach(ListIterator, &MemRegion[i].UsedListHead)
+            {
+                MmBlkDescIterator = (MemBlockDesc_t *)ListIterator;
+                if (MmBlkDescIterator->Owner == Owner)
+                    OS_MemOwnerUncharge(MmBlkDescIterator);
+            }
         }
 
-        OS_ASSERT(ListIterator != &MemZone.UsedListHead);
-        // Delete from used list
-        ListDel(&UsedMmBlkDesc->List);
-        // Set status to free
-        // Check if it can be merged with other memory block
-        OS_MergeMemBlock(&UsedMmBlkDesc->List);
+        OS_MEM_UNLOCK();
     }
+}
+
+OS_Uint32_t OS_API_TaskHeapUsageGet(OS_Uintptr_t TaskHandle, OS_Uint32_t *Bytes, OS_Uint32_t *PeakBytes)
+{
+    OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
+
+    OS_CHECK_NULL_POINTER(TaskCB);
+
+    OS_MEM_LOCK();
 
-    TRACE_Free(TP_FREE_DONE, OS_NULL, OS_NULL, MemZone);
+    if (Bytes != OS_NULL)
+        *Bytes = TaskCB->HeapBytes;
+
+    if (PeakBytes != OS_NULL)
+        *PeakBytes = TaskCB->HeapPeakBytes;
 
     OS_MEM_UNLOCK();
+
+    return OS_SUCCESS;
 }
+#endif // CONFIG_USE_MEM_ACCOUNTING
 
 #if CONFIG_USE_SHELL
 
+#if CONFIG_USE_MEM_POOL
+extern void OS_MemPoolShow(void);
+#endif
+
 void ShellMem(void)
 {
+    OS_Uint32_t i = 0;
+    MemZone_t *Zone = OS_NULL;
     ListHead_t     *ListIterator = OS_NULL;
     MemBlockDesc_t *MmBlkDescIterator = OS_NULL;
 
-    printf("----------------------- Total Memory ----------------------\r\n");
-    printf("|--- Address ---|--- Size(Bytes) ---|\r\n");
-    printf("|   0x%08X      0x%08X     |\r\n", MemZone.StartAddr, MemZone.TotalSize);
+    for (i = 0; i < CONFIG_MEM_MAX_REGIONS; i++)
+    {
+        Zone = &MemRegion[i];
+        if (Zone->Used == 0)
+            continue;
+
+        printf("------------------------ Region %u -------------------------\r\n", i);
+        printf("|--- Address ---|--- Size(Bytes) ---|--- Attributes ---|\r\n");
+        printf("|   %p      0x%08X          0x%08X    |\r\n", (void *)Zone->StartAddr, Zone->TotalSize, Zone->Attributes);
+        printf("|--- Free ---|--- Least Free ---|--- Failed ---|\r\n");
+        printf("|  0x%08X     0x%08X       %8u   |\r\n", Zone->RemainingSize, Zone->MinRemainingSize, Zone->FailedNr);
+
+        printf("----------------------- Free Memory -----------------------\r\n");
+        printf("|--- Address ---|--- Size(Bytes) ---|\r\n");
+        // Walk the blocks in address order up to the block of size 0 at the end
+        for (MmBlkDescIterator = (MemBlockDesc_t *)Zone->StartAddr;
+             MmBlkDescIterator->Size != 0;
+             MmBlkDescIterator = OS_MemBlockNext(MmBlkDescIterator))
+        {
+            if (OS_MEM_BLOCK_IS_FREE(MmBlkDescIterator))
+                printf("|   %p      0x%08X     |\r\n", (void *)MmBlkDescIterator, OS_MEM_BLOCK_SIZE(MmBlkDescIterator));
+        }
+
+        printf("----------------------- Used Memory -----------------------\r\n");
+#if CONFIG_USE_MEM_ACCOUNTING
+        printf("|--- Address ---|--- Size(Bytes) ---|--- Owner ---|--- Age ---|\r\n");
+        ListForEach(ListIterator, &Zone->UsedListHead)
+        {
+            MmBlkDescIterator = (MemBlockDesc_t *)ListIterator;
+            printf("|   %p      0x%08X     ", (void *)MmBlkDescIterator, MmBlkDescIterator->Size);
+            printf("  %8s   ", (MmBlkDescIterator->Owner == OS_NULL) ? (const char *)"-" : (const char *)MmBlkDescIterator->Owner->TaskName);
+            printf(" %10u |\r\n", OS_GetCurrentTime() - MmBlkDescIterator->AllocTime);
+        }
+#else
+        printf("|--- Address ---|--- Size(Bytes) ---|\r\n");
+        ListForEach(ListIterator, &Zone->UsedListHead)
+        {
+            MmBlkDescIterator = (MemBlockDesc_t *)ListIterator;
+            printf("|   %p      0x%08X     |\r\n", (void *)MmBlkDescIterator, MmBlkDescIterator->Size);
+        }
+#endif
+    }
+
+#if CONFIG_USE_MEM_POOL
+    OS_MemPoolShow();
+#endif
+}
+SHELL_EXPORT_CMD(mem, ShellMem, Show memory info);
+
+#if CONFIG_USE_MEM_ACCOUNTING
+extern ListHead_t * OS_SchAllTasksListGet(void);
+
+typedef struct _ShellMemTopLine {
+    OS_Uint32_t Bytes;
+    OS_Uint32_t PeakBytes;
+    OS_Uint32_t BlockNr;
+    OS_Uint32_t OldestAge;
+} ShellMemTopLine_t;
 
+/* Count the used blocks of Owner in all the regions, called with the memory lock held */
+static void ShellMemTopCount(OS_TCB_t *Owner, OS_Uint32_t Now, ShellMemTopLine_t *Line)
+{
+    OS_Uint32_t i = 0;
+    ListHead_t     *ListIterator = OS_NULL;
+    MemBlockDesc_t *MmBlkDescIterator = OS_NULL;
 
-    printf("----------------------- Free Memory -----------------------\r\n");
-    printf("|--- Address ---|--- Size(Bytes) ---|\r\n");
-    ListForEach(ListIterator, &MemZone.FreeListHead)
+    for (i = 0; i < CONFIG_MEM_MAX_REGIONS; i++)
     {
-        MmBlkDescIterator = (MemBlockDesc_t *)ListIterator;
-        printf("|   0x%08X      0x%08X     |\r\n", (OS_Uint32_t)MmBlkDescIterator, MmBlkDescIterator->Size);
+        if (MemRegion[i].Used == 0)
+            continue;
+
+        ListForEach(ListIterator, &MemRegion[i].UsedListHead)
+        {
+            MmBlkDescIterator = (MemBlockDesc_t *)ListIterator;
+            if (MmBlkDescIterator->Owner != Owner)
+                continue;
+
+            Line->BlockNr++;
+            if (Owner == OS_NULL)
+                Line->Bytes += MmBlkDescIterator->Size;
+            if (Now - MmBlkDescIterator->AllocTime > Line->OldestAge)
+                Line->OldestAge = Now - MmBlkDescIterator->AllocTime;
+        }
     }
+}
 
-    printf("----------------------- Used Memory -----------------------\r\n");
-    printf("|--- Address ---|--- Size(Bytes) ---|\r\n");
-    ListForEach(ListIterator, &MemZone.UsedListHead)
+static void ShellMemTopShow(const char *Name, ShellMemTopLine_t *Line)
+{
+    printf("|  %8s   ", Name);
+    printf("  %10u ", Line->Bytes);
+    printf("  %10u ", Line->PeakBytes);
+    printf("   %8u  ", Line->BlockNr);
+    printf("    %10u      |", Line->OldestAge);
+    printf("\r\n");
+}
+
+/*
+ * Heap usage by task, the bytes include the block descriptors. The blocks
+ * of no owner are allocated in interrupts or before the first task runs,
+ * or left by deleted tasks, an old one there is likely a leak.
+ */
+void ShellMemTop(void)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+    OS_Int8_t   TaskName[CONFIG_TASK_NAME_LEN];
+    ShellMemTopLine_t Line;
+
+    printf("------------------------- Task Heap Usage -------------------------\r\n");
+    printf("|--- Name ---|--- Bytes ---|--- Peak ---|--- Blocks ---|--- Oldest(ticks) ---|\r\n");
+
+    ListForEach(ListIterator, OS_SchAllTasksListGet())
     {
-        MmBlkDescIterator = (MemBlockDesc_t *)ListIterator;
-        printf("|   0x%08X      0x%08X     |\r\n", (OS_Uint32_t)MmBlkDescIterator, MmBlkDescIterator->Size);
+        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, TasksList);
+
+        OS_Memset((void *)&Line, 0x00, sizeof(ShellMemTopLine_t));
+
+        /* Take a consistent copy, print it out of the lock */
+        OS_MEM_LOCK();
+        Line.Bytes = TCB_Iterator->HeapBytes;
+        Line.PeakBytes = TCB_Iterator->HeapPeakBytes;
+        ShellMemTopCount(TCB_Iterator, OS_GetCurrentTime(), &Line);
+        OS_Memcpy((void *)TaskName, (void *)TCB_Iterator->TaskName, CONFIG_TASK_NAME_LEN);
+        OS_MEM_UNLOCK();
+
+        ShellMemTopShow((const char *)TaskName, &Line);
     }
+
+    OS_Memset((void *)&Line, 0x00, sizeof(ShellMemTopLine_t));
+
+    OS_MEM_LOCK();
+    ShellMemTopCount(OS_NULL, OS_GetCurrentTime(), &Line);
+    OS_MEM_UNLOCK();
+
+    Line.PeakBytes = Line.Bytes;
+    ShellMemTopShow("(none)", &Line);
 }
-SHELL_EXPORT_CMD(mem, ShellMem, Show memory info);
 
-#endif // CONFIG_USE_SHELL
+SHELL_EXPORT_CMD(memtop, ShellMemTop, Show heap usage by task);
+#endif // CONFIG_USE_MEM_ACCOUNTING
 
+#endif // CONFIG_USE_SHELL
@@ -0,0 +1,502 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+#include "arch.h"
+#include "os_lib.h"
+#include "os_mem.h"
+#include "os_task.h"
+#include "os_time.h"
+#include "os_list.h"
+#include "os_trace.h"
+#include "os_printk.h"
+#include "os_critical.h"
+#include "os_configs.h"
+#include "os_mem_pool.h"
+#include "os_scheduler.h"
+#include "os_error_code.h"
+
+#if CONFIG_USE_SHELL
+#include "os_shell.h"
+#endif
+
+#if CONFIG_USE_MEM_POOL
+
+#define OS_POOL_LOCK()                              OS_API_EnterCritical()
+#define OS_POOL_UNLOCK()                            OS_API_ExitCritical()
+
+/* The next free block is kept in the first word of a free block */
+#define OS_POOL_NEXT_BLOCK(Block)                   (*(void **)(Block))
+
+/* The in-use bit of a block, the block should be valid */
+#define OS_POOL_BLOCK_INDEX(Pool, Block)            \
+    ((OS_Uint32_t)(((OS_Uint8_t *)(Block) - (Pool)->Storage) / (Pool)->BlockSize))
+#define OS_POOL_BLOCK_IN_USE(Pool, Index)           \
+    ((Pool)->InUseMap[(Index) / 32] & ((OS_Uint32_t)1 << ((Index) % 32)))
+#define OS_POOL_BLOCK_MARK_USED(Pool, Index)        \
+    ((Pool)->InUseMap[(Index) / 32] |= ((OS_Uint32_t)1 << ((Index) % 32)))
+#define OS_POOL_BLOCK_MARK_FREE(Pool, Index)        \
+    ((Pool)->InUseMap[(Index) / 32] &= ~((OS_Uint32_t)1 << ((Index) % 32)))
+
+OS_Pool_t OS_PoolTable[CONFIG_MAX_MEM_POOL_DEFINE];
+
+#define OS_POOL_CHECK_HANDLE_VALID(HANDLE)          \
+{                                                   \
+    if (HANDLE >= CONFIG_MAX_MEM_POOL_DEFINE)       \
+    {                                               \
+        return OS_POOL_HANDLE_INVALID;              \
+    }                                               \
+}
+
+#define OS_POOL_CHECK_BEEN_CREATED(HANDLE)          \
+{                                                   \
+    if (OS_PoolTable[HANDLE].Used == OS_POOL_UNUSED) \
+    {                                               \
+        return OS_POOL_NOT_BEEN_CREATED;            \
+    }                                               \
+}
+
+#define OS_POOL_HANDLE_TO_POINTER(HANDLE)           &OS_PoolTable[HANDLE]
+
+extern void OS_TaskReadyToBlock(OS_TCB_t * TaskCB, ListHead_t *SleepHead, OS_Uint8_t BlockType, OS_Uint8_t SortType);
+extern OS_Int16_t OS_IsSchedulerSuspending(void);
+extern void OS_Schedule(void);
+extern void OS_TaskBlockToReady(OS_TCB_t * TaskCB);
+extern void OS_TaskWokenFromISR(OS_TCB_t * TaskCB, OS_Uint8_t *HigherPriorityTaskWoken);
+
+void OS_MemPoolInit(void)
+{
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < CONFIG_MAX_MEM_POOL_DEFINE; i++)
+    {
+        OS_PoolTable[i].FreeList = OS_NULL;
+        OS_PoolTable[i].Storage = OS_NULL;
+        OS_PoolTable[i].InUseMap = OS_NULL;
+        OS_PoolTable[i].Used = OS_POOL_UNUSED;
+        ListHeadInit(&OS_PoolTable[i].List);
+    }
+}
+
+OS_Uint32_t OS_GetPoolResource(OS_Uint32_t *PoolHandle)
+{
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < CONFIG_MAX_MEM_POOL_DEFINE; i++)
+    {
+        if (OS_PoolTable[i].Used == OS_POOL_UNUSED)
+            break;
+    }
+
+    if (i == CONFIG_MAX_MEM_POOL_DEFINE)
+    {
+        return OS_NOT_ENOUGH_POOL_RESOURCE;
+    }
+    else
+    {
+        *PoolHandle = i;
+    }
+
+    return OS_SUCCESS;
+}
+
+/*
+ * Create a pool of BlockNr blocks of BlockSize bytes, on the caller provided
+ * Storage of OS_POOL_STORAGE_SIZE(BlockSize, BlockNr) bytes aligned to a
+ * pointer, see OS_POOL_DEFINE. The storage is taken from heap if OS_NULL.
+ */
+OS_Uint32_t OS_API_PoolCreate(OS_Uint32_t *PoolHandle, OS_Uint32_t BlockSize,
+                              OS_Uint32_t BlockNr, void *Storage)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Uint32_t i = 0;
+    OS_Pool_t *Pool = OS_NULL;
+    OS_Uint8_t StaticStorage = OS_POOL_STATIC_STORAGE;
+
+    OS_CHECK_NULL_POINTER(PoolHandle);
+
+    if (BlockSize == 0 || BlockNr == 0 || ((OS_Uintptr_t)Storage & (sizeof(void *) - 1)))
+    {
+        return OS_POOL_CREATE_INVALID_PARAM;
+    }
+
+    /* The rounded block size and the whole storage should not wrap around */
+    if ( (BlockSize > 0xFFFFFFFF - (sizeof(void *) - 1)) ||
+         (BlockNr > (0xFFFFFFFF - OS_POOL_MAP_SIZE(BlockNr)) / OS_POOL_BLOCK_SIZE(BlockSize)) )
+    {
+        return OS_POOL_CREATE_INVALID_PARAM;
+    }
+
+    BlockSize = OS_POOL_BLOCK_SIZE(BlockSize);
+
+    OS_POOL_LOCK();
+
+    Ret = OS_GetPoolResource(PoolHandle);
+    if (Ret != OS_SUCCESS)
+        goto OS_API_PoolCreate_Exit;
+
+    if (Storage == OS_NULL)
+    {
+        Storage = OS_API_Malloc(OS_POOL_STORAGE_SIZE(BlockSize, BlockNr));
+        StaticStorage = OS_POOL_HEAP_STORAGE;
+        if (Storage == OS_NULL)
+        {
+            Ret = OS_NOT_ENOUGH_MEM_FOR_POOL_CREATE;
+            goto OS_API_PoolCreate_Exit;
+        }
+    }
+
+    Pool = OS_POOL_HANDLE_TO_POINTER(*PoolHandle);
+    Pool->Storage = (OS_Uint8_t *)Storage;
+    Pool->InUseMap = (OS_Uint32_t *)(Pool->Storage + BlockSize * BlockNr);
+    OS_Memset(Pool->InUseMap, 0x00, OS_POOL_MAP_SIZE(BlockNr));
+    Pool->StaticStorage = StaticStorage;
+    Pool->BlockSize = BlockSize;
+    Pool->BlockNr = BlockNr;
+    Pool->FreeNr = BlockNr;
+    Pool->MinFreeNr = BlockNr;
+    ListHeadInit(&Pool->List);
+
+    /* Link the blocks in address order, the lowest one is taken first */
+    Pool->FreeList = OS_NULL;
+    for (i = BlockNr; i > 0; i--)
+    {
+        OS_POOL_NEXT_BLOCK(Pool->Storage + (i - 1) * BlockSize) = Pool->FreeList;
+        Pool->FreeList = Pool->Storage + (i - 1) * BlockSize;
+    }
+
+    Pool->Used = OS_POOL_USED;
+
+    TRACE_PoolCreate(PoolHandle, BlockSize, BlockNr);
+
+OS_API_PoolCreate_Exit:
+    OS_POOL_UNLOCK();
+
+    return Ret;
+}
+
+static void *OS_PoolTake(OS_Pool_t *Pool)
+{
+    void *Block = Pool->FreeList;
+
+    Pool->FreeList = OS_POOL_NEXT_BLOCK(Block);
+    Pool->FreeNr--;
+    OS_POOL_BLOCK_MARK_USED(Pool, OS_POOL_BLOCK_INDEX(Pool, Block));
+
+    if (Pool->FreeNr < Pool->MinFreeNr)
+        Pool->MinFreeNr = Pool->FreeNr;
+
+    TRACE_PoolAlloc(Pool, Block);
+
+    return Block;
+}
+
+/* Take a block, never blocks, so it is callable from interrupt handler */
+OS_Uint32_t OS_API_PoolAlloc(OS_Uint32_t PoolHandle, void **Block)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Pool_t *Pool = OS_NULL;
+
+    OS_CHECK_NULL_POINTER(Block);
+
+    OS_POOL_CHECK_HANDLE_VALID(PoolHandle);
+    OS_POOL_CHECK_BEEN_CREATED(PoolHandle);
+
+    OS_POOL_LOCK();
+
+    Pool = OS_POOL_HANDLE_TO_POINTER(PoolHandle);
+
+    if (Pool->FreeNr == 0)
+    {
+        *Block = OS_NULL;
+        Ret = OS_POOL_TRY_ALLOC_FAILED;
+    }
+    else
+    {
+        *Block = OS_PoolTake(Pool);
+    }
+
+    OS_POOL_UNLOCK();
+
+    return Ret;
+}
+
+/* Take a block, wait for Timeout ticks or OS_POOL_WAIT_FOREVER when empty */
+OS_Uint32_t OS_API_PoolAllocTimeout(OS_Uint32_t PoolHandle, void **Block, OS_Uint32_t Timeout)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Pool_t *Pool = OS_NULL;
+    OS_TCB_t *TaskCB = OS_NULL;
+    OS_Uint8_t BlockType = OS_BLOCK_TYPE_ENDLESS;
+
+    OS_CHECK_NULL_POINTER(Block);
+
+    OS_POOL_CHECK_HANDLE_VALID(PoolHandle);
+    OS_POOL_CHECK_BEEN_CREATED(PoolHandle);
+
+    if ( (Timeout != OS_POOL_WAIT_FOREVER) && (Timeout >= OS_TSK_DLY_MAX) )
+    {
+        return OS_POOL_INVALID_TIMEOUT;
+    }
+
+    *Block = OS_NULL;
+
+    OS_POOL_LOCK();
+
+    TaskCB = CurrentTCB;
+
+    Pool = OS_POOL_HANDLE_TO_POINTER(PoolHandle);
+
+    if (Pool->FreeNr != 0)
+    {
+        *Block = OS_PoolTake(Pool);
+        goto OS_API_PoolAllocTimeout_Exit;
+    }
+
+    if (Timeout == 0)
+    {
+        Ret = OS_POOL_TRY_ALLOC_FAILED;
+        goto OS_API_PoolAllocTimeout_Exit;
+    }
+
+    if (ARCH_IsInterruptContext())
+    {
+        Ret = OS_POOL_WAIT_IN_INTR_CONTEXT;
+        goto OS_API_PoolAllocTimeout_Exit;
+    }
+
+    if (OS_IsSchedulerSuspending())
+    {
+        Ret = OS_POOL_WAIT_IN_SCH_SUSPEND;
+        goto OS_API_PoolAllocTimeout_Exit;
+    }
+
+    if (Timeout != OS_POOL_WAIT_FOREVER)
+    {
+        BlockType = OS_BLOCK_TYPE_TIMEOUT;
+        TaskCB->WakeUpTime = OS_GetCurrentTime() + Timeout;
+    }
+
+    /* The block freed is handed over in PoolBlock, no one else can take it */
+    TaskCB->PoolBlock = OS_NULL;
+
+    /* Before sleep, clear the wake up flag */
+    TaskCB->IpcTimeoutWakeup = OS_IPC_NO_TIMEOUT;
+
+    TRACE_PoolAllocSleep(TaskCB, Pool, BlockType);
+
+    OS_TaskReadyToBlock(TaskCB, &Pool->List, BlockType, OS_BLOCK_SORT_TASK_PRIO);
+
+    OS_Schedule();
+
+    OS_POOL_UNLOCK();
+    OS_POOL_LOCK();
+
+    /* Wake up here */
+    if (TaskCB->PoolBlock != OS_NULL)
+    {
+        *Block = TaskCB->PoolBlock;
+    }
+    else
+    {
+        Ret = OS_POOL_WAIT_TIMEOUT;
+    }
+
+OS_API_PoolAllocTimeout_Exit:
+    OS_POOL_UNLOCK();
+
+    return Ret;
+}
+
+/* A block of the pool must be at the start of one of the blocks in storage */
+static OS_Uint8_t OS_PoolBlockValid(OS_Pool_t *Pool, void *Block)
+{
+    OS_Uintptr_t Offset = (OS_Uintptr_t)((OS_Uint8_t *)Block - Pool->Storage);
+
+    return ((OS_Uint8_t *)Block >= Pool->Storage &&
+            Offset < (OS_Uintptr_t)Pool->BlockSize * Pool->BlockNr &&
+            Offset % Pool->BlockSize == 0);
+}
+
+/*
+ * Give the block to the first waiter, it stays in use, or back to the free
+ * list, returns 1 if a task is woken up
+ */
+static OS_Uint8_t OS_PoolGive(OS_Pool_t *Pool, void *Block, OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    OS_TCB_t *TaskCB = OS_NULL;
+
+    TRACE_PoolFree(Pool, Block);
+
+    if (!ListEmpty(&Pool->List))
+    {
+        TaskCB = ListFirstEntry(&Pool->List, OS_TCB_t, IpcSleepList);
+        TaskCB->PoolBlock = Block;
+
+        TRACE_PoolWakeup(TaskCB, Pool);
+
+        OS_TaskBlockToReady(TaskCB);
+
+        OS_TaskWokenFromISR(TaskCB, HigherPriorityTaskWoken);
+
+        return 1;
+    }
+
+    OS_POOL_NEXT_BLOCK(Block) = Pool->FreeList;
+    Pool->FreeList = Block;
+    Pool->FreeNr++;
+    OS_POOL_BLOCK_MARK_FREE(Pool, OS_POOL_BLOCK_INDEX(Pool, Block));
+
+    return 0;
+}
+
+static OS_Uint32_t OS_PoolFree(OS_Uint32_t PoolHandle, void *Block, OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Pool_t *Pool = OS_NULL;
+
+    OS_CHECK_NULL_POINTER(Block);
+
+    OS_POOL_CHECK_HANDLE_VALID(PoolHandle);
+    OS_POOL_CHECK_BEEN_CREATED(PoolHandle);
+
+    OS_POOL_LOCK();
+
+    Pool = OS_POOL_HANDLE_TO_POINTER(PoolHandle);
+
+    /* A block freed twice would be linked twice and loop the free list */
+    if ( !OS_PoolBlockValid(Pool, Block) ||
+         !OS_POOL_BLOCK_IN_USE(Pool, OS_POOL_BLOCK_INDEX(Pool, Block)) )
+    {
+        Ret = OS_POOL_INVALID_BLOCK;
+        goto OS_PoolFree_Exit;
+    }
+
+    /* In task context the woken task is scheduled at once */
+    if (OS_PoolGive(Pool, Block, HigherPriorityTaskWoken) && HigherPriorityTaskWoken == OS_NULL)
+    {
+        OS_Schedule();
+    }
+
+OS_PoolFree_Exit:
+    OS_POOL_UNLOCK();
+
+    return Ret;
+}
+
+OS_Uint32_t OS_API_PoolFree(OS_Uint32_t PoolHandle, void *Block)
+{
+    return OS_PoolFree(PoolHandle, Block, OS_NULL);
+}
+
+/*
+ * Free in interrupt handler, never print and never schedule, the caller
+ * should use OS_API_YieldFromISR with the woken flag before return.
+ */
+OS_Uint32_t OS_API_PoolFreeFromISR(OS_Uint32_t PoolHandle, void *Block,
+                                   OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    OS_CHECK_NULL_POINTER(HigherPriorityTaskWoken);
+
+    return OS_PoolFree(PoolHandle, Block, HigherPriorityTaskWoken);
+}
+
+/* Blocks in use now, and the most ever in use */
+OS_Uint32_t OS_API_PoolUsageGet(OS_Uint32_t PoolHandle, OS_Uint32_t *UsedNr, OS_Uint32_t *PeakNr)
+{
+    OS_Pool_t *Pool = OS_NULL;
+
+    OS_POOL_CHECK_HANDLE_VALID(PoolHandle);
+    OS_POOL_CHECK_BEEN_CREATED(PoolHandle);
+
+    OS_POOL_LOCK();
+
+    Pool = OS_POOL_HANDLE_TO_POINTER(PoolHandle);
+
+    if (UsedNr != OS_NULL)
+        *UsedNr = Pool->BlockNr - Pool->FreeNr;
+
+    if (PeakNr != OS_NULL)
+        *PeakNr = Pool->BlockNr - Pool->MinFreeNr;
+
+    OS_POOL_UNLOCK();
+
+    return OS_SUCCESS;
+}
+
+/* Only a pool with all of the blocks freed can be destoryed, so no one waits on it */
+OS_Uint32_t OS_API_PoolDestory(OS_Uint32_t PoolHandle)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Pool_t *Pool = OS_NULL;
+
+    OS_POOL_CHECK_HANDLE_VALID(PoolHandle);
+    OS_POOL_CHECK_BEEN_CREATED(PoolHandle);
+
+    OS_POOL_LOCK();
+
+    Pool = OS_POOL_HANDLE_TO_POINTER(PoolHandle);
+
+    if (Pool->FreeNr != Pool->BlockNr)
+    {
+        Ret = OS_POOL_DESTORY_BLOCK_IN_USE;
+        goto OS_API_PoolDestory_Exit;
+    }
+
+    if (Pool->StaticStorage == OS_POOL_HEAP_STORAGE)
+        OS_API_Free(Pool->Storage);
+
+    Pool->FreeList = OS_NULL;
+    Pool->Storage = OS_NULL;
+    Pool->InUseMap = OS_NULL;
+    Pool->Used = OS_POOL_UNUSED;
+
+OS_API_PoolDestory_Exit:
+    OS_POOL_UNLOCK();
+
+    return Ret;
+}
+
+#if CONFIG_USE_SHELL
+
+/* Part of the shell mem command */
+void OS_MemPoolShow(void)
+{
+    OS_Uint32_t i = 0;
+    OS_Pool_t *Pool = OS_NULL;
+
+    printf("----------------------- Memory Pools ----------------------\r\n");
+    printf("|-- Handle --|-- Block --|-- Total --|-- Used --|-- Peak --|\r\n");
+    for (i = 0; i < CONFIG_MAX_MEM_POOL_DEFINE; i++)
+    {
+        Pool = OS_POOL_HANDLE_TO_POINTER(i);
+        if (Pool->Used == OS_POOL_UNUSED)
+            continue;
+
+        printf("|   %4u     |  %6u   |  %6u   |  %6u  |  %6u  |\r\n", i, Pool->BlockSize,
+               Pool->BlockNr, Pool->BlockNr - Pool->FreeNr, Pool->BlockNr - Pool->MinFreeNr);
+    }
+}
+
+#endif // CONFIG_USE_SHELL
+
+#endif // CONFIG_USE_MEM_POOL
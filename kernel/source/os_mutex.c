@@ -59,8 +59,6 @@ OS_Mutex_t OS_MutexPool[CONFIG_MAX_MUTEX_DEFINE];
 
 #define OS_MUTEX_HANDLE_TO_POINTER(HANDLE)              &OS_MutexPool[HANDLE]
 
-extern OS_TCB_t * volatile CurrentTCB;
-
 extern void OS_TaskReadyToBlock(OS_TCB_t * TaskCB, ListHead_t *SleepHead, OS_Uint8_t BlockType, OS_Uint8_t SortType);
 extern OS_Int16_t OS_IsSchedulerSuspending(void);
 extern void OS_Schedule(void);
@@ -76,7 +74,9 @@ void OS_MutexInit(void)
         OS_MutexPool[i].Used = OS_MUTEX_UNUSED;
         OS_MutexPool[i].Owner = OS_NULL;
         OS_MutexPool[i].OwnerHoldCount = 0;
-        OS_MutexPool[i].OwnerPriority = 0;
+        ListHeadInit(&OS_MutexPool[i].HeldList);
+        OS_MutexPool[i].Protocol = OS_MUTEX_PRIO_INHERIT;
+        OS_MutexPool[i].Ceiling = 0;
         ListHeadInit(&OS_MutexPool[i].SleepList);
     }
 }
@@ -103,7 +103,7 @@ OS_Uint32_t OS_GetMutexResource(OS_Uint32_t *MutexHandle)
     return OS_SUCCESS;
 }
 
-OS_Uint32_t OS_API_MutexCreate(OS_Uint32_t *MutexHandle)
+static OS_Uint32_t OS_MutexCreate(OS_Uint32_t *MutexHandle, OS_Uint8_t Protocol, OS_Uint8_t Ceiling)
 {
     OS_Uint32_t Ret = OS_SUCCESS;
 
@@ -113,35 +113,168 @@ OS_Uint32_t OS_API_MutexCreate(OS_Uint32_t *MutexHandle)
 
     Ret = OS_GetMutexResource(MutexHandle);
     if (Ret != OS_SUCCESS)
-        goto OS_API_MutexCreate_Exit;
+        goto OS_MutexCreate_Exit;
 
     OS_MutexPool[*MutexHandle].Used = OS_MUTEX_USED;
     OS_MutexPool[*MutexHandle].Owner = OS_NULL;
     OS_MutexPool[*MutexHandle].OwnerHoldCount = 0;
-    OS_MutexPool[*MutexHandle].OwnerPriority = 0;
+    OS_MutexPool[*MutexHandle].Protocol = Protocol;
+    OS_MutexPool[*MutexHandle].Ceiling = Ceiling;
     ListHeadInit(&OS_MutexPool[*MutexHandle].SleepList);
 
     TARCE_MutexCreate(MutexHandle);
 
-OS_API_MutexCreate_Exit:
+OS_MutexCreate_Exit:
     OS_MUTEX_UNLOCK();
 
     return Ret;
 }
 
-void OS_MutexSleep(OS_TCB_t *TaskCB, OS_Mutex_t *Mutex, OS_Uint8_t BlockType)
+OS_Uint32_t OS_API_MutexCreate(OS_Uint32_t *MutexHandle)
 {
-    TARCE_MutexSleep(TaskCB, Mutex, BlockType);
+    return OS_MutexCreate(MutexHandle, OS_MUTEX_PRIO_INHERIT, 0);
+}
 
-    /* Check to priority to prevent task priority inversion */
-    if (TaskCB->Priority > Mutex->Owner->Priority)
+/*
+ * Immediate priority ceiling: the locker runs at Ceiling until it unlocks,
+ * so no task sharing the mutex can preempt the owner and the lock is never
+ * contended on a single core. Ceiling should be the highest priority of the
+ * tasks using the mutex, a task above it gets OS_MUTEX_CEILING_VIOLATED.
+ */
+OS_Uint32_t OS_API_MutexCreateCeiling(OS_Uint32_t *MutexHandle, OS_Uint32_t Ceiling)
+{
+    /* Wider than a priority, so the check holds with 256 priorities too */
+    if (Ceiling >= OS_MAX_TASK_PRIORITY)
     {
-        /* Increase the owner task priority temporarily */
-        OS_TaskChangePriority(Mutex->Owner, TaskCB->Priority);
+        return OS_MUTEX_INVALID_CEILING;
     }
 
+    return OS_MutexCreate(MutexHandle, OS_MUTEX_PRIO_CEILING, (OS_Uint8_t)Ceiling);
+}
+
+/*
+ * The priority TaskCB should run at: its base one, raised to the ceiling of
+ * every ceiling mutex it holds and to the highest task blocked on every
+ * mutex it holds.
+ */
+OS_Uint8_t OS_MutexEffectivePriority(OS_TCB_t *TaskCB)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_Mutex_t *Mutex = OS_NULL;
+    OS_TCB_t   *Waiter = OS_NULL;
+    OS_Uint8_t  Priority = TaskCB->BasePriority;
+
+    ListForEach(ListIterator, &TaskCB->MutexHeldList)
+    {
+        Mutex = ListEntry(ListIterator, OS_Mutex_t, HeldList);
+
+        if ( (Mutex->Protocol == OS_MUTEX_PRIO_CEILING) && (Mutex->Ceiling > Priority) )
+        {
+            Priority = Mutex->Ceiling;
+        }
+
+        /* The sleep list is sorted, the first one is the highest */
+        if (!ListEmpty(&Mutex->SleepList))
+        {
+            Waiter = ListEntry(Mutex->SleepList.next, OS_TCB_t, IpcSleepList);
+            if (Waiter->Priority > Priority)
+            {
+                Priority = Waiter->Priority;
+            }
+        }
+    }
+
+    return Priority;
+}
+
+/* Move TaskCB to its place in the sleep list after its priority changes */
+static void OS_MutexSleepListResort(OS_TCB_t *TaskCB, OS_Mutex_t *Mutex)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+
+    ListDel(&TaskCB->IpcSleepList);
+
+    ListForEach(ListIterator, &Mutex->SleepList)
+    {
+        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, IpcSleepList);
+        if (TaskCB->Priority > TCB_Iterator->Priority)
+            break;
+    }
+
+    /* Insert before the first lower one, or at the tail */
+    ListAddTail(&TaskCB->IpcSleepList, ListIterator);
+}
+
+/*
+ * Set TaskCB to its effective priority. If it blocks on a mutex, the owner
+ * of that mutex may inherit the change, and so on along the chain of
+ * owners, until a task whose priority does not change.
+ */
+void OS_MutexPriorityUpdate(OS_TCB_t *TaskCB)
+{
+    OS_Uint8_t  Priority = 0;
+    OS_Mutex_t *Mutex = OS_NULL;
+
+    while (TaskCB != OS_NULL)
+    {
+        Priority = OS_MutexEffectivePriority(TaskCB);
+        if (Priority == TaskCB->Priority)
+            break;
+
+        OS_TaskChangePriority(TaskCB, Priority);
+
+        /* Only a task still in the sleep list passes the change on */
+        Mutex = TaskCB->MutexWait;
+        if ( (Mutex == OS_NULL) ||
+             ((TaskCB->State != OS_TASK_ENDLESS_BLOCKED) && (TaskCB->State != OS_TASK_TIMEOUT_BLOCKED)) )
+            break;
+
+        OS_MutexSleepListResort(TaskCB, Mutex);
+
+        TaskCB = Mutex->Owner;
+    }
+}
+
+/*
+ * TaskCB has left the sleep list without the mutex, by timeout, suspend or
+ * delete, called in the same critical zone as it is taken off the list
+ */
+void OS_MutexWaitCancel(OS_TCB_t *TaskCB)
+{
+    OS_Mutex_t *Mutex = TaskCB->MutexWait;
+
+    if (Mutex == OS_NULL)
+        return;
+
+    TaskCB->MutexWait = OS_NULL;
+
+    /* The owner may lose the priority it inherits from TaskCB */
+    OS_MutexPriorityUpdate(Mutex->Owner);
+}
+
+/* TaskCB becomes the owner */
+static void OS_MutexTake(OS_TCB_t *TaskCB, OS_Mutex_t *Mutex)
+{
+    Mutex->Owner = TaskCB;
+    Mutex->OwnerHoldCount = 1;
+    ListAdd(&Mutex->HeldList, &TaskCB->MutexHeldList);
+
+    /* Raise to the ceiling or to the waiters left behind */
+    OS_MutexPriorityUpdate(TaskCB);
+}
+
+void OS_MutexSleep(OS_TCB_t *TaskCB, OS_Mutex_t *Mutex, OS_Uint8_t BlockType)
+{
+    TARCE_MutexSleep(TaskCB, Mutex, BlockType);
+
+    TaskCB->MutexWait = Mutex;
+
     // Insert to the sleep list with priority sort
     OS_TaskReadyToBlock(TaskCB, &Mutex->SleepList, BlockType, OS_BLOCK_SORT_TASK_PRIO);
+
+    /* Rise the owner, and the owners it blocks on, to prevent priority inversion */
+    OS_MutexPriorityUpdate(Mutex->Owner);
 }
 
 OS_Uint32_t OS_MutexLock(OS_Uint32_t MutexHandle,
@@ -150,13 +283,15 @@ OS_Uint32_t OS_MutexLock(OS_Uint32_t MutexHandle,
 {
     OS_Uint32_t Ret = OS_SUCCESS;
     OS_Mutex_t *Mutex = OS_NULL;
-    OS_TCB_t *TaskCB = CurrentTCB;
+    OS_TCB_t *TaskCB = OS_NULL;
 
     OS_MUTEX_CHECK_HANDLE_VALID(MutexHandle);
     OS_MUTEX_CHECK_BEEN_CREATED(MutexHandle);
 
     OS_MUTEX_LOCK();
 
+    TaskCB = CurrentTCB;
+
     if (ARCH_IsInterruptContext())
     {
         Ret = OS_USE_MUTEX_IN_INTR_CONTEXT;
@@ -173,15 +308,19 @@ OS_Uint32_t OS_MutexLock(OS_Uint32_t MutexHandle,
 
     Mutex = OS_MUTEX_HANDLE_TO_POINTER(MutexHandle);
 
+    if ( (Mutex->Protocol == OS_MUTEX_PRIO_CEILING) &&
+         (TaskCB->BasePriority > Mutex->Ceiling) )
+    {
+        Ret = OS_MUTEX_CEILING_VIOLATED;
+        OS_PRINTK_ERROR("MutexLock above ceiling");
+        goto OS_MutexLock_Exit;
+    }
+
     /* If no task get this lock before */
     if (Mutex->OwnerHoldCount == 0)
     {
         /* Record mutex owner */
-        Mutex->Owner = TaskCB;
-        /* Record mutex lock owner priority */
-        Mutex->OwnerPriority = TaskCB->Priority;
-        /* Increment the hold count */
-        Mutex->OwnerHoldCount++;
+        OS_MutexTake(TaskCB, Mutex);
 
         TARCE_MutexLock(TaskCB);
 
@@ -219,7 +358,7 @@ OS_Uint32_t OS_MutexLock(OS_Uint32_t MutexHandle,
     OS_MUTEX_UNLOCK();
     OS_MUTEX_LOCK();
 
-    /* Wake up here */
+    /* Wake up here, the wait has been cancelled by the timeout already */
     if (TaskCB->IpcTimeoutWakeup == OS_IPC_WAIT_TIMEOUT)
     {
         Ret = OS_MUTEX_WAIT_TIMEOUT;
@@ -254,24 +393,20 @@ OS_Uint32_t OS_API_MutexTryLock(OS_Uint32_t MutexHandle)
 static OS_Uint8_t OS_MutexWakeup(OS_TCB_t *TaskCB, OS_Mutex_t *Mutex)
 {
     OS_Uint8_t NeedResch = 0;
+    OS_Uint8_t Priority = TaskCB->Priority;
     OS_TCB_t *WakeupTaskCB = OS_NULL;
 
-    /* Check if the owner priority have been modified, just set it back */
-    if (TaskCB->Priority != Mutex->OwnerPriority)
-    {
-        OS_TaskChangePriority(Mutex->Owner, Mutex->OwnerPriority);
-    }
+    ListDel(&Mutex->HeldList);
 
     /* If there are tasks blocking on this mutex lock */
     if (!ListEmpty(&Mutex->SleepList))
     {
         /* Pick the next highset blocked task to wakeup */
         WakeupTaskCB = ListEntry(Mutex->SleepList.next, OS_TCB_t, IpcSleepList);
+        WakeupTaskCB->MutexWait = OS_NULL;
+        /* Update the mutex lock owner, raise it before it goes to the ready list */
+        OS_MutexTake(WakeupTaskCB, Mutex);
         OS_TaskBlockToReady(WakeupTaskCB);
-        /* Update the mutex lock owner */
-        Mutex->Owner = WakeupTaskCB;
-        Mutex->OwnerHoldCount = 1;
-        Mutex->OwnerPriority = WakeupTaskCB->Priority;
 
         TARCE_MutexWakeup(WakeupTaskCB, Mutex);
 
@@ -281,7 +416,37 @@ static OS_Uint8_t OS_MutexWakeup(OS_TCB_t *TaskCB, OS_Mutex_t *Mutex)
     {
         /* No other task blocked on this mutex lock */
         Mutex->Owner = OS_NULL;
-        Mutex->OwnerPriority = 0;
+    }
+
+    /* Drop what the owner inherits through this mutex, keep the rest */
+    OS_MutexPriorityUpdate(TaskCB);
+    if (TaskCB->Priority != Priority)
+    {
+        /* A task ready while the owner was raised may preempt it now */
+        NeedResch = 1;
+    }
+
+    return NeedResch;
+}
+
+/*
+ * TaskCB is deleted, so every mutex it holds goes to the highest waiter, or
+ * is released if none waits. Called with TaskCB off all the state lists,
+ * returns 1 if a waiter is woken.
+ */
+OS_Uint8_t OS_MutexReleaseAll(OS_TCB_t *TaskCB)
+{
+    OS_Uint8_t NeedResch = 0;
+    OS_Mutex_t *Mutex = OS_NULL;
+
+    while (!ListEmpty(&TaskCB->MutexHeldList))
+    {
+        Mutex = ListEntry(TaskCB->MutexHeldList.next, OS_Mutex_t, HeldList);
+
+        OS_PRINTK_WARNING("Task [%s] deleted with a mutex held", TaskCB->TaskName);
+
+        Mutex->OwnerHoldCount = 0;
+        NeedResch |= OS_MutexWakeup(TaskCB, Mutex);
     }
 
     return NeedResch;
@@ -291,7 +456,7 @@ OS_Uint32_t OS_API_MutexUnlock(OS_Uint32_t MutexHandle)
 {
     OS_Uint32_t Ret = OS_SUCCESS;
     OS_Mutex_t *Mutex = OS_NULL;
-    OS_TCB_t *TaskCB = CurrentTCB;
+    OS_TCB_t *TaskCB = OS_NULL;
     OS_Uint8_t NeedResch = 0;
 
     OS_MUTEX_CHECK_HANDLE_VALID(MutexHandle);
@@ -299,6 +464,8 @@ OS_Uint32_t OS_API_MutexUnlock(OS_Uint32_t MutexHandle)
 
     OS_MUTEX_LOCK();
 
+    TaskCB = CurrentTCB;
+
     if (ARCH_IsInterruptContext())
     {
         Ret = OS_USE_MUTEX_IN_INTR_CONTEXT;
@@ -379,7 +546,8 @@ OS_Uint32_t OS_API_MutexDestory(OS_Uint32_t MutexHandle)
     }
 
     Mutex->Owner = OS_NULL;
-    Mutex->OwnerPriority = 0;
+    Mutex->Protocol = OS_MUTEX_PRIO_INHERIT;
+    Mutex->Ceiling = 0;
     Mutex->Used = OS_MUTEX_UNUSED;
 
 OS_API_MutexDestory_Exit:
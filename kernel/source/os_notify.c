@@ -0,0 +1,222 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+#include "arch.h"
+#include "os_task.h"
+#include "os_time.h"
+#include "os_list.h"
+#include "os_trace.h"
+#include "os_notify.h"
+#include "os_critical.h"
+#include "os_configs.h"
+#include "os_scheduler.h"
+#include "os_error_code.h"
+
+#if CONFIG_USE_TASK_NOTIFY
+
+#define OS_NOTIFY_LOCK()                            OS_API_EnterCritical()
+#define OS_NOTIFY_UNLOCK()                          OS_API_ExitCritical()
+
+/* All of the waiting tasks sleep here, the notifier wakes its target by TCB */
+static ListHead_t OS_NotifySleepList;
+
+extern void OS_TaskReadyToBlock(OS_TCB_t * TaskCB, ListHead_t *SleepHead, OS_Uint8_t BlockType, OS_Uint8_t SortType);
+extern OS_Int16_t OS_IsSchedulerSuspending(void);
+extern void OS_Schedule(void);
+extern void OS_TaskBlockToReady(OS_TCB_t * TaskCB);
+extern void OS_TaskWokenFromISR(OS_TCB_t * TaskCB, OS_Uint8_t *HigherPriorityTaskWoken);
+
+void OS_TaskNotifyInit(void)
+{
+    ListHeadInit(&OS_NotifySleepList);
+}
+
+/* Update the word of the task, returns 1 if the task is woken up */
+static OS_Uint8_t OS_TaskNotifyUpdate(OS_TCB_t *TaskCB, OS_Uint32_t Value, OS_Uint8_t Action)
+{
+    switch (Action)
+    {
+        case OS_NOTIFY_SET_BITS:
+            TaskCB->NotifyValue |= Value;
+            break;
+        case OS_NOTIFY_INCREMENT:
+            TaskCB->NotifyValue++;
+            break;
+        default:
+            TaskCB->NotifyValue = Value;
+            break;
+    }
+
+    TRACE_TaskNotify(TaskCB, Value, Action);
+
+    if (TaskCB->NotifyState != OS_NOTIFY_WAITING)
+    {
+        TaskCB->NotifyState = OS_NOTIFY_PENDING;
+        return 0;
+    }
+
+    TaskCB->NotifyState = OS_NOTIFY_PENDING;
+
+    /* Timeout or suspend may have taken the waiter off the sleep list */
+    if ( (TaskCB->State != OS_TASK_ENDLESS_BLOCKED) && (TaskCB->State != OS_TASK_TIMEOUT_BLOCKED) )
+        return 0;
+
+    OS_TaskBlockToReady(TaskCB);
+
+    return 1;
+}
+
+OS_Uint32_t OS_API_TaskNotify(OS_Uintptr_t TaskHandle, OS_Uint32_t Value, OS_Uint8_t Action)
+{
+    OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
+
+    OS_CHECK_NULL_POINTER(TaskCB);
+
+    if (Action >= OS_NOTIFY_ACTION_MAX)
+    {
+        return OS_NOTIFY_INVALID_ACTION;
+    }
+
+    OS_NOTIFY_LOCK();
+
+    if (OS_TaskNotifyUpdate(TaskCB, Value, Action))
+    {
+        OS_Schedule();
+    }
+
+    OS_NOTIFY_UNLOCK();
+
+    return OS_SUCCESS;
+}
+
+/*
+ * Notify in interrupt handler, never print and never schedule, the caller
+ * should use OS_API_YieldFromISR with the woken flag before return.
+ */
+OS_Uint32_t OS_API_TaskNotifyFromISR(OS_Uintptr_t TaskHandle, OS_Uint32_t Value, OS_Uint8_t Action,
+                                     OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
+
+    OS_CHECK_NULL_POINTER(TaskCB);
+
+    if (Action >= OS_NOTIFY_ACTION_MAX)
+    {
+        return OS_NOTIFY_INVALID_ACTION;
+    }
+
+    OS_NOTIFY_LOCK();
+
+    if (OS_TaskNotifyUpdate(TaskCB, Value, Action))
+    {
+        OS_TaskWokenFromISR(TaskCB, HigherPriorityTaskWoken);
+    }
+
+    OS_NOTIFY_UNLOCK();
+
+    return OS_SUCCESS;
+}
+
+/*
+ * Wait until the word of current task is notified, then give it out by
+ * Value and clear ClearBitsOnExit of it. Timeout 0 never sleeps, and
+ * OS_NOTIFY_WAIT_FOREVER never times out.
+ */
+OS_Uint32_t OS_API_TaskNotifyWait(OS_Uint32_t ClearBitsOnExit, OS_Uint32_t *Value, OS_Uint32_t Timeout)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_TCB_t *TaskCB = OS_NULL;
+    OS_Uint8_t BlockType = OS_BLOCK_TYPE_ENDLESS;
+
+    if ( (Timeout != OS_NOTIFY_WAIT_FOREVER) && (Timeout >= OS_TSK_DLY_MAX) )
+    {
+        return OS_NOTIFY_INVALID_TIMEOUT;
+    }
+
+    OS_NOTIFY_LOCK();
+
+    TaskCB = CurrentTCB;
+
+    if (ARCH_IsInterruptContext())
+    {
+        Ret = OS_NOTIFY_WAIT_IN_INTR_CONTEXT;
+        goto OS_API_TaskNotifyWait_Exit;
+    }
+
+    if (OS_IsSchedulerSuspending())
+    {
+        Ret = OS_NOTIFY_WAIT_IN_SCH_SUSPEND;
+        goto OS_API_TaskNotifyWait_Exit;
+    }
+
+    if (TaskCB->NotifyState != OS_NOTIFY_PENDING)
+    {
+        if (Timeout == 0)
+        {
+            Ret = OS_NOTIFY_TRY_WAIT_FAILED;
+            goto OS_API_TaskNotifyWait_Exit;
+        }
+
+        if (Timeout != OS_NOTIFY_WAIT_FOREVER)
+        {
+            BlockType = OS_BLOCK_TYPE_TIMEOUT;
+            TaskCB->WakeUpTime = OS_GetCurrentTime() + Timeout;
+        }
+
+        /* Before sleep, clear the wake up flag */
+        TaskCB->IpcTimeoutWakeup = OS_IPC_NO_TIMEOUT;
+        TaskCB->NotifyState = OS_NOTIFY_WAITING;
+
+        TRACE_TaskNotifyWaitSleep(TaskCB, BlockType);
+
+        OS_TaskReadyToBlock(TaskCB, &OS_NotifySleepList, BlockType, OS_BLOCK_SORT_FIFO);
+
+        OS_Schedule();
+
+        OS_NOTIFY_UNLOCK();
+        OS_NOTIFY_LOCK();
+
+        /* Wake up here, by timeout or resume if nothing notified */
+        if (TaskCB->NotifyState != OS_NOTIFY_PENDING)
+        {
+            TaskCB->NotifyState = OS_NOTIFY_NONE;
+            Ret = OS_NOTIFY_WAIT_TIMEOUT;
+            goto OS_API_TaskNotifyWait_Exit;
+        }
+    }
+
+    if (Value != OS_NULL)
+    {
+        *Value = TaskCB->NotifyValue;
+    }
+
+    TaskCB->NotifyValue &= ~ClearBitsOnExit;
+    TaskCB->NotifyState = OS_NOTIFY_NONE;
+
+OS_API_TaskNotifyWait_Exit:
+    OS_NOTIFY_UNLOCK();
+
+    return Ret;
+}
+
+#endif // CONFIG_USE_TASK_NOTIFY
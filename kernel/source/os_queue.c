@@ -34,6 +34,10 @@
 #include "os_scheduler.h"
 #include "os_error_code.h"
 
+#if CONFIG_USE_COROUTINE
+#include "os_coroutine.h"
+#endif
+
 #if CONFIG_USE_QUEUE
 
 #define OS_QUEUE_LOCK()                                 OS_API_EnterCritical()
@@ -63,13 +67,12 @@ OS_Queue_t OS_QueuePool[CONFIG_MAX_QUEUE_DEFINE];
 
 #define OS_QUEUE_INDEX_TO_BUF_ADDR(QUEUE_P, INDEX)      ( ((OS_Uint8_t *)QUEUE_P->DataBuffer) + (QUEUE_P->ElementSize * INDEX) )
 
-extern OS_TCB_t * volatile CurrentTCB;
-
 extern void OS_TaskReadyToBlock(OS_TCB_t * TaskCB, ListHead_t *SleepHead, OS_Uint8_t BlockType, OS_Uint8_t SortType);
 extern OS_Int16_t OS_IsSchedulerSuspending(void);
 extern void OS_Schedule(void);
 extern void OS_TaskBlockToReady(OS_TCB_t * TaskCB);
 extern void OS_TaskChangePriority(OS_TCB_t * TaskCB, OS_Uint8_t NewPriority);
+extern void OS_TaskWokenFromISR(OS_TCB_t * TaskCB, OS_Uint8_t *HigherPriorityTaskWoken);
 
 void OS_QueueInit(void)
 {
@@ -78,10 +81,15 @@ void OS_QueueInit(void)
     for (i = 0; i < CONFIG_MAX_QUEUE_DEFINE; i++)
     {
         OS_QueuePool[i].DataBuffer = OS_NULL;
+        OS_QueuePool[i].StaticBuffer = OS_QUEUE_HEAP_BUFFER;
         OS_QueuePool[i].ReadPos = 0;
         OS_QueuePool[i].WritePos = 0;
         OS_QueuePool[i].ElementSize = 0;
         OS_QueuePool[i].ElementNr = 0;
+#if CONFIG_USE_COROUTINE
+        OS_QueuePool[i].CoReaderNr = 0;
+        OS_QueuePool[i].CoWriterNr = 0;
+#endif
         OS_QueuePool[i].Used = OS_QUEUE_UNUSED;
 
         ListHeadInit(&OS_QueuePool[i].ReaderSleepList);
@@ -111,11 +119,40 @@ OS_Uint32_t OS_GetQueueResource(OS_Uint32_t *QueueHandle)
     return OS_SUCCESS;
 }
 
+/* Attach the buffer to the queue and mark it used, called with queue lock held */
+static void OS_QueueSetup(OS_Uint32_t QueueHandle, void *Buffer, OS_Uint8_t StaticBuffer,
+                          OS_Uint32_t ElementSize, OS_Uint32_t ElementNr)
+{
+    OS_QueuePool[QueueHandle].DataBuffer = Buffer;
+    OS_QueuePool[QueueHandle].StaticBuffer = StaticBuffer;
+
+    /* Record the queue element informations */
+    OS_QueuePool[QueueHandle].ElementNr = ElementNr;
+    OS_QueuePool[QueueHandle].ElementSize = ElementSize;
+
+    /* Initial the read/write position to 0 */
+    OS_QueuePool[QueueHandle].ReadPos = 0;
+    OS_QueuePool[QueueHandle].WritePos = 0;
+
+#if CONFIG_USE_COROUTINE
+    OS_QueuePool[QueueHandle].CoReaderNr = 0;
+    OS_QueuePool[QueueHandle].CoWriterNr = 0;
+#endif
+
+    /* Initial the read/write sleep list */
+    ListHeadInit(&OS_QueuePool[QueueHandle].ReaderSleepList);
+    ListHeadInit(&OS_QueuePool[QueueHandle].WriterSleepList);
+
+    /* Mark this resource is used */
+    OS_QueuePool[QueueHandle].Used = OS_QUEUE_USED;
+}
+
 OS_Uint32_t OS_API_QueueCreate(OS_Uint32_t *QueueHandle,
                                OS_Uint32_t ElementSize,
                                OS_Uint32_t ElementNr)
 {
     OS_Uint32_t Ret = OS_SUCCESS;
+    void *Buffer = OS_NULL;
 
     OS_CHECK_NULL_POINTER(QueueHandle);
 
@@ -131,32 +168,54 @@ OS_Uint32_t OS_API_QueueCreate(OS_Uint32_t *QueueHandle,
         goto OS_API_QueueCreate_Exit;
 
     /* Alloc buffer for the queue data */
-    OS_QueuePool[*QueueHandle].DataBuffer = OS_API_Malloc(ElementSize * ElementNr);
+    Buffer = OS_API_Malloc(ElementSize * ElementNr);
 
-    if (OS_QueuePool[*QueueHandle].DataBuffer == OS_NULL)
+    if (Buffer == OS_NULL)
     {
         Ret = OS_NOT_ENOUGH_MEM_FOR_QUEUE_CREATE;
         goto OS_API_QueueCreate_Exit;
     }
 
-    /* Record the queue element informations */
-    OS_QueuePool[*QueueHandle].ElementNr = ElementNr;
-    OS_QueuePool[*QueueHandle].ElementSize = ElementSize;
+    OS_QueueSetup(*QueueHandle, Buffer, OS_QUEUE_HEAP_BUFFER, ElementSize, ElementNr);
 
-    /* Initial the read/write position to 0 */
-    OS_QueuePool[*QueueHandle].ReadPos = 0;
-    OS_QueuePool[*QueueHandle].WritePos = 0;
+    TARCE_QueueCreate(QueueHandle);
 
-    /* Initial the read/write sleep list */
-    ListHeadInit(&OS_QueuePool[*QueueHandle].ReaderSleepList);
-    ListHeadInit(&OS_QueuePool[*QueueHandle].WriterSleepList);
+OS_API_QueueCreate_Exit:
+    OS_QUEUE_UNLOCK();
 
-    /* Mark this resource is used */
-    OS_QueuePool[*QueueHandle].Used = OS_QUEUE_USED;
+    return Ret;
+}
+
+/*
+ * Create a queue on the caller provided buffer of ElementSize * ElementNr
+ * bytes, nothing comes from the heap, OS_QUEUE_DEFINE gives such buffer
+ */
+OS_Uint32_t OS_API_QueueCreateStatic(OS_Uint32_t *QueueHandle,
+                                     OS_Uint32_t ElementSize,
+                                     OS_Uint32_t ElementNr,
+                                     void *Buffer)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+
+    OS_CHECK_NULL_POINTER(QueueHandle);
+    OS_CHECK_NULL_POINTER(Buffer);
+
+    if (ElementSize == 0 || ElementNr == 0)
+    {
+        return OS_QUEUE_CREATE_INVALID_PARAM;
+    }
+
+    OS_QUEUE_LOCK();
+
+    Ret = OS_GetQueueResource(QueueHandle);
+    if (Ret != OS_SUCCESS)
+        goto OS_API_QueueCreateStatic_Exit;
+
+    OS_QueueSetup(*QueueHandle, Buffer, OS_QUEUE_STATIC_BUFFER, ElementSize, ElementNr);
 
     TARCE_QueueCreate(QueueHandle);
 
-OS_API_QueueCreate_Exit:
+OS_API_QueueCreateStatic_Exit:
     OS_QUEUE_UNLOCK();
 
     return Ret;
@@ -168,13 +227,15 @@ void OS_QueueSleep(OS_TCB_t *TaskCB, ListHead_t *SleepListHead, OS_Uint8_t Block
     OS_TaskReadyToBlock(TaskCB, SleepListHead, BlockType, OS_BLOCK_SORT_TASK_PRIO);
 }
 
-void OS_QueueWakeup(ListHead_t *SleepListHead)
+OS_TCB_t *OS_QueueWakeup(ListHead_t *SleepListHead)
 {
     OS_TCB_t *WakeupTaskCB = OS_NULL;
 
     WakeupTaskCB = ListFirstEntry(SleepListHead, OS_TCB_t, IpcSleepList);
 
     OS_TaskBlockToReady(WakeupTaskCB);
+
+    return WakeupTaskCB;
 }
 
 OS_Uint32_t OS_QueueRemainingSpace(OS_Queue_t *Queue)
@@ -192,14 +253,42 @@ OS_Uint8_t OS_QueueFull(OS_Queue_t *Queue)
    return ( OS_QueueRemainingSpace(Queue) == 0 );
 }
 
+static void OS_QueueCopyIn(OS_Queue_t *Queue, const void * buffer, OS_Uint32_t size)
+{
+    OS_Uint32_t index = 0;
+    OS_Uint8_t *BufferAddr = OS_NULL;
+
+    /* According to the write postion, calculate the buffer index */
+    index = OS_QUEUE_POS_TO_INDEX(Queue, Queue->WritePos);
+    /* Accroding to the index, find out the buffer address */
+    BufferAddr = OS_QUEUE_INDEX_TO_BUF_ADDR(Queue, index);
+    /* Copy data into target queue buffer */
+    OS_Memcpy((void *) BufferAddr, buffer, size);
+    /* Update write position to next */
+    Queue->WritePos++;
+}
+
+static void OS_QueueCopyOut(OS_Queue_t *Queue, void * buffer, OS_Uint32_t size)
+{
+    OS_Uint32_t index = 0;
+    OS_Uint8_t *BufferAddr = OS_NULL;
+
+    /* According to the read postion, calculate the buffer index */
+    index = OS_QUEUE_POS_TO_INDEX(Queue, Queue->ReadPos);
+    /* Accroding to the index, find out the buffer address */
+    BufferAddr = OS_QUEUE_INDEX_TO_BUF_ADDR(Queue, index);
+    /* Copy queue data into target buffer */
+    OS_Memcpy(buffer, (void *)BufferAddr, size);
+    /* Update read position to next */
+    Queue->ReadPos++;
+}
+
 static OS_Uint32_t OS_QueueWrite(OS_Uint32_t QueueHandle, const void * buffer,
                                  OS_Uint32_t size, OS_Uint8_t BlockType, OS_Uint32_t Timeout)
 {
     OS_Uint32_t Ret = OS_SUCCESS;
     OS_Queue_t *Queue = OS_NULL;
-    OS_TCB_t *TaskCB = CurrentTCB;
-    OS_Uint32_t index = 0;
-    OS_Uint8_t *BufferAddr = OS_NULL;
+    OS_TCB_t *TaskCB = OS_NULL;
 
     OS_CHECK_NULL_POINTER(buffer);
 
@@ -208,6 +297,8 @@ static OS_Uint32_t OS_QueueWrite(OS_Uint32_t QueueHandle, const void * buffer,
 
     OS_QUEUE_LOCK();
 
+    TaskCB = CurrentTCB;
+
     Queue = OS_QUEUE_HANDLE_TO_POINTER(QueueHandle);
 
     /* Check if the buffer size is greater than one element size */
@@ -282,14 +373,7 @@ static OS_Uint32_t OS_QueueWrite(OS_Uint32_t QueueHandle, const void * buffer,
     TARCE_QueueWriteIn(TaskCB, Queue);
 
     /* The queue still have unused space, copy data in */
-    /* According to the write postion, calculate the buffer index */
-    index = OS_QUEUE_POS_TO_INDEX(Queue, Queue->WritePos);
-    /* Accroding to the index, find out the buffer address */
-    BufferAddr = OS_QUEUE_INDEX_TO_BUF_ADDR(Queue, index);
-    /* Copy data into target queue buffer */
-    OS_Memcpy((void *) BufferAddr, buffer, size);
-    /* Update write position to next */
-    Queue->WritePos++;
+    OS_QueueCopyIn(Queue, buffer, size);
 
     /* Check if any task sleeping on the reader list */
     if (!ListEmpty(&Queue->ReaderSleepList))
@@ -301,6 +385,12 @@ static OS_Uint32_t OS_QueueWrite(OS_Uint32_t QueueHandle, const void * buffer,
         OS_Schedule();
     }
 
+#if CONFIG_USE_COROUTINE
+    /* The coroutines waiting for data check at once */
+    if (Queue->CoReaderNr != 0)
+        OS_API_CoroutineKick();
+#endif
+
 OS_QueueWrite_Exit:
     OS_QUEUE_UNLOCK();
 
@@ -333,9 +423,7 @@ OS_Uint32_t OS_API_QueueWriteTimeout(OS_Uint32_t QueueHandle, const void * buffe
 {
     OS_Uint32_t Ret = OS_SUCCESS;
     OS_Queue_t *Queue = OS_NULL;
-    OS_TCB_t *TaskCB = CurrentTCB;
-    OS_Uint32_t index = 0;
-    OS_Uint8_t *BufferAddr = OS_NULL;
+    OS_TCB_t *TaskCB = OS_NULL;
 
     OS_CHECK_NULL_POINTER(buffer);
 
@@ -344,6 +432,8 @@ OS_Uint32_t OS_API_QueueWriteTimeout(OS_Uint32_t QueueHandle, const void * buffe
 
     OS_QUEUE_LOCK();
 
+    TaskCB = CurrentTCB;
+
     Queue = OS_QUEUE_HANDLE_TO_POINTER(QueueHandle);
 
     /* Check if the buffer size is greater than one element size */
@@ -418,16 +508,7 @@ OS_Uint32_t OS_API_QueueWriteTimeout(OS_Uint32_t QueueHandle, const void * buffe
     TARCE_QueueReadOut(TaskCB, Queue);
 
     /* The queue have valid data, copy data out */
-    /* According to the read postion, calculate the buffer index */
-    index = OS_QUEUE_POS_TO_INDEX(Queue, Queue->ReadPos);
-    /* Accroding to the index, find out the buffer address */
-    BufferAddr = OS_QUEUE_INDEX_TO_BUF_ADDR(Queue, index);
-
-    /* Copy queue data into target buffer */
-    OS_Memcpy(buffer, (void *)BufferAddr, size);
-
-    /* Update read position to next */
-    Queue->ReadPos++;
+    OS_QueueCopyOut(Queue, buffer, size);
 
     /* Check if any task sleeping on the writer list */
     if (!ListEmpty(&Queue->WriterSleepList))
@@ -439,6 +520,12 @@ OS_Uint32_t OS_API_QueueWriteTimeout(OS_Uint32_t QueueHandle, const void * buffe
         OS_Schedule();
     }
 
+#if CONFIG_USE_COROUTINE
+    /* The coroutines waiting for space check at once */
+    if (Queue->CoWriterNr != 0)
+        OS_API_CoroutineKick();
+#endif
+
 OS_QueueRead_Exit:
     OS_QUEUE_UNLOCK();
 
@@ -466,6 +553,120 @@ OS_Uint32_t OS_API_QueueReadTimeout(OS_Uint32_t QueueHandle, void * buffer,
     return OS_QueueRead(QueueHandle, buffer, size, OS_BLOCK_TYPE_TIMEOUT, Timeout);
 }
 
+/*
+ * Write in interrupt handler, return immediately when the queue is full,
+ * never print and never schedule, the caller should use OS_API_YieldFromISR
+ * with the woken flag before return.
+ */
+OS_Uint32_t OS_API_QueueWriteFromISR(OS_Uint32_t QueueHandle, const void * buffer,
+                                     OS_Uint32_t size, OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Queue_t *Queue = OS_NULL;
+    OS_TCB_t *WakeupTaskCB = OS_NULL;
+
+    OS_CHECK_NULL_POINTER(buffer);
+
+    OS_QUEUE_CHECK_HANDLE_VALID(QueueHandle);
+    OS_QUEUE_CHECK_BEEN_CREATED(QueueHandle);
+
+    OS_QUEUE_LOCK();
+
+    Queue = OS_QUEUE_HANDLE_TO_POINTER(QueueHandle);
+
+    if (size > Queue->ElementSize)
+    {
+        Ret = OS_QUEUE_WR_DATA_TOO_BIG;
+        goto OS_API_QueueWriteFromISR_Exit;
+    }
+
+    if (OS_QueueFull(Queue))
+    {
+        Ret = OS_QUEUE_WR_FULL_IN_INTR_CONTEXT;
+        goto OS_API_QueueWriteFromISR_Exit;
+    }
+
+    TARCE_QueueWriteIn(CurrentTCB, Queue);
+
+    OS_QueueCopyIn(Queue, buffer, size);
+
+    if (!ListEmpty(&Queue->ReaderSleepList))
+    {
+        TARCE_QueueWriteWakeupReader(CurrentTCB, Queue);
+
+        WakeupTaskCB = OS_QueueWakeup(&Queue->ReaderSleepList);
+
+        OS_TaskWokenFromISR(WakeupTaskCB, HigherPriorityTaskWoken);
+    }
+
+#if CONFIG_USE_COROUTINE
+    if (Queue->CoReaderNr != 0)
+        OS_API_CoroutineKickFromISR(HigherPriorityTaskWoken);
+#endif
+
+OS_API_QueueWriteFromISR_Exit:
+    OS_QUEUE_UNLOCK();
+
+    return Ret;
+}
+
+/*
+ * Read in interrupt handler, return immediately when the queue is empty,
+ * never print and never schedule, the caller should use OS_API_YieldFromISR
+ * with the woken flag before return.
+ */
+OS_Uint32_t OS_API_QueueReadFromISR(OS_Uint32_t QueueHandle, void * buffer,
+                                    OS_Uint32_t size, OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Queue_t *Queue = OS_NULL;
+    OS_TCB_t *WakeupTaskCB = OS_NULL;
+
+    OS_CHECK_NULL_POINTER(buffer);
+
+    OS_QUEUE_CHECK_HANDLE_VALID(QueueHandle);
+    OS_QUEUE_CHECK_BEEN_CREATED(QueueHandle);
+
+    OS_QUEUE_LOCK();
+
+    Queue = OS_QUEUE_HANDLE_TO_POINTER(QueueHandle);
+
+    if (size > Queue->ElementSize)
+    {
+        Ret = OS_QUEUE_RD_DATA_TOO_BIG;
+        goto OS_API_QueueReadFromISR_Exit;
+    }
+
+    if (OS_QueueEmpty(Queue))
+    {
+        Ret = OS_QUEUE_RD_EMPTY_IN_INTR_CONTEXT;
+        goto OS_API_QueueReadFromISR_Exit;
+    }
+
+    TARCE_QueueReadOut(CurrentTCB, Queue);
+
+    OS_QueueCopyOut(Queue, buffer, size);
+
+    if (!ListEmpty(&Queue->WriterSleepList))
+    {
+        TARCE_QueueReadWakeupWriter(CurrentTCB, Queue);
+
+        WakeupTaskCB = OS_QueueWakeup(&Queue->WriterSleepList);
+
+        OS_TaskWokenFromISR(WakeupTaskCB, HigherPriorityTaskWoken);
+    }
+
+#if CONFIG_USE_COROUTINE
+    if (Queue->CoWriterNr != 0)
+        OS_API_CoroutineKickFromISR(HigherPriorityTaskWoken);
+#endif
+
+OS_API_QueueReadFromISR_Exit:
+    OS_QUEUE_UNLOCK();
+
+    return Ret;
+}
+
 OS_Uint32_t OS_API_QueueRemainingSpace(OS_Uint32_t QueueHandle)
 {
     OS_Queue_t *Queue = OS_NULL;
@@ -518,7 +719,9 @@ OS_Uint32_t OS_API_QueueDestory(OS_Uint32_t QueueHandle)
         goto OS_API_QueueDestory_Exit;
     }
 
-    OS_API_Free(Queue->DataBuffer);
+    /* The caller owns the buffer of a static queue */
+    if (Queue->StaticBuffer == OS_QUEUE_HEAP_BUFFER)
+        OS_API_Free(Queue->DataBuffer);
 
     Queue->Used = OS_QUEUE_UNUSED;
 
@@ -528,4 +731,31 @@ OS_API_QueueDestory_Exit:
     return Ret;
 }
 
+#if CONFIG_USE_COROUTINE
+
+/* A coroutine starts or stops waiting to read or to write, see OS_CO_QUEUE_READ */
+void OS_QueueCoroutineWait(OS_Uint32_t QueueHandle, OS_Uint8_t Writer, OS_Uint8_t Waiting)
+{
+    OS_Uint16_t *WaiterNr = OS_NULL;
+
+    if (QueueHandle >= CONFIG_MAX_QUEUE_DEFINE)
+        return;
+
+    OS_QUEUE_LOCK();
+
+    if (Writer)
+        WaiterNr = &OS_QueuePool[QueueHandle].CoWriterNr;
+    else
+        WaiterNr = &OS_QueuePool[QueueHandle].CoReaderNr;
+
+    if (Waiting)
+        (*WaiterNr)++;
+    else if (*WaiterNr != 0)
+        (*WaiterNr)--;
+
+    OS_QUEUE_UNLOCK();
+}
+
+#endif
+
 #endif // CONFIG_USE_QUEUE
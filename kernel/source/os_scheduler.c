@@ -23,6 +23,7 @@
  */
 
 #include "arch.h"
+#include "os_lib.h"
 #include "os_sem.h"
 #include "os_time.h"
 #include "os_list.h"
@@ -49,58 +50,144 @@
 
 SCH_FUNCTION_SPACE OS_TaskScheduler_t Scheduler;
 
-extern OS_TCB_t * volatile CurrentTCB;
-extern OS_TCB_t * volatile SwitchNextTCB;
+#define OS_THIS_RUN_QUEUE()               (&Scheduler.RunQueue[OS_CORE_ID()])
+#define OS_TASK_RUN_QUEUE(TaskCB)         (&Scheduler.RunQueue[OS_TASK_CORE(TaskCB)])
 
 #if CONFIG_USE_SW_TIMER
 extern void OS_SwTimerCheck(OS_Uint32_t CurrentTime);
+extern OS_Uint8_t OS_SwTimerGetNextWakeup(OS_Uint32_t *NextWakeupTime);
 #endif
 
-void OS_Schedule(void);
-
-SCH_FUNCTION_SPACE void SetPriorityActive(OS_Uint8_t ActiveBit)
-{
-    Scheduler.PriorityActive |= (0x01 << ActiveBit);
-}
+#if CONFIG_USE_MUTEX
+extern void OS_MutexWaitCancel(OS_TCB_t *TaskCB);
+#endif
 
-SCH_FUNCTION_SPACE void ClearPriorityActive(OS_Uint8_t ActiveBit)
-{
-    Scheduler.PriorityActive &= (~(0x01 << ActiveBit));
-}
+void OS_Schedule(void);
+static void OS_TimeElapsedCheck(OS_Uint32_t CurrentTime);
 
-OS_TCB_t * OS_HighestPrioTaskGet(void)
+/* Index of the highest bit set in Word, Word should not be 0 */
+static inline OS_Uint8_t OS_HighestBitGet(OS_Uint32_t Word)
 {
-    OS_Uint8_t TargetPri = 0;
-    OS_TCB_t * TargetTCB = OS_NULL;
+    OS_Uint8_t TargetBit = 0;
 
 #if CONFIG_ARM_ARCH
-    TargetPri = (31 - __clz(Scheduler.PriorityActive));
+    TargetBit = (31 - __clz(Word));
+#elif defined(__GNUC__)
+    TargetBit = (31 - __builtin_clz(Word));
 #else
     {
         OS_Uint8_t TryBit = 31;
-        for (; TryBit >=0; TryBit--)
+        for (; TryBit > 0; TryBit--)
         {
-            if (Scheduler.PriorityActive & (0x01 << TryBit))
+            if (Word & (0x01UL << TryBit))
                 break;
         }
-        TargetPri = TryBit;
+        TargetBit = TryBit;
     }
 #endif
 
-    OS_ASSERT(TargetPri <= 31);
-    OS_ASSERT(!ListEmpty(&Scheduler.ReadyListHead[TargetPri]));
+    OS_ASSERT(TargetBit <= 31);
+
+    return TargetBit;
+}
+
+#if OS_PRIORITY_TWO_LEVEL
+
+/*
+ * Priority P is bit (P % 32) of PriorityActive[P / 32], and bit (P / 32)
+ * of PriorityGroup is set when any priority in that group is active.
+ */
+#define OS_PRIORITY_GROUP(Priority)       ((Priority) >> 5)
+#define OS_PRIORITY_GROUP_BIT(Priority)   ((Priority) & 0x1F)
+
+SCH_FUNCTION_SPACE void SetPriorityActive(OS_CoreRunQueue_t *RunQueue, OS_Uint8_t ActiveBit)
+{
+    RunQueue->PriorityActive[OS_PRIORITY_GROUP(ActiveBit)] |= (0x01UL << OS_PRIORITY_GROUP_BIT(ActiveBit));
+    RunQueue->PriorityGroup |= (0x01UL << OS_PRIORITY_GROUP(ActiveBit));
+}
+
+SCH_FUNCTION_SPACE void ClearPriorityActive(OS_CoreRunQueue_t *RunQueue, OS_Uint8_t ActiveBit)
+{
+    RunQueue->PriorityActive[OS_PRIORITY_GROUP(ActiveBit)] &= (~(0x01UL << OS_PRIORITY_GROUP_BIT(ActiveBit)));
+    if (RunQueue->PriorityActive[OS_PRIORITY_GROUP(ActiveBit)] == 0)
+        RunQueue->PriorityGroup &= (~(0x01UL << OS_PRIORITY_GROUP(ActiveBit)));
+}
+
+static inline OS_Uint8_t OS_IsPriorityActive(OS_CoreRunQueue_t *RunQueue, OS_Uint8_t Priority)
+{
+    return ((RunQueue->PriorityActive[OS_PRIORITY_GROUP(Priority)] &
+            (0x01UL << OS_PRIORITY_GROUP_BIT(Priority))) != 0);
+}
+
+/* Only the idle priority(0) is active */
+static inline OS_Uint8_t OS_IsOnlyIdlePriorityActive(OS_CoreRunQueue_t *RunQueue)
+{
+    return ( (RunQueue->PriorityGroup == 0x01) && (RunQueue->PriorityActive[0] == 0x01) );
+}
+
+static OS_Uint8_t OS_HighestActivePriority(OS_CoreRunQueue_t *RunQueue)
+{
+    OS_Uint8_t Group = OS_HighestBitGet(RunQueue->PriorityGroup);
+
+    return (OS_Uint8_t)((Group << 5) + OS_HighestBitGet(RunQueue->PriorityActive[Group]));
+}
+
+#else
+
+SCH_FUNCTION_SPACE void SetPriorityActive(OS_CoreRunQueue_t *RunQueue, OS_Uint8_t ActiveBit)
+{
+    RunQueue->PriorityActive |= (0x01UL << ActiveBit);
+}
+
+SCH_FUNCTION_SPACE void ClearPriorityActive(OS_CoreRunQueue_t *RunQueue, OS_Uint8_t ActiveBit)
+{
+    RunQueue->PriorityActive &= (~(0x01UL << ActiveBit));
+}
+
+static inline OS_Uint8_t OS_IsPriorityActive(OS_CoreRunQueue_t *RunQueue, OS_Uint8_t Priority)
+{
+    return ((RunQueue->PriorityActive & (0x01UL << Priority)) != 0);
+}
+
+/* Only the idle priority(0) is active */
+static inline OS_Uint8_t OS_IsOnlyIdlePriorityActive(OS_CoreRunQueue_t *RunQueue)
+{
+    return (RunQueue->PriorityActive == 0x01);
+}
+
+static OS_Uint8_t OS_HighestActivePriority(OS_CoreRunQueue_t *RunQueue)
+{
+    return OS_HighestBitGet(RunQueue->PriorityActive);
+}
+
+#endif // OS_PRIORITY_TWO_LEVEL
+
+OS_TCB_t * OS_CoreHighestPrioTaskGet(OS_Uint8_t Core)
+{
+    OS_Uint8_t TargetPri = 0;
+    OS_TCB_t * TargetTCB = OS_NULL;
+    OS_CoreRunQueue_t *RunQueue = &Scheduler.RunQueue[Core];
+
+    TargetPri = OS_HighestActivePriority(RunQueue);
 
-    TargetTCB = ListFirstEntry(&Scheduler.ReadyListHead[TargetPri], OS_TCB_t, StateList);
+    OS_ASSERT(!ListEmpty(&RunQueue->ReadyListHead[TargetPri]));
+
+    TargetTCB = ListFirstEntry(&RunQueue->ReadyListHead[TargetPri], OS_TCB_t, StateList);
     return TargetTCB;
 }
 
+OS_TCB_t * OS_HighestPrioTaskGet(void)
+{
+    return OS_CoreHighestPrioTaskGet(OS_CORE_ID());
+}
+
 OS_Int16_t OS_IsSchedulerSuspending(void)
 {
     OS_Int16_t IsSuspending = 0;
 
     OS_SCHEDULER_LOCK();
 
-    IsSuspending = Scheduler.SchedulerSuspendNesting;
+    IsSuspending = OS_THIS_RUN_QUEUE()->SchedulerSuspendNesting;
     OS_ASSERT(IsSuspending >= 0);
 
     OS_SCHEDULER_UNLOCK();
@@ -108,36 +195,269 @@ OS_Int16_t OS_IsSchedulerSuspending(void)
     return IsSuspending;
 }
 
+/*
+ * With SMP, suspending scheduler only stops the task switch on the
+ * core which calls it, the other cores go on scheduling
+ */
 void OS_API_SchedulerSuspend(void)
 {
+    OS_CoreRunQueue_t *RunQueue = OS_NULL;
+
     OS_SCHEDULER_LOCK();
-    Scheduler.SchedulerSuspendNesting++;
 
-    TRACE_SchedulerSuspend(Scheduler.SchedulerSuspendNesting);
+    RunQueue = OS_THIS_RUN_QUEUE();
+    RunQueue->SchedulerSuspendNesting++;
+
+    TRACE_SchedulerSuspend(RunQueue->SchedulerSuspendNesting);
 
     OS_SCHEDULER_UNLOCK();
 }
 
 void OS_API_SchedulerResume(void)
 {
+    OS_CoreRunQueue_t *RunQueue = OS_NULL;
+
     OS_SCHEDULER_LOCK();
 
-    Scheduler.SchedulerSuspendNesting--;
+    RunQueue = OS_THIS_RUN_QUEUE();
+    RunQueue->SchedulerSuspendNesting--;
+
+    TRACE_SchedulerResume(RunQueue->SchedulerSuspendNesting);
+
+    OS_ASSERT(RunQueue->SchedulerSuspendNesting >= 0);
 
-    TRACE_SchedulerResume(Scheduler.SchedulerSuspendNesting);
+    /* Catch up the ticks missed while suspending, in one step */
+    if (RunQueue->SchedulerSuspendNesting == 0 && RunQueue->PendedTicks != 0)
+    {
+        TRACE_SchedulerPendedTicks(RunQueue->PendedTicks);
+
+        OS_StepTime(RunQueue->PendedTicks);
+        RunQueue->PendedTicks = 0;
 
-    OS_ASSERT(Scheduler.SchedulerSuspendNesting >= 0);
+        OS_TimeElapsedCheck(OS_GetCurrentTime());
+
+        RunQueue->ReSchedulePending = RESCH_PENDING;
+    }
 
-    if (Scheduler.SchedulerSuspendNesting == 0 &&
-        Scheduler.ReSchedulePending == RESCH_PENDING)
+    if (RunQueue->SchedulerSuspendNesting == 0 &&
+        RunQueue->ReSchedulePending == RESCH_PENDING)
     {
-        Scheduler.ReSchedulePending = NO_RESCH_PENDING;
+        RunQueue->ReSchedulePending = NO_RESCH_PENDING;
         OS_Schedule();
     }
 
     OS_SCHEDULER_UNLOCK();
 }
 
+#if (CONFIG_CPU_CORE_NUM > 1)
+
+static OS_Uint8_t OS_SmpTaskRunningCore(OS_TCB_t * TaskCB)
+{
+    OS_Uint8_t Core = 0;
+
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        if (CoreCurrentTCB[Core] == TaskCB)
+            return Core;
+    }
+
+    return OS_CORE_NONE;
+}
+
+/*
+ * Choose the core for a task which becomes ready, a running task stays
+ * on its core if allowed. Otherwise the allowed core running the lowest
+ * priority task is taken, it is the one most likely to be preempted, and
+ * the last core of the task wins the tie to keep the cache warm. Before
+ * the scheduler starts all of the cores tie, so tasks are spread in turn.
+ */
+static OS_Uint8_t OS_SmpSelectCore(OS_TCB_t * TaskCB)
+{
+    static OS_Uint8_t FirstTryCore = 0;
+    OS_Uint8_t  i = 0;
+    OS_Uint8_t  Core = 0;
+    OS_Uint8_t  TargetCore = OS_CORE_NONE;
+    OS_Int16_t  Priority = 0;
+    OS_Int16_t  TargetPriority = OS_MAX_TASK_PRIORITY;
+
+    Core = OS_SmpTaskRunningCore(TaskCB);
+    if ( (Core != OS_CORE_NONE) && (TaskCB->Affinity & (0x01UL << Core)) )
+        return Core;
+
+    for (i = 0; i < CONFIG_CPU_CORE_NUM; i++)
+    {
+        Core = (FirstTryCore + i) % CONFIG_CPU_CORE_NUM;
+
+        if (!(TaskCB->Affinity & (0x01UL << Core)))
+            continue;
+
+        Priority = (CoreCurrentTCB[Core] == OS_NULL) ? -1 : CoreCurrentTCB[Core]->Priority;
+
+        if ( (Priority < TargetPriority) ||
+             ((Priority == TargetPriority) && (Core == TaskCB->Core)) )
+        {
+            TargetPriority = Priority;
+            TargetCore = Core;
+        }
+    }
+
+    FirstTryCore = (FirstTryCore + 1) % CONFIG_CPU_CORE_NUM;
+
+    OS_ASSERT(TargetCore != OS_CORE_NONE);
+
+    return TargetCore;
+}
+
+/*
+ * The caller reschedules its own core, the other core is kicked by IPI
+ * when the task sitting on it should preempt the running one
+ */
+static void OS_SmpPreemptCheck(OS_TCB_t * TaskCB)
+{
+    OS_TCB_t *RunningTCB = CoreCurrentTCB[TaskCB->Core];
+
+    if ( (TaskCB->Core == OS_CORE_ID()) || (RunningTCB == OS_NULL) )
+        return;
+
+    if (TaskCB->Priority > RunningTCB->Priority)
+        ARCH_SendIPI(TaskCB->Core);
+
+#if CONFIG_USE_EDF
+    if ( (TaskCB->Priority == OS_EDF_TASK_PRIORITY) && (RunningTCB->Priority == OS_EDF_TASK_PRIORITY) &&
+         OS_EDF_DEADLINE_BEFORE(TaskCB->Deadline, RunningTCB->Deadline) )
+        ARCH_SendIPI(TaskCB->Core);
+#endif
+}
+
+/*
+ * The task has been moved away from the ready list of the core which is
+ * running it (suspend, priority or affinity change), kick that core
+ */
+void OS_SmpKickRunningCore(OS_TCB_t * TaskCB)
+{
+    OS_Uint8_t Core = OS_SmpTaskRunningCore(TaskCB);
+
+    if ( (Core != OS_CORE_NONE) && (Core != OS_CORE_ID()) )
+        ARCH_SendIPI(Core);
+}
+
+static OS_Uint8_t OS_SmpTaskRunnable(OS_TCB_t * TaskCB, OS_Uint8_t Core)
+{
+    OS_Uint8_t RunningCore = OS_SmpTaskRunningCore(TaskCB);
+
+    return ( (TaskCB->State == OS_TASK_READY) &&
+             (TaskCB->Core == Core) &&
+             ((RunningCore == OS_CORE_NONE) || (RunningCore == Core)) );
+}
+
+static OS_TCB_t * OS_SmpPickRunnable(OS_Uint8_t Core)
+{
+    OS_CoreRunQueue_t *RunQueue = &Scheduler.RunQueue[Core];
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+    OS_Int16_t  Priority = 0;
+
+    for (Priority = OS_MAX_TASK_PRIORITY - 1; Priority >= 0; Priority--)
+    {
+        if (!OS_IsPriorityActive(RunQueue, (OS_Uint8_t)Priority))
+            continue;
+
+        ListForEach(ListIterator, &RunQueue->ReadyListHead[Priority])
+        {
+            TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, StateList);
+            if (OS_SmpTaskRunnable(TCB_Iterator, Core))
+                return TCB_Iterator;
+        }
+    }
+
+    /* Never here, the idle task of this core is always runnable */
+    OS_ASSERT(0);
+
+    return OS_NULL;
+}
+
+/*
+ * Called by arch with kernel lock held right before the context switch.
+ * The lock was released since OS_Schedule made the decision, so check it
+ * again, a task moved from other core may still be running there, it can
+ * only be switched in after that core saved its context. The core which
+ * switches such a task out kicks its new core for the same reason.
+ */
+OS_TCB_t * OS_SmpSwitchNextGet(void)
+{
+    OS_Uint8_t Core = OS_CORE_ID();
+    OS_CoreRunQueue_t *RunQueue = &Scheduler.RunQueue[Core];
+    OS_TCB_t *PrevTCB = CoreCurrentTCB[Core];
+    OS_TCB_t *NextTCB = CoreSwitchNextTCB[Core];
+    OS_Uint8_t PrevRunnable = OS_SmpTaskRunnable(PrevTCB, Core);
+
+    if ( (RunQueue->SchedulerSuspendNesting != 0) && PrevRunnable )
+        return PrevTCB;
+
+    if ( (NextTCB == OS_NULL) || !OS_SmpTaskRunnable(NextTCB, Core) ||
+         (NextTCB->Priority < OS_HighestActivePriority(RunQueue)) )
+    {
+        NextTCB = OS_SmpPickRunnable(Core);
+    }
+
+    if ( PrevRunnable && (PrevTCB->Priority > NextTCB->Priority) )
+        NextTCB = PrevTCB;
+
+    if ( (NextTCB != PrevTCB) && (PrevTCB->State == OS_TASK_READY) && (PrevTCB->Core != Core) )
+        ARCH_SendIPI(PrevTCB->Core);
+
+    return NextTCB;
+}
+
+/* Cross core reschedule request, called by arch in the IPI handler */
+void OS_SmpReScheduleHandler(void)
+{
+    OS_SCHEDULER_LOCK();
+
+    OS_Schedule();
+
+    OS_SCHEDULER_UNLOCK();
+}
+
+#endif // CONFIG_CPU_CORE_NUM > 1
+
+/*
+ * Called by the FromISR APIs after a task is woken up in interrupt, only
+ * record whether a re-schedule is needed, the switch is deferred to
+ * OS_API_YieldFromISR at the end of the interrupt handler.
+ */
+void OS_TaskWokenFromISR(OS_TCB_t * TaskCB, OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    if (HigherPriorityTaskWoken == OS_NULL)
+        return;
+
+    /* With SMP, the task woken up on other core is kicked by IPI */
+    if (OS_TASK_CORE(TaskCB) != OS_CORE_ID())
+        return;
+
+    if (TaskCB->Priority > CurrentTCB->Priority)
+        *HigherPriorityTaskWoken = 1;
+
+#if CONFIG_USE_EDF
+    /* The same band, an earlier deadline preempts as OS_Schedule picks it */
+    if ( (TaskCB->Priority == OS_EDF_TASK_PRIORITY) && (CurrentTCB->Priority == OS_EDF_TASK_PRIORITY) &&
+         OS_EDF_DEADLINE_BEFORE(TaskCB->Deadline, CurrentTCB->Deadline) )
+        *HigherPriorityTaskWoken = 1;
+#endif
+}
+
+void OS_API_YieldFromISR(OS_Uint8_t HigherPriorityTaskWoken)
+{
+    if (!HigherPriorityTaskWoken)
+        return;
+
+    OS_SCHEDULER_LOCK();
+
+    OS_Schedule();
+
+    OS_SCHEDULER_UNLOCK();
+}
+
 OS_Uint8_t OS_CheckTaskInTargetList(OS_TCB_t *TargetTCB, OS_Uint8_t TargetList)
 {
     OS_Uint8_t Ret = 0;
@@ -149,15 +469,15 @@ OS_Uint8_t OS_CheckTaskInTargetList(OS_TCB_t *TargetTCB, OS_Uint8_t TargetList)
     {
         case OS_READY_LIST:
         {
-            StateListHead = &Scheduler.ReadyListHead[TargetTCB->Priority];
+            StateListHead = &OS_TASK_RUN_QUEUE(TargetTCB)->ReadyListHead[TargetTCB->Priority];
         }
         break;
 
         case OS_DELAY_LIST:
         {
-            StateListHead = &Scheduler.DelayListHead;
+            /* The timing wheel has no list to search, the state tells */
+            return (TargetTCB->State == OS_TASK_DELAY);
         }
-        break;
 
         case OS_SUSPEND_LIST:
         {
@@ -167,9 +487,8 @@ OS_Uint8_t OS_CheckTaskInTargetList(OS_TCB_t *TargetTCB, OS_Uint8_t TargetList)
 
         case OS_BLOCKED_TIMEOUT_LIST:
         {
-            StateListHead = &Scheduler.BlockTimeoutListHead;
+            return (TargetTCB->State == OS_TASK_TIMEOUT_BLOCKED);
         }
-        break;
 
         default : break;
     }
@@ -189,15 +508,60 @@ OS_Uint8_t OS_CheckTaskInTargetList(OS_TCB_t *TargetTCB, OS_Uint8_t TargetList)
     return Ret;
 }
 
+#if CONFIG_USE_EDF
+/*
+ * The ready list of EDF priority is kept sorted by deadline, so picking
+ * the earliest one is O(1) as the other priorities, the insert walks only
+ * the ready tasks of EDF priority. The same deadlines keep FIFO order.
+ */
+static void OS_EdfAddToReadyList(OS_TCB_t * TaskCB, ListHead_t *ReadyListHead)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+
+    /* The tasks not periodic have the latest deadline, run after the others */
+    if (TaskCB->Period == 0)
+        TaskCB->Deadline = OS_GetCurrentTime() + OS_TSK_DLY_MAX;
+
+    ListForEach(ListIterator, ReadyListHead)
+    {
+        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, StateList);
+        if (OS_EDF_DEADLINE_BEFORE(TaskCB->Deadline, TCB_Iterator->Deadline))
+            break;
+    }
+
+    /* Insert before the first later one, or at the tail */
+    ListAddTail(&TaskCB->StateList, ListIterator);
+}
+#endif
+
 void OS_AddTaskToReadyList(OS_TCB_t * TaskCB)
 {
+    OS_CoreRunQueue_t *RunQueue = OS_NULL;
+
     OS_ASSERT(TaskCB->State != OS_TASK_READY);
 
-    ListAdd(&TaskCB->StateList, &Scheduler.ReadyListHead[TaskCB->Priority]);
-    SetPriorityActive(TaskCB->Priority);
+#if (CONFIG_CPU_CORE_NUM > 1)
+    TaskCB->Core = OS_SmpSelectCore(TaskCB);
+#endif
+
+    RunQueue = OS_TASK_RUN_QUEUE(TaskCB);
+
+#if CONFIG_USE_EDF
+    if (TaskCB->Priority == OS_EDF_TASK_PRIORITY)
+        OS_EdfAddToReadyList(TaskCB, &RunQueue->ReadyListHead[TaskCB->Priority]);
+    else
+#endif
+    /* Queue behind the equal priority ones, the head of the list is running */
+    ListAddTail(&TaskCB->StateList, &RunQueue->ReadyListHead[TaskCB->Priority]);
+    SetPriorityActive(RunQueue, TaskCB->Priority);
     TaskCB->State = OS_TASK_READY;
 
     TRACE_AddToTargetList(TP_READY_LIST, TaskCB);
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+    OS_SmpPreemptCheck(TaskCB);
+#endif
 }
 
 void OS_AddTaskToEndlessBlockList(OS_TCB_t * TaskCB, ListHead_t *SleepHead, OS_Uint8_t SortType)
@@ -247,65 +611,11 @@ void OS_AddTaskToEndlessBlockList(OS_TCB_t * TaskCB, ListHead_t *SleepHead, OS_U
     TaskCB->State = OS_TASK_ENDLESS_BLOCKED;
 }
 
-static void _OS_AddTaskToTimeSortList(OS_TCB_t *TaskCB, OS_Uint8_t TargetList)
-{
-    ListHead_t *ListIterator = OS_NULL;
-    OS_TCB_t   *TCB_Iterator = OS_NULL;
-    ListHead_t *TargetListHead = OS_NULL;
-
-    switch (TargetList)
-    {
-        case OS_DELAY_LIST:
-        {
-            TargetListHead = &Scheduler.DelayListHead;
-        }
-        break;
-
-        case OS_BLOCKED_TIMEOUT_LIST:
-        {
-            TargetListHead = &Scheduler.BlockTimeoutListHead;
-        }
-        break;
-
-        default :
-        {
-            TargetListHead = &Scheduler.DelayListHead;
-        }
-        break;
-    }
-
-    if (ListEmpty(TargetListHead))
-    {
-        ListAdd(&TaskCB->StateList, TargetListHead);
-    }
-    else
-    {
-        // Insert in the delay list with sort
-        ListForEach(ListIterator, TargetListHead)
-        {
-            TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, StateList);
-            // If TCB_Iterator->WakeUpTime after TargetTCB->WakeUpTime
-            if (OS_TIME_AFTER_EQ(TCB_Iterator->WakeUpTime, TaskCB->WakeUpTime))
-                break;
-        }
-
-        // Do not find position
-        if (ListIterator == TargetListHead)
-        {
-            ListAddTail(&TaskCB->StateList, TargetListHead);
-        }
-        else
-        {
-            ListAdd(&TaskCB->StateList, TCB_Iterator->StateList.prev);
-        }
-    }
-}
-
 void OS_AddTaskToDelayList(OS_TCB_t *TaskCB)
 {
     OS_ASSERT(TaskCB->State != OS_TASK_DELAY);
 
-    _OS_AddTaskToTimeSortList(TaskCB, OS_DELAY_LIST);
+    OS_TimerWheelAdd(&Scheduler.TimerWheel, TaskCB);
 
     TaskCB->State = OS_TASK_DELAY;
 
@@ -316,7 +626,7 @@ void OS_AddTaskToTimeOutBlockList(OS_TCB_t * TaskCB)
 {
     OS_ASSERT(TaskCB->State != OS_TASK_TIMEOUT_BLOCKED);
 
-    _OS_AddTaskToTimeSortList(TaskCB, OS_BLOCKED_TIMEOUT_LIST);
+    OS_TimerWheelAdd(&Scheduler.TimerWheel, TaskCB);
 
     TaskCB->State = OS_TASK_TIMEOUT_BLOCKED;
 
@@ -338,9 +648,9 @@ void OS_RemoveTaskFromReadyList(OS_TCB_t * TaskCB)
     OS_ASSERT(TaskCB->State == OS_TASK_READY);
 
     ListDel(&TaskCB->StateList);
-    if ( ListEmpty(&Scheduler.ReadyListHead[TaskCB->Priority]) )
+    if ( ListEmpty(&OS_TASK_RUN_QUEUE(TaskCB)->ReadyListHead[TaskCB->Priority]) )
     {
-        ClearPriorityActive(TaskCB->Priority);
+        ClearPriorityActive(OS_TASK_RUN_QUEUE(TaskCB), TaskCB->Priority);
     }
     TaskCB->State = OS_TASK_UNKNOWN;
 
@@ -351,7 +661,7 @@ void OS_RemoveTaskFromDelayList(OS_TCB_t * TaskCB)
 {
     OS_ASSERT(TaskCB->State == OS_TASK_DELAY);
 
-    ListDel(&TaskCB->StateList);
+    OS_TimerWheelDel(&Scheduler.TimerWheel, TaskCB);
     TaskCB->State = OS_TASK_UNKNOWN;
 
     TRACE_RemoveFromTargetList(TP_DELAY_LIST, TaskCB);
@@ -371,12 +681,17 @@ void OS_RemoveTaskFromBlockedList(OS_TCB_t * TaskCB)
 {
     if (TaskCB->State == OS_TASK_TIMEOUT_BLOCKED)
     {
-        ListDel(&TaskCB->StateList);
+        OS_TimerWheelDel(&Scheduler.TimerWheel, TaskCB);
     }
     ListDel(&TaskCB->IpcSleepList);
 
     TaskCB->State = OS_TASK_UNKNOWN;
 
+#if CONFIG_USE_MUTEX
+    /* Woken not by the unlock, as by timeout, the owner drops what it inherits at once */
+    OS_MutexWaitCancel(TaskCB);
+#endif
+
     TRACE_RemoveFromTargetList(TP_BLOCKED_LIST, TaskCB);
 }
 
@@ -385,34 +700,119 @@ void OS_RemoveTaskFromUnknownList(OS_TCB_t * TaskCB)
     if ( (TaskCB->State == OS_TASK_ENDLESS_BLOCKED) || (TaskCB->State == OS_TASK_TIMEOUT_BLOCKED) )
     {
         ListDel(&TaskCB->IpcSleepList);
+#if CONFIG_USE_MUTEX
+        /* Suspended or deleted while waiting for a mutex */
+        OS_MutexWaitCancel(TaskCB);
+#endif
     }
 
-    if (TaskCB->State != OS_TASK_ENDLESS_BLOCKED)
+    if ( (TaskCB->State == OS_TASK_DELAY) || (TaskCB->State == OS_TASK_TIMEOUT_BLOCKED) )
+    {
+        OS_TimerWheelDel(&Scheduler.TimerWheel, TaskCB);
+    }
+    else if (TaskCB->State != OS_TASK_ENDLESS_BLOCKED)
     {
         ListDel(&TaskCB->StateList);
     }
 
     if (TaskCB->State == OS_TASK_READY)
     {
-        if ( ListEmpty(&Scheduler.ReadyListHead[TaskCB->Priority]) )
+        if ( ListEmpty(&OS_TASK_RUN_QUEUE(TaskCB)->ReadyListHead[TaskCB->Priority]) )
         {
-            ClearPriorityActive(TaskCB->Priority);
+            ClearPriorityActive(OS_TASK_RUN_QUEUE(TaskCB), TaskCB->Priority);
         }
     }
     TaskCB->State = OS_TASK_UNKNOWN;
 }
 
-void OS_TaskReadyToDelay(OS_TCB_t * TaskCB)
+/* The TCB or stack may still be used by a core to switch */
+static OS_Uint8_t OS_TaskInUse(OS_TCB_t * TaskCB)
 {
-    /* Remove from ready list firstly */
-    OS_RemoveTaskFromReadyList(TaskCB);
-    /* Add it in delay list */
-    OS_AddTaskToDelayList(TaskCB);
+#if (CONFIG_CPU_CORE_NUM > 1)
+    OS_Uint8_t Core = 0;
+
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        if ( (CoreCurrentTCB[Core] == TaskCB) || (CoreSwitchNextTCB[Core] == TaskCB) )
+            return 1;
+    }
+
+    return 0;
+#else
+    return ( (CurrentTCB == TaskCB) || (SwitchNextTCB == TaskCB) );
+#endif
 }
 
-void OS_TaskDelayToReady(OS_TCB_t * TaskCB)
+/*
+ * Take the task off all of the kernel lists. Return 1 if it is still in
+ * use by a core or Defer is set, then it waits in the terminate list for
+ * the idle task, otherwise the caller frees it right now.
+ */
+OS_Uint8_t OS_TaskUnknownToDeleted(OS_TCB_t * TaskCB, OS_Uint8_t Defer)
 {
-    /* Remove from delay list firstly */
+#if (CONFIG_CPU_CORE_NUM > 1)
+    OS_Uint8_t Core = 0;
+#endif
+
+    OS_RemoveTaskFromUnknownList(TaskCB);
+
+#if CONFIG_USE_SHELL
+    ListDel(&TaskCB->TasksList);
+#endif
+
+    TaskCB->State = OS_TASK_DELETED;
+
+    if (!Defer && !OS_TaskInUse(TaskCB))
+        return 0;
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+    /* A core picked it to switch in, let that core pick again */
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        if ( (CoreSwitchNextTCB[Core] == TaskCB) && (CoreCurrentTCB[Core] != TaskCB) )
+        {
+            CoreSwitchNextTCB[Core] = OS_NULL;
+            if (Core != OS_CORE_ID())
+                ARCH_SendIPI(Core);
+        }
+    }
+#endif
+
+    ListAdd(&TaskCB->StateList, &Scheduler.TerminateListHead);
+
+    return 1;
+}
+
+/* Called by idle task, take out a deleted task which no core uses any more */
+OS_TCB_t * OS_TerminatedTaskGet(void)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+
+    ListForEach(ListIterator, &Scheduler.TerminateListHead)
+    {
+        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, StateList);
+        if (!OS_TaskInUse(TCB_Iterator))
+        {
+            ListDel(&TCB_Iterator->StateList);
+            return TCB_Iterator;
+        }
+    }
+
+    return OS_NULL;
+}
+
+void OS_TaskReadyToDelay(OS_TCB_t * TaskCB)
+{
+    /* Remove from ready list firstly */
+    OS_RemoveTaskFromReadyList(TaskCB);
+    /* Add it in delay list */
+    OS_AddTaskToDelayList(TaskCB);
+}
+
+void OS_TaskDelayToReady(OS_TCB_t * TaskCB)
+{
+    /* Remove from delay list firstly */
     OS_RemoveTaskFromDelayList(TaskCB);
     /* Add it in ready list */
     OS_AddTaskToReadyList(TaskCB);
@@ -460,6 +860,8 @@ void OS_TaskReadyToBlock(OS_TCB_t * TaskCB, ListHead_t *SleepHead,
 
 void OS_TaskBlockToReady(OS_TCB_t * TaskCB)
 {
+    TRACE_TaskWakeup(TaskCB);
+
     /* Remove from block list */
     OS_RemoveTaskFromBlockedList(TaskCB);
 
@@ -482,79 +884,34 @@ void OS_TaskChangePriority(OS_TCB_t * TaskCB, OS_Uint8_t NewPriority)
     {
         TaskCB->Priority = NewPriority;
     }
-}
-
-void OS_TaskCheckDelayWakeup(OS_Uint32_t time)
-{
-    ListHead_t *ListIterator = OS_NULL;
-    ListHead_t *ListIterator_prev = OS_NULL;
-    OS_TCB_t   *TCB_Iterator = OS_NULL;
-
-    if (ListEmpty(&Scheduler.DelayListHead))
-    {
-        return;
-    }
 
-    // Find out the task which should be wake up
-    ListForEach(ListIterator, &Scheduler.DelayListHead)
-    {
-        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, StateList);
-        // Check if the task is timeout
-        if (OS_TIME_AFTER_EQ(time, TCB_Iterator->WakeUpTime))
-        {
-            TRACE_TaskDelayTimeout(TCB_Iterator);
-
-            ListIterator_prev = ListIterator->prev;
-            OS_TaskDelayToReady(TCB_Iterator);
-            // Current ListIterator will link to ready list, relocate the pointer
-            ListIterator = ListIterator_prev;
-        }
-        else
-        {
-            break;
-        }
-    }
+#if (CONFIG_CPU_CORE_NUM > 1)
+    OS_SmpKickRunningCore(TaskCB);
+#endif
 }
 
-void OS_TaskCheckBlockWakeup(OS_Uint32_t time)
+static void OS_TaskTimeoutWakeup(OS_TCB_t *TaskCB)
 {
-    ListHead_t *ListIterator = OS_NULL;
-    ListHead_t *ListIterator_prev = OS_NULL;
-    OS_TCB_t   *TCB_Iterator = OS_NULL;
-
-    if (ListEmpty(&Scheduler.BlockTimeoutListHead))
+    if (TaskCB->State == OS_TASK_DELAY)
     {
-        return;
-    }
+        TRACE_TaskDelayTimeout(TaskCB);
 
-    // Find out the task which should be wake up
-    ListForEach(ListIterator, &Scheduler.BlockTimeoutListHead)
+        OS_TaskDelayToReady(TaskCB);
+    }
+    else
     {
-        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, StateList);
-        // Check if the task is timeout
-        if (OS_TIME_AFTER_EQ(time, TCB_Iterator->WakeUpTime))
-        {
-            TRACE_TaskBlockTimeout(TCB_Iterator);
+        TRACE_TaskBlockTimeout(TaskCB);
 
-            ListIterator_prev = ListIterator->prev;
+        TaskCB->IpcTimeoutWakeup = OS_IPC_WAIT_TIMEOUT;
 
-            TCB_Iterator->IpcTimeoutWakeup = OS_IPC_WAIT_TIMEOUT;
-
-            OS_TaskBlockToReady(TCB_Iterator);
-            // Current ListIterator will link to ready list, relocate the pointer
-            ListIterator = ListIterator_prev;
-        }
-        else
-        {
-            break;
-        }
+        OS_TaskBlockToReady(TaskCB);
     }
 }
 
+/* Only the slot of this tick in the timing wheel is checked */
 void OS_TaskCheckWakeup(OS_Uint32_t time)
 {
-    OS_TaskCheckDelayWakeup(time);
-    OS_TaskCheckBlockWakeup(time);
+    OS_TimerWheelAdvance(&Scheduler.TimerWheel, time, OS_TaskTimeoutWakeup);
 }
 
 #if CONFIG_STACK_OVERFLOW_CHECK
@@ -574,25 +931,90 @@ void OS_CheckStackOverflow(void)
 
 #endif
 
+#if CONFIG_USE_RUN_TIME_STATS
+/* Charge the run time counter elapsed since the last stamp to the running task of Core */
+static void OS_RunTimeCharge(OS_Uint8_t Core)
+{
+    OS_CoreRunQueue_t *RunQueue = &Scheduler.RunQueue[Core];
+    OS_Uint32_t Now = ARCH_RunTimeCounterGet();
+#if (CONFIG_CPU_CORE_NUM > 1)
+    OS_TCB_t *RunningTCB = CoreCurrentTCB[Core];
+#else
+    OS_TCB_t *RunningTCB = CurrentTCB;
+#endif
+
+    if (RunningTCB != OS_NULL)
+        RunningTCB->RunTime += (OS_Uint32_t)(Now - RunQueue->RunTimeStamp);
+
+    RunQueue->RunTimeStamp = Now;
+}
+
+/* Called right before the first task runs, the counter is ready by then */
+void OS_RunTimeStatsStart(void)
+{
+    OS_Uint8_t Core = 0;
+
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        Scheduler.RunQueue[Core].RunTimeStamp = ARCH_RunTimeCounterGet();
+    }
+}
+
+/*
+ * The run time of the task in arch run time counter cycles, ARCH_RUN_TIME_COUNTER_HZ
+ * of them a second, the running tasks are charged up to now first
+ */
+OS_Uint32_t OS_API_TaskRunTimeGet(OS_Uintptr_t TaskHandle, OS_Uint64_t *RunTime)
+{
+    OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
+    OS_Uint8_t Core = 0;
+
+    OS_CHECK_NULL_POINTER(TaskCB);
+    OS_CHECK_NULL_POINTER(RunTime);
+
+    OS_SCHEDULER_LOCK();
+
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        OS_RunTimeCharge(Core);
+    }
+
+    *RunTime = TaskCB->RunTime;
+
+    OS_SCHEDULER_UNLOCK();
+
+    return OS_SUCCESS;
+}
+#endif
+
 void OS_Schedule(void)
 {
     OS_Uint8_t NeedResch = 0;
+    OS_CoreRunQueue_t *RunQueue = OS_THIS_RUN_QUEUE();
 
     /* Check if the scheduler is suspend */
     if (OS_IsSchedulerSuspending())
     {
-        Scheduler.ReSchedulePending = RESCH_PENDING;
+        RunQueue->ReSchedulePending = RESCH_PENDING;
         return;
     }
 
     /* Find the highest priority task now */
     SwitchNextTCB = OS_HighestPrioTaskGet();
 
-    /* Check CurrentTCB is in the ready list */
-    if (CurrentTCB->State != OS_TASK_READY)
+#if CONFIG_USE_EDF
+    /* The earliest deadline is always the first one, never rotate it */
+    if (SwitchNextTCB->Priority == OS_EDF_TASK_PRIORITY)
+    {
+        NeedResch = (SwitchNextTCB != CurrentTCB);
+        goto _OS_ScheduleRightNow;
+    }
+#endif
+
+    /* Check CurrentTCB is in the ready list of this core */
+    if ( (CurrentTCB->State != OS_TASK_READY) || (OS_TASK_CORE(CurrentTCB) != OS_CORE_ID()) )
     {
         NeedResch = 1;
-        ListMoveTail(&SwitchNextTCB->StateList, &Scheduler.ReadyListHead[SwitchNextTCB->Priority]);
         goto _OS_ScheduleRightNow;
     }
 
@@ -600,41 +1022,28 @@ void OS_Schedule(void)
     if (SwitchNextTCB->Priority > CurrentTCB->Priority)
     {
         NeedResch = 1;
-        ListMoveTail(&SwitchNextTCB->StateList, &Scheduler.ReadyListHead[SwitchNextTCB->Priority]);
     }
 
     // The next task have the same prioirty as before
     if (SwitchNextTCB->Priority == CurrentTCB->Priority)
     {
-        // Check the next is the same as before
-        if (SwitchNextTCB != CurrentTCB)
+        // Take turns only when the slice of current used up or it yields, it is at the tail by then
+        if (!RunQueue->RoundRobinPending)
         {
-            NeedResch = 1;
-            // Move the next to the list of highest priority list
-            ListMoveTail(&SwitchNextTCB->StateList, &Scheduler.ReadyListHead[SwitchNextTCB->Priority]);
+            SwitchNextTCB = CurrentTCB;
         }
-        else
-        {
-            // Only one task in the highest prioirty list
-            if (ListIsLast(&SwitchNextTCB->StateList, &Scheduler.ReadyListHead[SwitchNextTCB->Priority]))
-            {
-                NeedResch = 0;
-            }
-            else
-            {
-                // more than one task in highest priority task list
-                NeedResch = 1;
 
-                SwitchNextTCB = ListEntry(CurrentTCB->StateList.next, OS_TCB_t, StateList);
-                ListMoveTail(&CurrentTCB->StateList, &Scheduler.ReadyListHead[SwitchNextTCB->Priority]);
-                ListMoveTail(&SwitchNextTCB->StateList, &Scheduler.ReadyListHead[SwitchNextTCB->Priority]);
-            }
-        }
+        NeedResch = (SwitchNextTCB != CurrentTCB);
     }
 
 _OS_ScheduleRightNow:
+    RunQueue->RoundRobinPending = 0;
+
     if (NeedResch)
     {
+#if CONFIG_USE_RUN_TIME_STATS
+        OS_RunTimeCharge(OS_CORE_ID());
+#endif
         TRACE_ContextSwitch(CurrentTCB, SwitchNextTCB, OS_GetCurrentTime());
 
 #if CONFIG_STACK_OVERFLOW_CHECK
@@ -642,45 +1051,119 @@ _OS_ScheduleRightNow:
 #endif
         ARCH_TriggerContextSwitch((void *)CurrentTCB, (void *)SwitchNextTCB);
     }
+    else
+    {
+        /* Keep current, a switch pending from before should not take the pick */
+        SwitchNextTCB = CurrentTCB;
+    }
 }
 
 void OS_SchedulerInit(void)
 {
     OS_Uint32_t i = 0;
+    OS_Uint32_t Core = 0;
 
-    /* Initial the task ReadyList */
-    for (i = 0; i < OS_MAX_TASK_PRIORITY; i++)
+    /* Initial the task ReadyList of every core */
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
     {
-        ListHeadInit(&Scheduler.ReadyListHead[i]);
+        for (i = 0; i < OS_MAX_TASK_PRIORITY; i++)
+        {
+            ListHeadInit(&Scheduler.RunQueue[Core].ReadyListHead[i]);
+        }
+
+        Scheduler.RunQueue[Core].SchedulerSuspendNesting = 0;
+        Scheduler.RunQueue[Core].PendedTicks = 0;
+#if OS_PRIORITY_TWO_LEVEL
+        Scheduler.RunQueue[Core].PriorityGroup = 0;
+        OS_Memset(Scheduler.RunQueue[Core].PriorityActive, 0, sizeof(Scheduler.RunQueue[Core].PriorityActive));
+#else
+        Scheduler.RunQueue[Core].PriorityActive = 0;
+#endif
+        Scheduler.RunQueue[Core].ReSchedulePending = NO_RESCH_PENDING;
+        Scheduler.RunQueue[Core].RoundRobinPending = 0;
+#if CONFIG_USE_RUN_TIME_STATS
+        Scheduler.RunQueue[Core].RunTimeStamp = 0;
+#endif
     }
-    ListHeadInit(&Scheduler.BlockTimeoutListHead);
+    OS_TimerWheelInit(&Scheduler.TimerWheel, CONFIG_TICK_COUNT_INIT_VALUE);
     ListHeadInit(&Scheduler.SuspendListHead);
-    ListHeadInit(&Scheduler.DelayListHead);
+    ListHeadInit(&Scheduler.TerminateListHead);
 
 #if CONFIG_USE_SHELL
     ListHeadInit(&Scheduler.AllTasksListHead);
 #endif
-
-    Scheduler.SchedulerSuspendNesting = 0;
-    Scheduler.PriorityActive = 0;
-    Scheduler.ReSchedulePending = NO_RESCH_PENDING;
 }
 
-void OS_SystemTickHander(void)
+/*
+ * Charge a tick to the running task of every core, the one used up its
+ * slice goes to the tail of its ready list right here, so the turn is not
+ * lost if a higher priority task runs first. The other cores are kicked
+ * by IPI to switch.
+ */
+static void OS_TimeSliceCheck(void)
 {
-    OS_Uint32_t CurrentTime = 0;
+    OS_Uint8_t Core = 0;
+    OS_TCB_t *RunningTCB = OS_NULL;
+    ListHead_t *ReadyListHead = OS_NULL;
 
-    OS_SCHEDULER_LOCK();
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+#if (CONFIG_CPU_CORE_NUM > 1)
+        RunningTCB = CoreCurrentTCB[Core];
+#else
+        RunningTCB = CurrentTCB;
+#endif
+        if ( (RunningTCB == OS_NULL) || (RunningTCB->State != OS_TASK_READY) ||
+             (OS_TASK_CORE(RunningTCB) != Core) || (RunningTCB->TimeSlice == 0) )
+            continue;
+
+#if CONFIG_USE_EDF
+        /* No time slice for EDF, the running task is the earliest one */
+        if (RunningTCB->Priority == OS_EDF_TASK_PRIORITY)
+            continue;
+#endif
 
-    /* Check if the scheduler is active */
-    if (Scheduler.SchedulerSuspendNesting != 0)
-        goto SystemTickHanderExit;
+        if (--RunningTCB->RemainingSlice != 0)
+            continue;
 
-    /* Increment of System Tick */
-    OS_IncrementTime();
+        RunningTCB->RemainingSlice = RunningTCB->TimeSlice;
 
-    CurrentTime = OS_GetCurrentTime();
+        ReadyListHead = &Scheduler.RunQueue[Core].ReadyListHead[RunningTCB->Priority];
+        if (ListIsFirst(&RunningTCB->StateList, ReadyListHead) &&
+            ListIsLast(&RunningTCB->StateList, ReadyListHead))
+            continue;
 
+        ListMoveTail(&RunningTCB->StateList, ReadyListHead);
+        Scheduler.RunQueue[Core].RoundRobinPending = 1;
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+        if (Core != OS_CORE_ID())
+            ARCH_SendIPI(Core);
+#endif
+    }
+}
+
+/* Give way to the equal priority tasks, called by yield */
+void OS_ScheduleRoundRobin(void)
+{
+    OS_CoreRunQueue_t *RunQueue = OS_THIS_RUN_QUEUE();
+
+#if CONFIG_USE_EDF
+    /* EDF tasks stay in the order of deadline */
+    if (CurrentTCB->Priority != OS_EDF_TASK_PRIORITY)
+#endif
+    {
+        CurrentTCB->RemainingSlice = CurrentTCB->TimeSlice;
+        ListMoveTail(&CurrentTCB->StateList, &RunQueue->ReadyListHead[CurrentTCB->Priority]);
+    }
+
+    RunQueue->RoundRobinPending = 1;
+
+    OS_Schedule();
+}
+
+static void OS_TimeElapsedCheck(OS_Uint32_t CurrentTime)
+{
     TRACE_IncrementTick(CurrentTime);
 
     OS_TaskCheckWakeup(CurrentTime);
@@ -688,6 +1171,37 @@ void OS_SystemTickHander(void)
 #if CONFIG_USE_SW_TIMER
     OS_SwTimerCheck(CurrentTime);
 #endif
+}
+
+void OS_SystemTickHander(void)
+{
+#if CONFIG_USE_RUN_TIME_STATS
+    OS_Uint8_t Core = 0;
+#endif
+
+    OS_SCHEDULER_LOCK();
+
+    /* Check if the scheduler is active, or keep the tick for resume */
+    if (OS_THIS_RUN_QUEUE()->SchedulerSuspendNesting != 0)
+    {
+        OS_THIS_RUN_QUEUE()->PendedTicks++;
+        goto SystemTickHanderExit;
+    }
+
+    /* Increment of System Tick */
+    OS_IncrementTime();
+
+    OS_TimeElapsedCheck(OS_GetCurrentTime());
+
+#if CONFIG_USE_RUN_TIME_STATS
+    /* Charge every tick as well, a delta never gets near the counter wrap */
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        OS_RunTimeCharge(Core);
+    }
+#endif
+
+    OS_TimeSliceCheck();
 
     /* Schedule */
     OS_Schedule();
@@ -696,12 +1210,108 @@ SystemTickHanderExit:
     OS_SCHEDULER_UNLOCK();
 }
 
+#if CONFIG_USE_TICKLESS_IDLE
+
+static OS_Uint32_t OS_TicksToDeadline(OS_Uint32_t Deadline, OS_Uint32_t CurrentTime,
+                                      OS_Uint32_t IdleTicks)
+{
+    /* Should have been woken up already, do not sleep */
+    if (OS_TIME_AFTER_EQ(CurrentTime, Deadline))
+        return 0;
+
+    if (Deadline - CurrentTime < IdleTicks)
+        IdleTicks = Deadline - CurrentTime;
+
+    return IdleTicks;
+}
+
+/*
+ * The earliest task wakeup comes from the timing wheel,
+ * the software timer list is sorted, only its head should be checked
+ */
+static OS_Uint32_t OS_GetExpectedIdleTicks(OS_Uint32_t CurrentTime)
+{
+    OS_Uint32_t IdleTicks = OS_TSK_DLY_MAX;
+    OS_Uint32_t TaskWakeupTime = 0;
+#if CONFIG_USE_SW_TIMER
+    OS_Uint32_t SwTimerWakeupTime = 0;
+#endif
+
+    if (OS_TimerWheelNextExpiry(&Scheduler.TimerWheel, &TaskWakeupTime))
+    {
+        IdleTicks = OS_TicksToDeadline(TaskWakeupTime, CurrentTime, IdleTicks);
+    }
+
+#if CONFIG_USE_SW_TIMER
+    if (OS_SwTimerGetNextWakeup(&SwTimerWakeupTime))
+    {
+        IdleTicks = OS_TicksToDeadline(SwTimerWakeupTime, CurrentTime, IdleTicks);
+    }
+#endif
+
+    return IdleTicks;
+}
+
+/*
+ * Called by idle task, only sleep when idle task is the only ready task,
+ * ARCH_TicklessIdle return the whole ticks passed during the sleep
+ * and the tick interrupt for them will never come, so step them here.
+ */
+void OS_TicklessIdle(void)
+{
+    OS_Uint32_t ExpectedIdleTicks = 0;
+    OS_Uint32_t ElapsedTicks = 0;
+    OS_CoreRunQueue_t *RunQueue = OS_NULL;
+
+    OS_SCHEDULER_LOCK();
+
+    RunQueue = OS_THIS_RUN_QUEUE();
+
+    if (RunQueue->SchedulerSuspendNesting != 0)
+        goto OS_TicklessIdle_Exit;
+
+    /* Only the idle priority is active and only one task in it */
+    if ( (!OS_IsOnlyIdlePriorityActive(RunQueue)) ||
+         (!ListIsLast(&CurrentTCB->StateList, &RunQueue->ReadyListHead[0])) ||
+         (!ListIsFirst(&CurrentTCB->StateList, &RunQueue->ReadyListHead[0])) )
+        goto OS_TicklessIdle_Exit;
+
+    ExpectedIdleTicks = OS_GetExpectedIdleTicks(OS_GetCurrentTime());
+    if (ExpectedIdleTicks < CONFIG_TICKLESS_MIN_IDLE_TICKS)
+        goto OS_TicklessIdle_Exit;
+
+    TRACE_TicklessIdleEnter(ExpectedIdleTicks);
+
+    ElapsedTicks = ARCH_TicklessIdle(ExpectedIdleTicks);
+
+    TRACE_TicklessIdleExit(ElapsedTicks);
+
+    if (ElapsedTicks != 0)
+    {
+        OS_StepTime(ElapsedTicks);
+
+        OS_TimeElapsedCheck(OS_GetCurrentTime());
+
+        OS_Schedule();
+    }
+
+OS_TicklessIdle_Exit:
+    OS_SCHEDULER_UNLOCK();
+}
+
+#endif // CONFIG_USE_TICKLESS_IDLE
+
 #if CONFIG_USE_SHELL
 void OS_SchTaskRegister(OS_TCB_t *TaskCB)
 {
     ListAdd(&TaskCB->TasksList, &Scheduler.AllTasksListHead);
 }
 
+ListHead_t * OS_SchAllTasksListGet(void)
+{
+    return &Scheduler.AllTasksListHead;
+}
+
 char *ShellTaskStateString[] =
 {
     "READY",
@@ -709,7 +1319,8 @@ char *ShellTaskStateString[] =
     "SUSPEND",
     "ENDLESS",
     "TIMEOUT",
-    "UNKNOWN"
+    "UNKNOWN",
+    "DELETED"
 };
 
 void ShellTask(void)
@@ -738,5 +1349,129 @@ void ShellTask(void)
 }
 
 SHELL_EXPORT_CMD(task, ShellTask, Show task info);
+
+#if CONFIG_USE_RUN_TIME_STATS
+extern OS_Uint8_t OS_IsIdleTask(OS_TCB_t *TaskCB);
+
+/*
+ * Charge the running tasks first, then RunTimeSnapshot holds the run time at
+ * the beginning of the window, and the run time in the window at the end
+ */
+static OS_Uint64_t ShellTopSnapshot(OS_Uint8_t WindowEnd)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+    OS_Uint64_t Total = 0;
+    OS_Uint8_t  Core = 0;
+
+    OS_SCHEDULER_LOCK();
+
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        OS_RunTimeCharge(Core);
+    }
+
+    ListForEach(ListIterator, &Scheduler.AllTasksListHead)
+    {
+        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, TasksList);
+        if (WindowEnd)
+        {
+            TCB_Iterator->RunTimeSnapshot = TCB_Iterator->RunTime - TCB_Iterator->RunTimeSnapshot;
+            Total += TCB_Iterator->RunTimeSnapshot;
+        }
+        else
+        {
+            TCB_Iterator->RunTimeSnapshot = TCB_Iterator->RunTime;
+        }
+    }
+
+    OS_SCHEDULER_UNLOCK();
+
+    return Total;
+}
+
+/* Per-mille of Part in Whole */
+static OS_Uint32_t ShellPermille(OS_Uint64_t Part, OS_Uint64_t Whole)
+{
+    if (Whole == 0)
+        return 0;
+
+    return (OS_Uint32_t)((Part * 1000 + Whole / 2) / Whole);
+}
+
+void ShellTop(void)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+    OS_Uint64_t Total = 0;
+    OS_Uint64_t Idle = 0;
+    OS_Uint32_t Permille = 0;
+
+    ShellTopSnapshot(0);
+
+    OS_API_TaskDelay(CONFIG_TOP_WINDOW_TICKS);
+
+    Total = ShellTopSnapshot(1);
+
+    printf("----------------------- Task CPU Usage -----------------------\r\n");
+    printf("|--- Name ---|--- Priority ---|--- CPU(%%) ---|--- Total(ms) ---|\r\n");
+
+    ListForEach(ListIterator, &Scheduler.AllTasksListHead)
+    {
+        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, TasksList);
+        if (OS_IsIdleTask(TCB_Iterator))
+            Idle += TCB_Iterator->RunTimeSnapshot;
+
+        Permille = ShellPermille(TCB_Iterator->RunTimeSnapshot, Total);
+        printf("|  %8s   ", TCB_Iterator->TaskName);
+        printf("     0x%02X        ", TCB_Iterator->Priority);
+        printf("   %3u.%u     ", Permille / 10, Permille % 10);
+        printf("    %10u   |", (OS_Uint32_t)(TCB_Iterator->RunTime * 1000 / ARCH_RUN_TIME_COUNTER_HZ));
+        printf("\r\n");
+    }
+
+    Permille = 1000 - ShellPermille(Idle, Total);
+    printf("CPU load: %u.%u%% of %u core(s) over %u ticks\r\n",
+           Permille / 10, Permille % 10, CONFIG_CPU_CORE_NUM, CONFIG_TOP_WINDOW_TICKS);
+}
+
+SHELL_EXPORT_CMD(top, ShellTop, Show task CPU usage);
+#endif
+
+/* Per-mille of Used in Size, shown as the percent with one decimal */
+static void ShellStackLine(const char *Name, OS_Uint32_t Size, OS_Uint32_t Used)
+{
+    OS_Uint32_t Permille = (Size == 0) ? 0 : (OS_Uint32_t)((OS_Uint64_t)Used * 1000 / Size);
+
+    printf("|  %8s   ", Name);
+    printf("  %8u  ", Size);
+    printf("  %8u(%3u.%u%%) ", Used, Permille / 10, Permille % 10);
+    printf("   %8u     |", Size - Used);
+    printf("\r\n");
+}
+
+void ShellStack(void)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+    OS_Uint32_t Size = 0;
+    OS_Uint32_t Used = 0;
+
+    printf("------------------------- Stack Usage -------------------------\r\n");
+    printf("|--- Name ---|--- Size ---|--- Peak Used ---|--- Headroom ---|\r\n");
+
+    ListForEach(ListIterator, &Scheduler.AllTasksListHead)
+    {
+        TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, TasksList);
+        Used = OS_TaskStackUsage(TCB_Iterator, &Size);
+        ShellStackLine((const char *)TCB_Iterator->TaskName, Size, Used);
+    }
+
+    Used = OS_API_IsrStackHighWater(&Size);
+    if (Size != 0)
+        ShellStackLine("MSP(ISR)", Size, Used);
+}
+
+SHELL_EXPORT_CMD(stack, ShellStack, Show task stack usage);
 #endif
 
@@ -33,6 +33,10 @@
 #include "os_scheduler.h"
 #include "os_error_code.h"
 
+#if CONFIG_USE_COROUTINE
+#include "os_coroutine.h"
+#endif
+
 #if CONFIG_USE_SEM
 
 #define OS_SEM_MAX_COUNT                            0xFFFE
@@ -61,12 +65,11 @@ OS_Sem_t OS_SemPool[CONFIG_MAX_SEM_DEFINE];
 
 #define OS_SEM_HANDLE_TO_POINTER(HANDLE)            &OS_SemPool[HANDLE]
 
-extern OS_TCB_t * volatile CurrentTCB;
-
 extern void OS_TaskReadyToBlock(OS_TCB_t * TaskCB, ListHead_t *SleepHead, OS_Uint8_t BlockType, OS_Uint8_t SortType);
 extern OS_Int16_t OS_IsSchedulerSuspending(void);
 extern void OS_Schedule(void);
 extern void OS_TaskBlockToReady(OS_TCB_t * TaskCB);
+extern void OS_TaskWokenFromISR(OS_TCB_t * TaskCB, OS_Uint8_t *HigherPriorityTaskWoken);
 
 void OS_SemaphoreInit(void)
 {
@@ -75,6 +78,9 @@ void OS_SemaphoreInit(void)
     for (i = 0; i < CONFIG_MAX_SEM_DEFINE; i++)
     {
         OS_SemPool[i].Count = 0;
+#if CONFIG_USE_COROUTINE
+        OS_SemPool[i].CoWaiterNr = 0;
+#endif
         OS_SemPool[i].Used = OS_SEM_UNUSED;
         ListHeadInit(&OS_SemPool[i].List);
     }
@@ -119,6 +125,9 @@ static OS_Uint32_t OS_SemCreate(OS_Uint32_t *SemHandle, OS_Uint32_t Count)
 
     OS_SemPool[*SemHandle].Used = OS_SEM_USED;
     OS_SemPool[*SemHandle].Count = Count;
+#if CONFIG_USE_COROUTINE
+    OS_SemPool[*SemHandle].CoWaiterNr = 0;
+#endif
     ListHeadInit(&OS_SemPool[*SemHandle].List);
 
     TARCE_SemCreate(SemHandle, Count);
@@ -150,13 +159,15 @@ static OS_Uint32_t OS_SemWait(OS_Uint32_t SemHandle, OS_Uint8_t BlockType,
 {
     OS_Uint32_t Ret = OS_SUCCESS;
     OS_Sem_t *Sem = OS_NULL;
-    OS_TCB_t *TaskCB = CurrentTCB;
+    OS_TCB_t *TaskCB = OS_NULL;
 
     OS_SEM_CHECK_HANDLE_VALID(SemHandle);
     OS_SEM_CHECK_BEEN_CREATED(SemHandle);
 
     OS_SEM_LOCK();
 
+    TaskCB = CurrentTCB;
+
     Sem = OS_SEM_HANDLE_TO_POINTER(SemHandle);
 
     if (ARCH_IsInterruptContext())
@@ -282,6 +293,12 @@ static OS_Uint32_t OS_SemPost(OS_Uint32_t SemHandle, OS_Uint32_t MaxCount)
     else
     {
         Sem->Count++;
+
+#if CONFIG_USE_COROUTINE
+        /* No task takes it, the coroutines waiting on it check at once */
+        if (Sem->CoWaiterNr != 0)
+            OS_API_CoroutineKick();
+#endif
     }
 
 OS_API_SemPost_Exit:
@@ -300,6 +317,69 @@ OS_Uint32_t OS_API_BinarySemPost(OS_Uint32_t SemHandle)
     return OS_SemPost(SemHandle, OS_BINARY_SEM_MAX_COUNT);
 }
 
+/*
+ * Post in interrupt handler, never print and never schedule, the caller
+ * should use OS_API_YieldFromISR with the woken flag before return.
+ */
+static OS_Uint32_t OS_SemPostFromISR(OS_Uint32_t SemHandle, OS_Uint32_t MaxCount,
+                                     OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Sem_t *Sem = OS_NULL;
+    ListHead_t *IpcSleepList = OS_NULL;
+    OS_TCB_t *TaskCB = OS_NULL;
+
+    OS_SEM_CHECK_HANDLE_VALID(SemHandle);
+    OS_SEM_CHECK_BEEN_CREATED(SemHandle);
+
+    OS_SEM_LOCK();
+
+    Sem = OS_SEM_HANDLE_TO_POINTER(SemHandle);
+
+    if (Sem->Count >= MaxCount)
+    {
+        Ret = OS_SEM_OVERFLOW;
+        goto OS_SemPostFromISR_Exit;
+    }
+
+    if (!ListEmpty(&Sem->List))
+    {
+        // Pick the last one of sleep list because we use FIFO algorithm
+        IpcSleepList = PickListLast(&Sem->List);
+        TaskCB = ListEntry(IpcSleepList, OS_TCB_t, IpcSleepList);
+
+        TARCE_SemWakeup(TaskCB);
+
+        OS_TaskBlockToReady(TaskCB);
+
+        OS_TaskWokenFromISR(TaskCB, HigherPriorityTaskWoken);
+    }
+    else
+    {
+        Sem->Count++;
+
+#if CONFIG_USE_COROUTINE
+        if (Sem->CoWaiterNr != 0)
+            OS_API_CoroutineKickFromISR(HigherPriorityTaskWoken);
+#endif
+    }
+
+OS_SemPostFromISR_Exit:
+    OS_SEM_UNLOCK();
+
+    return Ret;
+}
+
+OS_Uint32_t OS_API_SemPostFromISR(OS_Uint32_t SemHandle, OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    return OS_SemPostFromISR(SemHandle, OS_SEM_MAX_COUNT, HigherPriorityTaskWoken);
+}
+
+OS_Uint32_t OS_API_BinarySemPostFromISR(OS_Uint32_t SemHandle, OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    return OS_SemPostFromISR(SemHandle, OS_BINARY_SEM_MAX_COUNT, HigherPriorityTaskWoken);
+}
+
 OS_Uint32_t OS_API_SemDestory(OS_Uint32_t SemHandle)
 {
     OS_Uint32_t Ret = OS_SUCCESS;
@@ -336,4 +416,28 @@ OS_Uint32_t OS_API_SemDestory(OS_Uint32_t SemHandle)
     return Ret;
 }
 
+#if CONFIG_USE_COROUTINE
+
+/* A coroutine starts or stops waiting on the semaphore, see OS_CO_SEM_WAIT */
+void OS_SemCoroutineWait(OS_Uint32_t SemHandle, OS_Uint8_t Waiting)
+{
+    OS_Sem_t *Sem = OS_NULL;
+
+    if (SemHandle >= CONFIG_MAX_SEM_DEFINE)
+        return;
+
+    OS_SEM_LOCK();
+
+    Sem = OS_SEM_HANDLE_TO_POINTER(SemHandle);
+
+    if (Waiting)
+        Sem->CoWaiterNr++;
+    else if (Sem->CoWaiterNr != 0)
+        Sem->CoWaiterNr--;
+
+    OS_SEM_UNLOCK();
+}
+
+#endif
+
 #endif // CONFIG_USE_SEM
@@ -34,7 +34,7 @@
 #include "os_error_code.h"
 
 #if CONFIG_USE_SHELL
-static OS_Uint32_t OS_ShellTaskHandle = 0;
+static OS_Uintptr_t OS_ShellTaskHandle = 0;
 
 extern void PlatformUartSendDataPolling(const char ch);
 extern signed char PlatformUartRecvDataPolling(char *ch);
@@ -85,6 +85,7 @@ void OS_ShellTaskCreate(void)
     Param.PrivateData = Shell->Param;
     Param.StackSize = CONFIG_SW_TMR_TASK_STACK_SIZE;
     Param.TaskEntry = Shell->TaskEntry;
+    Param.TimeSlice = CONFIG_SHELL_TASK_TIME_SLICE;
 
     OS_API_TaskCreate(Param, (void *)&OS_ShellTaskHandle);
 }
@@ -34,14 +34,14 @@
 
 #if CONFIG_USE_SW_TIMER
 
-#define OS_SW_TIMER_TASK_PRIO                       31
+#define OS_SW_TIMER_TASK_PRIO                       (OS_MAX_TASK_PRIORITY - 1)
 
 #define OS_SW_TIMER_LOCK()                          OS_API_EnterCritical()
 #define OS_SW_TIMER_UNLOCK()                        OS_API_ExitCritical()
 
 OS_SwTimerManager_t SwTimerManager;
 OS_SwTimerNode_t SwTimerNode[CONFIG_MAX_TIMER_DEFINE];
-static OS_Uint32_t OS_SwTimerTaskHandle = 0;
+static OS_Uintptr_t OS_SwTimerTaskHandle = 0;
 
 extern void OS_TaskSuspendToReady(OS_TCB_t * TaskCB);
 extern void OS_TaskReadyToSuspend(OS_TCB_t * TaskCB);
@@ -110,6 +110,17 @@ OS_Uint32_t OS_SwTimerNextWakeupTime(void)
     return SwTimerManager.NextWakeupTime;
 }
 
+/* Return 1 and the next wakeup time if any timer is running */
+OS_Uint8_t OS_SwTimerGetNextWakeup(OS_Uint32_t *NextWakeupTime)
+{
+    if (ListEmpty(&SwTimerManager.TimerNodesList))
+        return 0;
+
+    *NextWakeupTime = SwTimerManager.NextWakeupTime;
+
+    return 1;
+}
+
 OS_Uint32_t OS_API_SwTimerCreate(OS_Uint32_t *SwTimerHandle,
                                  OS_Uint8_t WorkMode,
                                  OS_Uint32_t Interval,
@@ -371,6 +382,7 @@ void OS_SwTimerTaskCreate(void)
     Param.PrivateData = OS_NULL;
     Param.StackSize = CONFIG_SW_TMR_TASK_STACK_SIZE;
     Param.TaskEntry = OS_SwTimerTaskEntry;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
 
     OS_API_TaskCreate(Param, (void *)&OS_SwTimerTaskHandle);
 }
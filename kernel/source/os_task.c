@@ -25,6 +25,7 @@
 #include "os_lib.h"
 #include "os_mem.h"
 #include "os_list.h"
+#include "os_notify.h"
 #include "os_time.h"
 #include "os_task.h"
 #include "os_trace.h"
@@ -39,11 +40,21 @@
 #define OS_TASK_LOCK()               OS_API_EnterCritical()
 #define OS_TASK_UNLOCK()             OS_API_ExitCritical()
 
+#if (CONFIG_CPU_CORE_NUM > 1)
+OS_TCB_t * volatile CoreCurrentTCB[CONFIG_CPU_CORE_NUM];
+OS_TCB_t * volatile CoreSwitchNextTCB[CONFIG_CPU_CORE_NUM];
+static OS_Uintptr_t OS_IdleTaskHandle[CONFIG_CPU_CORE_NUM];
+#else
 OS_TCB_t * volatile CurrentTCB = OS_NULL;
 OS_TCB_t * volatile SwitchNextTCB = OS_NULL;
-static OS_Uint32_t OS_IdleTaskHandle = 0;
+static OS_Uintptr_t OS_IdleTaskHandle = 0;
+#endif
 
 extern void OS_Schedule(void);
+extern void OS_ScheduleRoundRobin(void);
+#if CONFIG_USE_RUN_TIME_STATS
+extern void OS_RunTimeStatsStart(void);
+#endif
 extern OS_TCB_t * OS_HighestPrioTaskGet(void);
 extern OS_Int16_t OS_IsSchedulerSuspending(void);
 extern void OS_RemoveTaskFromReadyList(OS_TCB_t * TaskCB);
@@ -52,15 +63,103 @@ extern void OS_TaskReadyToDelay(OS_TCB_t * TaskCB);
 extern void OS_TaskUnknowToSuspend(OS_TCB_t * TaskCB);
 extern void OS_TaskSuspendToReady(OS_TCB_t * TaskCB);
 extern void OS_TaskChangePriority(OS_TCB_t * TaskCB, OS_Uint8_t NewPriority);
+#if CONFIG_USE_MUTEX
+extern OS_Uint8_t OS_MutexEffectivePriority(OS_TCB_t *TaskCB);
+extern void OS_MutexPriorityUpdate(OS_TCB_t *TaskCB);
+extern OS_Uint8_t OS_MutexReleaseAll(OS_TCB_t *TaskCB);
+#endif
+extern OS_Uint8_t OS_TaskUnknownToDeleted(OS_TCB_t * TaskCB, OS_Uint8_t Defer);
+extern OS_TCB_t * OS_TerminatedTaskGet(void);
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+extern OS_TCB_t * OS_CoreHighestPrioTaskGet(OS_Uint8_t Core);
+extern void OS_SmpKickRunningCore(OS_TCB_t * TaskCB);
+#endif
+
+#if CONFIG_USE_TICKLESS_IDLE
+extern void OS_TicklessIdle(void);
+#endif
 
 #if CONFIG_USE_SHELL
 extern void OS_SchTaskRegister(OS_TCB_t *TaskCB);
 #endif
 
-OS_Uint32_t OS_API_TaskCreate(TaskInitParameter Param, OS_Uint32_t *TaskHandle)
+/* Init the TCB and stack storage and make the task ready, called with task lock held */
+static void OS_TaskInit(OS_TCB_t *TaskCB, void *Stack, OS_Uint8_t StaticAlloc,
+                        TaskInitParameter *Param, OS_Uintptr_t *TaskHandle)
+{
+    TaskCB->Stack = Stack;
+    TaskCB->StartOfStack = Stack;
+    TaskCB->StackSize = Param->StackSize;
+    TaskCB->StaticAlloc = StaticAlloc;
+
+    // Fill the task stack with magic number in order to check stack overflow
+    OS_Memset((void *) TaskCB->Stack, OS_TASK_MAGIC_NUMBER, Param->StackSize);
+
+    TaskCB->Priority = Param->Priority;
+#if CONFIG_USE_MUTEX
+    TaskCB->BasePriority = Param->Priority;
+    ListHeadInit(&TaskCB->MutexHeldList);
+    TaskCB->MutexWait = OS_NULL;
+#endif
+
+    OS_Memset((void *) TaskCB->TaskName, 0x00, CONFIG_TASK_NAME_LEN);
+    OS_Memcpy((void *) TaskCB->TaskName,(void *)Param->Name, CONFIG_TASK_NAME_LEN);
+    // Set the last one to zero to make sure the end of the char *
+    TaskCB->TaskName[CONFIG_TASK_NAME_LEN - 1] = 0x00;
+
+    // Prepare the stack for task
+    TaskCB->Stack = ARCH_PrepareStack((void *) TaskCB->Stack, (void *)Param);
+
+    TaskCB->State = OS_TASK_UNKNOWN;
+    TaskCB->TimeSlice = Param->TimeSlice;
+    TaskCB->RemainingSlice = Param->TimeSlice;
+#if CONFIG_USE_RUN_TIME_STATS
+    TaskCB->RunTime = 0;
+    TaskCB->RunTimeSnapshot = 0;
+#endif
+#if CONFIG_USE_MEM_ACCOUNTING
+    TaskCB->HeapBytes = 0;
+    TaskCB->HeapPeakBytes = 0;
+#endif
+#if CONFIG_USE_TASK_NOTIFY
+    TaskCB->NotifyValue = 0;
+    TaskCB->NotifyState = OS_NOTIFY_NONE;
+#endif
+#if CONFIG_USE_EDF
+    /* Not periodic until OS_API_TaskEdfSet */
+    TaskCB->Period = 0;
+    TaskCB->RelativeDeadline = 0;
+    TaskCB->Release = OS_GetCurrentTime();
+#endif
+#if (CONFIG_CPU_CORE_NUM > 1)
+    TaskCB->Affinity = OS_CORE_MASK_ALL;
+    TaskCB->Core = OS_CORE_NONE;
+#endif
+    OS_AddTaskToReadyList(TaskCB);
+
+    TaskCB->WakeUpTime = OS_TIME_MAX;
+    TaskCB->IpcTimeoutWakeup = OS_IPC_NO_TIMEOUT;
+
+    ListHeadInit(&TaskCB->IpcSleepList);
+
+#if CONFIG_USE_SHELL
+    ListHeadInit(&TaskCB->TasksList);
+    OS_SchTaskRegister(TaskCB);
+#endif
+
+    *TaskHandle = (OS_Uintptr_t)TaskCB;
+
+    TRACE_TaskCreate(TaskCB);
+
+    OS_PRINTK_INFO("Create Task Name:[%s], Priority:[%d]", TaskCB->TaskName, TaskCB->Priority);
+}
+
+OS_Uint32_t OS_API_TaskCreate(TaskInitParameter Param, OS_Uintptr_t *TaskHandle)
 {
     OS_Uint32_t Ret = OS_SUCCESS;
     OS_TCB_t *TaskCB = OS_NULL;
+    void *Stack = OS_NULL;
 
     if (TaskHandle == OS_NULL)
     {
@@ -75,7 +174,7 @@ OS_Uint32_t OS_API_TaskCreate(TaskInitParameter Param, OS_Uint32_t *TaskHandle)
     OS_TASK_LOCK();
 
     /* allocte memory for task struct */
-    TaskCB = (OS_TCB_t *)OS_API_Malloc(sizeof(OS_TCB_t));
+    TaskCB = (OS_TCB_t *)OS_MemMallocPrefer(CONFIG_TASK_MEM_ATTR, sizeof(OS_TCB_t));
     if (TaskCB == OS_NULL)
     {
         Ret = OS_NOT_ENOUGH_MEM_FOR_TASK_CREATE;
@@ -83,57 +182,57 @@ OS_Uint32_t OS_API_TaskCreate(TaskInitParameter Param, OS_Uint32_t *TaskHandle)
     }
 
     /* allocte memory for task stack */
-    TaskCB->Stack = OS_API_Malloc(Param.StackSize);
-    if (TaskCB->Stack == OS_NULL)
+    Stack = OS_MemMallocPrefer(CONFIG_TASK_MEM_ATTR, Param.StackSize);
+    if (Stack == OS_NULL)
     {
         OS_API_Free((void *)TaskCB);
         Ret = OS_NOT_ENOUGH_MEM_FOR_TASK_CREATE;
         goto TaskCreateMemNotEnough;
     }
 
-#if CONFIG_STACK_OVERFLOW_CHECK
-    TaskCB->StartOfStack = TaskCB->Stack;
-#endif
-
-    // Fill the task stack with magic number in order to check stack overflow
-    OS_Memset((void *) TaskCB->Stack, OS_TASK_MAGIC_NUMBER, Param.StackSize);
-
-    TaskCB->Priority = Param.Priority;
+    OS_TaskInit(TaskCB, Stack, OS_TASK_HEAP_ALLOC, &Param, TaskHandle);
 
-    OS_Memset((void *) TaskCB->TaskName, 0x00, CONFIG_TASK_NAME_LEN);
-    OS_Memcpy((void *) TaskCB->TaskName,(void *)Param.Name, CONFIG_TASK_NAME_LEN);
-    // Set the last one to zero to make sure the end of the char *
-    TaskCB->TaskName[CONFIG_TASK_NAME_LEN - 1] = 0x00;
-
-    // Prepare the stack for task
-    TaskCB->Stack = ARCH_PrepareStack((void *) TaskCB->Stack, (void *)&Param);
+#if CONFIG_USE_MEM_ACCOUNTING
+    /* The TCB and stack are the task's own, not the creator's */
+    OS_MemOwnerSet((void *)TaskCB, TaskCB);
+    OS_MemOwnerSet(Stack, TaskCB);
+#endif
 
-    TaskCB->State = OS_TASK_UNKNOWN;
-    OS_AddTaskToReadyList(TaskCB);
+    OS_TASK_UNLOCK();
 
-    TaskCB->WakeUpTime = OS_TIME_MAX;
-    TaskCB->IpcTimeoutWakeup = OS_IPC_NO_TIMEOUT;
+    return OS_SUCCESS;
 
-    ListHeadInit(&TaskCB->IpcSleepList);
+TaskCreateMemNotEnough:
+    OS_TASK_UNLOCK();
+    return Ret;
+}
 
-#if CONFIG_USE_SHELL
-    ListHeadInit(&TaskCB->TasksList);
-    OS_SchTaskRegister(TaskCB);
-#endif
+/*
+ * Create a task on the caller provided TCB and stack, nothing comes from
+ * the heap. Param.StackSize is the size of the Stack storage, which should
+ * be aligned to 8 bytes, OS_TASK_DEFINE gives such storage. The storage
+ * can be used again only after the task is deleted and freed.
+ */
+OS_Uint32_t OS_API_TaskCreateStatic(TaskInitParameter Param, OS_TCB_t *TaskCB,
+                                    void *Stack, OS_Uintptr_t *TaskHandle)
+{
+    if (TaskHandle == OS_NULL || TaskCB == OS_NULL || Stack == OS_NULL)
+    {
+        return OS_NULL_POINTER;
+    }
 
-    *TaskHandle = (OS_Uint32_t)TaskCB;
+    if (Param.Priority >= OS_MAX_TASK_PRIORITY)
+    {
+        return OS_TASK_PRIO_OUT_OF_RANGE;
+    }
 
-    TRACE_TaskCreate(TaskCB);
+    OS_TASK_LOCK();
 
-    OS_PRINTK_INFO("Create Task Name:[%s], Priority:[%d]", TaskCB->TaskName, TaskCB->Priority);
+    OS_TaskInit(TaskCB, Stack, OS_TASK_STATIC_ALLOC, &Param, TaskHandle);
 
     OS_TASK_UNLOCK();
 
     return OS_SUCCESS;
-
-TaskCreateMemNotEnough:
-    OS_TASK_UNLOCK();
-    return Ret;
 }
 
 /*
@@ -162,7 +261,7 @@ OS_Uint32_t OS_API_TaskYield(void)
 
     TRACE_TaskYield(CurrentTCB);
 
-    OS_Schedule();
+    OS_ScheduleRoundRobin();
 
 OS_API_TaskYield_Exit:
     OS_TASK_UNLOCK();
@@ -229,7 +328,7 @@ OS_API_TaskDelay_Exit:
  * 3. Suspend Other  ----|--Scheduler Suspending - [Allowed]
  *-----------------------|--In Thread -------------[Allowed]
  */
-OS_Uint32_t OS_API_TaskSuspend(OS_Uint32_t TaskHandle)
+OS_Uint32_t OS_API_TaskSuspend(OS_Uintptr_t TaskHandle)
 {
     OS_Uint32_t Ret = OS_SUCCESS;
     OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
@@ -275,12 +374,169 @@ OS_Uint32_t OS_API_TaskSuspend(OS_Uint32_t TaskHandle)
         OS_Schedule();
     }
 
+#if (CONFIG_CPU_CORE_NUM > 1)
+    /* The task may be running on other core */
+    OS_SmpKickRunningCore(TaskCB);
+#endif
+
 OS_API_TaskSuspend_Exit:
     OS_TASK_UNLOCK();
 
     return Ret;
 }
 
+OS_Uint8_t OS_IsIdleTask(OS_TCB_t *TaskCB);
+
+static void OS_TaskFree(OS_TCB_t *TaskCB)
+{
+#if CONFIG_USE_MEM_ACCOUNTING
+    /* The blocks the task did not free are left with no owner */
+    OS_MemOwnerRelease(TaskCB);
+#endif
+
+    /* What the arch allocated in ARCH_PrepareStack, even for a static task */
+    ARCH_ReleaseStack(TaskCB->Stack, TaskCB->StartOfStack);
+
+    /* The caller owns the storage of a static task */
+    if (TaskCB->StaticAlloc == OS_TASK_STATIC_ALLOC)
+        return;
+
+    OS_API_Free(TaskCB->StartOfStack);
+    OS_API_Free((void *)TaskCB);
+}
+
+/*
+ * Analysis Context:
+ *------------------------------------------------
+ * 1. Delete idle task or the one in deleting ---- [Not Allowed]
+ *------------------------------------------------
+ *
+ *-----------------------|--In ISR --------------- [Not Allowed]
+ * 2. Delete Current  ---|--Scheduler Suspending - [Not Allowed]
+ *-----------------------|--In Thread ------------ [Allowed](Schedule right now, freed by idle task)
+ *
+ *-----------------------|--In ISR --------------- [Allowed](Freed by idle task)
+ * 3. Delete Other  -----|--Scheduler Suspending - [Allowed]
+ *-----------------------|--In Thread -------------[Allowed](Freed right now, by idle task if a core uses it)
+ *
+ * The heap and arch frees are never done in interrupt, the arch may free
+ * with a host allocator which is not safe in a signal handler.
+ * The mutexes held by the deleted task are handed over to their waiters,
+ * or released if none waits.
+ */
+OS_Uint32_t OS_API_TaskDelete(OS_Uintptr_t TaskHandle)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
+    OS_Uint8_t Deferred = 1;
+    OS_Uint8_t NeedResch = 0;
+
+    OS_TASK_LOCK();
+
+    if (TaskCB == OS_NULL)
+    {
+        Ret = OS_NULL_POINTER;
+        goto OS_API_TaskDelete_Exit;
+    }
+
+    if (OS_IsIdleTask(TaskCB))
+    {
+        Ret = OS_DELETE_IDLE_TSK;
+        goto OS_API_TaskDelete_Exit;
+    }
+
+    if (TaskCB->State == OS_TASK_DELETED)
+    {
+        Ret = OS_TSK_DELETE_IN_DELETING;
+        goto OS_API_TaskDelete_Exit;
+    }
+
+    /* Check if want to delete Current itself */
+    if (TaskCB == CurrentTCB)
+    {
+        if (ARCH_IsInterruptContext())
+        {
+            Ret = OS_DELETE_CUR_TSK_IN_INTR;
+            goto OS_API_TaskDelete_Exit;
+        }
+
+        if (OS_IsSchedulerSuspending())
+        {
+            Ret = OS_DELETE_CUR_TSK_IN_SCH_SUSPEND;
+            goto OS_API_TaskDelete_Exit;
+        }
+    }
+
+    TRACE_TaskDelete(TaskCB, CurrentTCB);
+
+    OS_PRINTK_INFO("Delete Task Name:[%s]", TaskCB->TaskName);
+
+    /* A mutex owner gives up the priority it inherits from TaskCB in it */
+    Deferred = OS_TaskUnknownToDeleted(TaskCB, ARCH_IsInterruptContext());
+
+#if CONFIG_USE_MUTEX
+    /* No mutex is left with the freed TCB as its owner */
+    NeedResch = OS_MutexReleaseAll(TaskCB);
+#endif
+
+    /* Deleted Current or the one picked to switch in, pick again, or a waiter of its mutexes is woken */
+    if ( NeedResch || (TaskCB == CurrentTCB) || (TaskCB == SwitchNextTCB) )
+    {
+        OS_Schedule();
+    }
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+    /* The task may be running on other core */
+    OS_SmpKickRunningCore(TaskCB);
+#endif
+
+OS_API_TaskDelete_Exit:
+    OS_TASK_UNLOCK();
+
+    /* Off all of the lists, nobody else gets it, free it with the interrupts enabled */
+    if (!Deferred)
+    {
+        OS_TaskFree(TaskCB);
+    }
+
+    return Ret;
+}
+
+/*
+ * Delete Current itself, also called by arch when the task function
+ * returns. Only returns with error, see OS_API_TaskDelete.
+ */
+OS_Uint32_t OS_API_TaskExit(void)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+
+    OS_TASK_LOCK();
+
+    Ret = OS_API_TaskDelete((OS_Uintptr_t)CurrentTCB);
+
+    OS_TASK_UNLOCK();
+
+    return Ret;
+}
+
+/* Free the deleted tasks which were still in use when deleted */
+static void OS_IdleTaskCleanup(void)
+{
+    OS_TCB_t *TaskCB = OS_NULL;
+
+    while (1)
+    {
+        OS_TASK_LOCK();
+        TaskCB = OS_TerminatedTaskGet();
+        OS_TASK_UNLOCK();
+
+        if (TaskCB == OS_NULL)
+            break;
+
+        OS_TaskFree(TaskCB);
+    }
+}
+
 /*
  * Analysis Context:
  *------------------------------------------------
@@ -295,7 +551,7 @@ OS_API_TaskSuspend_Exit:
  * 3. Resume Other  -----|--Scheduler Suspending - [Allowed]--|--Check highest priority--
  *-----------------------|--In Thread -------------[Allowed]--|
  */
-OS_Uint32_t OS_API_TaskResume(OS_Uint32_t TaskHandle)
+OS_Uint32_t OS_API_TaskResume(OS_Uintptr_t TaskHandle)
 {
     OS_Uint32_t Ret = OS_SUCCESS;
     OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
@@ -351,7 +607,7 @@ OS_API_TaskResume_Exit:
  * 3. Task In Ready-|- Update Ready list
  *------------------|
  */
-OS_Uint32_t OS_API_TaskPrioritySet(OS_Uint32_t TaskHandle, OS_Uint8_t NewPriority)
+OS_Uint32_t OS_API_TaskPrioritySet(OS_Uintptr_t TaskHandle, OS_Uint8_t NewPriority)
 {
     OS_Uint32_t Ret = OS_SUCCESS;
     OS_Uint8_t  NeedReSch = 0;
@@ -362,7 +618,11 @@ OS_Uint32_t OS_API_TaskPrioritySet(OS_Uint32_t TaskHandle, OS_Uint8_t NewPriorit
         return OS_NULL_POINTER;
     }
 
+#if CONFIG_USE_MUTEX
+    if (NewPriority == TaskCB->BasePriority)
+#else
     if (NewPriority == TaskCB->Priority)
+#endif
     {
         return OS_SET_SAME_PRIO;
     }
@@ -376,6 +636,12 @@ OS_Uint32_t OS_API_TaskPrioritySet(OS_Uint32_t TaskHandle, OS_Uint8_t NewPriorit
 
     TARCE_TaskPrioritySet(TaskCB, CurrentTCB, NewPriority);
 
+#if CONFIG_USE_MUTEX
+    /* Set the base one, the task keeps the priority it inherits */
+    TaskCB->BasePriority = NewPriority;
+    NewPriority = OS_MutexEffectivePriority(TaskCB);
+#endif
+
     /* If set current priority */
     if (TaskCB == CurrentTCB)
     {
@@ -403,7 +669,12 @@ OS_Uint32_t OS_API_TaskPrioritySet(OS_Uint32_t TaskHandle, OS_Uint8_t NewPriorit
     }
 
     /* Because the priority of ready task stand head list, so update it */
+#if CONFIG_USE_MUTEX
+    /* Also passed on to the owner of the mutex it blocks on */
+    OS_MutexPriorityUpdate(TaskCB);
+#else
     OS_TaskChangePriority(TaskCB, NewPriority);
+#endif
 
     if (NeedReSch)
     {
@@ -415,7 +686,7 @@ OS_Uint32_t OS_API_TaskPrioritySet(OS_Uint32_t TaskHandle, OS_Uint8_t NewPriorit
     return Ret;
 }
 
-OS_Uint8_t OS_API_TaskPriorityGet(OS_Uint32_t TaskHandle)
+OS_Uint8_t OS_API_TaskPriorityGet(OS_Uintptr_t TaskHandle)
 {
     OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
     OS_Uint8_t Ret = 0;
@@ -427,9 +698,257 @@ OS_Uint8_t OS_API_TaskPriorityGet(OS_Uint32_t TaskHandle)
     return Ret;
 }
 
+/* Bytes from the lowest end of a stack which still hold the fill */
+static OS_Uint32_t OS_StackUntouched(OS_Uint8_t *StackBase, OS_Uint32_t StackSize)
+{
+    OS_Uint32_t Untouched = 0;
+
+    while ( (Untouched < StackSize) && (StackBase[Untouched] == OS_TASK_MAGIC_NUMBER) )
+    {
+        Untouched++;
+    }
+
+    return Untouched;
+}
+
+/*
+ * Peak bytes the task ever used of its stack, the stack grows down into
+ * the fill of OS_TASK_MAGIC_NUMBER, so the untouched fill is the headroom
+ */
+OS_Uint32_t OS_TaskStackUsage(OS_TCB_t *TaskCB, OS_Uint32_t *StackSize)
+{
+    OS_Uint8_t *StackBase = OS_NULL;
+
+    *StackSize = TaskCB->StackSize;
+    StackBase = (OS_Uint8_t *)ARCH_TaskStackRegion(TaskCB->Stack, TaskCB->StartOfStack, StackSize);
+
+    return *StackSize - OS_StackUntouched(StackBase, *StackSize);
+}
+
+OS_Uint32_t OS_API_TaskStackHighWater(OS_Uintptr_t TaskHandle)
+{
+    OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
+    OS_Uint32_t StackSize = 0;
+
+    if (TaskCB == OS_NULL)
+        return 0;
+
+    return OS_TaskStackUsage(TaskCB, &StackSize);
+}
+
+/* Peak bytes used of the stack interrupt handlers run on, 0 if they use task stacks */
+OS_Uint32_t OS_API_IsrStackHighWater(OS_Uint32_t *StackSize)
+{
+    OS_Uint8_t *StackBase = (OS_Uint8_t *)ARCH_IsrStackRegion(StackSize);
+
+    if (StackBase == OS_NULL)
+        return 0;
+
+    return *StackSize - OS_StackUntouched(StackBase, *StackSize);
+}
+
+#if CONFIG_USE_EDF
+/*
+ * Make the task periodic, its first period starts right now, and its
+ * deadline is RelativeDeadline ticks after the start of every period,
+ * 0 RelativeDeadline means the end of the period. The deadline only
+ * decides the order when the task runs at OS_EDF_TASK_PRIORITY.
+ */
+OS_Uint32_t OS_API_TaskEdfSet(OS_Uintptr_t TaskHandle, OS_Uint32_t Period, OS_Uint32_t RelativeDeadline)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
+
+    if (TaskCB == OS_NULL)
+    {
+        return OS_NULL_POINTER;
+    }
+
+    if (RelativeDeadline == 0)
+    {
+        RelativeDeadline = Period;
+    }
+
+    if ( (Period == 0) || (Period >= OS_TSK_DLY_MAX) || (RelativeDeadline > Period) )
+    {
+        return OS_TSK_EDF_PARAM_INVALID;
+    }
+
+    OS_TASK_LOCK();
+
+    TaskCB->Period = Period;
+    TaskCB->RelativeDeadline = RelativeDeadline;
+    TaskCB->Release = OS_GetCurrentTime();
+    TaskCB->Deadline = TaskCB->Release + RelativeDeadline;
+
+    /* Sort it again with the new deadline */
+    if ( (TaskCB->State == OS_TASK_READY) && (TaskCB->Priority == OS_EDF_TASK_PRIORITY) )
+    {
+        OS_RemoveTaskFromReadyList(TaskCB);
+        OS_AddTaskToReadyList(TaskCB);
+
+        /* No task to switch out before the kernel starts */
+        if (CurrentTCB != OS_NULL)
+        {
+            OS_Schedule();
+        }
+    }
+
+    OS_TASK_UNLOCK();
+
+    return Ret;
+}
+
+/*
+ * Analysis Context:
+ *-----------------------|--In ISR --------------- [Not Allowed]
+ * -- Wait Current  -----|--Scheduler Suspending - [Not Allowed]
+ *-----------------------|--In Thread ------------ [Allowed](Schedule right now)
+ *
+ * Finish the job of this period and sleep until the next period starts.
+ * OS_TSK_EDF_DEADLINE_MISSED is returned if the job finished after its
+ * deadline, the next period is still counted from the last one, so an
+ * overrun job runs again at once without sleep.
+ */
+OS_Uint32_t OS_API_TaskWaitNextPeriod(void)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Uint32_t CurrentTime = 0;
+    OS_TCB_t *TaskCB = OS_NULL;
+
+    OS_TASK_LOCK();
+
+    TaskCB = CurrentTCB;
+
+    if (ARCH_IsInterruptContext())
+    {
+        Ret = OS_TSK_DLY_IN_INTR_CONTEXT;
+        goto OS_API_TaskWaitNextPeriod_Exit;
+    }
+
+    if (OS_IsSchedulerSuspending())
+    {
+        Ret = OS_TSK_DLY_IN_SCH_SUSPEND;
+        goto OS_API_TaskWaitNextPeriod_Exit;
+    }
+
+    if (TaskCB->Period == 0)
+    {
+        Ret = OS_TSK_EDF_NOT_PERIODIC;
+        goto OS_API_TaskWaitNextPeriod_Exit;
+    }
+
+    CurrentTime = OS_GetCurrentTime();
+
+    if (OS_EDF_DEADLINE_BEFORE(TaskCB->Deadline, CurrentTime))
+    {
+        Ret = OS_TSK_EDF_DEADLINE_MISSED;
+    }
+
+    TaskCB->Release += TaskCB->Period;
+    TaskCB->Deadline = TaskCB->Release + TaskCB->RelativeDeadline;
+
+    if (OS_EDF_DEADLINE_BEFORE(CurrentTime, TaskCB->Release))
+    {
+        TaskCB->WakeUpTime = TaskCB->Release;
+
+        TRACE_TaskDelay(TaskCB, TaskCB->Release - CurrentTime);
+
+        OS_TaskReadyToDelay(TaskCB);
+    }
+    else
+    {
+        /* The next period has started, just sort with the new deadline */
+        OS_RemoveTaskFromReadyList(TaskCB);
+        OS_AddTaskToReadyList(TaskCB);
+    }
+
+    OS_Schedule();
+
+OS_API_TaskWaitNextPeriod_Exit:
+    OS_TASK_UNLOCK();
+
+    return Ret;
+}
+#endif // CONFIG_USE_EDF
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+/*
+ * Analysis Context:
+ *------------------------------------------------
+ * 1. Task not ready or ready on an allowed core -- [Only update the mask]
+ *------------------------------------------------
+ * 2. Task ready on a core not allowed now ------- [Move to an allowed core]
+ *------------------------------------------------
+ * 3. Task is running on that core --------------- [Also kick that core to switch it out]
+ *------------------------------------------------
+ */
+OS_Uint32_t OS_API_TaskAffinitySet(OS_Uintptr_t TaskHandle, OS_Uint32_t CoreMask)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
+
+    if (TaskCB == OS_NULL)
+    {
+        return OS_NULL_POINTER;
+    }
+
+    CoreMask &= OS_CORE_MASK_ALL;
+    if (CoreMask == 0)
+    {
+        return OS_TSK_AFFINITY_INVALID;
+    }
+
+    OS_TASK_LOCK();
+
+    TaskCB->Affinity = CoreMask;
+
+    if ( (TaskCB->State == OS_TASK_READY) &&
+         !(CoreMask & (0x01UL << TaskCB->Core)) )
+    {
+        OS_RemoveTaskFromReadyList(TaskCB);
+        OS_AddTaskToReadyList(TaskCB);
+
+        if (TaskCB == CurrentTCB)
+        {
+            OS_Schedule();
+        }
+
+        OS_SmpKickRunningCore(TaskCB);
+    }
+
+    OS_TASK_UNLOCK();
+
+    return Ret;
+}
+
+OS_Uint32_t OS_API_TaskAffinityGet(OS_Uintptr_t TaskHandle)
+{
+    OS_TCB_t *TaskCB = OS_TSK_HANDLE_TO_TCB(TaskHandle);
+    OS_Uint32_t Ret = 0;
+
+    OS_TASK_LOCK();
+    Ret = TaskCB->Affinity;
+    OS_TASK_UNLOCK();
+
+    return Ret;
+}
+#endif // CONFIG_CPU_CORE_NUM > 1
+
 void OS_IdleTask(void *Parameter)
 {
-    while (1);
+    while (1)
+    {
+        OS_IdleTaskCleanup();
+#if CONFIG_USE_TICKLESS_IDLE
+        OS_TicklessIdle();
+#endif
+#if (CONFIG_CPU_CORE_NUM > 1)
+        ARCH_WaitForInterrupt();
+#endif
+        /* Idle has no time slice, give way to the tasks of idle priority */
+        OS_API_TaskYield();
+    }
 }
 
 void OS_IdleTaskCreate(void)
@@ -444,14 +963,65 @@ void OS_IdleTaskCreate(void)
     Param.PrivateData = OS_NULL;
     Param.StackSize = CONFIG_IDLE_TASK_STACK_SIZE;
     Param.TaskEntry = OS_IdleTask;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+#if (CONFIG_CPU_CORE_NUM > 1)
+    {
+        OS_Uint8_t Core = 0;
+
+        /* Every core has its own idle task, so its ready list never be empty */
+        for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+        {
+            Param.Name[4] = '0' + Core;
+            Param.Name[5] = 0x00;
+            OS_API_TaskCreate(Param, &OS_IdleTaskHandle[Core]);
+            OS_API_TaskAffinitySet(OS_IdleTaskHandle[Core], 0x01UL << Core);
+        }
+    }
+#else
     OS_API_TaskCreate(Param, (void *)&OS_IdleTaskHandle);
+#endif
+}
+
+/* Check whether it is the idle task of any core */
+OS_Uint8_t OS_IsIdleTask(OS_TCB_t *TaskCB)
+{
+#if (CONFIG_CPU_CORE_NUM > 1)
+    OS_Uint8_t Core = 0;
+
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        if ((OS_TCB_t *)OS_IdleTaskHandle[Core] == TaskCB)
+            return 1;
+    }
+
+    return 0;
+#else
+    return ((OS_TCB_t *)OS_IdleTaskHandle == TaskCB);
+#endif
 }
 
 void OS_FirstTaskStartup(void)
 {
+#if CONFIG_USE_RUN_TIME_STATS
+    OS_RunTimeStatsStart();
+#endif
+
+#if (CONFIG_CPU_CORE_NUM > 1)
+    OS_Uint8_t Core = 0;
+
+    /* Find the highest priority task in ready list of every core */
+    for (Core = 0; Core < CONFIG_CPU_CORE_NUM; Core++)
+    {
+        CoreCurrentTCB[Core] = OS_CoreHighestPrioTaskGet(Core);
+    }
+
+    /* Start scheduler, arch brings up the other cores */
+    ARCH_StartScheduler((void *)CoreCurrentTCB[0]);
+#else
     /* Find the highest priority task in ready list */
     CurrentTCB = OS_HighestPrioTaskGet();
 
     /* Start scheduler */
     ARCH_StartScheduler((void *)CurrentTCB);
+#endif
 }
@@ -47,6 +47,15 @@ void OS_IncrementTime(void)
     OS_CurrentTime++;
 }
 
+/* 
+ * Step kernel timestamp over the ticks suppressed by tickless idle
+ * Note : This should be protected with lock
+ */
+void OS_StepTime(OS_Uint32_t Ticks)
+{
+    OS_CurrentTime += Ticks;
+}
+
 /* 
  * Get current kernel timestamp
  * Note : This should be protected with lock
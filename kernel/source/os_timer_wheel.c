@@ -0,0 +1,196 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#include "os_list.h"
+#include "os_task.h"
+#include "os_types.h"
+#include "os_configs.h"
+#include "os_timer_wheel.h"
+
+/*
+ * A task waiting for time T is linked in level L, where L is the lowest
+ * level above which T and the wheel time are the same. So the tasks in
+ * level 0 expire in the current round of level 0, and the tasks in a slot
+ * of level L are cascaded to the lower levels when the wheel time reaches
+ * the start of that slot. Insert and remove are O(1), every tick only
+ * touches the current slot of level 0 and the slots being cascaded.
+ *
+ * All of the functions should be protected with lock.
+ */
+#define OS_TIMER_WHEEL_LEVEL_SHIFT(Level)       ((Level) * OS_TIMER_WHEEL_SLOT_BITS)
+#define OS_TIMER_WHEEL_INDEX(Time, Level)       (((Time) >> OS_TIMER_WHEEL_LEVEL_SHIFT(Level)) & OS_TIMER_WHEEL_SLOT_MASK)
+
+void OS_TimerWheelInit(OS_TimerWheel_t *Wheel, OS_Uint32_t Time)
+{
+    OS_Uint32_t Level = 0;
+    OS_Uint32_t Index = 0;
+
+    for (Level = 0; Level < OS_TIMER_WHEEL_LEVELS; Level++)
+    {
+        for (Index = 0; Index < OS_TIMER_WHEEL_SLOTS; Index++)
+        {
+            ListHeadInit(&Wheel->Slot[Level][Index]);
+        }
+    }
+
+    Wheel->Time = Time;
+    Wheel->Count = 0;
+}
+
+/* The tasks should have been timeout are linked to expire at Earliest */
+static OS_Uint32_t OS_TimerWheelExpires(OS_TCB_t *TaskCB, OS_Uint32_t Earliest)
+{
+    if ((OS_Int32_t)(TaskCB->WakeUpTime - Earliest) < 0)
+        return Earliest;
+
+    return TaskCB->WakeUpTime;
+}
+
+static void OS_TimerWheelLink(OS_TimerWheel_t *Wheel, OS_TCB_t *TaskCB, OS_Uint32_t Expires)
+{
+    OS_Uint32_t Diff = Expires ^ Wheel->Time;
+    OS_Uint32_t Level = 0;
+
+    /* Find the lowest level above which the expires is the same as now */
+    for (Level = 0; Level < OS_TIMER_WHEEL_LEVELS - 1; Level++)
+    {
+        if ((Diff >> OS_TIMER_WHEEL_LEVEL_SHIFT(Level + 1)) == 0)
+            break;
+    }
+
+    ListAddTail(&TaskCB->StateList, &Wheel->Slot[Level][OS_TIMER_WHEEL_INDEX(Expires, Level)]);
+    Wheel->Count++;
+}
+
+void OS_TimerWheelAdd(OS_TimerWheel_t *Wheel, OS_TCB_t *TaskCB)
+{
+    /* The current tick has been checked already, expire at the next one */
+    OS_TimerWheelLink(Wheel, TaskCB, OS_TimerWheelExpires(TaskCB, Wheel->Time + 1));
+}
+
+void OS_TimerWheelDel(OS_TimerWheel_t *Wheel, OS_TCB_t *TaskCB)
+{
+    ListDel(&TaskCB->StateList);
+    Wheel->Count--;
+}
+
+static void OS_TimerWheelCascade(OS_TimerWheel_t *Wheel, OS_Uint32_t Level)
+{
+    ListHead_t *SlotHead = &Wheel->Slot[Level][OS_TIMER_WHEEL_INDEX(Wheel->Time, Level)];
+    OS_TCB_t   *TaskCB   = OS_NULL;
+
+    while (!ListEmpty(SlotHead))
+    {
+        TaskCB = ListFirstEntry(SlotHead, OS_TCB_t, StateList);
+        OS_TimerWheelDel(Wheel, TaskCB);
+        /* Lands in a lower level now, maybe the slot of level 0 expiring right now */
+        OS_TimerWheelLink(Wheel, TaskCB, OS_TimerWheelExpires(TaskCB, Wheel->Time));
+    }
+}
+
+/*
+ * Step the wheel tick by tick to Time, the tasks expired are passed to Expire.
+ * The steps with nothing in the wheel are skipped at once (tickless idle)
+ */
+void OS_TimerWheelAdvance(OS_TimerWheel_t *Wheel, OS_Uint32_t Time, OS_TimerWheelExpire_t Expire)
+{
+    OS_Uint32_t Level = 0;
+    OS_Uint32_t TopLevel = 0;
+    ListHead_t *SlotHead = OS_NULL;
+
+    while ((OS_Int32_t)(Time - Wheel->Time) > 0)
+    {
+        if (Wheel->Count == 0)
+        {
+            Wheel->Time = Time;
+            break;
+        }
+
+        Wheel->Time++;
+
+        /* The highest level whose slot starts right now */
+        TopLevel = 0;
+        for (Level = 1; Level < OS_TIMER_WHEEL_LEVELS; Level++)
+        {
+            if (Wheel->Time & ((1UL << OS_TIMER_WHEEL_LEVEL_SHIFT(Level)) - 1))
+                break;
+            TopLevel = Level;
+        }
+
+        /* Higher level first, its tasks may go on cascading in the lower one */
+        for (Level = TopLevel; Level > 0; Level--)
+        {
+            OS_TimerWheelCascade(Wheel, Level);
+        }
+
+        SlotHead = &Wheel->Slot[0][OS_TIMER_WHEEL_INDEX(Wheel->Time, 0)];
+        while (!ListEmpty(SlotHead))
+        {
+            Expire(ListFirstEntry(SlotHead, OS_TCB_t, StateList));
+        }
+    }
+}
+
+/*
+ * Get the earliest expires in the wheel, return 0 if the wheel is empty.
+ * Every level only holds the tasks later than all of the lower levels,
+ * so the first slot not empty from the lowest level holds the earliest.
+ */
+OS_Uint8_t OS_TimerWheelNextExpiry(OS_TimerWheel_t *Wheel, OS_Uint32_t *Expires)
+{
+    OS_Uint32_t Level = 0;
+    OS_Uint32_t Step  = 0;
+    OS_Uint32_t Delta = 0;
+    OS_Uint32_t MinDelta = 0;
+    ListHead_t *SlotHead = OS_NULL;
+    ListHead_t *ListIterator = OS_NULL;
+    OS_TCB_t   *TCB_Iterator = OS_NULL;
+
+    if (Wheel->Count == 0)
+        return 0;
+
+    for (Level = 0; Level < OS_TIMER_WHEEL_LEVELS; Level++)
+    {
+        for (Step = 1; Step <= OS_TIMER_WHEEL_SLOTS; Step++)
+        {
+            SlotHead = &Wheel->Slot[Level][(OS_TIMER_WHEEL_INDEX(Wheel->Time, Level) + Step) & OS_TIMER_WHEEL_SLOT_MASK];
+            if (ListEmpty(SlotHead))
+                continue;
+
+            MinDelta = OS_UINT32_MAX;
+            ListForEach(ListIterator, SlotHead)
+            {
+                TCB_Iterator = ListEntry(ListIterator, OS_TCB_t, StateList);
+                Delta = OS_TimerWheelExpires(TCB_Iterator, Wheel->Time + 1) - Wheel->Time;
+                if (Delta < MinDelta)
+                    MinDelta = Delta;
+            }
+
+            *Expires = Wheel->Time + MinDelta;
+            return 1;
+        }
+    }
+
+    return 0;
+}
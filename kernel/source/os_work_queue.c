@@ -0,0 +1,429 @@
+/*
+ * MxOS Kernel V0.1
+ * Copyright (C) 2020 StephenZhou.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ */
+#include "arch.h"
+#include "os_lib.h"
+#include "os_task.h"
+#include "os_time.h"
+#include "os_list.h"
+#include "os_trace.h"
+#include "os_critical.h"
+#include "os_configs.h"
+#include "os_scheduler.h"
+#include "os_work_queue.h"
+#include "os_error_code.h"
+
+#if CONFIG_USE_WORK_QUEUE
+
+#define OS_WORK_QUEUE_LOCK()                        OS_API_EnterCritical()
+#define OS_WORK_QUEUE_UNLOCK()                      OS_API_ExitCritical()
+
+OS_WorkQueue_t OS_WorkQueuePool[CONFIG_MAX_WORK_QUEUE_DEFINE];
+
+#define OS_WORK_QUEUE_CHECK_HANDLE_VALID(HANDLE)    \
+{                                                   \
+    if (HANDLE >= CONFIG_MAX_WORK_QUEUE_DEFINE)     \
+    {                                               \
+        return OS_WORK_QUEUE_HANDLE_INVALID;        \
+    }                                               \
+}
+
+#define OS_WORK_QUEUE_CHECK_BEEN_CREATED(HANDLE)    \
+{                                                   \
+    if (OS_WorkQueuePool[HANDLE].Used != OS_WORK_QUEUE_USED) \
+    {                                               \
+        return OS_WORK_QUEUE_NOT_BEEN_CREATED;      \
+    }                                               \
+}
+
+#define OS_WORK_QUEUE_HANDLE_TO_POINTER(HANDLE)     &OS_WorkQueuePool[HANDLE]
+
+extern void OS_TaskReadyToBlock(OS_TCB_t * TaskCB, ListHead_t *SleepHead, OS_Uint8_t BlockType, OS_Uint8_t SortType);
+extern void OS_Schedule(void);
+extern void OS_TaskBlockToReady(OS_TCB_t * TaskCB);
+extern void OS_TaskWokenFromISR(OS_TCB_t * TaskCB, OS_Uint8_t *HigherPriorityTaskWoken);
+
+void OS_WorkQueueInit(void)
+{
+    OS_Uint32_t i = 0;
+
+    for (i = 0; i < CONFIG_MAX_WORK_QUEUE_DEFINE; i++)
+    {
+        OS_WorkQueuePool[i].WorkerNr = 0;
+        OS_WorkQueuePool[i].Used = OS_WORK_QUEUE_UNUSED;
+        ListHeadInit(&OS_WorkQueuePool[i].PendingList);
+        ListHeadInit(&OS_WorkQueuePool[i].DelayedList);
+        ListHeadInit(&OS_WorkQueuePool[i].SleepList);
+    }
+}
+
+/* Move the delayed works due by now to the tail of the pending list */
+static void OS_WorkQueueExpire(OS_WorkQueue_t *Queue, OS_Uint32_t CurrentTime)
+{
+    OS_Work_t *Work = OS_NULL;
+
+    while (!ListEmpty(&Queue->DelayedList))
+    {
+        Work = ListFirstEntry(&Queue->DelayedList, OS_Work_t, List);
+        if (!OS_TIME_AFTER_EQ(CurrentTime, Work->WakeUpTime))
+            break;
+
+        ListDel(&Work->List);
+        ListAddTail(&Work->List, &Queue->PendingList);
+        Work->State = OS_WORK_PENDING;
+    }
+}
+
+/* Pick an idle worker to run the works, NULL if all of them are running */
+static OS_TCB_t * OS_WorkerWakeup(OS_WorkQueue_t *Queue)
+{
+    OS_TCB_t *TaskCB = OS_NULL;
+
+    if (ListEmpty(&Queue->SleepList))
+        return OS_NULL;
+
+    // Pick the last one of sleep list because we use FIFO algorithm
+    TaskCB = ListEntry(PickListLast(&Queue->SleepList), OS_TCB_t, IpcSleepList);
+
+    OS_TaskBlockToReady(TaskCB);
+
+    return TaskCB;
+}
+
+/*
+ * The body of every worker, it runs all of the pending works in a row, then
+ * sleeps until a submit or until the earliest delayed work is due.
+ */
+static void OS_WorkerEntry(void *PrivateData)
+{
+    OS_WorkQueue_t *Queue = (OS_WorkQueue_t *)PrivateData;
+    OS_Work_t *Work = OS_NULL;
+    OS_WorkFunction_t Func = OS_NULL;
+    void *Arg = OS_NULL;
+    OS_TCB_t *TaskCB = OS_NULL;
+
+    while (1)
+    {
+        OS_WORK_QUEUE_LOCK();
+
+        OS_WorkQueueExpire(Queue, OS_GetCurrentTime());
+
+        if (!ListEmpty(&Queue->PendingList))
+        {
+            Work = ListFirstEntry(&Queue->PendingList, OS_Work_t, List);
+            ListDel(&Work->List);
+            /* Idle before it runs, so it can submit itself again */
+            Work->State = OS_WORK_IDLE;
+            Func = Work->Func;
+            Arg = Work->Arg;
+
+            /* Works left behind go to an idle worker, in case this one blocks */
+            if (!ListEmpty(&Queue->PendingList))
+            {
+                OS_WorkerWakeup(Queue);
+            }
+
+            TRACE_WorkRun(Queue, Work);
+
+            OS_WORK_QUEUE_UNLOCK();
+
+            Func(Arg);
+            continue;
+        }
+
+        TaskCB = CurrentTCB;
+        TaskCB->IpcTimeoutWakeup = OS_IPC_NO_TIMEOUT;
+
+        if (ListEmpty(&Queue->DelayedList))
+        {
+            OS_TaskReadyToBlock(TaskCB, &Queue->SleepList, OS_BLOCK_TYPE_ENDLESS, OS_BLOCK_SORT_FIFO);
+        }
+        else
+        {
+            Work = ListFirstEntry(&Queue->DelayedList, OS_Work_t, List);
+            TaskCB->WakeUpTime = Work->WakeUpTime;
+            OS_TaskReadyToBlock(TaskCB, &Queue->SleepList, OS_BLOCK_TYPE_TIMEOUT, OS_BLOCK_SORT_FIFO);
+        }
+
+        OS_Schedule();
+
+        OS_WORK_QUEUE_UNLOCK();
+    }
+}
+
+/*
+ * Create a queue served by WorkerNr tasks of Priority, every one with a
+ * stack of StackSize. More workers let the works of the queue block
+ * without holding up the others.
+ */
+OS_Uint32_t OS_API_WorkQueueCreate(OS_Uint32_t *QueueHandle, OS_Uint8_t Priority,
+                                   OS_Uint8_t WorkerNr, OS_Uint32_t StackSize)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_Uint32_t i = 0;
+    OS_WorkQueue_t *Queue = OS_NULL;
+    TaskInitParameter Param;
+
+    OS_CHECK_NULL_POINTER(QueueHandle);
+
+    if ( (WorkerNr == 0) || (WorkerNr > CONFIG_WORK_QUEUE_MAX_WORKERS) )
+    {
+        return OS_WORK_QUEUE_INVALID_WORKERS;
+    }
+
+    OS_WORK_QUEUE_LOCK();
+
+    for (i = 0; i < CONFIG_MAX_WORK_QUEUE_DEFINE; i++)
+    {
+        if (OS_WorkQueuePool[i].Used == OS_WORK_QUEUE_UNUSED)
+            break;
+    }
+
+    if (i == CONFIG_MAX_WORK_QUEUE_DEFINE)
+    {
+        OS_WORK_QUEUE_UNLOCK();
+        return OS_NOT_ENOUGH_WORK_QUEUE_RESOURCE;
+    }
+
+    *QueueHandle = i;
+    Queue = OS_WORK_QUEUE_HANDLE_TO_POINTER(i);
+    Queue->Used = OS_WORK_QUEUE_CREATING;
+
+    OS_WORK_QUEUE_UNLOCK();
+
+    /* The slot is ours, create the workers with the interrupts enabled, named "WQ<queue><worker>" */
+    OS_Memset(Param.Name, 0x00, CONFIG_TASK_NAME_LEN);
+    Param.Name[0] = 'W';
+    Param.Name[1] = 'Q';
+    Param.Name[2] = '0' + *QueueHandle;
+    Param.Priority = Priority;
+    Param.PrivateData = (void *)Queue;
+    Param.StackSize = StackSize;
+    Param.TaskEntry = OS_WorkerEntry;
+    Param.TimeSlice = OS_TASK_NO_TIME_SLICE;
+
+    for (i = 0; i < WorkerNr; i++)
+    {
+        Param.Name[3] = '0' + i;
+
+        Ret = OS_API_TaskCreate(Param, &Queue->Workers[i]);
+        if (Ret != OS_SUCCESS)
+            break;
+    }
+
+    /* Take back the workers created if any of them fails */
+    if (Ret != OS_SUCCESS)
+    {
+        while (i > 0)
+        {
+            i--;
+            OS_API_TaskDelete(Queue->Workers[i]);
+        }
+
+        OS_WORK_QUEUE_LOCK();
+        Queue->Used = OS_WORK_QUEUE_UNUSED;
+        OS_WORK_QUEUE_UNLOCK();
+
+        return Ret;
+    }
+
+    OS_WORK_QUEUE_LOCK();
+
+    Queue->WorkerNr = WorkerNr;
+    Queue->Used = OS_WORK_QUEUE_USED;
+
+    TRACE_WorkQueueCreate(QueueHandle, Priority, WorkerNr);
+
+    OS_WORK_QUEUE_UNLOCK();
+
+    return Ret;
+}
+
+/* A work on stack or heap should be initialized once before the first submit */
+void OS_API_WorkInit(OS_Work_t *Work)
+{
+    Work->Func = OS_NULL;
+    Work->Arg = OS_NULL;
+    Work->WakeUpTime = 0;
+    Work->State = OS_WORK_IDLE;
+}
+
+/*
+ * Link the work into the queue, Delay 0 means pending at once. Return the
+ * worker woken up in Woken, only the first pending work wakes up a worker,
+ * which wakes up the next idle one for the works behind before it runs it.
+ */
+static OS_Uint32_t OS_WorkEnqueue(OS_WorkQueue_t *Queue, OS_Work_t *Work, OS_WorkFunction_t Func,
+                                  void *Arg, OS_Uint32_t Delay, OS_TCB_t **Woken)
+{
+    ListHead_t *ListIterator = OS_NULL;
+    OS_Work_t *WorkIterator = OS_NULL;
+
+    *Woken = OS_NULL;
+
+    if (Work->State != OS_WORK_IDLE)
+    {
+        return OS_WORK_ALREADY_PENDING;
+    }
+
+    Work->Func = Func;
+    Work->Arg = Arg;
+
+    TRACE_WorkSubmit(Queue, Work, Delay);
+
+    if (Delay == 0)
+    {
+        Work->State = OS_WORK_PENDING;
+
+        /* The worker woken for the works in front runs this one as well */
+        if (ListEmpty(&Queue->PendingList))
+        {
+            *Woken = OS_WorkerWakeup(Queue);
+        }
+
+        ListAddTail(&Work->List, &Queue->PendingList);
+
+        return OS_SUCCESS;
+    }
+
+    Work->State = OS_WORK_DELAYED;
+    Work->WakeUpTime = OS_GetCurrentTime() + Delay;
+
+    ListForEach(ListIterator, &Queue->DelayedList)
+    {
+        WorkIterator = ListEntry(ListIterator, OS_Work_t, List);
+        if (OS_TIME_BEFORE(Work->WakeUpTime, WorkIterator->WakeUpTime))
+            break;
+    }
+
+    /* Insert before the first later one, or at the tail */
+    ListAddTail(&Work->List, ListIterator);
+
+    /* A new earliest one, let an idle worker sleep again until it is due */
+    if (ListIsFirst(&Work->List, &Queue->DelayedList))
+    {
+        *Woken = OS_WorkerWakeup(Queue);
+    }
+
+    return OS_SUCCESS;
+}
+
+static OS_Uint32_t OS_WorkSubmit(OS_Uint32_t QueueHandle, OS_Work_t *Work, OS_WorkFunction_t Func,
+                                 void *Arg, OS_Uint32_t Delay)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_TCB_t *Woken = OS_NULL;
+
+    OS_WORK_QUEUE_CHECK_HANDLE_VALID(QueueHandle);
+    OS_WORK_QUEUE_CHECK_BEEN_CREATED(QueueHandle);
+    OS_CHECK_NULL_POINTER(Work);
+    OS_CHECK_NULL_POINTER(Func);
+
+    OS_WORK_QUEUE_LOCK();
+
+    Ret = OS_WorkEnqueue(OS_WORK_QUEUE_HANDLE_TO_POINTER(QueueHandle), Work, Func, Arg, Delay, &Woken);
+
+    if (Woken != OS_NULL)
+    {
+        OS_Schedule();
+    }
+
+    OS_WORK_QUEUE_UNLOCK();
+
+    return Ret;
+}
+
+OS_Uint32_t OS_API_WorkSubmit(OS_Uint32_t QueueHandle, OS_Work_t *Work,
+                              OS_WorkFunction_t Func, void *Arg)
+{
+    return OS_WorkSubmit(QueueHandle, Work, Func, Arg, 0);
+}
+
+OS_Uint32_t OS_API_WorkSubmitDelayed(OS_Uint32_t QueueHandle, OS_Work_t *Work,
+                                     OS_WorkFunction_t Func, void *Arg, OS_Uint32_t Delay)
+{
+    if (Delay >= OS_TSK_DLY_MAX)
+    {
+        return OS_WORK_INVALID_DELAY;
+    }
+
+    return OS_WorkSubmit(QueueHandle, Work, Func, Arg, Delay);
+}
+
+/*
+ * Submit in interrupt handler, never schedule, the caller should use
+ * OS_API_YieldFromISR with the woken flag before return.
+ */
+OS_Uint32_t OS_API_WorkSubmitFromISR(OS_Uint32_t QueueHandle, OS_Work_t *Work,
+                                     OS_WorkFunction_t Func, void *Arg,
+                                     OS_Uint8_t *HigherPriorityTaskWoken)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+    OS_TCB_t *Woken = OS_NULL;
+
+    OS_WORK_QUEUE_CHECK_HANDLE_VALID(QueueHandle);
+    OS_WORK_QUEUE_CHECK_BEEN_CREATED(QueueHandle);
+    OS_CHECK_NULL_POINTER(Work);
+    OS_CHECK_NULL_POINTER(Func);
+
+    OS_WORK_QUEUE_LOCK();
+
+    Ret = OS_WorkEnqueue(OS_WORK_QUEUE_HANDLE_TO_POINTER(QueueHandle), Work, Func, Arg, 0, &Woken);
+
+    if (Woken != OS_NULL)
+    {
+        OS_TaskWokenFromISR(Woken, HigherPriorityTaskWoken);
+    }
+
+    OS_WORK_QUEUE_UNLOCK();
+
+    return Ret;
+}
+
+/* Take a pending or delayed work out of its queue, a running one is not stopped */
+OS_Uint32_t OS_API_WorkCancel(OS_Work_t *Work)
+{
+    OS_Uint32_t Ret = OS_SUCCESS;
+
+    OS_CHECK_NULL_POINTER(Work);
+
+    OS_WORK_QUEUE_LOCK();
+
+    if (Work->State == OS_WORK_IDLE)
+    {
+        Ret = OS_WORK_NOT_PENDING;
+        goto OS_API_WorkCancel_Exit;
+    }
+
+    ListDel(&Work->List);
+    Work->State = OS_WORK_IDLE;
+
+    TRACE_WorkCancel(Work);
+
+OS_API_WorkCancel_Exit:
+    OS_WORK_QUEUE_UNLOCK();
+
+    return Ret;
+}
+
+#endif // CONFIG_USE_WORK_QUEUE